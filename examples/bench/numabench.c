@@ -0,0 +1,150 @@
+/*
+ * Compare lookups in a single shared index with lookups in per-node
+ * replicas (see dc_index_replicate).
+ *
+ * The time taken is a proxy for the traffic between NUMA nodes; to count it
+ * directly, run this under:
+ *
+ *   perf stat -e node-loads,node-load-misses numabench Packages
+ */
+
+#include <debctrl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct bench
+{
+  const dcIndex *index;
+  int local;
+  unsigned long rounds;
+  size_t *found; /* one slot per worker, so they do not share a counter */
+};
+
+static void lookup(size_t item, void *arg)
+{
+  struct bench *bench = arg;
+  const dcIndex *index = bench->index;
+  unsigned long round;
+  size_t found = 0;
+  size_t iter;
+  size_t i;
+
+  if (bench->local)
+    index = dc_index_local(index);
+
+  for (round = 0; round < bench->rounds; round++)
+  {
+    for (i = 0; i < index->count; i++)
+    {
+      if (index->names[i] == NULL)
+        continue;
+
+      iter = 0;
+      while (dc_index_find(index, index->names[i], &iter) != NULL)
+        found++;
+      iter = 0;
+      while (dc_index_rdepends(index, index->names[i], &iter) != NULL)
+        found++;
+    }
+  }
+
+  /* keep the lookups from being optimized away */
+  bench->found[item] += found;
+}
+
+static double run(struct bench *bench, unsigned int threads)
+{
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  dc_parallel_run(threads, threads, &lookup, bench);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  return (end.tv_sec - start.tv_sec) +
+    (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+  struct bench bench;
+  unsigned int threads;
+  dcParser *parser;
+  dcIndex *index;
+  double shared, local;
+  double lookups;
+  size_t found = 0;
+  unsigned int i;
+
+  if (argc < 2)
+  {
+    printf("Usage: numabench <Packages file> [threads] [rounds]\n");
+    return 0;
+  }
+
+  threads = (argc > 2) ? (unsigned int) atoi(argv[2]) : 0;
+  if (threads == 0)
+    threads = dc_parallel_threads();
+
+  parser = dc_parser_new();
+  if (dc_parser_read_file(parser, argv[1]) != dcNoErr)
+  {
+    fprintf(stderr, "numabench: cannot parse %s\n", argv[1]);
+    dc_parser_free(&parser);
+    return 1;
+  }
+
+  index = dc_index_new();
+  if (dc_index_add(index, parser) != dcNoErr)
+  {
+    fprintf(stderr, "numabench: cannot index %s\n", argv[1]);
+    dc_index_free(&index);
+    dc_parser_free(&parser);
+    return 1;
+  }
+
+  bench.index = index;
+  bench.rounds = (argc > 3) ? strtoul(argv[3], NULL, 10) : 10;
+  bench.found = calloc(threads, sizeof(size_t));
+  if (bench.found == NULL)
+  {
+    fprintf(stderr, "numabench: out of memory\n");
+    dc_index_free(&index);
+    dc_parser_free(&parser);
+    return 1;
+  }
+
+  bench.local = 0;
+  shared = run(&bench, threads);
+
+  if (dc_index_replicate(index) != dcNoErr)
+  {
+    fprintf(stderr, "numabench: cannot replicate the index\n");
+    free(bench.found);
+    dc_index_free(&index);
+    dc_parser_free(&parser);
+    return 1;
+  }
+
+  bench.local = 1;
+  local = run(&bench, threads);
+
+  for (i = 0; i < threads; i++)
+    found += bench.found[i];
+  free(bench.found);
+
+  lookups = 2.0 * index->count * bench.rounds * threads;
+  printf("Nodes:           %u\n", dc_parallel_nodes());
+  printf("Threads:         %u\n", threads);
+  printf("Paragraphs:      %lu\n", (unsigned long) index->count);
+  printf("Results:         %lu\n", (unsigned long) found);
+  printf("Shared index:    %.3f s (%.1f ns per lookup)\n", shared,
+    shared * 1e9 / lookups * threads);
+  printf("Per-node copies: %.3f s (%.1f ns per lookup)\n", local,
+    local * 1e9 / lookups * threads);
+
+  dc_index_free(&index);
+  dc_parser_free(&parser);
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include <debctrl.h>
+#include <stdio.h>
+#include <string.h>
+
+static int query_frozen(int argc, char *argv[])
+{
+  dcFrozenIndex *frozen;
+  const char *text;
+  size_t paragraph;
+  size_t iter = 0;
+  size_t len;
+
+  if (argc < 4 || (strcmp(argv[2], "filter") == 0 && argc < 5))
+    return 1;
+
+  frozen = dc_frozen_open(argv[1]);
+  if (frozen == NULL)
+  {
+    fprintf(stderr, "dcquery: cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  for (;;)
+  {
+    if (strcmp(argv[2], "package") == 0)
+      paragraph = dc_frozen_find(frozen, argv[3], &iter);
+    else if (strcmp(argv[2], "rdepends") == 0)
+      paragraph = dc_frozen_rdepends(frozen, argv[3], &iter);
+    else
+      paragraph = dc_frozen_filter(frozen, argv[3], argv[4], &iter);
+
+    if (paragraph == FROZEN_NONE)
+      break;
+
+    text = dc_frozen_text(frozen, paragraph, &len);
+    fwrite(text, 1, len, stdout);
+    fputc('\n', stdout);
+  }
+
+  dc_frozen_close(&frozen);
+
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  dcQueryClient *client;
+  dcParser *result;
+  dcString *buf;
+  dcStatus rc;
+
+  if (argc < 4 || (strcmp(argv[2], "filter") == 0 && argc < 5))
+  {
+    printf("Usage: dcquery <socket> package <name>\n");
+    printf("       dcquery <socket> rdepends <name>\n");
+    printf("       dcquery <socket> filter <field> <value>\n");
+    printf("Use -f <image> instead of <socket> to query a frozen image.\n");
+    return 0;
+  }
+
+  if (strcmp(argv[1], "-f") == 0)
+    return query_frozen(argc - 1, argv + 1);
+
+  client = dc_query_connect(argv[1]);
+  if (client == NULL)
+  {
+    fprintf(stderr, "dcquery: cannot connect to %s\n", argv[1]);
+    return 1;
+  }
+
+  if (strcmp(argv[2], "package") == 0)
+    rc = dc_query_package(client, argv[3], &result);
+  else if (strcmp(argv[2], "rdepends") == 0)
+    rc = dc_query_rdepends(client, argv[3], &result);
+  else
+    rc = dc_query_filter(client, argv[3], argv[4], &result);
+
+  dc_query_close(&client);
+
+  if (rc != dcNoErr)
+  {
+    fprintf(stderr, "dcquery: query failed (error %d)\n", rc);
+    return 1;
+  }
+
+  buf = dc_string_new(0);
+  dc_parser_write(result, buf);
+  fputs(buf->text, stdout);
+
+  dc_string_free(&buf);
+  dc_parser_free(&result);
+
+  return 0;
+}
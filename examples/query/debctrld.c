@@ -0,0 +1,115 @@
+#include <debctrl.h>
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+
+static volatile int stop = 0;
+
+static void handle_signal(int sig)
+{
+  (void) sig;
+  stop = 1;
+}
+
+static void handle_signals(void)
+{
+  struct sigaction action;
+
+  /* no SA_RESTART, so that a signal interrupts the server */
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_signal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+}
+
+/* serve a frozen image, shared with any other process mapping it */
+static int serve_frozen(const char *path, const char *image)
+{
+  dcFrozenIndex *frozen;
+  dcStatus rc;
+
+  frozen = dc_frozen_open(image);
+  if (frozen == NULL)
+  {
+    fprintf(stderr, "debctrld: cannot open %s\n", image);
+    return 1;
+  }
+
+  fprintf(stderr, "debctrld: serving %lu paragraphs from %s on %s\n",
+    (unsigned long) frozen->count, image, path);
+
+  handle_signals();
+  rc = dc_query_serve_frozen(frozen, path, &stop);
+  if (rc != dcNoErr)
+    fprintf(stderr, "debctrld: cannot serve on %s (error %d)\n", path, rc);
+
+  dc_frozen_close(&frozen);
+
+  return (rc == dcNoErr) ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+  dcParser *parser;
+  dcIndex *index;
+  dcStatus rc;
+  int i;
+
+  if (argc < 3 || (strcmp(argv[1], "-f") == 0 && argc < 4))
+  {
+    printf("Usage: debctrld <socket> <Packages file>...\n");
+    printf("       debctrld -f <image> <Packages file>...\n");
+    printf("       debctrld -m <socket> <image>\n");
+    return 0;
+  }
+
+  if (strcmp(argv[1], "-m") == 0)
+  {
+    if (argc != 4)
+      return 1;
+    return serve_frozen(argv[2], argv[3]);
+  }
+
+  index = dc_index_new();
+  if (index == NULL)
+    return 1;
+
+  for (i = (strcmp(argv[1], "-f") == 0) ? 3 : 2; i < argc; i++)
+  {
+    parser = dc_parser_new();
+    rc = dc_parser_read_file(parser, argv[i]);
+    if (rc == dcNoErr)
+      rc = dc_index_add(index, parser);
+    dc_parser_free(&parser);
+
+    if (rc != dcNoErr)
+    {
+      fprintf(stderr, "debctrld: cannot load %s (error %d)\n", argv[i], rc);
+      dc_index_free(&index);
+      return 1;
+    }
+  }
+
+  /* write a frozen image for other processes to map, instead of serving */
+  if (strcmp(argv[1], "-f") == 0)
+  {
+    rc = dc_index_freeze(index, argv[2]);
+    if (rc != dcNoErr)
+      fprintf(stderr, "debctrld: cannot write %s (error %d)\n", argv[2], rc);
+
+    dc_index_free(&index);
+    return (rc == dcNoErr) ? 0 : 1;
+  }
+
+  fprintf(stderr, "debctrld: serving %lu paragraphs on %s\n",
+    (unsigned long) index->count, argv[1]);
+
+  handle_signals();
+  rc = dc_query_serve(index, argv[1], &stop);
+  if (rc != dcNoErr)
+    fprintf(stderr, "debctrld: cannot serve on %s (error %d)\n", argv[1], rc);
+
+  dc_index_free(&index);
+
+  return (rc == dcNoErr) ? 0 : 1;
+}
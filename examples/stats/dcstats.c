@@ -0,0 +1,82 @@
+/*
+ * Report the distributions of line, field and paragraph sizes over a set
+ * of control files, to help choose the defaults in debctrl/defaults.h.
+ */
+
+#include <debctrl.h>
+#include <stdio.h>
+
+static void histogram(const char *title, const size_t *counts, size_t total)
+{
+  size_t seen = 0;
+  unsigned int i;
+
+  printf("%s (%lu)\n", title, (unsigned long) total);
+  if (total == 0)
+  {
+    printf("\n");
+    return;
+  }
+
+  for (i = 0; i < STATS_BUCKETS; i++)
+  {
+    if (counts[i] == 0)
+      continue;
+
+    seen += counts[i];
+    printf("  %10lu - %-10lu %10lu %6.2f%% %7.2f%%\n",
+      (i == 0) ? 0UL : 1UL << i, (1UL << (i + 1)) - 1,
+      (unsigned long) counts[i], 100.0 * counts[i] / total,
+      100.0 * seen / total);
+  }
+
+  printf("  median < %lu, 90%% < %lu, 99%% < %lu\n\n",
+    (unsigned long) dc_parser_stats_quantile(counts, 50),
+    (unsigned long) dc_parser_stats_quantile(counts, 90),
+    (unsigned long) dc_parser_stats_quantile(counts, 99));
+}
+
+int main(int argc, char *argv[])
+{
+  dcParserStats *stats;
+  dcParser *parser;
+  int failed = 0;
+  int i;
+
+  if (argc < 2)
+  {
+    printf("Usage: dcstats <file> [<file> ...]\n");
+    return 0;
+  }
+
+  stats = dc_parser_stats_new();
+  if (stats == NULL)
+    return 1;
+
+  for (i = 1; i < argc; i++)
+  {
+    parser = dc_parser_new();
+    if (parser == NULL)
+      return 1;
+
+    parser->stats = stats;
+    if (dc_parser_read_file(parser, argv[i]) != dcNoErr)
+    {
+      fprintf(stderr, "dcstats: cannot parse %s\n", argv[i]);
+      failed = 1;
+    }
+
+    dc_parser_free(&parser);
+  }
+
+  printf("%lu bytes in %lu files\n\n", (unsigned long) stats->bytes,
+    (unsigned long) stats->ninputs);
+  histogram("Line sizes", stats->lines, stats->nlines);
+  histogram("Field sizes", stats->fields, stats->nfields);
+  histogram("Paragraph sizes", stats->paragraphs, stats->nparagraphs);
+  histogram("Paragraphs per file", stats->inputs, stats->ninputs);
+
+  dc_parser_stats_free(&stats);
+
+  return failed;
+}
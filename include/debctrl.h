@@ -18,9 +18,29 @@
  *   \code #include <debctrl.h> \endcode
  *
  * Currently, the following headers are included:
+ *  - \ref arrow.h
+ *  - \ref changelog.h
+ *  - \ref column.h
  *  - \ref control.h
+ *  - \ref dpkg.h
  *  - \ref error.h
+ *  - \ref format.h
+ *  - \ref frozen.h
+ *  - \ref hash.h
+ *  - \ref index.h
+ *  - \ref overlay.h
  *  - \ref parser.h
+ *  - \ref position.h
+ *  - \ref query.h
+ *  - \ref relation.h
+ *  - \ref schema.h
+ *  - \ref serialize.h
+ *  - \ref snapshot.h
+ *  - \ref sort.h
+ *  - \ref stats.h
+ *  - \ref substvars.h
+ *  - \ref thread.h
+ *  - \ref upgrade.h
  *  - \ref util.h
  *  - \ref validate.h
  *  - \ref version.h
@@ -29,9 +49,29 @@
 #ifndef DEBCTRL_H
 #define DEBCTRL_H
 
+#include <debctrl/arrow.h>
+#include <debctrl/changelog.h>
+#include <debctrl/column.h>
 #include <debctrl/control.h>
+#include <debctrl/dpkg.h>
 #include <debctrl/error.h>
+#include <debctrl/format.h>
+#include <debctrl/frozen.h>
+#include <debctrl/hash.h>
+#include <debctrl/index.h>
+#include <debctrl/overlay.h>
 #include <debctrl/parser.h>
+#include <debctrl/position.h>
+#include <debctrl/query.h>
+#include <debctrl/relation.h>
+#include <debctrl/schema.h>
+#include <debctrl/serialize.h>
+#include <debctrl/snapshot.h>
+#include <debctrl/sort.h>
+#include <debctrl/stats.h>
+#include <debctrl/substvars.h>
+#include <debctrl/thread.h>
+#include <debctrl/upgrade.h>
 #include <debctrl/util.h>
 #include <debctrl/validate.h>
 #include <debctrl/version.h>
@@ -0,0 +1,29 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Apache Arrow columnar export
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref arrow.c
+ */
+
+#ifndef DEBCTRL_ARROW_H
+#define DEBCTRL_ARROW_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/parser.h> /* for: dcParser */
+
+dcStatus dc_arrow_write(
+  dcParser * const *parsers,
+  size_t count,
+  const char * const *fields,
+  size_t nfields,
+  const char *path
+);
+
+#endif /* DEBCTRL_ARROW_H */
@@ -0,0 +1,76 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Debian changelog parser
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref changelog.c
+ */
+
+#ifndef DEBCTRL_CHANGELOG_H
+#define DEBCTRL_CHANGELOG_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>   /* for: dcStatus */
+#include <debctrl/version.h> /* for: dcVersion */
+
+/**
+ * A single entry of a changelog
+ *
+ * Strings point into the buffer of the \ref dcChangelog, which owns them.
+ *
+ * \warning The \c version must not be cleared or freed with
+ * \ref dc_version_clear, since its strings are not allocated on their own.
+ */
+struct _dcChangelogEntry
+{
+  const char *package; /**< Source package name */
+  dcVersion version; /**< Version */
+  const char *distribution; /**< Distributions (e.g. "unstable") */
+  const char *urgency; /**< Urgency, or \c NULL if none was given */
+  const char *maintainer; /**< Maintainer ("Name <email>"), or \c NULL if
+                               the entry has no trailer line */
+  const char *date; /**< Date of the trailer line, or \c NULL */
+
+  const char *changes; /**< Lines between the header and trailer (not
+                            \c NUL terminated) */
+  size_t changeslen; /**< Length of \c changes */
+  size_t line; /**< Line number of the header */
+};
+
+/**
+ * A parsed changelog
+ */
+struct _dcChangelog
+{
+  char *buf; /**< Contents of the changelog, split in place */
+  size_t len; /**< Length of \c buf */
+
+  dcChangelogEntry *entries; /**< Entries, newest first */
+  size_t count; /**< Number of entries */
+  size_t size; /**< Allocated size of \c entries */
+};
+/* related methods */
+dcChangelog * dc_changelog_new(
+  void
+);
+dcStatus dc_changelog_read_buffer(
+  dcChangelog *changelog,
+  const char *buf,
+  size_t len,
+  size_t limit
+);
+dcStatus dc_changelog_read_file(
+  dcChangelog *changelog,
+  const char *path,
+  size_t limit
+);
+void dc_changelog_free(
+  dcChangelog **ptr
+);
+
+#endif /* DEBCTRL_CHANGELOG_H */
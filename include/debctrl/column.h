@@ -0,0 +1,104 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Typed field columns and aggregates
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref column.c
+ */
+
+#ifndef DEBCTRL_COLUMN_H
+#define DEBCTRL_COLUMN_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/hash.h>   /* for: dcHashTable */
+#include <debctrl/index.h>  /* for: dcIndex */
+
+/**
+ * This enumeration represents how the values of a column are stored.
+ */
+enum dcColumnType
+{
+  /**
+   * Values are unsigned decimal integers (e.g. \c Installed-Size), stored in
+   * \c values. Paragraphs without a valid number are marked missing.
+   */
+  COLUMN_NUMBER,
+
+  /**
+   * Values are strings from a small set (e.g. \c Section), stored as codes
+   * into \c labels. Code \c 0 marks a missing value.
+   */
+  COLUMN_DICTIONARY
+};
+
+/**
+ * A column of field values
+ *
+ * A dcColumn holds the value of one field for each paragraph of a
+ * \ref dcIndex, converted from text once, in arrays indexed by paragraph
+ * number.
+ */
+struct _dcColumn
+{
+  char *field; /**< Field name */
+  enum dcColumnType type; /**< How the values are stored */
+
+  size_t count; /**< Number of paragraphs converted so far */
+  size_t size; /**< Allocated size of the arrays */
+
+  uint64_t *values; /**< Numbers, for \c COLUMN_NUMBER */
+  uint64_t *present; /**< Bitmap of paragraphs with a number */
+
+  uint32_t *codes; /**< Codes, for \c COLUMN_DICTIONARY */
+  const char **labels; /**< Value of each code (\c labels[0] is \c NULL) */
+  size_t nlabels; /**< Number of codes, including \c 0 */
+  dcHashTable *lookup; /**< Code of each value, by value */
+};
+/* related methods */
+const dcColumn * dc_index_column(
+  dcIndex *index,
+  const char *field,
+  enum dcColumnType type
+);
+int dc_column_number(
+  const dcColumn *column,
+  size_t paragraph,
+  uint64_t *value
+);
+void dc_column_free(
+  dcColumn **ptr
+);
+
+/**
+ * Aggregates of a numeric column
+ *
+ * When \c count is \c 0, the other fields are \c 0 as well.
+ */
+struct _dcColumnStats
+{
+  size_t count; /**< Number of values */
+  uint64_t sum; /**< Sum of the values */
+  uint64_t min; /**< Smallest value */
+  uint64_t max; /**< Largest value */
+};
+/* related methods */
+void dc_column_stats(
+  const dcColumn *column,
+  dcColumnStats *stats
+);
+dcStatus dc_index_group(
+  dcIndex *index,
+  const char *field,
+  const char *by,
+  dcColumnStats **groups,
+  const char * const **labels,
+  size_t *count
+);
+
+#endif /* DEBCTRL_COLUMN_H */
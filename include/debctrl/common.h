@@ -13,6 +13,7 @@
  *   - \c stdlib.h (for malloc, realloc, free)
  *   - \c assert.h (for assert)
  *   - \c stddef.h (for NULL, size_t)
+ *   - \c stdint.h (for uint32_t, uint64_t)
  * - It defines macros used throughout libdebctrl:
  *   - \ref NEW
  *   - \ref _
@@ -36,6 +37,7 @@
 #define DEBCTRL_COMMON_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <assert.h>
 
@@ -78,23 +80,110 @@ typedef struct _dcParserBlock      dcParserBlock;
 typedef struct _dcParserChunk      dcParserChunk;
 /** \see The originating struct definition, \ref _dcParserContext */
 typedef struct _dcParserContext    dcParserContext;
+/** \see The originating struct definition, \ref _dcParserFile */
+typedef struct _dcParserFile       dcParserFile;
+/** \see The originating struct definition, \ref _dcParserLimits */
+typedef struct _dcParserLimits     dcParserLimits;
+/** \see The originating struct definition, \ref _dcParserPosition */
+typedef struct _dcParserPosition   dcParserPosition;
 /** \see The originating struct definition, \ref _dcParserSection */
 typedef struct _dcParserSection    dcParserSection;
+/** \see The originating struct definition, \ref _dcParserStats */
+typedef struct _dcParserStats      dcParserStats;
+/** \see The originating struct definition, \ref _dcParserStop */
+typedef struct _dcParserStop       dcParserStop;
 
 /** \see The originating struct definition, \ref _dcControl */
 typedef struct _dcControl          dcControl;
 /** \see The originating struct definition, \ref _dcControlSource */
 typedef struct _dcControlSource    dcControlSource;
 
+/** \see The originating struct definition, \ref _dcFormatOptions */
+typedef struct _dcFormatOptions    dcFormatOptions;
+
+/** \see The originating struct definition, \ref _dcDpkgEntry */
+typedef struct _dcDpkgEntry        dcDpkgEntry;
+/** \see The originating struct definition, \ref _dcDpkgStatus */
+typedef struct _dcDpkgStatus       dcDpkgStatus;
+
 /** \see The originating struct definition, \ref _dcErrorHandler */
 typedef struct _dcErrorHandler     dcErrorHandler;
 
+/** \see The originating struct definition, \ref _dcBloom */
+typedef struct _dcBloom            dcBloom;
+/** \see The originating struct definition, \ref _dcHashSlot */
+typedef struct _dcHashSlot         dcHashSlot;
+/** \see The originating struct definition, \ref _dcHashTable */
+typedef struct _dcHashTable        dcHashTable;
+
+/** \see The originating struct definition, \ref _dcChangelog */
+typedef struct _dcChangelog        dcChangelog;
+/** \see The originating struct definition, \ref _dcChangelogEntry */
+typedef struct _dcChangelogEntry   dcChangelogEntry;
+
+/** \see The originating struct definition, \ref _dcColumn */
+typedef struct _dcColumn           dcColumn;
+/** \see The originating struct definition, \ref _dcColumnStats */
+typedef struct _dcColumnStats      dcColumnStats;
+
+/** \see The originating struct definition, \ref _dcIndex */
+typedef struct _dcIndex            dcIndex;
+/** \see The originating struct definition, \ref _dcIndexPostings */
+typedef struct _dcIndexPostings    dcIndexPostings;
+/** \see The originating struct definition, \ref _dcFrozenIndex */
+typedef struct _dcFrozenIndex      dcFrozenIndex;
+
+/** \see The originating struct definition, \ref _dcOverlay */
+typedef struct _dcOverlay          dcOverlay;
+/** \see The originating struct definition, \ref _dcOverlayCandidate */
+typedef struct _dcOverlayCandidate dcOverlayCandidate;
+/** \see The originating struct definition, \ref _dcOverlayLayer */
+typedef struct _dcOverlayLayer     dcOverlayLayer;
+/** \see The originating struct definition, \ref _dcOverlayPin */
+typedef struct _dcOverlayPin       dcOverlayPin;
+
+/** \see The originating struct definition, \ref _dcQueryClient */
+typedef struct _dcQueryClient      dcQueryClient;
+
+/** \see The originating struct definition, \ref _dcRelation */
+typedef struct _dcRelation         dcRelation;
+/** \see The originating struct definition, \ref _dcRelationAtom */
+typedef struct _dcRelationAtom     dcRelationAtom;
+/** \see The originating struct definition, \ref _dcRelationScanner */
+typedef struct _dcRelationScanner  dcRelationScanner;
+/** \see The originating struct definition, \ref _dcRelationToken */
+typedef struct _dcRelationToken    dcRelationToken;
+/** \see The originating struct definition, \ref _dcRestrictions */
+typedef struct _dcRestrictions     dcRestrictions;
+
+/** \see The originating struct definition, \ref _dcSnapshot */
+typedef struct _dcSnapshot         dcSnapshot;
+/** \see The originating struct definition, \ref _dcSnapshotStore */
+typedef struct _dcSnapshotStore    dcSnapshotStore;
+
+/** \see The originating struct definition, \ref _dcArena */
+typedef struct _dcArena            dcArena;
 /** \see The originating struct definition, \ref _dcString */
 typedef struct _dcString           dcString;
 
+/** \see The originating struct definition, \ref _dcSubstvar */
+typedef struct _dcSubstvar         dcSubstvar;
+/** \see The originating struct definition, \ref _dcSubstvars */
+typedef struct _dcSubstvars        dcSubstvars;
+
+/** \see The originating struct definition, \ref _dcUpgrade */
+typedef struct _dcUpgrade          dcUpgrade;
+
 /** \see The originating struct definition, \ref _dcVersion */
 typedef struct _dcVersion          dcVersion;
 
+/** \see The originating struct definition, \ref _dcSchema */
+typedef struct _dcSchema           dcSchema;
+/** \see The originating struct definition, \ref _dcSchemaField */
+typedef struct _dcSchemaField      dcSchemaField;
+/** \see The originating struct definition, \ref _dcSchemaParagraph */
+typedef struct _dcSchemaParagraph  dcSchemaParagraph;
+
 /**
  * Status indication
  *
@@ -112,7 +201,16 @@ typedef enum
 
   dcPackagePrefixErr, /**< Package name has invalid prefixing characters */
   dcPackageLengthErr, /**< Package name too short */
-  dcPackageInvalidErr /**< Package name contains invalid characters */
+  dcPackageInvalidErr, /**< Package name contains invalid characters */
+
+  dcVersionPrefixErr, /**< Upstream version does not begin with a digit */
+  dcVersionUpstreamErr, /**< Upstream version contains invalid characters */
+  dcVersionRevisionErr, /**< Debian revision contains invalid characters */
+
+  dcSchemaErr, /**< Metadata does not conform to the expected schema */
+  dcLimitErr, /**< Input exceeds a configured resource limit */
+  dcProtocolErr, /**< Malformed message received from a query peer */
+  dcStoppedErr /**< Stopped early on request; the results so far are kept */
 } dcStatus;
 
 #endif /* DEBCTRL_COMMON_H */
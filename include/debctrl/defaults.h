@@ -58,7 +58,9 @@
  * files we work with, rounded up to the next page (usually 4KB).
  *
  * \bug The "average size" used here (4KB) was just selected arbitrarily. More
- * rigorous statistics would be helpful.
+ * rigorous statistics would be helpful; the \c dcstats example reports
+ * them for a set of files, and \ref dc_parser_stats_apply replaces this
+ * value at run time with one measured from the input.
  */
 #define STRING_INIT_SIZE      4096
 
@@ -72,9 +74,137 @@
  * standard deviation from the mean (see \ref STRING_INIT_SIZE).
  *
  * \bug The "standard deviation" figure used here (1KB) was just selected
- * arbitrarily. More rigorous statistics would be helpful.
+ * arbitrarily. More rigorous statistics would be helpful (see
+ * \ref STRING_INIT_SIZE).
  */
 #define STRING_STEP_SIZE      1024
 
+/**
+ * Size of a version key buffer
+ *
+ * Buffers of this size are used to hold the keys computed by
+ * \ref dc_version_key, which is enough for any version in the archive;
+ * longer keys are handled by allocating a larger buffer.
+ */
+#define VERSION_KEY_SIZE      256
+
+/**
+ * Bloom filter density
+ *
+ * This is the number of bits per key used by \ref dcBloom filters, which
+ * gives a false positive rate of about 0.1% when they are full.
+ */
+#define BLOOM_BITS            16
+
+/**
+ * Deadline polling interval
+ *
+ * A parser with a deadline (see \ref dcParserStop) reads the clock once
+ * every this many lines, so that checking it costs little per line.
+ */
+#define STOP_POLL_LINES       256
+
+/**
+ * Arena block size
+ *
+ * A \ref dcArena allocates memory from the system in blocks of this many
+ * bytes; larger requests get a block of their own.
+ */
+#define ARENA_BLOCK_SIZE      65536
+
+/**
+ * Substitution variable nesting limit
+ *
+ * This is how deeply substitution variables may refer to one another (see
+ * \ref dc_substvars_expand), which catches variables that refer to
+ * themselves.
+ */
+#define SUBSTVARS_DEPTH       8
+
+/**
+ * Bounds for tuned sizes
+ *
+ * Sizes chosen from parse statistics by \ref dc_parser_stats_apply are
+ * kept within these bounds, so that a few unusual inputs cannot make later
+ * allocations tiny or huge.
+ */
+#define STATS_SIZE_MIN        256     /**< Smallest tuned size */
+#define STATS_SIZE_MAX        1048576 /**< Largest tuned size (1 MiB) */
+
+/**
+ * Bounds for the tuned size of indexes
+ *
+ * The number of paragraphs which new indexes are sized for by
+ * \ref dc_parser_stats_apply is kept within these bounds. The upper bound
+ * covers a complete \c Packages file for one architecture.
+ */
+#define STATS_INDEX_MIN       64      /**< Fewest paragraphs */
+#define STATS_INDEX_MAX       131072  /**< Most paragraphs */
+
+/**
+ * Paragraphs per tuned arena block
+ *
+ * When sized from parse statistics, arena blocks hold this many large
+ * paragraphs (see \ref dc_parser_stats_apply).
+ */
+#define STATS_ARENA_PARAGRAPHS 16
+
+/**
+ * Changelog read size
+ *
+ * When only the first few entries of a changelog are wanted, the file is
+ * read this many bytes at a time, until enough entries have been seen (see
+ * \ref dc_changelog_read_file).
+ */
+#define CHANGELOG_READ_SIZE   65536
+
+/**
+ * Maximum number of NUMA nodes
+ *
+ * Worker threads are spread over the processors of at most this many nodes
+ * (see \ref dc_parallel_nodes); any further nodes are not used.
+ */
+#define PARALLEL_NODES        64
+
+/**
+ * NUMA topology directory
+ *
+ * This is where Linux describes the nodes of the machine, each in a
+ * \c nodeN subdirectory listing its processors.
+ */
+#define PARALLEL_NODE_DIR     "/sys/devices/system/node"
+
+/**
+ * Default dpkg administrative directory
+ *
+ * This is where dpkg keeps its database of installed packages, and is used
+ * by \ref dc_dpkg_status_new unless another directory is given.
+ */
+#define DPKG_ADMINDIR         "/var/lib/dpkg"
+
+/**
+ * Default query daemon socket
+ *
+ * This is the Unix domain socket on which a query daemon listens, and is
+ * used by \ref dc_query_connect unless another path is given.
+ */
+#define QUERY_SOCKET          "/run/debctrl/query.sock"
+
+/**
+ * Recommended resource limits for untrusted input
+ *
+ * These are the limits installed by \ref dc_parser_limits_init, and are meant
+ * for parsing uploaded control, .dsc and .changes files, which are small in
+ * practice. Parsers created by \ref dc_parser_new are unlimited by default.
+ *
+ * \bug These values were chosen to comfortably exceed the largest files in
+ * the archive, rather than from any rigorous statistics.
+ */
+#define LIMIT_LINE_LENGTH     65536   /**< Bytes per line */
+#define LIMIT_BYTES           16777216 /**< Bytes in total (16 MiB) */
+#define LIMIT_SECTIONS        4096    /**< Paragraphs per file */
+#define LIMIT_FIELDS          256     /**< Field lines per paragraph */
+#define LIMIT_CHUNKS          65536   /**< Continuation lines per field */
+
 #endif /* DEBCTRL_DEFAULTS_H */
 
@@ -0,0 +1,81 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * dpkg status database reader
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref dpkg.c
+ */
+
+#ifndef DEBCTRL_DPKG_H
+#define DEBCTRL_DPKG_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcErrorHandler */
+#include <debctrl/hash.h>   /* for: dcHashTable */
+#include <debctrl/parser.h> /* for: dcParserSection */
+
+/**
+ * A package record in the dpkg status database
+ *
+ * Each dcDpkgEntry holds one parsed paragraph, along with the location and
+ * hash of the bytes it was parsed from, which are used to recognize it when
+ * the database is read again.
+ */
+struct _dcDpkgEntry
+{
+  const char *package; /**< Package name (points into \c section) */
+  const char *arch; /**< Architecture, or an empty string if none */
+  dcParserSection *section; /**< Parsed paragraph */
+
+  size_t offset; /**< Byte offset of the paragraph in its file */
+  size_t length; /**< Length of the paragraph, in bytes */
+  uint64_t hash; /**< Hash of the paragraph's bytes (see \ref dc_hash) */
+  char *text; /**< The paragraph's bytes, to confirm matches by hash */
+
+  size_t index; /**< Position in \ref dcDpkgStatus::entries */
+};
+
+/**
+ * A dpkg status database
+ *
+ * A dcDpkgStatus holds the installed package records read from a dpkg
+ * administrative directory (usually \ref DPKG_ADMINDIR), including updates
+ * journalled by dpkg but not yet merged into the \c status file.
+ */
+struct _dcDpkgStatus
+{
+  char *admindir; /**< Path to the dpkg administrative directory */
+  dcErrorHandler handler; /**< Warning/error handler */
+
+  dcDpkgEntry **entries; /**< Package records, in file order */
+  size_t count; /**< Number of package records */
+  size_t size; /**< Allocated number of elements in \c entries */
+
+  dcHashTable *paragraphs; /**< Records, by hash of their bytes */
+  dcHashTable *packages; /**< Records, by hash of their package name */
+
+  size_t parsed; /**< Paragraphs parsed during the last read */
+  size_t reused; /**< Paragraphs reused (unchanged) during the last read */
+};
+/* related methods */
+dcDpkgStatus * dc_dpkg_status_new(
+  const char *admindir
+);
+dcStatus dc_dpkg_status_read(
+  dcDpkgStatus *status
+);
+dcDpkgEntry * dc_dpkg_status_find(
+  const dcDpkgStatus *status,
+  const char *package,
+  const char *arch
+);
+void dc_dpkg_status_free(
+  dcDpkgStatus **ptr
+);
+
+#endif /* DEBCTRL_DPKG_H */
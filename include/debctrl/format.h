@@ -0,0 +1,61 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Canonical control file formatter
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref format.c
+ */
+
+#ifndef DEBCTRL_FORMAT_H
+#define DEBCTRL_FORMAT_H
+
+#include <debctrl/common.h>
+#include <debctrl/parser.h> /* for: dcParser */
+
+/**
+ * Formatting options
+ *
+ * These options control how \ref dc_format_section and friends rewrite
+ * control data. Use \ref dc_format_options_init to obtain the defaults.
+ */
+struct _dcFormatOptions
+{
+  unsigned int width; /**< Wrap lines longer than this (0 = \ref WRAPLEN) */
+
+  int sort_fields; /**< Reorder fields into canonical order */
+  int sort_relations; /**< Sort entries of relationship fields */
+  int wrap_always; /**< Put each entry on its own line, even if it fits */
+  int trailing_comma; /**< Add a comma after the last wrapped entry */
+};
+/* related methods */
+void dc_format_options_init(
+  dcFormatOptions *options
+);
+dcStatus dc_format_section(
+  dcParserSection *section,
+  const dcFormatOptions *options
+);
+dcStatus dc_format_parser(
+  dcParser *parser,
+  const dcFormatOptions *options
+);
+dcStatus dc_format_file(
+  const char *path,
+  const dcFormatOptions *options,
+  int *changed
+);
+dcStatus dc_format_files(
+  const char * const *paths,
+  size_t count,
+  const dcFormatOptions *options,
+  unsigned int threads,
+  dcStatus *results,
+  int *changed
+);
+
+#endif /* DEBCTRL_FORMAT_H */
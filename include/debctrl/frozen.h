@@ -0,0 +1,81 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Frozen shared indexes
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref frozen.c
+ */
+
+#ifndef DEBCTRL_FROZEN_H
+#define DEBCTRL_FROZEN_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/index.h>  /* for: dcIndex */
+
+/** Paragraph number returned when there are no more matches */
+#define FROZEN_NONE   ((size_t) -1)
+
+dcStatus dc_index_freeze(
+  const dcIndex *index,
+  const char *path
+);
+
+/**
+ * A frozen index image, mapped read-only
+ *
+ * Paragraphs in the image are identified by number, from \c 0 to
+ * \c count - 1, in the order they were added to the original index.
+ */
+struct _dcFrozenIndex
+{
+  const char *base; /**< Start of the mapped image */
+  size_t size; /**< Size of the mapped image */
+  size_t count; /**< Number of paragraphs */
+};
+/* related methods */
+dcFrozenIndex * dc_frozen_open(
+  const char *path
+);
+int dc_frozen_may_contain(
+  const dcFrozenIndex *frozen,
+  const char *package,
+  const char *version
+);
+size_t dc_frozen_find(
+  const dcFrozenIndex *frozen,
+  const char *package,
+  size_t *iter
+);
+size_t dc_frozen_rdepends(
+  const dcFrozenIndex *frozen,
+  const char *package,
+  size_t *iter
+);
+size_t dc_frozen_filter(
+  const dcFrozenIndex *frozen,
+  const char *field,
+  const char *value,
+  size_t *iter
+);
+const char * dc_frozen_text(
+  const dcFrozenIndex *frozen,
+  size_t paragraph,
+  size_t *len
+);
+const char * dc_frozen_field(
+  const dcFrozenIndex *frozen,
+  size_t paragraph,
+  const char *field,
+  size_t *len
+);
+void dc_frozen_close(
+  dcFrozenIndex **ptr
+);
+
+#endif /* DEBCTRL_FROZEN_H */
@@ -0,0 +1,119 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Hashing and hash tables
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref hash.c
+ */
+
+#ifndef DEBCTRL_HASH_H
+#define DEBCTRL_HASH_H
+
+#include <debctrl/common.h>
+
+uint64_t dc_hash(
+  const void *buf,
+  size_t len
+);
+uint64_t dc_hash_case(
+  const void *buf,
+  size_t len
+);
+uint64_t dc_hash_combine(
+  uint64_t h,
+  uint64_t value
+);
+
+/**
+ * A single slot in a Hash Table
+ *
+ * Slots whose \c value is \c NULL are empty.
+ */
+struct _dcHashSlot
+{
+  uint64_t key; /**< Hash key (see \ref dc_hash) */
+  void *value; /**< Associated value */
+};
+
+/**
+ * A hash table keyed by 64-bit hashes
+ *
+ * A dcHashTable maps hash values (as computed by \ref dc_hash) to pointers.
+ * Several values may be stored under the same key, since distinct data may
+ * hash to the same value; callers compare the data itself to tell them
+ * apart, iterating over the candidates with \ref dc_hash_table_find.
+ */
+struct _dcHashTable
+{
+  dcHashSlot *slots; /**< Array of slots */
+  size_t size; /**< Number of slots (always a power of two) */
+  size_t count; /**< Number of values stored */
+};
+/* related methods */
+dcHashTable * dc_hash_table_new(
+  size_t hint
+);
+dcStatus dc_hash_table_insert(
+  dcHashTable *table,
+  uint64_t key,
+  void *value
+);
+void * dc_hash_table_find(
+  const dcHashTable *table,
+  uint64_t key,
+  size_t *iter
+);
+int dc_hash_table_remove(
+  dcHashTable *table,
+  uint64_t key,
+  const void *value
+);
+void dc_hash_table_free(
+  dcHashTable **ptr
+);
+
+/** Number of words in a Bloom filter block (64 bytes, one cache line) */
+#define BLOOM_BLOCK   8
+
+/**
+ * A Bloom filter over 64-bit hashes
+ *
+ * A dcBloom records a set of hash values (as computed by \ref dc_hash) in
+ * \ref BLOOM_BITS bits per key. Checking for a key that was added always
+ * succeeds, while checking for one that was not usually fails, so it can
+ * rule out most lookups of absent keys cheaply. Keys cannot be removed.
+ */
+struct _dcBloom
+{
+  uint64_t *words; /**< Bits, in blocks of \ref BLOOM_BLOCK words */
+  size_t nblocks; /**< Number of blocks */
+  size_t count; /**< Number of keys added */
+  size_t capacity; /**< Number of keys the filter was sized for */
+};
+/* related methods */
+dcBloom * dc_bloom_new(
+  size_t capacity
+);
+void dc_bloom_add(
+  dcBloom *bloom,
+  uint64_t key
+);
+int dc_bloom_check(
+  const dcBloom *bloom,
+  uint64_t key
+);
+int dc_bloom_check_words(
+  const uint64_t *words,
+  size_t nblocks,
+  uint64_t key
+);
+void dc_bloom_free(
+  dcBloom **ptr
+);
+
+#endif /* DEBCTRL_HASH_H */
@@ -0,0 +1,115 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Package indexes
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref index.c
+ */
+
+#ifndef DEBCTRL_INDEX_H
+#define DEBCTRL_INDEX_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/hash.h>   /* for: dcBloom */
+#include <debctrl/parser.h> /* for: dcParser */
+
+/**
+ * Paragraphs depending on a package
+ *
+ * The reverse dependency table of a \ref dcIndex holds one of these for
+ * each distinct name, so that names depended on by many paragraphs (e.g.
+ * \c libc6) occupy a single slot of the hash table.
+ */
+struct _dcIndexPostings
+{
+  const char *name; /**< The name (in a chunk, not \c NUL terminated) */
+  size_t len; /**< Length of the name */
+
+  size_t *sections; /**< Numbers of the paragraphs, in increasing order */
+  size_t count; /**< Number of paragraphs */
+  size_t size; /**< Allocated size of \c sections */
+};
+
+/**
+ * An index of package paragraphs
+ *
+ * A dcIndex holds the paragraphs of one or more parsers, with hash tables
+ * for looking them up by package name and by the names they depend on, and
+ * a Bloom filter summarizing the package names and (name, version) pairs it
+ * contains.
+ */
+struct _dcIndex
+{
+  dcParser **parsers; /**< Clones of the parsers added to this index */
+  size_t nparsers; /**< Number of parsers */
+
+  dcParserSection **sections; /**< Every paragraph, in order */
+  const char **names; /**< Package name of each paragraph, or \c NULL */
+  size_t count; /**< Number of paragraphs */
+  size_t size; /**< Allocated size of \c sections and \c names */
+
+  dcHashTable *packages; /**< Paragraph number + 1, by package name */
+  dcHashTable *rdepends; /**< \ref dcIndexPostings, by dependency name */
+  dcBloom *summary; /**< Keys (see \ref dc_index_key) of every paragraph, or
+                         \c NULL if there is none */
+
+  dcColumn **columns; /**< Cached columns (see \ref dc_index_column) */
+  size_t ncolumns; /**< Number of cached columns */
+
+  dcIndex **replicas; /**< Copy for each NUMA node (see
+                           \ref dc_index_replicate), or \c NULL */
+  unsigned int nreplicas; /**< Number of replicas */
+};
+/* related methods */
+dcIndex * dc_index_new(
+  void
+);
+void dc_index_tune(
+  size_t paragraphs
+);
+dcStatus dc_index_add(
+  dcIndex *index,
+  dcParser *parser
+);
+uint64_t dc_index_key(
+  const char *package,
+  const char *version
+);
+int dc_index_may_contain(
+  const dcIndex *index,
+  const char *package,
+  const char *version
+);
+dcParserSection * dc_index_find(
+  const dcIndex *index,
+  const char *package,
+  size_t *iter
+);
+dcParserSection * dc_index_rdepends(
+  const dcIndex *index,
+  const char *package,
+  size_t *iter
+);
+dcParserSection * dc_index_filter(
+  const dcIndex *index,
+  const char *field,
+  const char *value,
+  size_t *iter
+);
+dcStatus dc_index_replicate(
+  dcIndex *index
+);
+const dcIndex * dc_index_local(
+  const dcIndex *index
+);
+void dc_index_free(
+  dcIndex **ptr
+);
+
+#endif /* DEBCTRL_INDEX_H */
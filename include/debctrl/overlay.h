@@ -0,0 +1,112 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Layered index overlays
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref overlay.c
+ */
+
+#ifndef DEBCTRL_OVERLAY_H
+#define DEBCTRL_OVERLAY_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/hash.h>   /* for: dcHashTable */
+#include <debctrl/index.h>  /* for: dcIndex */
+
+/**
+ * A pin, assigning a priority to some versions of a layer
+ *
+ * Patterns are shell wildcards, as accepted by \c fnmatch(3).
+ */
+struct _dcOverlayPin
+{
+  char *package; /**< Package name pattern */
+  char *version; /**< Version pattern, or \c NULL to match any version */
+  int priority; /**< Priority of matching versions */
+};
+
+/**
+ * A layer of an overlay (e.g. a suite or component of an archive)
+ */
+struct _dcOverlayLayer
+{
+  char *name; /**< Name of the layer (e.g. "bookworm-security") */
+  const dcIndex *index; /**< Paragraphs of the layer (not owned) */
+  int priority; /**< Priority of versions not matched by any pin */
+
+  dcOverlayPin *pins; /**< Pins, in the order they were added */
+  size_t npins; /**< Number of pins */
+};
+
+/**
+ * The candidate version of a package
+ *
+ * This is the version of a package that would be chosen for installation:
+ * the one with the highest priority, or the newest of those with the
+ * highest priority.
+ */
+struct _dcOverlayCandidate
+{
+  const char *package; /**< Package name (in the layer's index) */
+  const char *version; /**< Version (in \c section) */
+  dcParserSection *section; /**< Paragraph of the candidate */
+  size_t layer; /**< Number of the layer it was found in */
+  int priority; /**< Priority it was given */
+};
+
+/**
+ * An overlay of package indexes
+ *
+ * A dcOverlay combines several indexes in layers, without copying them, and
+ * keeps a table of the candidate version of every package they contain.
+ */
+struct _dcOverlay
+{
+  dcOverlayLayer *layers; /**< Layers, in the order they were added */
+  size_t count; /**< Number of layers */
+
+  dcHashTable *candidates; /**< \ref dcOverlayCandidate, by package name */
+};
+/* related methods */
+dcOverlay * dc_overlay_new(
+  void
+);
+dcStatus dc_overlay_add(
+  dcOverlay *overlay,
+  const char *name,
+  const dcIndex *index,
+  int priority
+);
+dcStatus dc_overlay_pin(
+  dcOverlay *overlay,
+  size_t layer,
+  const char *package,
+  const char *version,
+  int priority
+);
+dcStatus dc_overlay_replace(
+  dcOverlay *overlay,
+  size_t layer,
+  const dcIndex *index
+);
+int dc_overlay_priority(
+  const dcOverlay *overlay,
+  size_t layer,
+  const char *package,
+  const char *version
+);
+const dcOverlayCandidate * dc_overlay_candidate(
+  const dcOverlay *overlay,
+  const char *package
+);
+void dc_overlay_free(
+  dcOverlay **ptr
+);
+
+#endif /* DEBCTRL_OVERLAY_H */
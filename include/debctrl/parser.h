@@ -22,9 +22,12 @@
 #ifndef DEBCTRL_PARSER_H
 #define DEBCTRL_PARSER_H
 
+#include <time.h>           /* for: struct timespec */
+
 #include <debctrl/common.h>
-#include <debctrl/util.h>   /* for: dcString */
+#include <debctrl/util.h>   /* for: dcString, dcArena */
 #include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/position.h> /* for: dcParserPosition */
 
 /**
  * This enumeration represents the type of data chunk, based on whether it
@@ -71,6 +74,9 @@ enum dcParserChunkType
  *
  * It is used particularly to provide useful debugging output; eg., "there is
  * an unknown block in \c debian/control at line 30."
+ *
+ * \note Chunks store a compact \ref dcParserPosition instead, which can be
+ * converted into a context using \ref dc_parser_position_context.
  */
 struct _dcParserContext
 {
@@ -91,7 +97,9 @@ struct _dcParserChunk
 
   enum dcParserChunkType type; /**< Type of this chunk */
 
-  dcParserContext ctx; /**< Originating context of this chunk */
+  dcParserPosition pos; /**< Originating position of this chunk */
+  unsigned int pooled; /**< Nonzero if \c text is held by the arena of the
+                            block, rather than allocated on its own */
 
   dcParserChunk *next; /**< Next chunk in this block */
   dcParserChunk *prev; /**< Previous chunk in this block */
@@ -109,13 +117,23 @@ void dc_parser_chunk_free(
  *
  * Each dcParserBlock contains one or more dcParserChunk objects, which each
  * hold a blob of data.
+ *
+ * \note The \c hash is maintained by the parser as chunks are read. After
+ * modifying a block through other routines, it must be recomputed using
+ * \ref dc_parser_block_hash.
  */
 struct _dcParserBlock
 {
   char *name; /**< The block name (e.g., Description) */
+  unsigned int refs; /**< Number of sections sharing the list this heads */
+  uint64_t hash; /**< Hash of the field name and contents */
 
   dcParserChunk *head; /**< First chunk in this block */
   dcParserChunk *tail; /**< Last chunk in this block */
+  unsigned int *shares; /**< Number of blocks sharing the chunks, or
+                             \c NULL if they belong to this block alone */
+  dcArena *arena; /**< Arena holding the text of pooled chunks, or
+                       \c NULL if there are none */
 
   dcParserBlock *next; /**< Next block in section */
   dcParserBlock *prev; /**< Previous block in section */
@@ -136,9 +154,19 @@ void dc_parser_block_delete(
   dcParserBlock *block,
   dcParserChunk **chunk
 );
+int dc_parser_block_write(
+  dcParserBlock *block,
+  dcString *buf
+);
 dcString * dc_parser_block_string(
   dcParserBlock *block
 );
+dcStatus dc_parser_block_writable(
+  dcParserBlock *block
+);
+uint64_t dc_parser_block_hash(
+  dcParserBlock *block
+);
 void dc_parser_block_free(
   dcParserBlock **ptr
 );
@@ -148,13 +176,19 @@ void dc_parser_block_free(
  *
  * Each dcParserSection contains one or more dcParserBlock objects, which
  * each represent a given control paragraph.
+ *
+ * \note The \c hash is maintained by the parser as lines are read. After
+ * modifying a section through other routines, it must be recomputed using
+ * \ref dc_parser_section_hash.
  */
 struct _dcParserSection
 {
   dcParserBlock *head; /**< First block in this section */
   dcParserBlock *tail; /**< Last block in this section */
+  uint64_t hash; /**< Hash of the paragraph's fields */
 
   dcParserSection *next; /**< Next section */
+  unsigned int refs; /**< Number of references to this section */
 };
 /* related methods */
 dcParserSection * dc_parser_section_new(
@@ -168,10 +202,83 @@ dcParserBlock * dc_parser_section_find(
   dcParserSection *section,
   const char *field
 );
+int dc_parser_section_write(
+  dcParserSection *section,
+  dcString *buf
+);
+uint64_t dc_parser_section_hash(
+  dcParserSection *section
+);
 void dc_parser_section_free(
   dcParserSection **ptr
 );
 
+/**
+ * Parser resource limits
+ *
+ * These bound the resources a \ref dcParser may consume while reading its
+ * input, so that hostile input (e.g. an uploaded .changes file) cannot make
+ * parsing take unbounded time or memory. Each limit is checked in constant
+ * time as lines are read, and a limit of \c 0 means unlimited.
+ *
+ * Use \ref dc_parser_limits_init to obtain the recommended limits for
+ * untrusted input.
+ */
+struct _dcParserLimits
+{
+  size_t line; /**< Maximum bytes in a line, excluding the terminator */
+  size_t bytes; /**< Maximum bytes of input in total */
+  size_t sections; /**< Maximum number of paragraphs */
+  size_t fields; /**< Maximum number of field lines in a paragraph */
+  size_t chunks; /**< Maximum number of continuation lines in a field */
+};
+/* related methods */
+void dc_parser_limits_init(
+  dcParserLimits *limits
+);
+
+/**
+ * Conditions for stopping a parse early
+ *
+ * Unlike \ref dcParserLimits, these are not errors in the input: they let a
+ * caller ask for only the start of a file, or give up on a long parse. When
+ * one is met, reading stops after the current line and returns
+ * \c dcStoppedErr, and the paragraphs read so far are kept. A condition of
+ * \c 0 (or \c NULL) is never met.
+ *
+ * \note When stopped by \c bytes, \c cancel or \c deadline, the last
+ * paragraph may be incomplete. When stopped by \c sections, it is
+ * followed by an empty paragraph, as after a blank line.
+ */
+struct _dcParserStop
+{
+  size_t sections; /**< Stop once this many paragraphs are complete */
+  size_t bytes; /**< Stop once this many bytes of input have been read */
+
+  /**
+   * Stop once this becomes nonzero. It is read once per line (atomically,
+   * with acquire ordering, where the compiler supports it), so another
+   * thread may cancel the parse by setting it, preferably with a release
+   * store such as \c __atomic_store_n(cancel, 1, \c __ATOMIC_RELEASE).
+   * A signal handler may also set it where \c sig_atomic_t is \c int (as
+   * with glibc); elsewhere, the handler should set a \c volatile
+   * \c sig_atomic_t, which another thread copies here.
+   */
+  volatile int *cancel;
+
+  /**
+   * Stop once the \c CLOCK_MONOTONIC clock passes this time (see
+   * \ref dc_parser_stop_timeout). The clock is read once every
+   * \ref STOP_POLL_LINES lines.
+   */
+  struct timespec deadline;
+};
+/* related methods */
+void dc_parser_stop_timeout(
+  dcParserStop *stop,
+  unsigned long msec
+);
+
 /**
  * A Parser state object
  *
@@ -183,6 +290,20 @@ struct _dcParser
   dcParserContext ctx; /**< Tracks current parsing context */
   dcErrorHandler handler; /**< Warning/error handler */
 
+  dcParserFile *file; /**< File being parsed, or \c NULL if unknown */
+  dcParserPosition pos; /**< Position of the line being parsed */
+  size_t offset; /**< Byte offset of the next line to be parsed */
+
+  dcParserLimits limits; /**< Resource limits (unlimited by default) */
+  dcParserStop stop; /**< Early stopping conditions (none by default) */
+  int trusted; /**< Assume the input is well-formed, skipping some checks
+                    (see \ref parser.c) */
+  dcParserStats *stats; /**< Statistics to collect (see \ref stats.c), or
+                             \c NULL */
+  size_t sections; /**< Number of paragraphs read so far */
+  size_t fields; /**< Number of field lines in the current paragraph */
+  size_t chunks; /**< Number of continuation lines in the current field */
+
   dcParserSection *head; /**< First dcParserSection in this file */
   dcParserSection *tail; /**< Last dcParserSection in this file */
 };
@@ -190,10 +311,23 @@ struct _dcParser
 dcParser * dc_parser_new(
   void
 );
+dcParser * dc_parser_clone(
+  dcParser *parser
+);
+dcParserSection * dc_parser_section_writable(
+  dcParser *parser,
+  dcParserSection *section
+);
 dcStatus dc_parser_read_file(
   dcParser *parser,
   const char *path
 );
+dcStatus dc_parser_read_buffer(
+  dcParser *parser,
+  const char *buf,
+  size_t len,
+  const char *name
+);
 dcStatus dc_parser_read_line(
   dcParser *parser,
   char *line,
@@ -203,6 +337,10 @@ void dc_parser_append(
   dcParser *parser,
   dcParserSection *section
 );
+void dc_parser_write(
+  dcParser *parser,
+  dcString *buf
+);
 void dc_parser_free(
   dcParser **ptr
 );
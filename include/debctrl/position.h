@@ -0,0 +1,76 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Compact source positions
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref position.c
+ */
+
+#ifndef DEBCTRL_POSITION_H
+#define DEBCTRL_POSITION_H
+
+#include <debctrl/common.h>
+
+/**
+ * Source position
+ *
+ * A dcParserPosition identifies where a given chunk of data originated, as a
+ * (file id, byte offset) pair. It is much smaller than a full
+ * \ref dcParserContext, and can be converted into one on demand using
+ * \ref dc_parser_position_context.
+ *
+ * \note A file id of \c 0 means the originating file is unknown (e.g. for
+ * data not read from a file).
+ */
+struct _dcParserPosition
+{
+  uint32_t file; /**< Originating file id (see \ref dcParserFile) */
+  uint32_t offset; /**< Byte offset of the start of the line */
+};
+
+/**
+ * Source file information
+ *
+ * Each dcParserFile holds the path of a file being (or having been) parsed,
+ * along with an index of the byte offsets at which its lines begin. Files are
+ * registered in a process-wide table, so that positions can be resolved into
+ * a path and line number without access to the originating parser.
+ *
+ * Files are reference counted; they stay registered for as long as any
+ * parser (or other data structure) holding positions into them exists.
+ */
+struct _dcParserFile
+{
+  char *path; /**< Path to filename */
+  uint32_t id; /**< File id, used in \ref dcParserPosition */
+  unsigned int refs; /**< Reference count */
+
+  uint32_t *lines; /**< Byte offset of the start of each line */
+  size_t count; /**< Number of lines in the index */
+  size_t size; /**< Allocated number of elements in \c lines */
+};
+/* related methods */
+dcParserFile * dc_parser_file_new(
+  const char *path
+);
+dcStatus dc_parser_file_line(
+  dcParserFile *file,
+  uint32_t offset
+);
+dcParserFile * dc_parser_file_retain(
+  dcParserFile *file
+);
+void dc_parser_file_release(
+  dcParserFile **ptr
+);
+dcParserContext * dc_parser_position_context(
+  const dcParserPosition *pos,
+  dcParserContext *ctx
+);
+
+#endif /* DEBCTRL_POSITION_H */
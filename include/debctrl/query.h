@@ -0,0 +1,67 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Query daemon protocol
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref query.c
+ */
+
+#ifndef DEBCTRL_QUERY_H
+#define DEBCTRL_QUERY_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/frozen.h> /* for: dcFrozenIndex */
+#include <debctrl/index.h>  /* for: dcIndex */
+#include <debctrl/parser.h> /* for: dcParser */
+#include <debctrl/util.h>   /* for: dcString */
+
+dcStatus dc_query_serve(
+  const dcIndex *index,
+  const char *path,
+  volatile int *stop
+);
+dcStatus dc_query_serve_frozen(
+  const dcFrozenIndex *frozen,
+  const char *path,
+  volatile int *stop
+);
+
+/**
+ * A connection to a query daemon
+ */
+struct _dcQueryClient
+{
+  int fd; /**< Connected socket */
+  dcString *buf; /**< Buffer for requests and responses */
+};
+/* related methods */
+dcQueryClient * dc_query_connect(
+  const char *path
+);
+dcStatus dc_query_package(
+  dcQueryClient *client,
+  const char *package,
+  dcParser **result
+);
+dcStatus dc_query_rdepends(
+  dcQueryClient *client,
+  const char *package,
+  dcParser **result
+);
+dcStatus dc_query_filter(
+  dcQueryClient *client,
+  const char *field,
+  const char *value,
+  dcParser **result
+);
+void dc_query_close(
+  dcQueryClient **ptr
+);
+
+#endif /* DEBCTRL_QUERY_H */
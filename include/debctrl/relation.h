@@ -0,0 +1,205 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Relationship field tokenizer and parser
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref relation.c
+ */
+
+#ifndef DEBCTRL_RELATION_H
+#define DEBCTRL_RELATION_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/parser.h> /* for: dcParserBlock */
+
+/**
+ * This enumeration represents the type of a token in a relationship field.
+ */
+enum dcRelationTokenType
+{
+  TOKEN_WORD, /**< A package name, version or restriction term */
+  TOKEN_OPERATOR, /**< A version relation (e.g. \c >=) */
+  TOKEN_COMMA, /**< \c , between relations */
+  TOKEN_PIPE, /**< \c | between alternatives */
+  TOKEN_OPEN, /**< \c ( starting a version constraint */
+  TOKEN_CLOSE, /**< \c ) ending a version constraint */
+  TOKEN_ARCH_OPEN, /**< \c [ starting an architecture restriction */
+  TOKEN_ARCH_CLOSE, /**< \c ] ending an architecture restriction */
+  TOKEN_PROFILE_OPEN, /**< \c < starting a build profile restriction */
+  TOKEN_PROFILE_CLOSE /**< \c > ending a build profile restriction */
+};
+
+/**
+ * A token of a relationship field
+ *
+ * The text of a token points into a chunk of the field, and is not \c NUL
+ * terminated.
+ */
+struct _dcRelationToken
+{
+  enum dcRelationTokenType type; /**< Type of this token */
+  const char *text; /**< Text of the token */
+  size_t len; /**< Length of the text */
+};
+
+/**
+ * Tokenizer state for a relationship field
+ *
+ * This walks the chunks of a \ref dcParserBlock in turn, so tokens are
+ * found in a single pass over the whole field.
+ */
+struct _dcRelationScanner
+{
+  const dcParserChunk *chunk; /**< Chunk being scanned */
+  const char *p; /**< Position in the chunk's text */
+  const char *end; /**< End of the chunk's text */
+  int paren; /**< Nonzero within a version constraint */
+};
+/* related methods */
+void dc_relation_scan_init(
+  dcRelationScanner *scanner,
+  const dcParserBlock *block
+);
+int dc_relation_scan(
+  dcRelationScanner *scanner,
+  dcRelationToken *token
+);
+
+/**
+ * A single relation (one alternative of a relationship field)
+ *
+ * The text of each part points into the chunks of the field, and is not
+ * \c NUL terminated. Parts which are absent have \c NULL text and zero
+ * length.
+ */
+struct _dcRelationAtom
+{
+  const char *name; /**< Package name */
+  size_t namelen; /**< Length of \c name */
+  const char *arch; /**< Architecture qualifier (e.g. "any"), after ':' */
+  size_t archlen; /**< Length of \c arch */
+  const char *op; /**< Version relation (e.g. ">=") */
+  size_t oplen; /**< Length of \c op */
+  const char *version; /**< Version */
+  size_t versionlen; /**< Length of \c version */
+
+  size_t group; /**< Number of the comma-separated group it belongs to */
+
+  size_t archs; /**< First architecture restriction term in \c terms */
+  size_t narchs; /**< Number of architecture restriction terms */
+  size_t profiles; /**< First build profile token in \c terms */
+  size_t nprofiles; /**< Number of build profile tokens */
+
+  uint64_t archmask; /**< Architectures listed in the architecture list
+                          (compiled only if the parser has \c restrictions) */
+  uint64_t archexclude; /**< Architectures listed negated (as \c !arch) */
+  size_t masks; /**< First build profile list in \c masks */
+  size_t nmasks; /**< Number of build profile lists */
+};
+
+/**
+ * A parsed relationship field
+ *
+ * A relationship field is a list of groups separated by commas, each of
+ * which is a list of alternative atoms separated by pipes. Restriction
+ * terms are kept in a single array, which atoms refer to by position.
+ *
+ * \note A dcRelation may be used to parse any number of fields in turn,
+ * which reuses its memory.
+ */
+struct _dcRelation
+{
+  dcRelationAtom *atoms; /**< Atoms, in order */
+  size_t count; /**< Number of atoms */
+  size_t size; /**< Allocated size of \c atoms */
+  size_t groups; /**< Number of groups */
+
+  dcRelationToken *terms; /**< Restriction terms of all atoms */
+  size_t nterms; /**< Number of terms */
+  size_t tsize; /**< Allocated size of \c terms */
+
+  /**
+   * Names to compile restrictions against, or \c NULL to leave them
+   * uncompiled. This may be set by the caller, and is not freed with the
+   * parser.
+   */
+  dcRestrictions *restrictions;
+  uint64_t *masks; /**< Build profile lists of all atoms, as pairs of
+                        (required, excluded) profile masks */
+  size_t nmasks; /**< Number of lists */
+  size_t msize; /**< Allocated number of lists in \c masks */
+};
+/* related methods */
+dcRelation * dc_relation_new(
+  void
+);
+dcStatus dc_relation_parse(
+  dcRelation *relation,
+  const dcParserBlock *block
+);
+int dc_relation_enabled(
+  const dcRelation *relation,
+  const dcRelationAtom *atom,
+  uint64_t arch,
+  uint64_t profiles
+);
+void dc_relation_free(
+  dcRelation **ptr
+);
+
+/** Number of names each of \ref dcRestrictions can tell apart */
+#define RESTRICTION_IDS 64
+
+/**
+ * Names of architectures and build profiles
+ *
+ * Restrictions are compiled into 64-bit masks, with one bit for each
+ * distinct architecture (or wildcard) and build profile name seen. This
+ * numbers those names, and is shared by every field to be evaluated
+ * together.
+ *
+ * \note At most \c RESTRICTION_IDS names of each kind can be told apart;
+ * parsing fields which use more fails with \c dcLimitErr.
+ */
+struct _dcRestrictions
+{
+  char *archs[RESTRICTION_IDS]; /**< Architecture names and wildcards */
+  size_t narchs; /**< Number of architecture names */
+  char *profiles[RESTRICTION_IDS]; /**< Build profile names */
+  size_t nprofiles; /**< Number of build profile names */
+};
+/* related methods */
+dcRestrictions * dc_restrictions_new(
+  void
+);
+int dc_restrictions_arch(
+  dcRestrictions *restrictions,
+  const char *name,
+  size_t len
+);
+int dc_restrictions_profile(
+  dcRestrictions *restrictions,
+  const char *name,
+  size_t len
+);
+uint64_t dc_restrictions_arch_mask(
+  const dcRestrictions *restrictions,
+  const char *arch
+);
+dcStatus dc_restrictions_profile_mask(
+  dcRestrictions *restrictions,
+  const char * const *profiles,
+  size_t count,
+  uint64_t *mask
+);
+void dc_restrictions_free(
+  dcRestrictions **ptr
+);
+
+#endif /* DEBCTRL_RELATION_H */
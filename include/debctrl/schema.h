@@ -0,0 +1,123 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Declarative control file schemas
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Internally, various flags describe the fields permitted by a schema.
+ *
+ * Briefly:
+ * - \c FIELD_REQUIRED means the field must be present in each paragraph
+ * - \c FIELD_MULTILINE means the field may have continuation lines
+ *
+ * For more details on how this works, see \ref schema.c
+ */
+
+#ifndef DEBCTRL_SCHEMA_H
+#define DEBCTRL_SCHEMA_H
+
+#include <debctrl/common.h>
+#include <debctrl/parser.h> /* for: dcParser */
+
+/**
+ * Flags describing a field permitted by a schema
+ */
+enum dcSchemaFieldFlags
+{
+  /**
+   * The field must be present in every paragraph of this kind.
+   */
+  FIELD_REQUIRED  = 1 << 0,
+
+  /**
+   * The field value may span multiple lines. Fields without this flag must
+   * consist of a single line of data.
+   */
+  FIELD_MULTILINE = 1 << 1
+};
+
+/**
+ * Types of file with a built-in schema
+ */
+enum dcSchemaType
+{
+  SCHEMA_CONTROL, /**< Source package control file, \c debian/control */
+  SCHEMA_DSC,     /**< Debian source control file, \c *.dsc */
+  SCHEMA_CHANGES  /**< Debian changes file, \c *.changes */
+};
+
+/**
+ * Description of a single field permitted by a schema
+ *
+ * Each field has a name (in the preferred CamelCase format, but where case is
+ * irrelevant for determining equivalence), a combination of
+ * \ref dcSchemaFieldFlags values and an optional validation function, which
+ * is given the text on the first line of the field.
+ */
+struct _dcSchemaField
+{
+  const char *name; /**< Field name */
+  unsigned int flags; /**< Combination of \ref dcSchemaFieldFlags */
+  dcStatus (*valid)( /**< Value validator, or \c NULL */
+    const char *
+  );
+};
+
+/**
+ * Description of a kind of paragraph in a file
+ *
+ * Each kind of paragraph lists the fields it permits and how many times it
+ * may occur in a file. Paragraphs of a file are matched against each kind of
+ * paragraph in order; for example, a \c debian/control file consists of one
+ * source paragraph followed by one or more binary package paragraphs.
+ */
+struct _dcSchemaParagraph
+{
+  const char *name; /**< Descriptive name, used in diagnostics */
+  const dcSchemaField *fields; /**< Table of permitted fields */
+  size_t count; /**< Number of elements in \c fields */
+
+  unsigned int min; /**< Minimum number of occurrences */
+  unsigned int max; /**< Maximum number of occurrences (0 = unlimited) */
+
+  short *slots; /**< Compiled dispatch table (field indexes, or -1) */
+  size_t mask; /**< Number of dispatch table slots, minus one */
+};
+
+/**
+ * A compiled schema
+ *
+ * Each dcSchema describes the paragraphs of a given type of file, along with
+ * the dispatch tables used to look up their fields.
+ */
+struct _dcSchema
+{
+  const char *name; /**< Descriptive name of the file type */
+
+  dcSchemaParagraph *paragraphs; /**< Kinds of paragraph, in file order */
+  size_t count; /**< Number of elements in \c paragraphs */
+};
+/* related methods */
+dcSchema * dc_schema_new(
+  enum dcSchemaType type
+);
+dcStatus dc_schema_validate(
+  const dcSchema *schema,
+  dcParser *parser
+);
+dcStatus dc_schema_validate_files(
+  const dcSchema *schema,
+  const char * const *paths,
+  size_t count,
+  unsigned int threads,
+  dcStatus *results
+);
+void dc_schema_free(
+  dcSchema **ptr
+);
+
+#endif /* DEBCTRL_SCHEMA_H */
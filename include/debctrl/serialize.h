@@ -0,0 +1,56 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * JSON and CBOR serialization
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref serialize.c
+ */
+
+#ifndef DEBCTRL_SERIALIZE_H
+#define DEBCTRL_SERIALIZE_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/parser.h> /* for: dcParser */
+#include <debctrl/util.h>   /* for: dcString */
+
+/**
+ * Flags controlling how parse trees are serialized
+ */
+enum dcSerializeFlags
+{
+  /**
+   * Write each field value as an array of its chunks, rather than a single
+   * string with lines joined by newlines.
+   */
+  SERIALIZE_CHUNKS = 1 << 0
+};
+
+/* related methods */
+dcStatus dc_json_write_section(
+  const dcParserSection *section,
+  dcString *buf,
+  int flags
+);
+dcStatus dc_json_write(
+  const dcParser *parser,
+  dcString *buf,
+  int flags
+);
+dcStatus dc_cbor_write_section(
+  const dcParserSection *section,
+  dcString *buf,
+  int flags
+);
+dcStatus dc_cbor_write(
+  const dcParser *parser,
+  dcString *buf,
+  int flags
+);
+
+#endif /* DEBCTRL_SERIALIZE_H */
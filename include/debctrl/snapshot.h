@@ -0,0 +1,88 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Archive snapshot history
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref snapshot.c
+ */
+
+#ifndef DEBCTRL_SNAPSHOT_H
+#define DEBCTRL_SNAPSHOT_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcErrorHandler */
+#include <debctrl/hash.h>   /* for: dcHashTable */
+#include <debctrl/parser.h> /* for: dcParserSection */
+
+/**
+ * A snapshot of an archive
+ *
+ * Each dcSnapshot refers to the paragraphs it contains by their ids in the
+ * \ref dcSnapshotStore holding it.
+ */
+struct _dcSnapshot
+{
+  char *name; /**< Name of the snapshot (e.g. its date) */
+  size_t *ids; /**< Ids of its paragraphs, in increasing order */
+  size_t count; /**< Number of paragraphs */
+};
+
+/**
+ * A store of archive snapshots
+ *
+ * A dcSnapshotStore holds any number of snapshots, with each distinct
+ * paragraph stored once and identified by its id, an index into
+ * \c sections.
+ */
+struct _dcSnapshotStore
+{
+  dcErrorHandler handler; /**< Warning/error handler */
+
+  dcParserSection **sections; /**< Distinct paragraphs, by id */
+  uint64_t *hashes; /**< Hash of each paragraph's bytes */
+  size_t *lengths; /**< Length of each paragraph, in bytes */
+  char **texts; /**< Bytes of each paragraph, to confirm matches by hash */
+  size_t count; /**< Number of distinct paragraphs */
+  size_t size; /**< Allocated size of the arrays above */
+  dcHashTable *ids; /**< Paragraph id + 1, by hash of its bytes */
+
+  dcSnapshot **snapshots; /**< Snapshots, in the order they were added */
+  size_t nsnapshots; /**< Number of snapshots */
+};
+/* related methods */
+dcSnapshotStore * dc_snapshot_store_new(
+  void
+);
+dcStatus dc_snapshot_store_add(
+  dcSnapshotStore *store,
+  const char *name,
+  const char *buf,
+  size_t len
+);
+dcStatus dc_snapshot_store_add_file(
+  dcSnapshotStore *store,
+  const char *name,
+  const char *path
+);
+dcSnapshot * dc_snapshot_store_find(
+  const dcSnapshotStore *store,
+  const char *name
+);
+dcStatus dc_snapshot_diff(
+  const dcSnapshot *a,
+  const dcSnapshot *b,
+  size_t **added,
+  size_t *nadded,
+  size_t **removed,
+  size_t *nremoved
+);
+void dc_snapshot_store_free(
+  dcSnapshotStore **ptr
+);
+
+#endif /* DEBCTRL_SNAPSHOT_H */
@@ -0,0 +1,26 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Sorting of package indexes
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref sort.c
+ */
+
+#ifndef DEBCTRL_SORT_H
+#define DEBCTRL_SORT_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/parser.h> /* for: dcParser */
+
+dcStatus dc_parser_sort(
+  dcParser *parser,
+  unsigned int threads
+);
+
+#endif /* DEBCTRL_SORT_H */
@@ -0,0 +1,86 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Parse statistics
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref stats.c
+ */
+
+#ifndef DEBCTRL_STATS_H
+#define DEBCTRL_STATS_H
+
+#include <debctrl/common.h>
+
+/** Number of buckets in each histogram of a \ref dcParserStats */
+#define STATS_BUCKETS 32
+
+/**
+ * Statistics about parsed input
+ *
+ * Each histogram counts sizes by their power of two: bucket \c i counts the
+ * sizes from \c 2^i up to, but not including, \c 2^(i+1), and bucket \c 0
+ * also counts sizes of \c 0. Sizes are in bytes, including line
+ * terminators.
+ *
+ * The counts for each input are kept apart until the input has been read
+ * in full, and only then added to these totals.
+ */
+struct _dcParserStats
+{
+  size_t lines[STATS_BUCKETS]; /**< Sizes of lines */
+  size_t fields[STATS_BUCKETS]; /**< Sizes of fields, with their
+                                     continuation lines */
+  size_t paragraphs[STATS_BUCKETS]; /**< Sizes of paragraphs */
+  size_t inputs[STATS_BUCKETS]; /**< Numbers of paragraphs in each input */
+
+  size_t nlines; /**< Number of lines */
+  size_t nfields; /**< Number of fields */
+  size_t nparagraphs; /**< Number of paragraphs */
+  size_t ninputs; /**< Number of inputs */
+  uint64_t bytes; /**< Total size of the inputs */
+
+  size_t field; /**< Size of the current field so far (internal) */
+  size_t paragraph; /**< Size of the current paragraph so far (internal) */
+  size_t count; /**< Paragraphs in the current input so far (internal) */
+  size_t input_lines[STATS_BUCKETS]; /**< Sizes of lines in the current
+                                          input (internal) */
+  size_t input_fields[STATS_BUCKETS]; /**< Sizes of fields in the current
+                                           input (internal) */
+  size_t input_paragraphs[STATS_BUCKETS]; /**< Sizes of paragraphs in the
+                                               current input (internal) */
+  size_t input_nlines; /**< Lines in the current input (internal) */
+  size_t input_nfields; /**< Fields in the current input (internal) */
+  uint64_t input_bytes; /**< Size of the current input (internal) */
+};
+/* related methods */
+dcParserStats * dc_parser_stats_new(
+  void
+);
+void dc_parser_stats_begin(
+  dcParserStats *stats
+);
+void dc_parser_stats_line(
+  dcParserStats *stats,
+  const char *line,
+  size_t len
+);
+void dc_parser_stats_end(
+  dcParserStats *stats
+);
+size_t dc_parser_stats_quantile(
+  const size_t *histogram,
+  unsigned int percent
+);
+void dc_parser_stats_apply(
+  const dcParserStats *stats
+);
+void dc_parser_stats_free(
+  dcParserStats **ptr
+);
+
+#endif /* DEBCTRL_STATS_H */
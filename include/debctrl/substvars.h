@@ -0,0 +1,76 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Substitution variables
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref substvars.c
+ */
+
+#ifndef DEBCTRL_SUBSTVARS_H
+#define DEBCTRL_SUBSTVARS_H
+
+#include <debctrl/common.h>
+#include <debctrl/error.h>  /* for: dcStatus */
+#include <debctrl/hash.h>   /* for: dcHashTable */
+#include <debctrl/parser.h> /* for: dcParser */
+#include <debctrl/util.h>   /* for: dcArena */
+
+/**
+ * A single substitution variable (internal)
+ */
+struct _dcSubstvar
+{
+  const char *name; /**< Variable name */
+  const char *value; /**< Value */
+};
+
+/**
+ * A table of substitution variables
+ *
+ * Names and values are kept in \c arena, as is the text of every chunk
+ * expanded by \ref dc_substvars_expand.
+ */
+struct _dcSubstvars
+{
+  dcHashTable *table; /**< \ref dcSubstvar structures, by hash of name */
+  size_t count; /**< Number of variables */
+  dcArena *arena; /**< Storage for names, values and expanded text */
+  dcString *buf; /**< Scratch buffer for expansion */
+};
+/* related methods */
+dcSubstvars * dc_substvars_new(
+  void
+);
+dcStatus dc_substvars_set(
+  dcSubstvars *substvars,
+  const char *name,
+  const char *value
+);
+const char * dc_substvars_get(
+  const dcSubstvars *substvars,
+  const char *name,
+  size_t len
+);
+dcStatus dc_substvars_read_buffer(
+  dcSubstvars *substvars,
+  const char *buf,
+  size_t len
+);
+dcStatus dc_substvars_read_file(
+  dcSubstvars *substvars,
+  const char *path
+);
+dcStatus dc_substvars_expand(
+  dcSubstvars *substvars,
+  dcParser *parser
+);
+void dc_substvars_free(
+  dcSubstvars **ptr
+);
+
+#endif /* DEBCTRL_SUBSTVARS_H */
@@ -0,0 +1,45 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Parallel processing facilities
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref thread.c
+ */
+
+#ifndef DEBCTRL_THREAD_H
+#define DEBCTRL_THREAD_H
+
+#include <debctrl/common.h>
+
+unsigned int dc_parallel_threads(
+  void
+);
+unsigned int dc_parallel_nodes(
+  void
+);
+unsigned int dc_parallel_node(
+  void
+);
+void dc_parallel_each_node(
+  void (*work)(
+    size_t,
+    void *
+  ),
+  void *arg
+);
+void dc_parallel_run(
+  size_t count,
+  unsigned int threads,
+  void (*work)(
+    size_t,
+    void *
+  ),
+  void *arg
+);
+
+#endif /* DEBCTRL_THREAD_H */
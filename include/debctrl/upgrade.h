@@ -0,0 +1,44 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Upgrade computation
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * For more details on how this works, see \ref upgrade.c
+ */
+
+#ifndef DEBCTRL_UPGRADE_H
+#define DEBCTRL_UPGRADE_H
+
+#include <debctrl/common.h>
+#include <debctrl/dpkg.h>   /* for: dcDpkgStatus */
+#include <debctrl/parser.h> /* for: dcParser */
+
+/**
+ * An available upgrade
+ *
+ * Each dcUpgrade pairs an installed package with the newest version of it
+ * found in the package indexes.
+ */
+struct _dcUpgrade
+{
+  dcDpkgEntry *installed; /**< Installed package record */
+  dcParserSection *candidate; /**< Index paragraph of the newest version */
+
+  const char *installed_version; /**< Installed version (in \c installed) */
+  const char *version; /**< Newest version (in \c candidate) */
+};
+/* related methods */
+dcStatus dc_upgrade_compute(
+  const dcDpkgStatus *status,
+  dcParser * const *indexes,
+  size_t count,
+  dcUpgrade **upgrades,
+  size_t *n
+);
+
+#endif /* DEBCTRL_UPGRADE_H */
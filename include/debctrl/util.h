@@ -10,6 +10,7 @@
  *
  * This provides utilities for:
  * - string manipulation
+ * - arena allocation
  *
  * These utilities are used internally by libdebctrl, and may also be useful
  * externally.
@@ -20,6 +21,8 @@
 #ifndef DEBCTRL_UTIL_H
 #define DEBCTRL_UTIL_H
 
+#include <stdio.h> /* for: FILE */
+
 #include <debctrl/common.h>
 
 char * dc_strchomp(
@@ -33,6 +36,14 @@ char * dc_strndup(
   const char *text,
   size_t n
 );
+char * dc_file_read(
+  const char *path,
+  size_t *len
+);
+FILE * dc_file_temp(
+  const char *path,
+  char **tmp
+);
 
 /**
  * An automatically-expanding string buffer
@@ -60,6 +71,11 @@ void dc_string_append(
   dcString *string,
   const char *text
 );
+int dc_string_append_n(
+  dcString *string,
+  const char *text,
+  size_t len
+);
 void dc_string_append_c(
   dcString *string,
   char c
@@ -68,8 +84,54 @@ int dc_string_resize(
   dcString *string,
   size_t size
 );
+void dc_string_tune(
+  size_t init,
+  size_t step
+);
 void dc_string_free(
   dcString **ptr
 );
 
+/**
+ * A reference counted arena allocator
+ *
+ * An arena hands out memory from large blocks, which are all freed at once
+ * when the last reference to the arena is dropped. This suits text produced
+ * in bulk (e.g. by \ref dc_substvars_expand) which lives as long as the
+ * data structures referring to it.
+ *
+ * \note Reference counts are not atomic, so an arena must not be shared
+ * between threads without locking.
+ */
+struct _dcArena
+{
+  void *blocks; /**< Most recent block; each begins with a pointer to the
+                     previous one */
+  char *next; /**< Next free byte in the current block */
+  size_t avail; /**< Free bytes left in the current block */
+  unsigned int refs; /**< Number of references to this arena */
+};
+/* related methods */
+dcArena * dc_arena_new(
+  void
+);
+void * dc_arena_alloc(
+  dcArena *arena,
+  size_t size
+);
+char * dc_arena_strndup(
+  dcArena *arena,
+  const char *text,
+  size_t len
+);
+dcArena * dc_arena_ref(
+  dcArena *arena
+);
+void dc_arena_tune(
+  size_t size
+);
+void dc_arena_free(
+  dcArena **ptr
+);
+
 #endif /* DEBCTRL_UTIL_H */
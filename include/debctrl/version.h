@@ -31,6 +31,7 @@
 struct _dcVersion
 {
   unsigned long epoch; /**< Epoch number */
+  int hasepoch; /**< Whether the epoch was given explicitly */
   char *version;  /**< Upstream version */
   char *revision; /**< Debian package revision */
 };
@@ -42,6 +43,21 @@ dcStatus dc_version_set(
   dcVersion *version,
   const char *vstring
 );
+int dc_version_compare(
+  const dcVersion *a,
+  const dcVersion *b
+);
+size_t dc_version_key(
+  const char *vstring,
+  unsigned char *buf,
+  size_t size
+);
+int dc_version_key_compare(
+  const unsigned char *a,
+  size_t alen,
+  const unsigned char *b,
+  size_t blen
+);
 void dc_version_clear(
   dcVersion *version
 );
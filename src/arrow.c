@@ -0,0 +1,1009 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Apache Arrow columnar export
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * This writes selected fields of every paragraph held by one or more parsers
+ * (e.g. all of the \c Packages files of an archive) as an Apache Arrow IPC
+ * file, also known as Feather version 2. Such files can be loaded directly
+ * into dataframes, e.g. using \c pyarrow.feather.read_table or
+ * \c pandas.read_feather.
+ *
+ * \par Columns
+ * Each field becomes a nullable UTF-8 column, with one row per paragraph;
+ * paragraphs without the field have a null value. Values spanning several
+ * lines (e.g. \c Description) have their lines joined with newlines.
+ * \par
+ * Fields known to have few distinct values (such as \c Section, \c Priority
+ * and \c Architecture) are dictionary-encoded: each distinct value is stored
+ * once, and rows hold 32-bit indexes into the dictionary. Values are matched
+ * to dictionary entries using a \ref dcHashTable.
+ *
+ * \par File Layout
+ * The file holds a schema, one dictionary batch per dictionary-encoded
+ * column and a single record batch, followed by a footer locating them. The
+ * metadata of each is a FlatBuffers table; as only a handful of tables are
+ * needed, they are encoded here by hand, front to back, rather than by
+ * depending on a FlatBuffers library. All data is little-endian, and every
+ * buffer is padded to a multiple of 8 bytes.
+ *
+ * \note Column data is limited to 2 GiB per column, since 32-bit offsets
+ * are used.
+ *
+ * \see The Arrow columnar format specification:
+ * https://arrow.apache.org/docs/format/Columnar.html
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memcmp, strlen */
+#include <strings.h>  /* for: strcasecmp */
+#include <stdio.h>    /* for: fopen, fwrite, etc. */
+
+#include <debctrl/arrow.h>
+#include <debctrl/error.h>
+#include <debctrl/hash.h>
+#include <debctrl/parser.h>
+#include <debctrl/util.h>
+
+/** Arrow metadata version 5 */
+#define ARROW_VERSION_V5        4
+
+/** Arrow Message header types (the MessageHeader union) */
+#define ARROW_HEADER_SCHEMA     1
+#define ARROW_HEADER_DICTIONARY 2
+#define ARROW_HEADER_BATCH      3
+
+/** Arrow column types (the Type union) */
+#define ARROW_TYPE_INT          2
+#define ARROW_TYPE_UTF8         5
+
+/** Largest offset representable in a column */
+#define ARROW_MAX_OFFSET        0x7fffffff
+
+/**
+ * Fields which are dictionary-encoded
+ *
+ * This list must be kept sorted (case-insensitively), since it is searched
+ * using \c bsearch.
+ */
+static const char *dc_arrow_dictionary[] = {
+  "Architecture",
+  "Build-Essential",
+  "Essential",
+  "Format",
+  "Important",
+  "Multi-Arch",
+  "Origin",
+  "Priority",
+  "Protected",
+  "Section",
+  "Status"
+};
+
+/**
+ * Column under construction (internal)
+ *
+ * Plain columns keep their values in \c offsets and \c data. For
+ * dictionary-encoded columns, those buffers hold the dictionary instead,
+ * and \c indices holds each row's dictionary index.
+ */
+typedef struct
+{
+  const char *name; /**< Field name */
+  int dictionary; /**< Nonzero if the column is dictionary-encoded */
+
+  dcString *validity; /**< Validity bitmap (bit set if not null) */
+  dcString *offsets; /**< 32-bit offsets of each value in \c data */
+  dcString *data; /**< Concatenated UTF-8 values */
+  size_t nulls; /**< Number of null values */
+
+  dcString *indices; /**< 32-bit dictionary index of each row */
+  dcHashTable *lookup; /**< Dictionary index + 1, by hash of value */
+  size_t values; /**< Number of dictionary entries */
+} dcArrowColumn;
+
+/**
+ * Compare a field name with an entry of the dictionary-encoded field list
+ * (helper function for bsearch)
+ *
+ * \param[in] key A pointer to the field name
+ * \param[in] entry A pointer to an element of \c dc_arrow_dictionary
+ *
+ * \return The result of \c strcasecmp
+ */
+static int dc_arrow_dictionary_cmp(
+  const void *key,
+  const void *entry
+) {
+  return strcasecmp((const char *) key, *(const char * const *) entry);
+}
+
+/**
+ * Append a 32-bit little-endian integer to a buffer (helper function)
+ *
+ * \param[in,out] buf The buffer
+ * \param[in] value The value to append
+ *
+ * \return Nonzero if successful
+ */
+static int dc_arrow_put32(
+  dcString *buf,
+  uint32_t value
+) {
+  char b[4];
+
+  b[0] = (char) (value & 0xff);
+  b[1] = (char) ((value >> 8) & 0xff);
+  b[2] = (char) ((value >> 16) & 0xff);
+  b[3] = (char) ((value >> 24) & 0xff);
+
+  return dc_string_append_n(buf, b, sizeof(b));
+}
+
+/**
+ * Store a little-endian integer at a position in a buffer (helper)
+ *
+ * \param[in,out] buf The buffer
+ * \param[in] pos The position at which to store the value
+ * \param[in] value The value to store
+ * \param[in] size The size of the value, in bytes
+ */
+static void dc_arrow_store(
+  dcString *buf,
+  size_t pos,
+  uint64_t value,
+  size_t size
+) {
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    buf->text[pos + i] = (char) ((value >> (8 * i)) & 0xff);
+}
+
+/**
+ * Append zero bytes to a buffer (helper function)
+ *
+ * \param[in,out] buf The buffer
+ * \param[in] n The number of bytes to append
+ *
+ * \return The position of the first byte appended
+ */
+static size_t dc_arrow_reserve(
+  dcString *buf,
+  size_t n
+) {
+  static const char zero[16] = { 0 };
+  size_t pos = buf->len;
+
+  while (n > 0)
+  {
+    size_t k = (n < sizeof(zero)) ? n : sizeof(zero);
+    dc_string_append_n(buf, zero, k);
+    n -= k;
+  }
+
+  return pos;
+}
+
+/**
+ * Pad a buffer with zero bytes to a multiple of some alignment (helper)
+ *
+ * \param[in,out] buf The buffer
+ * \param[in] align The alignment, in bytes
+ */
+static void dc_arrow_pad(
+  dcString *buf,
+  size_t align
+) {
+  if (buf->len % align != 0)
+    dc_arrow_reserve(buf, align - buf->len % align);
+}
+
+/**
+ * Write a FlatBuffers table (helper function)
+ *
+ * This writes a vtable followed by a table with zeroed slots for the given
+ * fields, and returns the position of each slot so they can be filled in.
+ * Fields are identified by their position in the table's schema.
+ *
+ * \param[in,out] fb The FlatBuffers buffer
+ * \param[in] n The number of fields in the table's schema
+ * \param[in] sizes The size of each field (\c 0 if it is omitted)
+ * \param[out] slots Set to the position of each field's slot
+ *
+ * \return The position of the table
+ */
+static size_t dc_arrow_table(
+  dcString *fb,
+  size_t n,
+  const size_t *sizes,
+  size_t *slots
+) {
+  size_t layout[8];
+  size_t off = 4; /* the table begins with the offset to its vtable */
+  size_t vtable;
+  size_t table;
+  size_t i;
+
+  assert(n <= 8);
+
+  for (i = 0; i < n; i++)
+  {
+    layout[i] = 0;
+    if (sizes[i] == 0)
+      continue;
+
+    off = (off + sizes[i] - 1) / sizes[i] * sizes[i];
+    layout[i] = off;
+    off += sizes[i];
+  }
+
+  dc_arrow_pad(fb, 2);
+  vtable = dc_arrow_reserve(fb, 4 + 2 * n);
+  dc_arrow_store(fb, vtable, 4 + 2 * n, 2);
+  dc_arrow_store(fb, vtable + 2, off, 2);
+  for (i = 0; i < n; i++)
+    dc_arrow_store(fb, vtable + 4 + 2 * i, layout[i], 2);
+
+  /* tables are aligned so that 8-byte fields are aligned too */
+  dc_arrow_pad(fb, 8);
+  table = dc_arrow_reserve(fb, off);
+  dc_arrow_store(fb, table, table - vtable, 4);
+
+  for (i = 0; i < n; i++)
+    slots[i] = table + layout[i];
+
+  return table;
+}
+
+/**
+ * Point an offset slot at an object (helper function)
+ *
+ * \param[in,out] fb The FlatBuffers buffer
+ * \param[in] slot The position of the offset
+ * \param[in] target The position of the object, which must follow the slot
+ */
+static void dc_arrow_link(
+  dcString *fb,
+  size_t slot,
+  size_t target
+) {
+  assert(target > slot);
+  dc_arrow_store(fb, slot, target - slot, 4);
+}
+
+/**
+ * Write a FlatBuffers vector (helper function)
+ *
+ * \param[in,out] fb The FlatBuffers buffer
+ * \param[in] count The number of elements
+ * \param[in] size The size of each element
+ * \param[in] align The alignment of each element
+ *
+ * \return The position of the vector; elements begin 4 bytes later
+ */
+static size_t dc_arrow_vector(
+  dcString *fb,
+  size_t count,
+  size_t size,
+  size_t align
+) {
+  size_t pos;
+
+  /* the elements follow the 32-bit length, and must be aligned */
+  dc_arrow_pad(fb, 4);
+  while ((fb->len + 4) % align != 0)
+    dc_arrow_reserve(fb, 4);
+
+  pos = dc_arrow_reserve(fb, 4 + count * size);
+  dc_arrow_store(fb, pos, count, 4);
+
+  return pos;
+}
+
+/**
+ * Write a FlatBuffers string (helper function)
+ *
+ * \param[in,out] fb The FlatBuffers buffer
+ * \param[in] text The string
+ *
+ * \return The position of the string
+ */
+static size_t dc_arrow_string(
+  dcString *fb,
+  const char *text
+) {
+  size_t pos;
+
+  dc_arrow_pad(fb, 4);
+  pos = fb->len;
+  dc_arrow_put32(fb, strlen(text));
+  dc_string_append_n(fb, text, strlen(text) + 1);
+
+  return pos;
+}
+
+/**
+ * Write a Schema table (helper function)
+ *
+ * \param[in,out] fb The FlatBuffers buffer
+ * \param[in] columns The columns
+ * \param[in] count The number of columns
+ *
+ * \return The position of the table
+ */
+static size_t dc_arrow_schema(
+  dcString *fb,
+  const dcArrowColumn *columns,
+  size_t count
+) {
+  /* Schema: endianness, fields */
+  static const size_t schema[] = { 0, 4 };
+  /* Field: name, nullable, type_type, type, dictionary, children */
+  static const size_t field[] = { 4, 1, 1, 4, 4, 4 };
+  static const size_t plain[] = { 4, 1, 1, 4, 0, 4 };
+  /* DictionaryEncoding: id, indexType */
+  static const size_t encoding[] = { 8, 4 };
+  /* Int: bitWidth, is_signed */
+  static const size_t integer[] = { 4, 1 };
+  size_t slots[8];
+  size_t fslots[8];
+  size_t dslots[8];
+  size_t table;
+  size_t fields;
+  size_t pos;
+  size_t i;
+
+  table = dc_arrow_table(fb, 2, schema, slots);
+  fields = dc_arrow_vector(fb, count, 4, 4);
+  dc_arrow_link(fb, slots[1], fields);
+
+  for (i = 0; i < count; i++)
+  {
+    pos = dc_arrow_table(fb, 6, columns[i].dictionary ? field : plain,
+      fslots);
+    dc_arrow_link(fb, fields + 4 + 4 * i, pos);
+
+    fb->text[fslots[1]] = 1;
+    fb->text[fslots[2]] = ARROW_TYPE_UTF8;
+
+    dc_arrow_link(fb, fslots[0], dc_arrow_string(fb, columns[i].name));
+    dc_arrow_link(fb, fslots[3], dc_arrow_table(fb, 0, NULL, NULL));
+
+    if (columns[i].dictionary)
+    {
+      pos = dc_arrow_table(fb, 2, encoding, dslots);
+      dc_arrow_link(fb, fslots[4], pos);
+      dc_arrow_store(fb, dslots[0], i, 8);
+
+      pos = dc_arrow_table(fb, 2, integer, slots);
+      dc_arrow_link(fb, dslots[1], pos);
+      dc_arrow_store(fb, slots[0], 32, 4);
+      fb->text[slots[1]] = 1;
+    }
+
+    dc_arrow_link(fb, fslots[5], dc_arrow_vector(fb, 0, 4, 4));
+  }
+
+  return table;
+}
+
+/**
+ * A buffer of a record batch body (internal)
+ */
+typedef struct
+{
+  const dcString *data; /**< Contents, or \c NULL if empty */
+  size_t offset; /**< Offset from the start of the body */
+  size_t length; /**< Length, in bytes */
+} dcArrowBuffer;
+
+/**
+ * Write a RecordBatch table (helper function)
+ *
+ * \param[in,out] fb The FlatBuffers buffer
+ * \param[in] rows The number of rows
+ * \param[in] nodes Pairs of (length, null count), one pair for each column
+ * \param[in] ncols The number of columns
+ * \param[in] buffers The body buffers
+ * \param[in] nbufs The number of body buffers
+ *
+ * \return The position of the table
+ */
+static size_t dc_arrow_batch(
+  dcString *fb,
+  size_t rows,
+  const size_t *nodes,
+  size_t ncols,
+  const dcArrowBuffer *buffers,
+  size_t nbufs
+) {
+  /* RecordBatch: length, nodes, buffers */
+  static const size_t batch[] = { 8, 4, 4 };
+  size_t slots[8];
+  size_t table;
+  size_t pos;
+  size_t i;
+
+  table = dc_arrow_table(fb, 3, batch, slots);
+  dc_arrow_store(fb, slots[0], rows, 8);
+
+  /* FieldNode structs: length, null_count */
+  pos = dc_arrow_vector(fb, ncols, 16, 8);
+  dc_arrow_link(fb, slots[1], pos);
+  for (i = 0; i < ncols; i++)
+  {
+    dc_arrow_store(fb, pos + 4 + 16 * i, nodes[2 * i], 8);
+    dc_arrow_store(fb, pos + 4 + 16 * i + 8, nodes[2 * i + 1], 8);
+  }
+
+  /* Buffer structs: offset, length */
+  pos = dc_arrow_vector(fb, nbufs, 16, 8);
+  dc_arrow_link(fb, slots[2], pos);
+  for (i = 0; i < nbufs; i++)
+  {
+    dc_arrow_store(fb, pos + 4 + 16 * i, buffers[i].offset, 8);
+    dc_arrow_store(fb, pos + 4 + 16 * i + 8, buffers[i].length, 8);
+  }
+
+  return table;
+}
+
+/**
+ * Begin a Message table (helper function)
+ *
+ * \param[in,out] fb The FlatBuffers buffer, which must be empty
+ * \param[in] type The type of the message header
+ * \param[in] body The length of the message body
+ *
+ * \return The position of the slot for the header offset
+ */
+static size_t dc_arrow_message(
+  dcString *fb,
+  int type,
+  size_t body
+) {
+  /* Message: version, header_type, header, bodyLength */
+  static const size_t message[] = { 2, 1, 4, 8 };
+  size_t slots[8];
+  size_t root;
+
+  root = dc_arrow_reserve(fb, 4);
+  dc_arrow_link(fb, root, dc_arrow_table(fb, 4, message, slots));
+
+  dc_arrow_store(fb, slots[0], ARROW_VERSION_V5, 2);
+  fb->text[slots[1]] = (char) type;
+  dc_arrow_store(fb, slots[3], body, 8);
+
+  return slots[2];
+}
+
+/**
+ * Location of a message in the file (internal)
+ */
+typedef struct
+{
+  size_t offset; /**< Offset of the message in the file */
+  size_t metadata; /**< Length of the metadata, including its prefix */
+  size_t body; /**< Length of the body */
+} dcArrowBlock;
+
+/**
+ * Write an encapsulated message to a file (helper function)
+ *
+ * \param[in] fp The file
+ * \param[in,out] offset The current offset in the file
+ * \param[in,out] fb The message metadata
+ * \param[in] buffers The body buffers
+ * \param[in] nbufs The number of body buffers
+ * \param[out] block Set to the location of the message
+ *
+ * \return Nonzero if successful
+ */
+static int dc_arrow_write_message(
+  FILE *fp,
+  size_t *offset,
+  dcString *fb,
+  const dcArrowBuffer *buffers,
+  size_t nbufs,
+  dcArrowBlock *block
+) {
+  static const char zero[8] = { 0 };
+  char prefix[8];
+  size_t pos = 0;
+  size_t i;
+
+  /* the metadata, with its prefix, must end on an 8-byte boundary */
+  dc_arrow_pad(fb, 8);
+
+  prefix[0] = prefix[1] = prefix[2] = prefix[3] = (char) 0xff;
+  prefix[4] = (char) (fb->len & 0xff);
+  prefix[5] = (char) ((fb->len >> 8) & 0xff);
+  prefix[6] = (char) ((fb->len >> 16) & 0xff);
+  prefix[7] = (char) ((fb->len >> 24) & 0xff);
+
+  if (fwrite(prefix, 1, 8, fp) != 8 ||
+    fwrite(fb->text, 1, fb->len, fp) != fb->len)
+    return 0;
+
+  block->offset = *offset;
+  block->metadata = 8 + fb->len;
+
+  for (i = 0; i < nbufs; i++)
+  {
+    if (buffers[i].length > 0 &&
+      fwrite(buffers[i].data->text, 1, buffers[i].length, fp) !=
+      buffers[i].length)
+      return 0;
+
+    pos = buffers[i].offset + buffers[i].length;
+    if (pos % 8 != 0 && fwrite(zero, 1, 8 - pos % 8, fp) != 8 - pos % 8)
+      return 0;
+    pos += (8 - pos % 8) % 8;
+  }
+
+  block->body = pos;
+  *offset += block->metadata + block->body;
+
+  return 1;
+}
+
+/**
+ * Lay out body buffers one after another (helper function)
+ *
+ * \param[in,out] buffers The body buffers, whose offsets are set
+ * \param[in] nbufs The number of body buffers
+ *
+ * \return The length of the body
+ */
+static size_t dc_arrow_layout(
+  dcArrowBuffer *buffers,
+  size_t nbufs
+) {
+  size_t pos = 0;
+  size_t i;
+
+  for (i = 0; i < nbufs; i++)
+  {
+    buffers[i].offset = pos;
+    buffers[i].length = (buffers[i].data == NULL) ? 0 : buffers[i].data->len;
+    pos += (buffers[i].length + 7) / 8 * 8;
+  }
+
+  return pos;
+}
+
+/**
+ * Append a value to a column (helper function)
+ *
+ * \param[in,out] column The column
+ * \param[in] row The row number
+ * \param[in] value The value (need not be \c NUL terminated), or \c NULL
+ * \param[in] len The length of the value
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcLimitErr if the column exceeds 2 GiB
+ */
+static dcStatus dc_arrow_append(
+  dcArrowColumn *column,
+  size_t row,
+  const char *value,
+  size_t len
+) {
+  const unsigned char *offsets;
+  size_t index = 0;
+  size_t iter = 0;
+  size_t start;
+  size_t end;
+  uint64_t hash;
+  void *found;
+
+  if (row % 8 == 0)
+  {
+    dc_arrow_reserve(column->validity, 1);
+    if (column->validity->len != row / 8 + 1)
+      return dcMemFullErr;
+  }
+
+  if (value == NULL)
+  {
+    column->nulls++;
+    if (!column->dictionary)
+      return dc_arrow_put32(column->offsets, column->data->len) ?
+        dcNoErr : dcMemFullErr;
+    return dc_arrow_put32(column->indices, 0) ? dcNoErr : dcMemFullErr;
+  }
+
+  column->validity->text[row / 8] |= (char) (1 << (row % 8));
+
+  if (column->dictionary)
+  {
+    /* look for an existing dictionary entry with the same value */
+    hash = dc_hash(value, len);
+    offsets = (const unsigned char *) column->offsets->text;
+    while ((found = dc_hash_table_find(column->lookup, hash, &iter)) != NULL)
+    {
+      index = (size_t) ((uintptr_t) found - 1);
+      start = offsets[4 * index] | (offsets[4 * index + 1] << 8) |
+        (offsets[4 * index + 2] << 16) |
+        ((size_t) offsets[4 * index + 3] << 24);
+      end = offsets[4 * index + 4] | (offsets[4 * index + 5] << 8) |
+        (offsets[4 * index + 6] << 16) |
+        ((size_t) offsets[4 * index + 7] << 24);
+      if (end - start == len &&
+        memcmp(column->data->text + start, value, len) == 0)
+        break;
+    }
+
+    if (found == NULL)
+    {
+      index = column->values++;
+      if (dc_hash_table_insert(column->lookup, hash,
+        (void *) (uintptr_t) (index + 1)) != dcNoErr)
+        return dcMemFullErr;
+    }
+
+    if (!dc_arrow_put32(column->indices, index))
+      return dcMemFullErr;
+    if (found != NULL)
+      return dcNoErr;
+  }
+
+  if (column->data->len + len > ARROW_MAX_OFFSET)
+    return dcLimitErr;
+
+  if (!dc_string_append_n(column->data, value, len) ||
+    !dc_arrow_put32(column->offsets, column->data->len))
+    return dcMemFullErr;
+
+  return dcNoErr;
+}
+
+/**
+ * Gather the value of a field into a buffer (helper function)
+ *
+ * \param[in] block The field
+ * \param[in,out] buf The buffer, which is emptied first
+ */
+static void dc_arrow_value(
+  dcParserBlock *block,
+  dcString *buf
+) {
+  dcParserChunk *chunk;
+
+  buf->len = 0;
+  buf->text[0] = '\0';
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    if (chunk != block->head)
+      dc_string_append_c(buf, '\n');
+    if (chunk->text != NULL)
+      dc_string_append(buf, chunk->text);
+  }
+}
+
+/**
+ * Release the buffers of a column (helper function)
+ *
+ * \param[in,out] column The column
+ */
+static void dc_arrow_column_free(
+  dcArrowColumn *column
+) {
+  if (column->validity != NULL)
+    dc_string_free(&column->validity);
+  if (column->offsets != NULL)
+    dc_string_free(&column->offsets);
+  if (column->data != NULL)
+    dc_string_free(&column->data);
+  if (column->indices != NULL)
+    dc_string_free(&column->indices);
+  if (column->lookup != NULL)
+    dc_hash_table_free(&column->lookup);
+}
+
+/**
+ * Write the columns to an Arrow IPC file (helper function)
+ *
+ * \param[in] fp The file
+ * \param[in] columns The columns
+ * \param[in] count The number of columns
+ * \param[in] rows The number of rows
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the file could not be written
+ */
+static dcStatus dc_arrow_emit(
+  FILE *fp,
+  const dcArrowColumn *columns,
+  size_t count,
+  size_t rows
+) {
+  /* Footer: version, schema, dictionaries, recordBatches */
+  static const size_t footer[] = { 2, 4, 4, 4 };
+  dcArrowBuffer *buffers;
+  dcArrowBlock *blocks;
+  dcString *fb;
+  size_t *nodes;
+  size_t slots[8];
+  size_t nbufs = 0;
+  size_t nblocks = 0;
+  size_t ndicts = 0;
+  size_t offset = 8;
+  size_t body;
+  size_t pos;
+  size_t root;
+  size_t i;
+  size_t j;
+  dcStatus rc = dcFileErr;
+
+  fb = dc_string_new(0);
+  buffers = malloc(3 * (count + 1) * sizeof(dcArrowBuffer));
+  blocks = malloc((count + 2) * sizeof(dcArrowBlock));
+  nodes = malloc(2 * (count + 1) * sizeof(size_t));
+  if (fb == NULL || buffers == NULL || blocks == NULL || nodes == NULL)
+  {
+    rc = dcMemFullErr;
+    goto done;
+  }
+
+  if (fwrite("ARROW1\0\0", 1, 8, fp) != 8)
+    goto done;
+
+  /* schema */
+  pos = dc_arrow_message(fb, ARROW_HEADER_SCHEMA, 0);
+  dc_arrow_link(fb, pos, dc_arrow_schema(fb, columns, count));
+  if (!dc_arrow_write_message(fp, &offset, fb, NULL, 0, &blocks[nblocks]))
+    goto done;
+
+  /* one dictionary batch per dictionary-encoded column */
+  for (i = 0; i < count; i++)
+  {
+    /* DictionaryBatch: id, data */
+    static const size_t dictionary[] = { 8, 4 };
+
+    if (!columns[i].dictionary)
+      continue;
+
+    buffers[0].data = NULL;
+    buffers[1].data = columns[i].offsets;
+    buffers[2].data = columns[i].data;
+    body = dc_arrow_layout(buffers, 3);
+    nodes[0] = columns[i].values;
+    nodes[1] = 0;
+
+    fb->len = 0;
+    pos = dc_arrow_message(fb, ARROW_HEADER_DICTIONARY, body);
+    dc_arrow_link(fb, pos, dc_arrow_table(fb, 2, dictionary, slots));
+    dc_arrow_store(fb, slots[0], i, 8);
+    dc_arrow_link(fb, slots[1], dc_arrow_batch(fb, columns[i].values, nodes,
+      1, buffers, 3));
+
+    if (!dc_arrow_write_message(fp, &offset, fb, buffers, 3,
+      &blocks[++nblocks]))
+      goto done;
+    ndicts++;
+  }
+
+  /* the record batch */
+  for (i = 0; i < count; i++)
+  {
+    buffers[nbufs++].data = (columns[i].nulls > 0) ?
+      columns[i].validity : NULL;
+    if (columns[i].dictionary)
+      buffers[nbufs++].data = columns[i].indices;
+    else
+    {
+      buffers[nbufs++].data = columns[i].offsets;
+      buffers[nbufs++].data = columns[i].data;
+    }
+    nodes[2 * i] = rows;
+    nodes[2 * i + 1] = columns[i].nulls;
+  }
+  body = dc_arrow_layout(buffers, nbufs);
+
+  /* the validity bitmap may have a partial byte, which is still valid */
+  fb->len = 0;
+  pos = dc_arrow_message(fb, ARROW_HEADER_BATCH, body);
+  dc_arrow_link(fb, pos, dc_arrow_batch(fb, rows, nodes, count, buffers,
+    nbufs));
+  if (!dc_arrow_write_message(fp, &offset, fb, buffers, nbufs,
+    &blocks[++nblocks]))
+    goto done;
+
+  /* end-of-stream marker */
+  if (fwrite("\xff\xff\xff\xff\0\0\0\0", 1, 8, fp) != 8)
+    goto done;
+
+  /* footer */
+  fb->len = 0;
+  root = dc_arrow_reserve(fb, 4);
+  pos = dc_arrow_table(fb, 4, footer, slots);
+  dc_arrow_link(fb, root, pos);
+  dc_arrow_store(fb, slots[0], ARROW_VERSION_V5, 2);
+  dc_arrow_link(fb, slots[1], dc_arrow_schema(fb, columns, count));
+
+  /* Block structs: offset, metaDataLength, bodyLength */
+  for (j = 0; j < 2; j++)
+  {
+    size_t first = (j == 0) ? 1 : ndicts + 1;
+    size_t n = (j == 0) ? ndicts : 1;
+
+    pos = dc_arrow_vector(fb, n, 24, 8);
+    dc_arrow_link(fb, slots[2 + j], pos);
+    for (i = 0; i < n; i++)
+    {
+      dc_arrow_store(fb, pos + 4 + 24 * i, blocks[first + i].offset, 8);
+      dc_arrow_store(fb, pos + 4 + 24 * i + 8, blocks[first + i].metadata,
+        4);
+      dc_arrow_store(fb, pos + 4 + 24 * i + 16, blocks[first + i].body, 8);
+    }
+  }
+
+  if (fwrite(fb->text, 1, fb->len, fp) != fb->len)
+    goto done;
+
+  /* the footer is followed by its length and the magic string */
+  pos = fb->len;
+  fb->len = 0;
+  if (!dc_arrow_put32(fb, pos) || !dc_string_append_n(fb, "ARROW1", 6) ||
+    fwrite(fb->text, 1, fb->len, fp) != fb->len)
+    goto done;
+
+  rc = dcNoErr;
+
+done:
+  if (fb != NULL)
+    dc_string_free(&fb);
+  free(buffers);
+  free(blocks);
+  free(nodes);
+
+  return rc;
+}
+
+/**
+ * Export paragraphs as an Apache Arrow IPC file
+ *
+ * This writes one row for every (non-empty) paragraph held by the given
+ * parsers, in order, with one column for each of the requested fields. Field names are
+ * matched case-insensitively, and are used as the column names.
+ *
+ * Example:
+ * \code
+ * const char *fields[] = { "Package", "Version", "Section", "Installed-Size" };
+ * dc_arrow_write(&parser, 1, fields, 4, "packages.arrow");
+ * \endcode
+ *
+ * \param[in] parsers The parsers whose paragraphs are exported
+ * \param[in] count The number of parsers
+ * \param[in] fields The names of the fields to export
+ * \param[in] nfields The number of fields
+ * \param[in] path The path of the file to write
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the file could not be written
+ * \retval dcLimitErr if the data of a column exceeds 2 GiB
+ *
+ * \note On failure, a partially written file may be left behind.
+ */
+dcStatus dc_arrow_write(
+  dcParser * const *parsers,
+  size_t count,
+  const char * const *fields,
+  size_t nfields,
+  const char *path
+) {
+  dcArrowColumn *columns;
+  dcParserSection *section;
+  dcParserBlock *block;
+  dcString *value;
+  FILE *fp;
+  size_t rows = 0;
+  size_t i;
+  size_t j;
+  dcStatus rc = dcNoErr;
+
+  assert(parsers != NULL || count == 0);
+  assert(fields != NULL);
+  assert(nfields > 0);
+  assert(path != NULL);
+
+  if ((parsers == NULL && count > 0) || fields == NULL || nfields == 0 ||
+    path == NULL)
+    return dcParameterErr;
+
+  columns = malloc(nfields * sizeof(dcArrowColumn));
+  value = dc_string_new(0);
+  if (columns == NULL || value == NULL)
+  {
+    free(columns);
+    if (value != NULL)
+      dc_string_free(&value);
+    return dcMemFullErr;
+  }
+
+  for (i = 0; i < nfields; i++)
+  {
+    columns[i].name = fields[i];
+    columns[i].dictionary = (bsearch(fields[i], dc_arrow_dictionary,
+      sizeof(dc_arrow_dictionary) / sizeof(dc_arrow_dictionary[0]),
+      sizeof(dc_arrow_dictionary[0]), &dc_arrow_dictionary_cmp) != NULL);
+    columns[i].nulls = 0;
+    columns[i].values = 0;
+    columns[i].validity = dc_string_new(0);
+    columns[i].offsets = dc_string_new(0);
+    columns[i].data = dc_string_new(0);
+    columns[i].indices = NULL;
+    columns[i].lookup = NULL;
+
+    if (columns[i].dictionary)
+    {
+      columns[i].indices = dc_string_new(0);
+      columns[i].lookup = dc_hash_table_new(0);
+      if (columns[i].indices == NULL || columns[i].lookup == NULL)
+        rc = dcMemFullErr;
+    }
+
+    /* offsets always begin with the offset of the first value */
+    if (columns[i].validity == NULL || columns[i].offsets == NULL ||
+      columns[i].data == NULL || !dc_arrow_put32(columns[i].offsets, 0))
+      rc = dcMemFullErr;
+  }
+
+  for (i = 0; i < count && rc == dcNoErr; i++)
+  {
+    for (section = parsers[i]->head; section != NULL && rc == dcNoErr;
+      section = section->next)
+    {
+      /* skip the empty section that follows trailing blank lines */
+      if (section->head == NULL)
+        continue;
+
+      for (j = 0; j < nfields && rc == dcNoErr; j++)
+      {
+        block = dc_parser_section_find(section, fields[j]);
+        if (block == NULL)
+        {
+          rc = dc_arrow_append(&columns[j], rows, NULL, 0);
+          continue;
+        }
+
+        dc_arrow_value(block, value);
+        rc = dc_arrow_append(&columns[j], rows, value->text, value->len);
+      }
+      rows++;
+    }
+  }
+
+  if (rc == dcNoErr)
+  {
+    fp = fopen(path, "wb");
+    if (fp == NULL)
+      rc = dcFileErr;
+    else
+    {
+      rc = dc_arrow_emit(fp, columns, nfields, rows);
+      if (fclose(fp) != 0 && rc == dcNoErr)
+        rc = dcFileErr;
+    }
+  }
+
+  for (i = 0; i < nfields; i++)
+    dc_arrow_column_free(&columns[i]);
+  free(columns);
+  dc_string_free(&value);
+
+  return rc;
+}
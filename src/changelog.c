@@ -0,0 +1,512 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Debian changelog parser
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * After control files, \c debian/changelog is the file nearly every tool
+ * reads, usually just for the version and distribution of the latest
+ * entry. Each entry looks like:
+ * \code
+ * package (1:2.0-1) unstable; urgency=medium
+ *
+ *   * Some change.
+ *
+ *  -- Maintainer Name <maint@example.org>  Mon, 01 Jan 2024 00:00:00 +0000
+ * \endcode
+ *
+ * \par Scanning
+ * The changelog is read into a single buffer and split into lines with
+ * \c memchr, as \ref dc_parser_read_buffer does. Only the first byte of
+ * most lines is examined: change lines are indented, so a line starting in
+ * the first column is a header, and \c " -- " starts a trailer. Parsing
+ * stops once \c limit entries have been read, so finding the latest entry
+ * of a long changelog costs no more than for a short one; when reading a
+ * file, only as much of it is read as the entries need. Parsing also stops at
+ * the first line in the first column which is not a header, which is how
+ * old changelogs end (e.g. with "Local variables:" or "Old Changelog:").
+ *
+ * \par Storage
+ * Fields are split in place: the buffer is kept by the \ref dcChangelog,
+ * and \c NUL bytes are written over the delimiters in headers and
+ * trailers, so entries (including the strings of each \ref dcVersion)
+ * point into it rather than holding copies. When reading a file, the
+ * buffer is the one the file was read into, so nothing is copied at all.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memchr, memcmp, memcpy, memset, strchr */
+#include <strings.h>  /* for: strncasecmp */
+#include <ctype.h>    /* for: isdigit */
+#include <stdio.h>    /* for: fopen, fread, etc. */
+
+#include <debctrl/changelog.h>
+#include <debctrl/util.h>
+
+/**
+ * Construct a Changelog
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcChangelog object
+ */
+dcChangelog * dc_changelog_new(
+  void
+) {
+  dcChangelog *changelog = NEW(dcChangelog);
+
+  if (changelog == NULL)
+    return NULL;
+
+  changelog->buf = NULL;
+  changelog->len = 0;
+
+  changelog->entries = NULL;
+  changelog->count = 0;
+  changelog->size = 0;
+
+  return changelog;
+}
+
+/**
+ * Find the value of the urgency in an entry header (helper function)
+ *
+ * \param[in,out] text The text after the \c ; of the header, which is
+ * \c NUL terminated after the value
+ *
+ * \retval NULL if no urgency was given
+ * \return The urgency
+ */
+static char * dc_changelog_urgency(
+  char *text
+) {
+  char *eq;
+  char *end;
+
+  while (*text != '\0')
+  {
+    while (*text == ' ' || *text == '\t' || *text == ',')
+      text++;
+
+    eq = strchr(text, '=');
+    if (eq == NULL)
+      return NULL;
+
+    for (end = eq + 1; *end != '\0' && *end != ',' && *end != ' ' &&
+      *end != '\t'; end++)
+      ;
+
+    if (eq - text == 7 && strncasecmp(text, "urgency", 7) == 0)
+    {
+      *end = '\0';
+      return eq + 1;
+    }
+
+    text = end;
+  }
+
+  return NULL;
+}
+
+/**
+ * Parse an entry header line (helper function)
+ *
+ * \param[in,out] changelog A pointer to the changelog
+ * \param[in,out] line The start of the line
+ * \param[in,out] eol The end of the line, where a \c NUL may be written
+ * \param[in] lineno The line number
+ *
+ * \retval NULL if the line is not an entry header
+ * \return A pointer to the new entry
+ *
+ * \note There must be room for another entry in \c entries.
+ */
+static dcChangelogEntry * dc_changelog_header(
+  dcChangelog *changelog,
+  char *line,
+  char *eol,
+  size_t lineno
+) {
+  dcChangelogEntry *entry;
+  char *name;
+  char *open;
+  char *close;
+  char *vstart;
+  char *hyphen;
+  char *semi;
+  char *dist;
+  char *p;
+
+  /* package (version) distributions; options */
+  for (p = line; p < eol && *p != ' ' && *p != '\t' && *p != '('; p++)
+    ;
+  name = p;
+  while (p < eol && (*p == ' ' || *p == '\t'))
+    p++;
+  if (name == line || p == name || p == eol || *p != '(')
+    return NULL;
+
+  open = p;
+  close = memchr(open, ')', eol - open);
+  if (close == NULL || close == open + 1)
+    return NULL;
+  semi = memchr(close, ';', eol - close);
+  if (semi == NULL)
+    return NULL;
+
+  /* the epoch, if any, must be numeric */
+  vstart = open + 1;
+  p = memchr(vstart, ':', close - vstart);
+  if (p != NULL)
+  {
+    if (p == vstart)
+      return NULL;
+    for (; vstart < p; vstart++)
+    {
+      if (!isdigit((unsigned char) *vstart))
+        return NULL;
+    }
+    vstart = p + 1;
+  }
+
+  for (dist = close + 1; dist < semi && (*dist == ' ' || *dist == '\t');
+    dist++)
+    ;
+  for (p = semi; p > dist && (p[-1] == ' ' || p[-1] == '\t'); p--)
+    ;
+  if (p == dist)
+    return NULL;
+
+  entry = &changelog->entries[changelog->count++];
+  memset(entry, 0, sizeof(dcChangelogEntry));
+  entry->line = lineno;
+
+  /* the line is known to be a header, so split it */
+  if (eol > line && eol[-1] == '\r')
+    eol[-1] = '\0';
+  *eol = '\0';
+
+  *name = '\0';
+  entry->package = line;
+
+  entry->version.hasepoch = (vstart != open + 1);
+  entry->version.epoch = entry->version.hasepoch ?
+    strtoul(open + 1, NULL, 10) : 0;
+  for (hyphen = close; hyphen > vstart && hyphen[-1] != '-'; hyphen--)
+    ;
+  if (hyphen > vstart)
+  {
+    hyphen[-1] = '\0';
+    entry->version.revision = hyphen;
+  }
+  *close = '\0';
+  entry->version.version = vstart;
+
+  *p = '\0';
+  entry->distribution = dist;
+  entry->urgency = dc_changelog_urgency(semi + 1);
+
+  return entry;
+}
+
+/**
+ * Parse an entry trailer line (helper function)
+ *
+ * \param[in,out] entry The entry the trailer ends
+ * \param[in,out] line The start of the line, which begins with \c " -- "
+ * \param[in,out] eol The end of the line, where a \c NUL may be written
+ */
+static void dc_changelog_trailer(
+  dcChangelogEntry *entry,
+  char *line,
+  char *eol
+) {
+  char *gt;
+  char *date;
+
+  if (eol > line && eol[-1] == '\r')
+    eol--;
+
+  entry->maintainer = line + 4;
+  gt = memchr(line + 4, '>', eol - line - 4);
+  if (gt != NULL)
+  {
+    for (date = gt + 1; date < eol && (*date == ' ' || *date == '\t');
+      date++)
+      ;
+    if (date < eol)
+      entry->date = date;
+    gt[1] = '\0';
+  }
+
+  *eol = '\0';
+}
+
+/**
+ * Parse the buffer of a changelog (helper function)
+ *
+ * \param[in,out] changelog A pointer to the changelog, whose buffer must be
+ * \c NUL terminated
+ * \param[in] limit The number of entries to read, or \c 0 for all of them
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_changelog_parse(
+  dcChangelog *changelog,
+  size_t limit
+) {
+  dcChangelogEntry *entry = NULL;
+  char *end = changelog->buf + changelog->len;
+  char *line;
+  char *eol;
+  char *next;
+  char *p;
+  size_t lineno = 0;
+  size_t size;
+
+  for (line = changelog->buf; line < end; line = next)
+  {
+    eol = memchr(line, '\n', end - line);
+    if (eol == NULL)
+      eol = end;
+    next = (eol < end) ? eol + 1 : end;
+    lineno++;
+
+    for (p = line; p < eol && (*p == ' ' || *p == '\t' || *p == '\r'); p++)
+      ;
+    if (p == eol)
+      continue;
+
+    if (line[0] != ' ' && line[0] != '\t')
+    {
+      if (limit != 0 && changelog->count == limit)
+        break;
+
+      if (changelog->count == changelog->size)
+      {
+        size = (changelog->size == 0) ? 16 : changelog->size * 2;
+        entry = realloc(changelog->entries, size * sizeof(dcChangelogEntry));
+        if (entry == NULL)
+          return dcMemFullErr;
+        changelog->entries = entry;
+        changelog->size = size;
+      }
+
+      entry = dc_changelog_header(changelog, line, eol, lineno);
+      if (entry == NULL)
+        break;
+    }
+    else if (entry == NULL)
+      continue;
+    else if (eol - line >= 4 && memcmp(line, " -- ", 4) == 0)
+    {
+      dc_changelog_trailer(entry, line, eol);
+      entry = NULL;
+    }
+    else
+    {
+      if (entry->changes == NULL)
+        entry->changes = line;
+      entry->changeslen = eol - entry->changes;
+    }
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Parse a changelog from a buffer
+ *
+ * The buffer is copied, so it may be freed afterwards.
+ *
+ * \param[in,out] changelog A pointer to an empty changelog
+ * \param[in] buf The contents of the changelog
+ * \param[in] len The length of the contents
+ * \param[in] limit The number of entries to read, or \c 0 for all of them
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_changelog_read_buffer(
+  dcChangelog *changelog,
+  const char *buf,
+  size_t len,
+  size_t limit
+) {
+  assert(changelog != NULL);
+  assert(changelog->buf == NULL);
+  assert(buf != NULL || len == 0);
+
+  if (changelog == NULL || changelog->buf != NULL ||
+    (buf == NULL && len != 0))
+    return dcParameterErr;
+
+  changelog->buf = malloc(len + 1);
+  if (changelog->buf == NULL)
+    return dcMemFullErr;
+
+  memcpy(changelog->buf, buf, len);
+  changelog->buf[len] = '\0';
+  changelog->len = len;
+
+  return dc_changelog_parse(changelog, limit);
+}
+
+/**
+ * Read the start of a changelog file (helper function)
+ *
+ * The file is read in blocks of \ref CHANGELOG_READ_SIZE bytes, until the
+ * line which would start entry \c limit + 1 (or the end of the file). Any
+ * line starting in the first column is counted, since parsing stops at
+ * such a line whether or not it is a header.
+ *
+ * \param[in,out] changelog A pointer to an empty changelog
+ * \param[in] path The path to the changelog
+ * \param[in] limit The number of entries to read, which must not be \c 0
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcFileErr if the file cannot be read
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_changelog_read_prefix(
+  dcChangelog *changelog,
+  const char *path,
+  size_t limit
+) {
+  FILE *fp;
+  char *buf = NULL;
+  char *tmp;
+  char *eol;
+  size_t size = 0;
+  size_t len = 0;
+  size_t scanned = 0;
+  size_t headers = 0;
+  size_t n;
+  int bol = 1;
+  char c;
+
+  fp = fopen(path, "rb");
+  if (fp == NULL)
+    return dcFileErr;
+
+  for (;;)
+  {
+    if (len + CHANGELOG_READ_SIZE + 1 > size)
+    {
+      size = (size == 0) ? CHANGELOG_READ_SIZE + 1 : size * 2;
+      tmp = realloc(buf, size);
+      if (tmp == NULL)
+      {
+        free(buf);
+        fclose(fp);
+        return dcMemFullErr;
+      }
+      buf = tmp;
+    }
+
+    n = fread(buf + len, 1, CHANGELOG_READ_SIZE, fp);
+    if (n == 0)
+      break;
+    len += n;
+
+    /* check the first byte of each line, skipping to the next with memchr */
+    while (scanned < len)
+    {
+      c = buf[scanned];
+      if (bol && c != ' ' && c != '\t' && c != '\r' && c != '\n' &&
+        ++headers > limit)
+      {
+        len = scanned;
+        break;
+      }
+
+      eol = memchr(buf + scanned, '\n', len - scanned);
+      bol = (eol != NULL);
+      scanned = (eol == NULL) ? len : (size_t) (eol - buf) + 1;
+    }
+
+    if (headers > limit)
+      break;
+  }
+
+  if (ferror(fp))
+  {
+    free(buf);
+    fclose(fp);
+    return dcFileErr;
+  }
+
+  fclose(fp);
+  buf[len] = '\0';
+  changelog->buf = buf;
+  changelog->len = len;
+  return dcNoErr;
+}
+
+/**
+ * Parse a changelog from a file
+ *
+ * \param[in,out] changelog A pointer to an empty changelog
+ * \param[in] path The path to the changelog (e.g. "debian/changelog")
+ * \param[in] limit The number of entries to read, or \c 0 for all of them
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcFileErr if the file cannot be read
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_changelog_read_file(
+  dcChangelog *changelog,
+  const char *path,
+  size_t limit
+) {
+  dcStatus rc;
+
+  assert(changelog != NULL);
+  assert(changelog->buf == NULL);
+  assert(path != NULL);
+
+  if (changelog == NULL || changelog->buf != NULL || path == NULL)
+    return dcParameterErr;
+
+  if (limit != 0)
+  {
+    rc = dc_changelog_read_prefix(changelog, path, limit);
+    if (rc != dcNoErr)
+      return rc;
+
+    return dc_changelog_parse(changelog, limit);
+  }
+
+  changelog->buf = dc_file_read(path, &changelog->len);
+  if (changelog->buf == NULL)
+    return dcFileErr;
+
+  return dc_changelog_parse(changelog, limit);
+}
+
+/**
+ * Destroy a Changelog
+ *
+ * \param[in,out] ptr The address of a pointer to a Changelog
+ *
+ * \note The pointer will be set to \c NULL after memory is freed.
+ */
+void dc_changelog_free(
+  dcChangelog **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  free((*ptr)->buf);
+  free((*ptr)->entries);
+
+  free(*ptr);
+  *ptr = NULL;
+}
@@ -0,0 +1,518 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Typed field columns and aggregates
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Reports over package indexes (e.g. "total installed size per section")
+ * read the same few fields of every paragraph. Finding a field in each
+ * paragraph and converting its text every time is much slower than the
+ * arithmetic itself, so a \ref dcIndex can keep columns: arrays holding the
+ * converted value of a field for each paragraph.
+ *
+ * \par Lazy Conversion
+ * A column is only built when it is first requested with
+ * \ref dc_index_column, and is then cached in the index. When paragraphs
+ * are added to the index afterwards, only the new ones are converted, the
+ * next time the column is requested.
+ *
+ * \par Storage
+ * Numeric fields (such as \c Installed-Size and \c Size) are stored as
+ * 64-bit integers, with a bitmap of the paragraphs which have a value.
+ * Fields with few distinct values (such as \c Section, \c Priority and
+ * \c Architecture) are dictionary encoded: each paragraph has a 32-bit code
+ * for its value, so grouping by them needs no string comparisons.
+ *
+ * \par Aggregates
+ * \ref dc_column_stats and \ref dc_index_group are simple loops over these
+ * arrays. Bitmap words with every bit set (the common case) are summed
+ * without testing each bit.
+ *
+ * \note Requesting a column modifies the index's cache, so it must not be
+ * done concurrently with other use of the index.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: strcmp, strdup, strlen, memset */
+#include <strings.h>  /* for: strcasecmp */
+
+#include <debctrl/column.h>
+
+/** Bitmap word with every bit set */
+#define COLUMN_FULL     UINT64_C(0xffffffffffffffff)
+
+/**
+ * Parse an unsigned decimal number (helper function)
+ *
+ * \param[in] text The text of the value
+ * \param[out] value Set to the number
+ *
+ * \retval 0 if the text is not a number, or is too large
+ * \retval 1 if the number was parsed
+ */
+static int dc_column_parse(
+  const char *text,
+  uint64_t *value
+) {
+  uint64_t n = 0;
+  unsigned int digit;
+
+  if (*text == '\0')
+    return 0;
+
+  for (; *text != '\0'; text++)
+  {
+    digit = (unsigned int) (*text - '0');
+    if (digit > 9 || n > (UINT64_MAX - digit) / 10)
+      return 0;
+    n = n * 10 + digit;
+  }
+
+  *value = n;
+  return 1;
+}
+
+/**
+ * Find the code of a value in a dictionary column (helper function)
+ *
+ * New values are added to the dictionary.
+ *
+ * \param[in,out] column A pointer to a Column
+ * \param[in] text The value
+ *
+ * \retval 0 if there is a failure to allocate memory
+ * \return The code of the value
+ */
+static uint32_t dc_column_code(
+  dcColumn *column,
+  const char *text
+) {
+  const char **labels;
+  uint64_t hash = dc_hash(text, strlen(text));
+  void *value;
+  size_t iter = 0;
+  size_t size;
+
+  while ((value = dc_hash_table_find(column->lookup, hash, &iter)) != NULL)
+  {
+    if (strcmp(column->labels[(uintptr_t) value], text) == 0)
+      return (uint32_t) (uintptr_t) value;
+  }
+
+  if (column->nlabels >= UINT32_MAX)
+    return 0;
+
+  /* the array is sized in powers of two */
+  if ((column->nlabels & (column->nlabels - 1)) == 0)
+  {
+    size = 2 * column->nlabels;
+    labels = realloc(column->labels, size * sizeof(const char *));
+    if (labels == NULL)
+      return 0;
+    column->labels = labels;
+  }
+
+  if (dc_hash_table_insert(column->lookup, hash,
+    (void *) (uintptr_t) column->nlabels) != dcNoErr)
+    return 0;
+
+  column->labels[column->nlabels] = text;
+  return (uint32_t) column->nlabels++;
+}
+
+/**
+ * Convert the values of new paragraphs of an Index (helper function)
+ *
+ * \param[in,out] column A pointer to a Column
+ * \param[in] index A pointer to the Index the column belongs to
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory (the
+ * column then covers some of the new paragraphs)
+ */
+static dcStatus dc_column_extend(
+  dcColumn *column,
+  const dcIndex *index
+) {
+  dcParserBlock *block;
+  const char *text;
+  size_t words;
+  size_t size;
+  size_t i;
+  uint32_t code;
+
+  if (index->count > column->size)
+  {
+    size = index->size;
+    words = (size + 63) / 64;
+
+    if (column->type == COLUMN_NUMBER)
+    {
+      uint64_t *values = realloc(column->values, size * sizeof(uint64_t));
+      uint64_t *present;
+
+      if (values == NULL)
+        return dcMemFullErr;
+      column->values = values;
+
+      present = realloc(column->present, words * sizeof(uint64_t));
+      if (present == NULL)
+        return dcMemFullErr;
+      memset(present + (column->size + 63) / 64, 0,
+        (words - (column->size + 63) / 64) * sizeof(uint64_t));
+      column->present = present;
+    }
+    else
+    {
+      uint32_t *codes = realloc(column->codes, size * sizeof(uint32_t));
+
+      if (codes == NULL)
+        return dcMemFullErr;
+      column->codes = codes;
+    }
+
+    column->size = size;
+  }
+
+  for (i = column->count; i < index->count; i++)
+  {
+    text = NULL;
+    block = dc_parser_section_find(index->sections[i], column->field);
+    if (block != NULL && block->head != NULL)
+      text = block->head->text;
+
+    if (column->type == COLUMN_NUMBER)
+    {
+      column->values[i] = 0;
+      if (text != NULL && dc_column_parse(text, &column->values[i]))
+        column->present[i / 64] |= UINT64_C(1) << (i % 64);
+    }
+    else
+    {
+      code = 0;
+      if (text != NULL)
+      {
+        code = dc_column_code(column, text);
+        if (code == 0)
+          return dcMemFullErr;
+      }
+      column->codes[i] = code;
+    }
+
+    column->count = i + 1;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Get a column of an Index
+ *
+ * This returns the column holding the values of the given field for every
+ * paragraph of the index, building it (or converting the paragraphs added
+ * since it was built) if necessary. See \ref column.c for details.
+ *
+ * Example:
+ * \code
+ * column = dc_index_column(index, "Installed-Size", COLUMN_NUMBER);
+ * dc_column_stats(column, &stats);
+ * \endcode
+ *
+ * \param[in,out] index A pointer to an Index
+ * \param[in] field The field name
+ * \param[in] type How the values should be stored
+ *
+ * \retval NULL if the parameters are invalid, or there is a failure to
+ * allocate memory
+ * \return The column, which remains valid for as long as the index does
+ */
+const dcColumn * dc_index_column(
+  dcIndex *index,
+  const char *field,
+  enum dcColumnType type
+) {
+  dcColumn **columns;
+  dcColumn *column = NULL;
+  size_t i;
+
+  assert(index != NULL);
+  assert(field != NULL);
+
+  if (index == NULL || field == NULL)
+    return NULL;
+
+  for (i = 0; i < index->ncolumns && column == NULL; i++)
+  {
+    if (index->columns[i]->type == type &&
+      strcasecmp(index->columns[i]->field, field) == 0)
+      column = index->columns[i];
+  }
+
+  if (column == NULL)
+  {
+    columns = realloc(index->columns, (index->ncolumns + 1) *
+      sizeof(dcColumn *));
+    if (columns == NULL)
+      return NULL;
+    index->columns = columns;
+
+    column = NEW(dcColumn);
+    if (column == NULL)
+      return NULL;
+
+    memset(column, 0, sizeof(dcColumn));
+    column->type = type;
+    column->field = strdup(field);
+    if (type == COLUMN_DICTIONARY)
+    {
+      column->lookup = dc_hash_table_new(0);
+      column->labels = malloc(sizeof(const char *));
+      if (column->labels != NULL)
+        column->labels[0] = NULL;
+      column->nlabels = 1;
+    }
+
+    if (column->field == NULL || (type == COLUMN_DICTIONARY &&
+      (column->lookup == NULL || column->labels == NULL)))
+    {
+      dc_column_free(&column);
+      return NULL;
+    }
+
+    index->columns[index->ncolumns++] = column;
+  }
+
+  if (column->count < index->count &&
+    dc_column_extend(column, index) != dcNoErr)
+    return NULL;
+
+  return column;
+}
+
+/**
+ * Get a value of a numeric column
+ *
+ * \param[in] column A pointer to a Column of type \c COLUMN_NUMBER
+ * \param[in] paragraph The paragraph number
+ * \param[out] value Set to the value, if there is one
+ *
+ * \retval 0 if the paragraph has no value (or is out of range)
+ * \retval 1 if \c value was set
+ */
+int dc_column_number(
+  const dcColumn *column,
+  size_t paragraph,
+  uint64_t *value
+) {
+  assert(column != NULL);
+  assert(column->type == COLUMN_NUMBER);
+  assert(value != NULL);
+
+  if (paragraph >= column->count ||
+    !(column->present[paragraph / 64] & (UINT64_C(1) << (paragraph % 64))))
+    return 0;
+
+  *value = column->values[paragraph];
+  return 1;
+}
+
+/**
+ * Add a value to aggregates (helper function)
+ *
+ * \param[in,out] stats The aggregates
+ * \param[in] value The value
+ */
+static void dc_column_add(
+  dcColumnStats *stats,
+  uint64_t value
+) {
+  stats->count++;
+  stats->sum += value;
+  if (value < stats->min)
+    stats->min = value;
+  if (value > stats->max)
+    stats->max = value;
+}
+
+/**
+ * Compute aggregates of a numeric column
+ *
+ * This computes the number, sum, minimum and maximum of the values of a
+ * column. Paragraphs without a value are skipped.
+ *
+ * \param[in] column A pointer to a Column of type \c COLUMN_NUMBER
+ * \param[out] stats Set to the aggregates
+ *
+ * \note Sums wrap around if they exceed 2^64 - 1.
+ */
+void dc_column_stats(
+  const dcColumn *column,
+  dcColumnStats *stats
+) {
+  const uint64_t *values;
+  uint64_t bits;
+  size_t words;
+  size_t w;
+  size_t i;
+  size_t n;
+
+  assert(column != NULL);
+  assert(column->type == COLUMN_NUMBER);
+  assert(stats != NULL);
+
+  stats->count = 0;
+  stats->sum = 0;
+  stats->min = UINT64_MAX;
+  stats->max = 0;
+
+  words = (column->count + 63) / 64;
+  for (w = 0; w < words; w++)
+  {
+    values = column->values + w * 64;
+    bits = column->present[w];
+    n = column->count - w * 64;
+    if (n > 64)
+      n = 64;
+
+    if (bits == COLUMN_FULL)
+    {
+      for (i = 0; i < 64; i++)
+        dc_column_add(stats, values[i]);
+    }
+    else
+    {
+      for (i = 0; i < n; i++)
+      {
+        if (bits & (UINT64_C(1) << i))
+          dc_column_add(stats, values[i]);
+      }
+    }
+  }
+
+  if (stats->count == 0)
+    stats->min = 0;
+}
+
+/**
+ * Compute aggregates of a numeric field, grouped by another field
+ *
+ * This computes aggregates (see \ref dc_column_stats) of a numeric field
+ * for each distinct value of another field, using the columns of both (see
+ * \ref dc_index_column).
+ *
+ * Example:
+ * \code
+ * rc = dc_index_group(index, "Installed-Size", "Section", &groups, &labels,
+ *   &n);
+ * for (i = 1; i < n; i++)
+ *   printf("%s: %llu KiB\n", labels[i], (unsigned long long) groups[i].sum);
+ * free(groups);
+ * \endcode
+ *
+ * \param[in,out] index A pointer to an Index
+ * \param[in] field The name of the numeric field
+ * \param[in] by The name of the field to group by
+ * \param[out] groups Set to a dynamically allocated array of aggregates, one
+ * for each value of \c by. It should be released using \c free.
+ * \param[out] labels Set to the value of \c by for each group; group \c 0
+ * holds the paragraphs without a value, and its label is \c NULL. The
+ * labels belong to the index, and remain valid until paragraphs are next
+ * added to it.
+ * \param[out] count Set to the number of groups
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_index_group(
+  dcIndex *index,
+  const char *field,
+  const char *by,
+  dcColumnStats **groups,
+  const char * const **labels,
+  size_t *count
+) {
+  const dcColumn *values;
+  const dcColumn *keys;
+  dcColumnStats *stats;
+  size_t i;
+
+  assert(index != NULL);
+  assert(field != NULL);
+  assert(by != NULL);
+  assert(groups != NULL);
+  assert(labels != NULL);
+  assert(count != NULL);
+
+  if (index == NULL || field == NULL || by == NULL || groups == NULL ||
+    labels == NULL || count == NULL)
+    return dcParameterErr;
+
+  values = dc_index_column(index, field, COLUMN_NUMBER);
+  keys = dc_index_column(index, by, COLUMN_DICTIONARY);
+  if (values == NULL || keys == NULL)
+    return dcMemFullErr;
+
+  stats = malloc(keys->nlabels * sizeof(dcColumnStats));
+  if (stats == NULL)
+    return dcMemFullErr;
+
+  for (i = 0; i < keys->nlabels; i++)
+  {
+    stats[i].count = 0;
+    stats[i].sum = 0;
+    stats[i].min = UINT64_MAX;
+    stats[i].max = 0;
+  }
+
+  for (i = 0; i < values->count; i++)
+  {
+    if (values->present[i / 64] & (UINT64_C(1) << (i % 64)))
+      dc_column_add(&stats[keys->codes[i]], values->values[i]);
+  }
+
+  for (i = 0; i < keys->nlabels; i++)
+  {
+    if (stats[i].count == 0)
+      stats[i].min = 0;
+  }
+
+  *groups = stats;
+  *labels = keys->labels;
+  *count = keys->nlabels;
+
+  return dcNoErr;
+}
+
+/**
+ * Destroy a Column
+ *
+ * Columns belonging to an index are destroyed along with it (see
+ * \ref dc_index_free); this is only needed for others.
+ *
+ * \param[in,out] ptr The address of a pointer to a Column
+ *
+ * \note The pointer will be set to \c NULL after memory is freed.
+ */
+void dc_column_free(
+  dcColumn **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  free((*ptr)->field);
+  free((*ptr)->values);
+  free((*ptr)->present);
+  free((*ptr)->codes);
+  free((*ptr)->labels);
+  if ((*ptr)->lookup != NULL)
+    dc_hash_table_free(&(*ptr)->lookup);
+
+  free(*ptr);
+  *ptr = NULL;
+}
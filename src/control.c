@@ -31,6 +31,7 @@
 
 #include <debctrl/parser.h>
 #include <debctrl/error.h>
+#include <debctrl/position.h>
 #include <debctrl/control.h>
 #include <debctrl/validate.h>
 
@@ -164,6 +165,7 @@ dcStatus dc_control_parse(
   dcParserSection *section
 ) {
   dcParserBlock *block;
+  dcParserContext ctx;
   dcControlField needle; /* find this in the dc_field_table haystack */
   dcControlField *res; /* result if found */
 
@@ -181,8 +183,10 @@ dcStatus dc_control_parse(
       sizeof(dcControlField), dc_field_compare);
 
     if (res == NULL)
-      dc_warn(&control->handler, &block->head->ctx, _("Ignoring unknown "
-        "source package control field '%s'"), needle.name);
+      dc_warn(&control->handler,
+        dc_parser_position_context(&block->head->pos, &ctx),
+        _("Ignoring unknown source package control field '%s'"),
+        needle.name);
     else
       (*res->hook)(control, res->name, block);
 
@@ -212,6 +216,7 @@ static dcStatus dc_control_parse_package(
   dcParserBlock *block
 ) {
   dcParserChunk *chunk;
+  dcParserContext ctx;
 
   assert(control != NULL);
   assert(block != NULL);
@@ -224,17 +229,19 @@ static dcStatus dc_control_parse_package(
   switch (dc_valid_package(chunk->text))
   {
     case dcPackageLengthErr:
-      dc_warn(&control->handler, &chunk->ctx, _("Package names must be at "
-        "least two characters long (Sec. 5.6.1)"));
+      dc_warn(&control->handler, dc_parser_position_context(&chunk->pos,
+        &ctx), _("Package names must be at least two characters long "
+        "(Sec. 5.6.1)"));
       break;
     case dcPackagePrefixErr:
-     dc_warn(&control->handler, &chunk->ctx, _("Package names must begin "
-       "with a number or lower-case letter (Sec. 5.6.1)"));
+     dc_warn(&control->handler, dc_parser_position_context(&chunk->pos,
+       &ctx), _("Package names must begin with a number or lower-case "
+       "letter (Sec. 5.6.1)"));
       break;
     case dcPackageInvalidErr:
-     dc_warn(&control->handler, &chunk->ctx, _("Package names must contain "
-       "only lower-case alphabetic, numeric, or '+', '-', and '.' "
-       "characters (Sec. 5.6.1)"));
+     dc_warn(&control->handler, dc_parser_position_context(&chunk->pos,
+       &ctx), _("Package names must contain only lower-case alphabetic, "
+       "numeric, or '+', '-', and '.' characters (Sec. 5.6.1)"));
       break;
     case dcNoErr:
       break;
@@ -264,8 +271,9 @@ static dcStatus dc_control_parse_package(
   chunk = chunk->next;
   if (chunk != NULL)
   {
-    dc_warn(&control->handler, &chunk->ctx, _("Ignoring unexpected "
-      "continuation data in '%s' field"), name);
+    dc_warn(&control->handler, dc_parser_position_context(&chunk->pos,
+      &ctx), _("Ignoring unexpected continuation data in '%s' field"),
+      name);
   }
 
   return dcNoErr;
@@ -0,0 +1,696 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * dpkg status database reader
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * dpkg records the state of every installed package in the \c status file
+ * of its administrative directory (usually \c /var/lib/dpkg), which uses
+ * the same format as other control files. Changes made since the file was
+ * last written are journalled as files named with decimal numbers in the
+ * \c updates directory; each holds complete records which supersede the
+ * records for the same package (and architecture) in the \c status file, and
+ * are applied in numerical order.
+ *
+ * \par Incremental Reading
+ * Monitoring tools tend to read the database periodically, although only a
+ * few records change between reads. To avoid parsing the whole file every
+ * time, \ref dc_dpkg_status_read splits each file into paragraphs and
+ * hashes their bytes (see \ref dc_hash). Each record keeps a copy of its
+ * paragraph's bytes, so a paragraph whose hash matches a record from the
+ * previous read is compared with it byte for byte, and reuses its parsed data
+ * only if they are identical; new or changed paragraphs (and any that merely
+ * collide) are parsed. Reading then costs little more than a pass over the
+ * bytes of the file.
+ *
+ * \note dpkg rewrites the \c status file as a whole, so paragraphs are
+ * recognized by their contents rather than by their offsets.
+ *
+ * \see dpkg(1), in particular the description of \c --admindir
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: strcmp, strlen, memchr, etc. */
+#include <stdio.h>    /* for: snprintf */
+#include <errno.h>    /* for: errno */
+#include <dirent.h>   /* for: opendir, readdir, closedir */
+
+#include <debctrl/dpkg.h>
+#include <debctrl/hash.h>
+#include <debctrl/parser.h>
+#include <debctrl/util.h>
+
+/**
+ * Destroy a dpkg status entry (helper function)
+ *
+ * \param[in,out] ptr The address of a pointer to an entry
+ */
+static void dc_dpkg_entry_free(
+  dcDpkgEntry **ptr
+) {
+  if ((*ptr)->section != NULL)
+    dc_parser_section_free(&(*ptr)->section);
+
+  free((*ptr)->text);
+  free(*ptr);
+  *ptr = NULL;
+}
+
+/**
+ * Destroy all of the entries in a hash table (helper function)
+ *
+ * \param[in,out] ptr The address of a pointer to a Hash Table of entries
+ */
+static void dc_dpkg_table_free(
+  dcHashTable **ptr
+) {
+  dcDpkgEntry *entry;
+  size_t i;
+
+  for (i = 0; i < (*ptr)->size; i++)
+  {
+    entry = (*ptr)->slots[i].value;
+    if (entry != NULL)
+      dc_dpkg_entry_free(&entry);
+  }
+
+  dc_hash_table_free(ptr);
+}
+
+/**
+ * Construct a dpkg status database reader
+ *
+ * For details on the structure and its fields, see \ref dcDpkgStatus
+ *
+ * \param[in] admindir The path to the dpkg administrative directory, or
+ * \c NULL to use \ref DPKG_ADMINDIR
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcDpkgStatus object, with no entries until
+ * \ref dc_dpkg_status_read is called
+ */
+dcDpkgStatus * dc_dpkg_status_new(
+  const char *admindir
+) {
+  dcDpkgStatus *status = NEW(dcDpkgStatus);
+
+  if (status == NULL)
+    return NULL;
+
+  status->admindir = strdup((admindir == NULL) ? DPKG_ADMINDIR : admindir);
+  if (status->admindir == NULL)
+  {
+    free(status);
+    return NULL;
+  }
+
+  status->entries = NULL;
+  status->count = 0;
+  status->size = 0;
+  status->paragraphs = NULL;
+  status->packages = NULL;
+  status->parsed = 0;
+  status->reused = 0;
+
+  dc_error_handler_init(&status->handler);
+
+  return status;
+}
+
+/**
+ * Add an entry to a dpkg status database (helper function)
+ *
+ * If there is already an entry for the same package and architecture, it is
+ * superseded by the new one. Superseded entries are kept (only) in the
+ * \c paragraphs table, since the \c status file usually still contains them
+ * at the next read.
+ *
+ * \param[in,out] status A pointer to a dpkg status database
+ * \param[in] entry A pointer to the entry to add
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ *
+ * \note The database takes ownership of the entry, even on failure.
+ */
+static dcStatus dc_dpkg_add(
+  dcDpkgStatus *status,
+  dcDpkgEntry *entry
+) {
+  dcDpkgEntry **tmp;
+  dcDpkgEntry *old;
+  uint64_t key;
+  size_t iter = 0;
+  size_t size;
+
+  if (status->count == status->size)
+  {
+    size = (status->size == 0) ? 256 : status->size * 2;
+    tmp = realloc(status->entries, size * sizeof(dcDpkgEntry *));
+    if (tmp == NULL)
+    {
+      dc_dpkg_entry_free(&entry);
+      return dcMemFullErr;
+    }
+    status->entries = tmp;
+    status->size = size;
+  }
+
+  if (dc_hash_table_insert(status->paragraphs, entry->hash, entry) != dcNoErr)
+  {
+    dc_dpkg_entry_free(&entry);
+    return dcMemFullErr;
+  }
+
+  key = dc_hash(entry->package, strlen(entry->package));
+  while ((old = dc_hash_table_find(status->packages, key, &iter)) != NULL)
+  {
+    if (strcmp(old->package, entry->package) == 0 &&
+      strcmp(old->arch, entry->arch) == 0)
+      break;
+  }
+
+  if (old != NULL)
+  {
+    /* take over the superseded record's place */
+    entry->index = old->index;
+    status->entries[old->index] = entry;
+
+    dc_hash_table_remove(status->packages, key, old);
+  }
+  else
+  {
+    entry->index = status->count;
+    status->entries[status->count++] = entry;
+  }
+
+  return dc_hash_table_insert(status->packages, key, entry);
+}
+
+/**
+ * Parse a paragraph into a dpkg status entry (helper function)
+ *
+ * \param[in,out] status A pointer to a dpkg status database
+ * \param[in] path The path of the file, for diagnostics
+ * \param[in] line The line number at which the paragraph begins
+ * \param[in] buf The paragraph's bytes
+ * \param[in] len The length of the paragraph
+ * \param[out] entry Set to the new entry, or \c NULL if the paragraph has no
+ * \c Package field (and was ignored)
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \returns Otherwise, the status returned by \ref dc_parser_read_buffer
+ */
+static dcStatus dc_dpkg_parse(
+  dcDpkgStatus *status,
+  const char *path,
+  unsigned int line,
+  const char *buf,
+  size_t len,
+  dcDpkgEntry **entry
+) {
+  dcParser *parser;
+  dcParserBlock *block;
+  dcStatus rc;
+
+  *entry = NULL;
+
+  parser = dc_parser_new();
+  if (parser == NULL)
+    return dcMemFullErr;
+
+  /* report problems relative to the whole file */
+  parser->handler = status->handler;
+  parser->ctx.path = (char *) path;
+  parser->ctx.line = line - 1;
+
+  rc = dc_parser_read_buffer(parser, buf, len, NULL);
+  if (rc != dcNoErr)
+  {
+    dc_parser_free(&parser);
+    return rc;
+  }
+
+  *entry = NEW(dcDpkgEntry);
+  if (*entry == NULL)
+  {
+    dc_parser_free(&parser);
+    return dcMemFullErr;
+  }
+
+  /* a paragraph has no blank lines, so it becomes a single section */
+  (*entry)->section = parser->head;
+  (*entry)->text = NULL;
+  parser->head = NULL;
+  dc_parser_free(&parser);
+
+  block = dc_parser_section_find((*entry)->section, "Package");
+  if (block == NULL || block->head == NULL || block->head->text == NULL)
+  {
+    dc_warn(&status->handler, NULL, _("Ignoring record without a Package "
+      "field in '%s' at line %u"), path, line);
+    dc_dpkg_entry_free(entry);
+    return dcNoErr;
+  }
+  (*entry)->package = block->head->text;
+
+  block = dc_parser_section_find((*entry)->section, "Architecture");
+  if (block == NULL || block->head == NULL || block->head->text == NULL)
+    (*entry)->arch = "";
+  else
+    (*entry)->arch = block->head->text;
+
+  return dcNoErr;
+}
+
+/**
+ * Determine whether a line is blank (helper function)
+ *
+ * \param[in] p The start of the line
+ * \param[in] end The end of the line
+ *
+ * \return Nonzero if the line contains only whitespace
+ */
+static int dc_dpkg_blank(
+  const char *p,
+  const char *end
+) {
+  while (p < end)
+  {
+    if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+      return 0;
+    p++;
+  }
+  return 1;
+}
+
+/**
+ * Add a paragraph to a dpkg status database (helper function)
+ *
+ * If the paragraph's bytes are identical to those of an entry in \c cache,
+ * that entry is moved from the cache rather than parsing the paragraph again.
+ *
+ * \param[in,out] status A pointer to a dpkg status database
+ * \param[in,out] cache Entries from the previous read, by hash of their bytes
+ * \param[in] path The path of the file, for diagnostics
+ * \param[in] line The line number at which the paragraph begins
+ * \param[in] buf The paragraph's bytes
+ * \param[in] len The length of the paragraph
+ * \param[in] offset The byte offset of the paragraph in the file
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \returns Otherwise, the status returned by \ref dc_parser_read_buffer
+ */
+static dcStatus dc_dpkg_paragraph(
+  dcDpkgStatus *status,
+  dcHashTable *cache,
+  const char *path,
+  unsigned int line,
+  const char *buf,
+  size_t len,
+  size_t offset
+) {
+  dcDpkgEntry *entry;
+  uint64_t hash;
+  size_t iter = 0;
+  dcStatus rc;
+
+  hash = dc_hash(buf, len);
+
+  /* reuse the record from the last read if the bytes are unchanged */
+  while ((entry = dc_hash_table_find(cache, hash, &iter)) != NULL)
+  {
+    if (entry->length == len && memcmp(entry->text, buf, len) == 0)
+      break;
+  }
+
+  if (entry != NULL)
+  {
+    dc_hash_table_remove(cache, hash, entry);
+    status->reused++;
+  }
+  else
+  {
+    rc = dc_dpkg_parse(status, path, line, buf, len, &entry);
+    status->parsed++;
+    if (entry == NULL)
+      return rc;
+
+    entry->text = malloc(len);
+    if (entry->text == NULL)
+    {
+      dc_dpkg_entry_free(&entry);
+      return dcMemFullErr;
+    }
+    memcpy(entry->text, buf, len);
+  }
+
+  entry->offset = offset;
+  entry->length = len;
+  entry->hash = hash;
+
+  return dc_dpkg_add(status, entry);
+}
+
+/**
+ * Read the paragraphs of a file into a dpkg status database (helper)
+ *
+ * \param[in,out] status A pointer to a dpkg status database
+ * \param[in,out] cache Entries from the previous read, by hash of their bytes
+ * \param[in] path The path to the file to read
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcFileErr if the file could not be read
+ * \returns Otherwise, the status returned by \c dc_dpkg_paragraph
+ */
+static dcStatus dc_dpkg_read_file(
+  dcDpkgStatus *status,
+  dcHashTable *cache,
+  const char *path
+) {
+  char *buf;
+  const char *end;
+  const char *p;
+  const char *next = NULL;
+  const char *start = NULL;
+  unsigned int line = 1;
+  unsigned int first = 0;
+  size_t len;
+  dcStatus rc = dcNoErr;
+
+  buf = dc_file_read(path, &len);
+  if (buf == NULL)
+  {
+    dc_crit(&status->handler, NULL, _("Can't read file '%s': %s"),
+      path, strerror(errno));
+    return dcFileErr;
+  }
+
+  end = buf + len;
+  p = buf;
+  while (rc == dcNoErr)
+  {
+    if (p < end)
+    {
+      next = memchr(p, '\n', end - p);
+      next = (next == NULL) ? end : next + 1;
+
+      if (!dc_dpkg_blank(p, next))
+      {
+        if (start == NULL)
+        {
+          start = p;
+          first = line;
+        }
+        p = next;
+        line++;
+        continue;
+      }
+    }
+
+    /* paragraphs end at a blank line, or the end of the file */
+    if (start != NULL)
+    {
+      rc = dc_dpkg_paragraph(status, cache, path, first, start, p - start,
+        start - buf);
+      start = NULL;
+    }
+
+    if (p == end)
+      break;
+
+    p = next;
+    line++;
+  }
+
+  free(buf);
+
+  return rc;
+}
+
+/**
+ * Compare journal file names numerically (helper function for qsort)
+ *
+ * \param[in] a A pointer to the first name
+ * \param[in] b A pointer to the second name
+ *
+ * \return An integer less than, equal to or greater than zero, if \c a is
+ * found to be less than, equal to or greater than \c b, respectively
+ */
+static int dc_dpkg_journal_cmp(
+  const void *a,
+  const void *b
+) {
+  unsigned long x = strtoul(*(char * const *) a, NULL, 10);
+  unsigned long y = strtoul(*(char * const *) b, NULL, 10);
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * Replay the dpkg update journal (helper function)
+ *
+ * \param[in,out] status A pointer to a dpkg status database
+ * \param[in,out] cache Entries from the previous read, by hash of their bytes
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \returns Otherwise, the status returned by \ref dc_dpkg_read_file
+ */
+static dcStatus dc_dpkg_replay(
+  dcDpkgStatus *status,
+  dcHashTable *cache
+) {
+  DIR *dir;
+  struct dirent *ent;
+  char **names = NULL;
+  char **tmp;
+  char *path;
+  size_t count = 0;
+  size_t size = 0;
+  size_t i;
+  dcStatus rc = dcNoErr;
+
+  path = malloc(strlen(status->admindir) + sizeof("/updates/") + 32);
+  if (path == NULL)
+    return dcMemFullErr;
+
+  sprintf(path, "%s/updates", status->admindir);
+  dir = opendir(path);
+  if (dir == NULL)
+  {
+    /* no journal is the same as an empty one */
+    free(path);
+    return dcNoErr;
+  }
+
+  /* journal entries are named with decimal numbers only */
+  while ((ent = readdir(dir)) != NULL)
+  {
+    if (ent->d_name[0] == '\0' ||
+      ent->d_name[strspn(ent->d_name, "0123456789")] != '\0' ||
+      strlen(ent->d_name) > 20)
+      continue;
+
+    if (count == size)
+    {
+      size = (size == 0) ? 16 : size * 2;
+      tmp = realloc(names, size * sizeof(char *));
+      if (tmp == NULL)
+      {
+        rc = dcMemFullErr;
+        break;
+      }
+      names = tmp;
+    }
+
+    names[count] = strdup(ent->d_name);
+    if (names[count] == NULL)
+    {
+      rc = dcMemFullErr;
+      break;
+    }
+    count++;
+  }
+  closedir(dir);
+
+  if (count > 0)
+    qsort(names, count, sizeof(char *), dc_dpkg_journal_cmp);
+
+  for (i = 0; i < count; i++)
+  {
+    if (rc == dcNoErr)
+    {
+      sprintf(path, "%s/updates/%s", status->admindir, names[i]);
+      rc = dc_dpkg_read_file(status, cache, path);
+    }
+    free(names[i]);
+  }
+
+  free(names);
+  free(path);
+
+  return rc;
+}
+
+/**
+ * Read (or re-read) a dpkg status database
+ *
+ * This reads the \c status file of the administrative directory, and then
+ * applies the records journalled in its \c updates directory. When called
+ * again, paragraphs whose bytes have not changed since the previous read are
+ * not parsed again (see \ref dpkg.c for details).
+ *
+ * Example:
+ * \code
+ * status = dc_dpkg_status_new(NULL);
+ * for (;;)
+ * {
+ *   if (dc_dpkg_status_read(status) == dcNoErr)
+ *     report(status->entries, status->count);
+ *   sleep(60);
+ * }
+ * \endcode
+ *
+ * \param[in,out] status A pointer to a dpkg status database
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcFileErr if the database could not be read
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \returns Otherwise, the status returned by \ref dc_parser_read_buffer
+ *
+ * \note On failure, all records are discarded, so that the next read starts
+ * afresh.
+ *
+ * \note Pointers to entries from the previous read remain valid only if the
+ * entry is still present (i.e. it appears in \c entries).
+ */
+dcStatus dc_dpkg_status_read(
+  dcDpkgStatus *status
+) {
+  dcHashTable *cache;
+  char *path;
+  dcStatus rc;
+
+  assert(status != NULL);
+
+  if (status == NULL)
+    return dcParameterErr;
+
+  path = malloc(strlen(status->admindir) + sizeof("/status"));
+  if (path == NULL)
+    return dcMemFullErr;
+  sprintf(path, "%s/status", status->admindir);
+
+  /* the previous read's records become the cache for this one */
+  cache = status->paragraphs;
+  if (status->packages != NULL)
+    dc_hash_table_free(&status->packages);
+
+  status->paragraphs = dc_hash_table_new(status->count);
+  status->packages = dc_hash_table_new(status->count);
+  status->count = 0;
+  status->parsed = 0;
+  status->reused = 0;
+
+  if (status->paragraphs == NULL || status->packages == NULL)
+    rc = dcMemFullErr;
+  else if (cache == NULL && (cache = dc_hash_table_new(0)) == NULL)
+    rc = dcMemFullErr;
+  else
+  {
+    rc = dc_dpkg_read_file(status, cache, path);
+    if (rc == dcNoErr)
+      rc = dc_dpkg_replay(status, cache);
+  }
+
+  /* records that have disappeared since the last read */
+  if (cache != NULL)
+    dc_dpkg_table_free(&cache);
+
+  if (rc != dcNoErr)
+  {
+    status->count = 0;
+
+    if (status->paragraphs != NULL)
+      dc_dpkg_table_free(&status->paragraphs);
+    if (status->packages != NULL)
+      dc_hash_table_free(&status->packages);
+  }
+
+  free(path);
+
+  return rc;
+}
+
+/**
+ * Find a package record in a dpkg status database
+ *
+ * \param[in] status A pointer to a dpkg status database
+ * \param[in] package The name of the package
+ * \param[in] arch The architecture of the package, or \c NULL to match any
+ *
+ * \retval NULL if no such record exists
+ * \return A pointer to the record
+ */
+dcDpkgEntry * dc_dpkg_status_find(
+  const dcDpkgStatus *status,
+  const char *package,
+  const char *arch
+) {
+  dcDpkgEntry *entry;
+  size_t iter = 0;
+
+  assert(status != NULL);
+  assert(package != NULL);
+
+  if (status == NULL || package == NULL || status->packages == NULL)
+    return NULL;
+
+  while ((entry = dc_hash_table_find(status->packages,
+    dc_hash(package, strlen(package)), &iter)) != NULL)
+  {
+    if (strcmp(entry->package, package) == 0 &&
+      (arch == NULL || strcmp(entry->arch, arch) == 0))
+      return entry;
+  }
+
+  return NULL;
+}
+
+/**
+ * Destroy a dpkg status database reader
+ *
+ * Given a dcDpkgStatus that was allocated by \ref dc_dpkg_status_new, this
+ * will free all of its records before destroying the reader itself.
+ *
+ * \param[in,out] ptr The address of a pointer to a dpkg status database
+ *
+ * \note The pointer will be set to \c NULL after memory is freed.
+ */
+void dc_dpkg_status_free(
+  dcDpkgStatus **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  /* every entry (including superseded ones) is in the paragraphs table */
+  if ((*ptr)->paragraphs != NULL)
+    dc_dpkg_table_free(&(*ptr)->paragraphs);
+  if ((*ptr)->packages != NULL)
+    dc_hash_table_free(&(*ptr)->packages);
+
+  free((*ptr)->entries);
+  free((*ptr)->admindir);
+
+  free(*ptr);
+  *ptr = NULL;
+}
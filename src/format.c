@@ -0,0 +1,832 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Canonical control file formatter
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * The routines in this file rewrite parsed control data into a canonical
+ * form, in the style of the \c wrap-and-sort tool from \c devscripts, so
+ * that packaging repositories can be normalized in bulk.
+ *
+ * \par Canonical form
+ * - Fields are reordered into a canonical order (source package fields,
+ *   then relationship fields, then informational fields), with unknown
+ *   fields kept in their original relative order after the known ones. The
+ *   \c Description field always comes last.
+ * - Entries in relationship fields (e.g. \c Depends) are separated by
+ *   commas, have their whitespace normalized and are sorted by package
+ *   name. Entries which do not begin with a package name (such as
+ *   substitution variables like \c ${misc:Depends}) sort after all others.
+ *   The order of alternatives within an entry is significant, so it is
+ *   preserved; only the spacing around \c | is normalized.
+ * - Relationship fields and \c Uploaders which do not fit within the wrap
+ *   width are written with the field name on a line by itself, followed by
+ *   one entry per continuation line (like <tt>wrap-and-sort -s</tt>).
+ * - Other fields, including \c Description, are left as they are.
+ *
+ * \par Rewriting files
+ * Files are written out using \ref dc_parser_write, and are only replaced
+ * when the formatted output differs from the original contents. Since the
+ * parser discards comments, files containing comments are left untouched.
+ *
+ * \bug All error messages are in English and are not internationalized
+ */
+
+#include <string.h>   /* for: memcmp, strlen, etc. */
+#include <strings.h>  /* for: strcasecmp */
+#include <stdio.h>    /* for: fopen, rename, etc. */
+#include <errno.h>    /* for: errno */
+
+#include <debctrl/format.h>
+#include <debctrl/parser.h>
+#include <debctrl/error.h>
+#include <debctrl/thread.h>
+#include <debctrl/util.h>
+
+/** The field is a comma-separated relationship field, sorted and wrapped */
+#define FORMAT_RELATION   (1 << 0)
+/** The field is a comma-separated list, wrapped but not sorted */
+#define FORMAT_LIST       (1 << 1)
+
+/** Canonical rank of fields not listed in \c dc_format_table */
+#define RANK_UNKNOWN      500
+
+/**
+ * Information about how to format a field
+ *
+ * Each value of this type consists of a field name, its rank in canonical
+ * field order (lower ranks come first) and formatting flags.
+ */
+struct _dcFormatField
+{
+  const char *name;
+  unsigned int rank;
+  unsigned int flags;
+};
+typedef struct _dcFormatField dcFormatField;
+
+/**
+ * Table of field formatting information
+ *
+ * This is a simple sorted table (lookups occur using binary searches), like
+ * the field table in \ref control.c.
+ */
+static const dcFormatField dc_format_table[] = {
+  { "Architecture",              3, 0                },
+  { "Breaks",                   25, FORMAT_RELATION  },
+  { "Build-Conflicts",          15, FORMAT_RELATION  },
+  { "Build-Conflicts-Arch",     16, FORMAT_RELATION  },
+  { "Build-Conflicts-Indep",    17, FORMAT_RELATION  },
+  { "Build-Depends",            12, FORMAT_RELATION  },
+  { "Build-Depends-Arch",       13, FORMAT_RELATION  },
+  { "Build-Depends-Indep",      14, FORMAT_RELATION  },
+  { "Build-Profiles",            4, 0                },
+  { "Built-Using",              29, FORMAT_RELATION  },
+  { "Conflicts",                26, FORMAT_RELATION  },
+  { "Depends",                  21, FORMAT_RELATION  },
+  { "Description",            1000, 0                },
+  { "Enhances",                 24, FORMAT_RELATION  },
+  { "Essential",                 8, 0                },
+  { "Homepage",                 30, 0                },
+  { "Maintainer",               10, 0                },
+  { "Multi-Arch",                5, 0                },
+  { "Package",                   1, 0                },
+  { "Package-Type",              2, 0                },
+  { "Pre-Depends",              20, FORMAT_RELATION  },
+  { "Priority",                  7, 0                },
+  { "Protected",                 9, 0                },
+  { "Provides",                 28, FORMAT_RELATION  },
+  { "Recommends",               22, FORMAT_RELATION  },
+  { "Replaces",                 27, FORMAT_RELATION  },
+  { "Rules-Requires-Root",      18, 0                },
+  { "Section",                   6, 0                },
+  { "Source",                    0, 0                },
+  { "Standards-Version",        19, 0                },
+  { "Suggests",                 23, FORMAT_RELATION  },
+  { "Testsuite",                40, 0                },
+  { "Uploaders",                11, FORMAT_LIST      },
+  { "Vcs-Arch",                 32, 0                },
+  { "Vcs-Browser",              31, 0                },
+  { "Vcs-Bzr",                  33, 0                },
+  { "Vcs-Cvs",                  34, 0                },
+  { "Vcs-Darcs",                35, 0                },
+  { "Vcs-Git",                  36, 0                },
+  { "Vcs-Hg",                   37, 0                },
+  { "Vcs-Mtn",                  38, 0                },
+  { "Vcs-Svn",                  39, 0                }
+};
+/** Number of elements in \c dc_format_table */
+#define FORMAT_TABLE_SIZE   (sizeof (dc_format_table) / sizeof (dcFormatField))
+
+/**
+ * Comparison function for Format Field records
+ *
+ * This is a simple comparison function (using strcasecmp) to compare two
+ * \c dcFormatField objects, passed to \c bsearch.
+ */
+static int dc_format_field_compare(
+  const void *f1,
+  const void *f2
+) {
+  const dcFormatField *dcf1 = (dcFormatField *) f1;
+  const dcFormatField *dcf2 = (dcFormatField *) f2;
+
+  return strcasecmp(dcf1->name, dcf2->name);
+}
+
+/**
+ * Look up formatting information for a field
+ *
+ * \param[in] name The field name
+ *
+ * \retval NULL if the field is unknown
+ * \return The formatting information for the field
+ */
+static const dcFormatField * dc_format_lookup(
+  const char *name
+) {
+  dcFormatField needle;
+
+  needle.name = name;
+  return bsearch(&needle, dc_format_table, FORMAT_TABLE_SIZE,
+    sizeof(dcFormatField), dc_format_field_compare);
+}
+
+/**
+ * Initialize Formatting options
+ *
+ * This sets the options to their defaults: wrap at \ref WRAPLEN, sort both
+ * fields and relationships, only wrap long fields, and do not add trailing
+ * commas.
+ *
+ * For details on the structure and its fields, see \ref dcFormatOptions
+ *
+ * \param[out] options A pointer to a Formatting Options object
+ */
+void dc_format_options_init(
+  dcFormatOptions *options
+) {
+  assert(options != NULL);
+
+  options->width = WRAPLEN;
+  options->sort_fields = 1;
+  options->sort_relations = 1;
+  options->wrap_always = 0;
+  options->trailing_comma = 0;
+}
+
+/**
+ * Normalize whitespace in a list entry
+ *
+ * This internal helper copies a single list entry, collapsing each run of
+ * whitespace into a single space and removing whitespace at either end, as
+ * well as after opening and before closing parentheses and brackets.
+ * Alternatives are separated by exactly <tt>" | "</tt>.
+ *
+ * \param[in] text The start of the entry
+ * \param[in] len The length of the entry, in bytes
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return A dynamically allocated, normalized copy of the entry (which may be
+ * empty)
+ */
+static char * dc_format_entry(
+  const char *text,
+  size_t len
+) {
+  char *entry;
+  size_t out = 0;
+  size_t i;
+  int space = 0; /* whitespace is pending before the next character */
+
+  /* alternatives may grow from "a|b" to "a | b" */
+  entry = malloc(len * 3 + 1);
+  if (entry == NULL)
+    return NULL;
+
+  for (i = 0; i < len; i++)
+  {
+    char c = text[i];
+
+    if (c == ' ' || c == '\t' || c == '\n')
+    {
+      space = (out > 0);
+      continue;
+    }
+
+    if (c == '|')
+    {
+      if (out > 0)
+        entry[out++] = ' ';
+      entry[out++] = '|';
+      space = 1;
+      continue;
+    }
+
+    /* no whitespace before closing delimiters, or after opening ones */
+    if (space && c != ')' && c != ']' &&
+      entry[out-1] != '(' && entry[out-1] != '[')
+    {
+      entry[out++] = ' ';
+    }
+    space = 0;
+
+    entry[out++] = c;
+  }
+
+  entry[out] = '\0';
+  return entry;
+}
+
+/**
+ * Comparison function for relationship entries
+ *
+ * Entries beginning with a package name (a lower-case letter or a digit)
+ * come first, in byte order. Other entries, such as substitution variables,
+ * come last, also in byte order.
+ */
+static int dc_format_entry_compare(
+  const void *e1,
+  const void *e2
+) {
+  const char *s1 = *(const char * const *) e1;
+  const char *s2 = *(const char * const *) e2;
+  int p1 = ((*s1 >= 'a' && *s1 <= 'z') || (*s1 >= '0' && *s1 <= '9'));
+  int p2 = ((*s2 >= 'a' && *s2 <= 'z') || (*s2 >= '0' && *s2 <= '9'));
+
+  if (p1 != p2)
+    return p2 - p1;
+
+  return strcmp(s1, s2);
+}
+
+/**
+ * Append a new chunk to a block (helper function)
+ *
+ * \param[in,out] block The block to append to
+ * \param[in] text The text of the chunk, or \c NULL for an empty chunk
+ * \param[in] type The type of the chunk
+ * \param[in] pos The originating position of the chunk
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_format_chunk(
+  dcParserBlock *block,
+  const char *text,
+  enum dcParserChunkType type,
+  const dcParserPosition *pos
+) {
+  dcParserChunk *chunk;
+
+  chunk = dc_parser_chunk_new(text);
+  if (chunk == NULL)
+    return dcMemFullErr;
+
+  chunk->type = type;
+  chunk->pos = *pos;
+
+  dc_parser_block_append(block, chunk);
+  return dcNoErr;
+}
+
+/**
+ * Rewrite a comma-separated list field (helper function)
+ *
+ * This internal helper splits the value of a block into its comma-separated
+ * entries, normalizes and (optionally) sorts them, then replaces the chunks
+ * of the block with either a single line or one line per entry.
+ *
+ * \param[in,out] block The block to rewrite
+ * \param[in] sort Whether to sort the entries
+ * \param[in] options The formatting options
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_format_list(
+  dcParserBlock *block,
+  int sort,
+  const dcFormatOptions *options
+) {
+  dcParserPosition pos;
+  dcParserChunk *chunk;
+  dcParserChunk *next;
+  dcString *value;
+  dcString *line;
+  char **entries = NULL;
+  size_t count = 0;
+  size_t width;
+  size_t len;
+  size_t i;
+  char *start;
+  char *end;
+  dcStatus rc = dcMemFullErr;
+
+  pos = block->head->pos;
+  width = (options->width == 0) ? WRAPLEN : options->width;
+
+  /* gather the whole value, regardless of how it was split into lines */
+  value = dc_string_new(0);
+  if (value == NULL)
+    return dcMemFullErr;
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    if (chunk->text == NULL)
+      continue;
+
+    dc_string_append(value, chunk->text);
+    dc_string_append_c(value, ' ');
+  }
+
+  /* one more entry than there are commas, at most */
+  entries = malloc((value->len / 2 + 2) * sizeof(char *));
+  if (entries == NULL)
+    goto done;
+
+  len = strlen(block->name) + 1; /* "Name:" */
+  start = value->text;
+  for (;;)
+  {
+    end = strchr(start, ',');
+    if (end == NULL)
+      end = start + strlen(start);
+
+    entries[count] = dc_format_entry(start, end - start);
+    if (entries[count] == NULL)
+      goto done;
+
+    /* drop empty entries (e.g. following a trailing comma) */
+    if (*entries[count] == '\0')
+      free(entries[count]);
+    else
+      len += strlen(entries[count++]) + 2; /* " entry," */
+
+    if (*end == '\0')
+      break;
+    start = end + 1;
+  }
+
+  if (count == 0)
+  {
+    rc = dcNoErr;
+    goto done;
+  }
+
+  if (sort)
+    qsort(entries, count, sizeof(char *), &dc_format_entry_compare);
+
+  /* drop the original chunks */
+  chunk = block->head;
+  while (chunk != NULL)
+  {
+    next = chunk->next;
+    dc_parser_chunk_free(&chunk);
+    chunk = next;
+  }
+  block->head = NULL;
+  block->tail = NULL;
+
+  /* the whole value fits on one line (minus the final comma) */
+  if (!options->wrap_always && len - 1 <= width)
+  {
+    line = dc_string_new(len);
+    if (line == NULL)
+      goto done;
+
+    for (i = 0; i < count; i++)
+    {
+      if (i > 0)
+        dc_string_append(line, ", ");
+      dc_string_append(line, entries[i]);
+    }
+
+    rc = dc_format_chunk(block, line->text, CHUNK_FIXED, &pos);
+    dc_string_free(&line);
+    goto done;
+  }
+
+  rc = dc_format_chunk(block, NULL, CHUNK_EMPTY, &pos);
+  for (i = 0; i < count && rc == dcNoErr; i++)
+  {
+    if (i + 1 < count || options->trailing_comma)
+    {
+      len = strlen(entries[i]);
+      entries[i][len] = ','; /* there is room; see dc_format_entry */
+      entries[i][len+1] = '\0';
+    }
+
+    rc = dc_format_chunk(block, entries[i], CHUNK_MERGE, &pos);
+  }
+
+done:
+  for (i = 0; i < count; i++)
+    free(entries[i]);
+  free(entries);
+  dc_string_free(&value);
+
+  return rc;
+}
+
+/**
+ * Sort record used to reorder the fields of a section
+ */
+struct _dcFormatRank
+{
+  dcParserBlock *block; /**< The block */
+  unsigned int rank; /**< Canonical rank of the field */
+  size_t index; /**< Original position, to keep the sort stable */
+};
+typedef struct _dcFormatRank dcFormatRank;
+
+/**
+ * Comparison function for field ranks
+ */
+static int dc_format_rank_compare(
+  const void *r1,
+  const void *r2
+) {
+  const dcFormatRank *dcr1 = (dcFormatRank *) r1;
+  const dcFormatRank *dcr2 = (dcFormatRank *) r2;
+
+  if (dcr1->rank != dcr2->rank)
+    return (dcr1->rank < dcr2->rank) ? -1 : 1;
+
+  return (dcr1->index < dcr2->index) ? -1 : (dcr1->index > dcr2->index);
+}
+
+/**
+ * Format a Parser Section into canonical form
+ *
+ * This routine rewrites the blocks of a given \ref dcParserSection in place,
+ * as described in \ref format.c, and recomputes their hashes (see
+ * \ref dc_parser_section_hash).
+ *
+ * \param[in,out] section A pointer to a Parser Section
+ * \param[in] options Formatting options, or \c NULL for the defaults
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_format_section(
+  dcParserSection *section,
+  const dcFormatOptions *options
+) {
+  dcFormatOptions defaults;
+  const dcFormatField *field;
+  dcFormatRank *ranks;
+  dcParserBlock *block;
+  size_t count = 0;
+  size_t i;
+  dcStatus rc;
+
+  assert(section != NULL);
+
+  if (section == NULL)
+    return dcParameterErr;
+
+  if (options == NULL)
+  {
+    dc_format_options_init(&defaults);
+    options = &defaults;
+  }
+
+  for (block = section->head; block != NULL; block = block->next)
+  {
+    count++;
+
+    field = dc_format_lookup(block->name);
+    if (field == NULL || block->head == NULL)
+      continue;
+
+    if (field->flags & (FORMAT_RELATION | FORMAT_LIST))
+    {
+      rc = dc_format_list(block, options->sort_relations &&
+        (field->flags & FORMAT_RELATION), options);
+      if (rc != dcNoErr)
+        return rc;
+    }
+  }
+
+  /* the values may have changed; the order does not affect the hash */
+  dc_parser_section_hash(section);
+
+  if (!options->sort_fields || count < 2)
+    return dcNoErr;
+
+  ranks = malloc(count * sizeof(dcFormatRank));
+  if (ranks == NULL)
+    return dcMemFullErr;
+
+  for (i = 0, block = section->head; block != NULL; i++, block = block->next)
+  {
+    field = dc_format_lookup(block->name);
+
+    ranks[i].block = block;
+    ranks[i].rank = (field == NULL) ? RANK_UNKNOWN : field->rank;
+    ranks[i].index = i;
+  }
+
+  qsort(ranks, count, sizeof(dcFormatRank), &dc_format_rank_compare);
+
+  /* relink the blocks in their new order */
+  section->head = ranks[0].block;
+  section->tail = ranks[count-1].block;
+  for (i = 0; i < count; i++)
+  {
+    ranks[i].block->prev = (i > 0) ? ranks[i-1].block : NULL;
+    ranks[i].block->next = (i + 1 < count) ? ranks[i+1].block : NULL;
+  }
+
+  free(ranks);
+  return dcNoErr;
+}
+
+/**
+ * Format all of the sections of a Parser instance into canonical form
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in] options Formatting options, or \c NULL for the defaults
+ *
+ * \returns The first failing status returned by \ref dc_format_section, or
+ * \c dcNoErr if all sections were formatted successfully
+ */
+dcStatus dc_format_parser(
+  dcParser *parser,
+  const dcFormatOptions *options
+) {
+  dcParserSection *section;
+  dcStatus rc;
+
+  assert(parser != NULL);
+
+  if (parser == NULL)
+    return dcParameterErr;
+
+  for (section = parser->head; section != NULL; section = section->next)
+  {
+    rc = dc_format_section(section, options);
+    if (rc != dcNoErr)
+      return rc;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Determine whether file contents contain comment lines (helper function)
+ *
+ * \param[in] buf The contents of the file
+ * \param[in] len The length of the contents
+ *
+ * \return Nonzero if any line begins with \c #
+ */
+static int dc_format_comments(
+  const char *buf,
+  size_t len
+) {
+  const char *end = buf + len;
+  const char *ptr = buf;
+
+  while (ptr < end)
+  {
+    if (*ptr == '#')
+      return 1;
+
+    ptr = memchr(ptr, '\n', end - ptr);
+    if (ptr == NULL)
+      break;
+    ptr++;
+  }
+
+  return 0;
+}
+
+/**
+ * Format a control file in place
+ *
+ * This routine parses the given file, formats it into canonical form and
+ * writes it back, unless the formatted output is byte-identical to the
+ * original. The new contents are written to a temporary file which then
+ * replaces the original (keeping its permissions), so the file is never
+ * left half-written.
+ *
+ * \param[in] path The path to the file to format
+ * \param[in] options Formatting options, or \c NULL for the defaults
+ * \param[out] changed Set to \c 1 if the file was rewritten, or \c 0
+ * otherwise. May be \c NULL.
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the file could not be read or written
+ * \returns Otherwise, the status returned by \ref dc_parser_read_buffer
+ *
+ * \note Files containing comments are not rewritten, since comments are
+ * discarded by the parser; a warning is emitted instead.
+ */
+dcStatus dc_format_file(
+  const char *path,
+  const dcFormatOptions *options,
+  int *changed
+) {
+  dcParser *parser;
+  dcString *out = NULL;
+  char *orig;
+  char *tmp = NULL;
+  size_t len;
+  FILE *fp;
+  int written;
+  dcStatus rc;
+
+  assert(path != NULL);
+
+  if (changed != NULL)
+    *changed = 0;
+
+  if (path == NULL)
+    return dcParameterErr;
+
+  parser = dc_parser_new();
+  if (parser == NULL)
+    return dcMemFullErr;
+
+  orig = dc_file_read(path, &len);
+  if (orig == NULL)
+  {
+    dc_crit(&parser->handler, NULL, _("Can't read file '%s': %s"),
+      path, strerror(errno));
+    dc_parser_free(&parser);
+    return dcFileErr;
+  }
+
+  /* the parser drops comments, so refuse to rewrite them away */
+  if (dc_format_comments(orig, len))
+  {
+    dc_warn(&parser->handler, NULL, _("Not formatting '%s', since "
+      "comments would be lost"), path);
+    rc = dcNoErr;
+    goto done;
+  }
+
+  /* parse the contents already in memory, rather than reading them twice */
+  rc = dc_parser_read_buffer(parser, orig, len, path);
+  if (rc != dcNoErr)
+    goto done;
+
+  rc = dc_format_parser(parser, options);
+  if (rc != dcNoErr)
+    goto done;
+
+  out = dc_string_new(len + 1);
+  if (out == NULL)
+  {
+    rc = dcMemFullErr;
+    goto done;
+  }
+  dc_parser_write(parser, out);
+
+  /* skip the rewrite entirely if nothing changed */
+  if (out->len == len && memcmp(out->text, orig, len) == 0)
+    goto done;
+
+  fp = dc_file_temp(path, &tmp);
+  if (fp == NULL)
+  {
+    dc_crit(&parser->handler, NULL, _("Can't write file '%s': %s"),
+      path, strerror(errno));
+    rc = dcFileErr;
+    goto done;
+  }
+
+  /* close the file even if writing failed, and check both */
+  written = (fwrite(out->text, 1, out->len, fp) == out->len);
+  if (fclose(fp) != 0)
+    written = 0;
+
+  if (!written || rename(tmp, path) != 0)
+  {
+    dc_crit(&parser->handler, NULL, _("Can't write file '%s': %s"),
+      path, strerror(errno));
+    remove(tmp);
+    rc = dcFileErr;
+    goto done;
+  }
+
+  if (changed != NULL)
+    *changed = 1;
+
+done:
+  free(tmp);
+  free(orig);
+  if (out != NULL)
+    dc_string_free(&out);
+  dc_parser_free(&parser);
+
+  return rc;
+}
+
+/**
+ * Arguments shared by the workers of \ref dc_format_files
+ */
+struct _dcFormatBatch
+{
+  const char * const *paths; /**< Paths of files to format */
+  const dcFormatOptions *options; /**< Formatting options */
+  dcStatus *results; /**< Status of each file */
+  int *changed; /**< Whether each file was rewritten */
+};
+typedef struct _dcFormatBatch dcFormatBatch;
+
+/**
+ * Format a single file (batch worker)
+ *
+ * \param[in] index The index of the file to format
+ * \param[in,out] arg A pointer to the shared \c dcFormatBatch
+ */
+static void dc_format_one(
+  size_t index,
+  void *arg
+) {
+  dcFormatBatch *batch = arg;
+  dcStatus rc;
+
+  rc = dc_format_file(batch->paths[index], batch->options,
+    (batch->changed == NULL) ? NULL : &batch->changed[index]);
+
+  if (batch->results != NULL)
+    batch->results[index] = rc;
+}
+
+/**
+ * Format a batch of control files in place
+ *
+ * This routine formats each of the given files with \ref dc_format_file,
+ * spreading the work over several threads (see \ref dc_parallel_run).
+ *
+ * \param[in] paths An array of paths of files to format
+ * \param[in] count The number of elements in \c paths
+ * \param[in] options Formatting options, or \c NULL for the defaults
+ * \param[in] threads The maximum number of threads to use (\c 0 for one per
+ * online processor)
+ * \param[out] results An array of \c count elements which receives the
+ * status of each file, or \c NULL if it is not needed
+ * \param[out] changed An array of \c count elements which receives whether
+ * each file was rewritten, or \c NULL if it is not needed
+ *
+ * \retval dcNoErr if all of the files were formatted successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \return Otherwise, the first failing status, in order of \c paths
+ */
+dcStatus dc_format_files(
+  const char * const *paths,
+  size_t count,
+  const dcFormatOptions *options,
+  unsigned int threads,
+  dcStatus *results,
+  int *changed
+) {
+  dcFormatBatch batch;
+  dcStatus rc = dcNoErr;
+  size_t i;
+
+  assert(paths != NULL || count == 0);
+
+  if (paths == NULL && count > 0)
+    return dcParameterErr;
+
+  batch.paths = paths;
+  batch.options = options;
+  batch.results = results;
+  batch.changed = changed;
+
+  if (results == NULL && count > 0)
+  {
+    batch.results = malloc(count * sizeof(dcStatus));
+    if (batch.results == NULL)
+      return dcMemFullErr;
+  }
+
+  dc_parallel_run(count, threads, &dc_format_one, &batch);
+
+  for (i = 0; i < count; i++)
+  {
+    if (batch.results[i] != dcNoErr)
+    {
+      rc = batch.results[i];
+      break;
+    }
+  }
+
+  if (results == NULL)
+    free(batch.results);
+
+  return rc;
+}
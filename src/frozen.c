@@ -0,0 +1,965 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Frozen shared indexes
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * A \ref dcIndex lives in the memory of the process that built it. When
+ * many worker processes need the same index, \ref dc_index_freeze can
+ * instead write it out as a single flat image, which each process maps
+ * read-only with \ref dc_frozen_open. Since the image is mapped rather than
+ * read, opening it costs nothing beyond checking its header, and all of the
+ * processes share the same physical pages.
+ *
+ * Placing the image in \c /dev/shm (or any other \c tmpfs mount) keeps it
+ * in shared memory; elsewhere, it is shared through the page cache.
+ *
+ * \par Image Layout
+ * All references within the image are byte offsets rather than pointers, so
+ * it may be mapped at any address. The image begins with a header locating
+ * the following arrays, each aligned to 8 bytes:
+ * - paragraphs, each with its text (in control file format), its package
+ *   name and the range of its fields
+ * - fields, each with its name and value (with lines joined by newlines)
+ * - two open-addressing hash tables, mapping hashes (see \ref dc_hash) of
+ *   package names to paragraphs and of dependency names to postings
+ * - postings, each with a dependency name and the range of its list
+ * - lists of paragraph numbers for the postings
+ * - the index's summary (see \ref dcBloom), a Bloom filter used to rule out
+ *   lookups of absent packages without probing the hash table
+ * - strings, each \c NUL terminated, to which the others refer
+ *
+ * \par Replacement
+ * The image is written to a uniquely named temporary file which is then
+ * renamed over the old one, so processes which have the old image mapped are
+ * unaffected, a newly opened image is always complete, and concurrent writers
+ * do not clobber each other. To pick up a new image, processes simply close
+ * and reopen it.
+ *
+ * \note On systems without \c mmap, images are read into each process's
+ * own memory instead, so they are no longer shared.
+ *
+ * \note Images use the byte order of the machine which wrote them, and are
+ * rejected by machines with a different byte order.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memcmp, memcpy, strcmp, strlen */
+#include <strings.h>  /* for: strcasecmp */
+#include <stdio.h>    /* for: fopen, fwrite, rename, etc. */
+#include <fcntl.h>    /* for: open */
+#include <unistd.h>   /* for: close */
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h> /* for: mmap, munmap */
+#endif
+#include <sys/stat.h> /* for: fstat */
+
+#include <debctrl/frozen.h>
+#include <debctrl/hash.h>
+#include <debctrl/util.h>
+
+/** Magic number at the start of an image */
+#define FROZEN_MAGIC    "DCFROZEN"
+
+/** Version of the image layout */
+#define FROZEN_VERSION  2
+
+/** Written in native byte order, to detect images from other machines */
+#define FROZEN_ORDER    0x01020304
+
+/** Offset used in place of a missing string */
+#define FROZEN_NULL     UINT64_C(0xffffffffffffffff)
+
+/**
+ * Image header (internal)
+ */
+typedef struct
+{
+  char magic[8]; /**< \c FROZEN_MAGIC */
+  uint32_t version; /**< \c FROZEN_VERSION */
+  uint32_t order; /**< \c FROZEN_ORDER */
+  uint64_t size; /**< Size of the image, in bytes */
+
+  uint64_t paragraphs; /**< Offset of the paragraphs */
+  uint64_t nparagraphs; /**< Number of paragraphs */
+  uint64_t fields; /**< Offset of the fields */
+  uint64_t nfields; /**< Number of fields */
+  uint64_t packages; /**< Offset of the package name table */
+  uint64_t npackages; /**< Number of slots (a power of two) */
+  uint64_t rdepends; /**< Offset of the dependency name table */
+  uint64_t nrdepends; /**< Number of slots (a power of two) */
+  uint64_t postings; /**< Offset of the postings */
+  uint64_t npostings; /**< Number of postings */
+  uint64_t lists; /**< Offset of the posting lists */
+  uint64_t nlists; /**< Number of entries in all lists */
+  uint64_t summary; /**< Offset of the summary's words */
+  uint64_t nsummary; /**< Number of blocks in the summary, or \c 0 */
+  uint64_t strings; /**< Offset of the strings */
+  uint64_t nstrings; /**< Size of the strings, in bytes */
+} dcFrozenHeader;
+
+/**
+ * Paragraph record (internal)
+ */
+typedef struct
+{
+  uint64_t text; /**< String holding the paragraph's text */
+  uint64_t name; /**< String holding the package name, or \c FROZEN_NULL */
+  uint64_t field; /**< Number of the first field */
+  uint32_t length; /**< Length of the text */
+  uint32_t nfields; /**< Number of fields */
+} dcFrozenParagraph;
+
+/**
+ * Field record (internal)
+ */
+typedef struct
+{
+  uint64_t name; /**< String holding the field name */
+  uint64_t value; /**< String holding the value */
+  uint64_t length; /**< Length of the value */
+} dcFrozenField;
+
+/**
+ * Hash table slot (internal)
+ */
+typedef struct
+{
+  uint64_t key; /**< Hash of the name */
+  uint64_t value; /**< Paragraph or posting number + 1, or \c 0 if empty */
+} dcFrozenSlot;
+
+/**
+ * Posting record (internal)
+ */
+typedef struct
+{
+  uint64_t name; /**< String holding the dependency name */
+  uint64_t list; /**< Number of the first list entry */
+  uint64_t count; /**< Number of list entries */
+} dcFrozenPosting;
+
+/**
+ * Round up to a multiple of 8 (helper function)
+ *
+ * \param[in] n The value to round
+ *
+ * \return The rounded value
+ */
+static uint64_t dc_frozen_align(
+  uint64_t n
+) {
+  return (n + 7) & ~UINT64_C(7);
+}
+
+/**
+ * Find the number of slots for a hash table (helper function)
+ *
+ * \param[in] count The number of entries to store
+ *
+ * \return A power of two at least twice \c count
+ */
+static uint64_t dc_frozen_slots(
+  uint64_t count
+) {
+  uint64_t size = 16;
+
+  while (size < 2 * count)
+    size *= 2;
+
+  return size;
+}
+
+/**
+ * Insert an entry into a hash table (helper function)
+ *
+ * \param[in,out] slots The slots
+ * \param[in] size The number of slots
+ * \param[in] key The hash key
+ * \param[in] value The value (nonzero)
+ */
+static void dc_frozen_insert(
+  dcFrozenSlot *slots,
+  uint64_t size,
+  uint64_t key,
+  uint64_t value
+) {
+  uint64_t i = key & (size - 1);
+
+  while (slots[i].value != 0)
+    i = (i + 1) & (size - 1);
+
+  slots[i].key = key;
+  slots[i].value = value;
+}
+
+/**
+ * Add a string to the string area of an image (helper function)
+ *
+ * \param[in,out] strings The string area
+ * \param[in] text The text (need not be \c NUL terminated)
+ * \param[in] len The length of the text
+ * \param[in,out] ok Set to \c 0 if there is a failure to allocate memory
+ *
+ * \return The offset of the string
+ */
+static uint64_t dc_frozen_string(
+  dcString *strings,
+  const char *text,
+  size_t len,
+  int *ok
+) {
+  uint64_t pos = strings->len;
+
+  if (!dc_string_append_n(strings, text, len) ||
+    !dc_string_append_n(strings, "", 1))
+    *ok = 0;
+
+  return pos;
+}
+
+/**
+ * Write an Index as a frozen image
+ *
+ * This writes an image of the index to the given path, as described in
+ * \ref frozen.c, replacing any existing file atomically.
+ *
+ * Example:
+ * \code
+ * dc_index_freeze(index, "/dev/shm/debctrl.index");
+ * \endcode
+ *
+ * \param[in] index A pointer to an Index
+ * \param[in] path The path of the image
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the image could not be written
+ * \retval dcLimitErr if a paragraph's text exceeds 4 GiB
+ */
+dcStatus dc_index_freeze(
+  const dcIndex *index,
+  const char *path
+) {
+  dcFrozenHeader header;
+  dcFrozenParagraph *paragraphs = NULL;
+  dcFrozenField *fields = NULL;
+  dcFrozenSlot *packages = NULL;
+  dcFrozenSlot *rdepends = NULL;
+  dcFrozenPosting *postings = NULL;
+  uint32_t *lists = NULL;
+  dcIndexPostings *source;
+  dcParserSection *section;
+  dcParserBlock *block;
+  dcParserChunk *chunk;
+  dcString *strings = NULL;
+  dcString *text = NULL;
+  char *tmp = NULL;
+  FILE *fp = NULL;
+  uint64_t n;
+  size_t i;
+  size_t j;
+  size_t k;
+  int ok = 1;
+  dcStatus rc = dcMemFullErr;
+
+  assert(index != NULL);
+  assert(path != NULL);
+
+  if (index == NULL || path == NULL)
+    return dcParameterErr;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, FROZEN_MAGIC, sizeof(header.magic));
+  header.version = FROZEN_VERSION;
+  header.order = FROZEN_ORDER;
+
+  /* size each of the arrays */
+  header.nparagraphs = index->count;
+  for (i = 0; i < index->count; i++)
+  {
+    for (block = index->sections[i]->head; block != NULL; block = block->next)
+      header.nfields++;
+  }
+
+  if (index->summary != NULL)
+    header.nsummary = index->summary->nblocks;
+
+  header.npackages = dc_frozen_slots(index->count);
+  header.nrdepends = dc_frozen_slots(index->rdepends->count);
+  for (i = 0; i < index->rdepends->size; i++)
+  {
+    source = index->rdepends->slots[i].value;
+    if (source != NULL)
+    {
+      header.npostings++;
+      header.nlists += source->count;
+    }
+  }
+
+  paragraphs = calloc(header.nparagraphs + 1, sizeof(dcFrozenParagraph));
+  fields = calloc(header.nfields + 1, sizeof(dcFrozenField));
+  packages = calloc(header.npackages, sizeof(dcFrozenSlot));
+  rdepends = calloc(header.nrdepends, sizeof(dcFrozenSlot));
+  postings = calloc(header.npostings + 1, sizeof(dcFrozenPosting));
+  lists = calloc(header.nlists + 1, sizeof(uint32_t));
+  strings = dc_string_new(0);
+  text = dc_string_new(0);
+  if (paragraphs == NULL || fields == NULL || packages == NULL ||
+    rdepends == NULL || postings == NULL || lists == NULL ||
+    strings == NULL || text == NULL)
+    goto done;
+
+  /* paragraphs and their fields */
+  n = 0;
+  for (i = 0; i < index->count; i++)
+  {
+    section = index->sections[i];
+
+    text->len = 0;
+    text->text[0] = '\0';
+    if (!dc_parser_section_write(section, text))
+      goto done;
+    if (text->len > 0xffffffff)
+    {
+      rc = dcLimitErr;
+      goto done;
+    }
+
+    paragraphs[i].text = dc_frozen_string(strings, text->text, text->len,
+      &ok);
+    paragraphs[i].length = (uint32_t) text->len;
+    paragraphs[i].field = n;
+    paragraphs[i].name = FROZEN_NULL;
+    if (index->names[i] != NULL)
+    {
+      paragraphs[i].name = dc_frozen_string(strings, index->names[i],
+        strlen(index->names[i]), &ok);
+      dc_frozen_insert(packages, header.npackages,
+        dc_hash(index->names[i], strlen(index->names[i])), i + 1);
+    }
+
+    for (block = section->head; block != NULL; block = block->next)
+    {
+      text->len = 0;
+      text->text[0] = '\0';
+      for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+      {
+        if (chunk != block->head && !dc_string_append_n(text, "\n", 1))
+          goto done;
+        if (chunk->text != NULL &&
+          !dc_string_append_n(text, chunk->text, strlen(chunk->text)))
+          goto done;
+      }
+
+      fields[n].name = dc_frozen_string(strings, block->name,
+        strlen(block->name), &ok);
+      fields[n].value = dc_frozen_string(strings, text->text, text->len,
+      &ok);
+      fields[n].length = text->len;
+      paragraphs[i].nfields++;
+      n++;
+    }
+  }
+
+  /* reverse dependency postings */
+  n = 0;
+  for (i = 0, j = 0; i < index->rdepends->size; i++)
+  {
+    source = index->rdepends->slots[i].value;
+    if (source == NULL)
+      continue;
+
+    postings[j].name = dc_frozen_string(strings, source->name, source->len,
+      &ok);
+    postings[j].list = n;
+    postings[j].count = source->count;
+    for (k = 0; k < source->count; k++)
+      lists[n++] = (uint32_t) source->sections[k];
+
+    dc_frozen_insert(rdepends, header.nrdepends,
+      index->rdepends->slots[i].key, j + 1);
+    j++;
+  }
+
+  if (!ok)
+    goto done;
+
+  /* lay out the arrays */
+  header.paragraphs = dc_frozen_align(sizeof(header));
+  header.fields = dc_frozen_align(header.paragraphs +
+    header.nparagraphs * sizeof(dcFrozenParagraph));
+  header.packages = dc_frozen_align(header.fields +
+    header.nfields * sizeof(dcFrozenField));
+  header.rdepends = dc_frozen_align(header.packages +
+    header.npackages * sizeof(dcFrozenSlot));
+  header.postings = dc_frozen_align(header.rdepends +
+    header.nrdepends * sizeof(dcFrozenSlot));
+  header.lists = dc_frozen_align(header.postings +
+    header.npostings * sizeof(dcFrozenPosting));
+  header.summary = dc_frozen_align(header.lists +
+    header.nlists * sizeof(uint32_t));
+  header.strings = header.summary + header.nsummary * BLOOM_BLOCK *
+    sizeof(uint64_t);
+  header.nstrings = strings->len;
+  header.size = header.strings + header.nstrings;
+
+  /* write everything to a temporary file, then move it into place */
+  rc = dcFileErr;
+  fp = dc_file_temp(path, &tmp);
+  if (fp == NULL)
+    goto done;
+
+  if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+    fseek(fp, header.paragraphs, SEEK_SET) != 0 ||
+    fwrite(paragraphs, sizeof(dcFrozenParagraph), header.nparagraphs, fp) !=
+      header.nparagraphs ||
+    fseek(fp, header.fields, SEEK_SET) != 0 ||
+    fwrite(fields, sizeof(dcFrozenField), header.nfields, fp) !=
+      header.nfields ||
+    fseek(fp, header.packages, SEEK_SET) != 0 ||
+    fwrite(packages, sizeof(dcFrozenSlot), header.npackages, fp) !=
+      header.npackages ||
+    fseek(fp, header.rdepends, SEEK_SET) != 0 ||
+    fwrite(rdepends, sizeof(dcFrozenSlot), header.nrdepends, fp) !=
+      header.nrdepends ||
+    fseek(fp, header.postings, SEEK_SET) != 0 ||
+    fwrite(postings, sizeof(dcFrozenPosting), header.npostings, fp) !=
+      header.npostings ||
+    fseek(fp, header.lists, SEEK_SET) != 0 ||
+    fwrite(lists, sizeof(uint32_t), header.nlists, fp) != header.nlists ||
+    fseek(fp, header.summary, SEEK_SET) != 0 ||
+    (header.nsummary > 0 && fwrite(index->summary->words,
+      BLOOM_BLOCK * sizeof(uint64_t), header.nsummary, fp) !=
+      header.nsummary) ||
+    fseek(fp, header.strings, SEEK_SET) != 0 ||
+    fwrite(strings->text, 1, strings->len, fp) != strings->len)
+  {
+    fclose(fp);
+    remove(tmp);
+    goto done;
+  }
+
+  if (fclose(fp) != 0 || rename(tmp, path) != 0)
+  {
+    remove(tmp);
+    goto done;
+  }
+
+  rc = dcNoErr;
+
+done:
+  free(paragraphs);
+  free(fields);
+  free(packages);
+  free(rdepends);
+  free(postings);
+  free(lists);
+  free(tmp);
+  if (strings != NULL)
+    dc_string_free(&strings);
+  if (text != NULL)
+    dc_string_free(&text);
+
+  return rc;
+}
+
+/**
+ * Release the memory holding an image (helper function)
+ *
+ * \param[in] base The start of the image
+ * \param[in] size The size of the image
+ */
+static void dc_frozen_unmap(
+  void *base,
+  size_t size
+) {
+#ifdef HAVE_SYS_MMAN_H
+  munmap(base, size);
+#else
+  (void) size;
+  free(base);
+#endif
+}
+
+/**
+ * Open a frozen image
+ *
+ * This maps an image written by \ref dc_index_freeze read-only, after
+ * checking that its header is consistent with its size.
+ *
+ * For details on the structure and its fields, see \ref dcFrozenIndex
+ *
+ * \param[in] path The path of the image
+ *
+ * \retval NULL if the image could not be opened or mapped, was written by a
+ * machine with a different byte order or is corrupt, or there is a failure
+ * to allocate memory
+ * \return a dynamically allocated dcFrozenIndex object
+ */
+dcFrozenIndex * dc_frozen_open(
+  const char *path
+) {
+  const dcFrozenHeader *header;
+  dcFrozenIndex *frozen;
+  struct stat st;
+  void *base;
+  size_t size;
+  int fd;
+
+  assert(path != NULL);
+
+  if (path == NULL)
+    return NULL;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(dcFrozenHeader))
+  {
+    close(fd);
+    return NULL;
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  size = st.st_size;
+  base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return NULL;
+#else
+  /* without memory mapping, each process reads its own copy */
+  close(fd);
+  base = dc_file_read(path, &size);
+  if (base == NULL)
+    return NULL;
+#endif
+
+  frozen = NEW(dcFrozenIndex);
+  if (frozen == NULL)
+  {
+    dc_frozen_unmap(base, size);
+    return NULL;
+  }
+
+  frozen->base = base;
+  frozen->size = size;
+
+  /* every array must be aligned and lie within the image, and strings must
+   * be terminated */
+  header = base;
+  if (memcmp(header->magic, FROZEN_MAGIC, sizeof(header->magic)) != 0 ||
+    header->version != FROZEN_VERSION || header->order != FROZEN_ORDER ||
+    header->size != frozen->size ||
+    ((header->paragraphs | header->fields | header->packages |
+      header->rdepends | header->postings | header->lists |
+      header->summary) & 7) ||
+    header->paragraphs > frozen->size || header->nparagraphs >
+      (frozen->size - header->paragraphs) / sizeof(dcFrozenParagraph) ||
+    header->fields > frozen->size || header->nfields >
+      (frozen->size - header->fields) / sizeof(dcFrozenField) ||
+    header->packages > frozen->size || header->npackages >
+      (frozen->size - header->packages) / sizeof(dcFrozenSlot) ||
+    header->rdepends > frozen->size || header->nrdepends >
+      (frozen->size - header->rdepends) / sizeof(dcFrozenSlot) ||
+    header->postings > frozen->size || header->npostings >
+      (frozen->size - header->postings) / sizeof(dcFrozenPosting) ||
+    header->lists > frozen->size || header->nlists >
+      (frozen->size - header->lists) / sizeof(uint32_t) ||
+    header->summary > frozen->size ||
+    header->nsummary > (frozen->size - header->summary) /
+      (BLOOM_BLOCK * sizeof(uint64_t)) ||
+    header->strings > frozen->size ||
+    header->nstrings > frozen->size - header->strings ||
+    (header->nstrings > 0 &&
+      frozen->base[header->strings + header->nstrings - 1] != '\0') ||
+    header->npackages == 0 || (header->npackages & (header->npackages - 1)) ||
+    header->nrdepends == 0 || (header->nrdepends & (header->nrdepends - 1)))
+  {
+    dc_frozen_close(&frozen);
+    return NULL;
+  }
+
+  frozen->count = header->nparagraphs;
+
+  return frozen;
+}
+
+/**
+ * Find a string in a frozen image (helper function)
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] offset The offset of the string
+ * \param[in] length The length of the string, or \c 0 if it is not known
+ *
+ * \retval NULL if the string, with its terminating \c NUL, would not fit in
+ * the strings of the image
+ * \return The string
+ */
+static const char * dc_frozen_text_at(
+  const dcFrozenIndex *frozen,
+  uint64_t offset,
+  uint64_t length
+) {
+  const dcFrozenHeader *header = (const dcFrozenHeader *) frozen->base;
+
+  if (offset >= header->nstrings || length >= header->nstrings - offset)
+    return NULL;
+
+  return frozen->base + header->strings + offset;
+}
+
+/**
+ * Find a paragraph record in a frozen image (helper function)
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] paragraph The paragraph number
+ *
+ * \retval NULL if the paragraph number is out of range
+ * \return The paragraph record
+ */
+static const dcFrozenParagraph * dc_frozen_paragraph(
+  const dcFrozenIndex *frozen,
+  size_t paragraph
+) {
+  const dcFrozenHeader *header = (const dcFrozenHeader *) frozen->base;
+
+  if (paragraph >= header->nparagraphs)
+    return NULL;
+
+  return (const dcFrozenParagraph *) (frozen->base + header->paragraphs) +
+    paragraph;
+}
+
+/**
+ * Find the next candidate in a frozen hash table (helper function)
+ *
+ * \param[in] slots The slots
+ * \param[in] size The number of slots
+ * \param[in] key The hash key
+ * \param[in,out] iter Iteration state, as for \ref dc_hash_table_find
+ *
+ * \retval 0 if there are no more candidates
+ * \return The value of the next candidate
+ */
+static uint64_t dc_frozen_probe(
+  const dcFrozenSlot *slots,
+  uint64_t size,
+  uint64_t key,
+  size_t *iter
+) {
+  uint64_t i;
+
+  /* a corrupt table might have no empty slots, so bound the search */
+  while (*iter < size)
+  {
+    i = (key + *iter) & (size - 1);
+    if (slots[i].value == 0)
+      break;
+
+    (*iter)++;
+    if (slots[i].key == key)
+      return slots[i].value;
+  }
+
+  *iter = size;
+  return 0;
+}
+
+/**
+ * Check whether a frozen image may contain a package
+ *
+ * This works like \ref dc_index_may_contain, consulting the summary stored
+ * in the image.
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] package The package name
+ * \param[in] version The exact version, or \c NULL to accept any version
+ *
+ * \retval 0 if the image certainly has no paragraph for the package (with
+ * the given version)
+ * \retval 1 if it may have one
+ */
+int dc_frozen_may_contain(
+  const dcFrozenIndex *frozen,
+  const char *package,
+  const char *version
+) {
+  const dcFrozenHeader *header;
+
+  assert(frozen != NULL);
+  assert(package != NULL);
+
+  header = (const dcFrozenHeader *) frozen->base;
+  if (header->nsummary == 0)
+    return 1;
+
+  return dc_bloom_check_words((const uint64_t *) (frozen->base +
+    header->summary), header->nsummary, dc_index_key(package, version));
+}
+
+/**
+ * Find the paragraphs for a package in a frozen image
+ *
+ * This works like \ref dc_index_find, returning each matching paragraph
+ * number in turn. Set \c *iter to \c 0 before the first call.
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] package The package name
+ * \param[in,out] iter Iteration state
+ *
+ * \retval FROZEN_NONE if there are no more matching paragraphs
+ * \return The number of the next matching paragraph
+ */
+size_t dc_frozen_find(
+  const dcFrozenIndex *frozen,
+  const char *package,
+  size_t *iter
+) {
+  const dcFrozenHeader *header;
+  const dcFrozenParagraph *paragraph;
+  const char *name;
+  uint64_t key;
+  uint64_t value;
+
+  assert(frozen != NULL);
+  assert(package != NULL);
+  assert(iter != NULL);
+
+  header = (const dcFrozenHeader *) frozen->base;
+  key = dc_hash(package, strlen(package));
+
+  /* most lookups of absent packages end here */
+  if (*iter == 0 && header->nsummary > 0 && !dc_bloom_check_words(
+    (const uint64_t *) (frozen->base + header->summary), header->nsummary,
+    key))
+    return FROZEN_NONE;
+
+  while ((value = dc_frozen_probe((const dcFrozenSlot *) (frozen->base +
+    header->packages), header->npackages, key, iter)) != 0)
+  {
+    paragraph = dc_frozen_paragraph(frozen, value - 1);
+    if (paragraph == NULL)
+      continue;
+
+    name = dc_frozen_text_at(frozen, paragraph->name, 0);
+    if (name != NULL && strcmp(name, package) == 0)
+      return value - 1;
+  }
+
+  return FROZEN_NONE;
+}
+
+/**
+ * Find the paragraphs depending on a package in a frozen image
+ *
+ * This works like \ref dc_index_rdepends, returning each matching paragraph
+ * number in turn. Set \c *iter to \c 0 before the first call.
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] package The package name
+ * \param[in,out] iter Iteration state
+ *
+ * \retval FROZEN_NONE if there are no more matching paragraphs
+ * \return The number of the next matching paragraph
+ */
+size_t dc_frozen_rdepends(
+  const dcFrozenIndex *frozen,
+  const char *package,
+  size_t *iter
+) {
+  const dcFrozenHeader *header;
+  const dcFrozenPosting *posting;
+  const uint32_t *lists;
+  const char *name;
+  uint64_t key;
+  uint64_t value;
+  size_t probe = 0;
+
+  assert(frozen != NULL);
+  assert(package != NULL);
+  assert(iter != NULL);
+
+  header = (const dcFrozenHeader *) frozen->base;
+  key = dc_hash(package, strlen(package));
+  while ((value = dc_frozen_probe((const dcFrozenSlot *) (frozen->base +
+    header->rdepends), header->nrdepends, key, &probe)) != 0)
+  {
+    if (value > header->npostings)
+      continue;
+
+    posting = (const dcFrozenPosting *) (frozen->base + header->postings) +
+      (value - 1);
+    name = dc_frozen_text_at(frozen, posting->name, 0);
+    if (name == NULL || strcmp(name, package) != 0)
+      continue;
+
+    if (*iter >= posting->count || posting->list > header->nlists ||
+      posting->count > header->nlists - posting->list)
+      return FROZEN_NONE;
+
+    lists = (const uint32_t *) (frozen->base + header->lists);
+    return lists[posting->list + (*iter)++];
+  }
+
+  return FROZEN_NONE;
+}
+
+/**
+ * Find the paragraphs with a given field value in a frozen image
+ *
+ * This works like \ref dc_index_filter, returning each matching paragraph
+ * number in turn, except that the whole value (rather than its first line)
+ * is compared. Set \c *iter to \c 0 before the first call.
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] field The field name
+ * \param[in] value The value
+ * \param[in,out] iter Iteration state
+ *
+ * \retval FROZEN_NONE if there are no more matching paragraphs
+ * \return The number of the next matching paragraph
+ *
+ * \note This examines every paragraph of the image.
+ */
+size_t dc_frozen_filter(
+  const dcFrozenIndex *frozen,
+  const char *field,
+  const char *value,
+  size_t *iter
+) {
+  const char *found;
+
+  assert(frozen != NULL);
+  assert(field != NULL);
+  assert(value != NULL);
+  assert(iter != NULL);
+
+  while (*iter < frozen->count)
+  {
+    found = dc_frozen_field(frozen, (*iter)++, field, NULL);
+    if (found != NULL && strcmp(found, value) == 0)
+      return *iter - 1;
+  }
+
+  return FROZEN_NONE;
+}
+
+/**
+ * Get the text of a paragraph in a frozen image
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] paragraph The paragraph number
+ * \param[out] len Set to the length of the text, unless \c NULL
+ *
+ * \retval NULL if the paragraph number is out of range, or its text does
+ * not lie within the image
+ * \return The paragraph, in control file format (within the image, so it
+ * remains valid until the image is closed)
+ */
+const char * dc_frozen_text(
+  const dcFrozenIndex *frozen,
+  size_t paragraph,
+  size_t *len
+) {
+  const dcFrozenParagraph *record;
+  const char *text;
+
+  assert(frozen != NULL);
+
+  record = dc_frozen_paragraph(frozen, paragraph);
+  if (record == NULL)
+    return NULL;
+
+  text = dc_frozen_text_at(frozen, record->text, record->length);
+  if (text != NULL && len != NULL)
+    *len = record->length;
+
+  return text;
+}
+
+/**
+ * Get the value of a field of a paragraph in a frozen image
+ *
+ * Field names are matched case-insensitively. Values spanning several lines
+ * have their lines joined by newlines.
+ *
+ * \param[in] frozen A pointer to a Frozen Index
+ * \param[in] paragraph The paragraph number
+ * \param[in] field The field name
+ * \param[out] len Set to the length of the value, unless \c NULL
+ *
+ * \retval NULL if the paragraph number is out of range, the paragraph has
+ * no such field, or its value does not lie within the image
+ * \return The value (within the image, so it remains valid until the image
+ * is closed)
+ */
+const char * dc_frozen_field(
+  const dcFrozenIndex *frozen,
+  size_t paragraph,
+  const char *field,
+  size_t *len
+) {
+  const dcFrozenHeader *header;
+  const dcFrozenParagraph *record;
+  const dcFrozenField *fields;
+  const char *name;
+  const char *value;
+  uint64_t i;
+
+  assert(frozen != NULL);
+  assert(field != NULL);
+
+  header = (const dcFrozenHeader *) frozen->base;
+  record = dc_frozen_paragraph(frozen, paragraph);
+  if (record == NULL || record->field > header->nfields ||
+    record->nfields > header->nfields - record->field)
+    return NULL;
+
+  fields = (const dcFrozenField *) (frozen->base + header->fields) +
+    record->field;
+  for (i = 0; i < record->nfields; i++)
+  {
+    name = dc_frozen_text_at(frozen, fields[i].name, 0);
+    if (name == NULL || strcasecmp(name, field) != 0)
+      continue;
+
+    value = dc_frozen_text_at(frozen, fields[i].value, fields[i].length);
+    if (value != NULL && len != NULL)
+      *len = fields[i].length;
+    return value;
+  }
+
+  return NULL;
+}
+
+/**
+ * Close a frozen image
+ *
+ * This unmaps the image; strings obtained from it become invalid.
+ *
+ * \param[in,out] ptr The address of a pointer to a Frozen Index
+ *
+ * \note The pointer will be set to \c NULL.
+ */
+void dc_frozen_close(
+  dcFrozenIndex **ptr
+) {
+  dcFrozenIndex *frozen;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  frozen = *ptr;
+
+  dc_frozen_unmap((void *) frozen->base, frozen->size);
+  free(frozen);
+  *ptr = NULL;
+}
@@ -0,0 +1,627 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Hashing and hash tables
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * This provides a fast, non-cryptographic 64-bit hash function and a hash
+ * table keyed by its results. They are used to detect changed paragraphs
+ * (e.g. when re-reading the dpkg status database) and to index packages.
+ *
+ * \par Hash Function
+ * \ref dc_hash consumes its input eight bytes at a time, mixing each word
+ * into the state with a multiplication, and finishes with a full avalanche
+ * step. Words are always loaded in little-endian order, so hash values are
+ * the same on every platform and may be stored on disk. \ref dc_hash_case
+ * additionally folds ASCII letters to lower case a word at a time, and
+ * \ref dc_hash_combine builds a hash up from the hashes of several parts.
+ *
+ * \par Hash Table
+ * \ref dcHashTable uses open addressing with linear probing, which keeps the
+ * slots of a cluster adjacent in memory. The table is kept at most half
+ * full, and deletions shift later entries of the cluster backwards instead
+ * of leaving tombstones, so lookups never degrade over time.
+ *
+ * \par Bloom Filters
+ * \ref dcBloom summarizes a set of hashes in a few bits per key, so that
+ * most lookups of keys which are not in the set can be answered without
+ * touching a hash table. It is a blocked filter: each key selects a single
+ * 64-byte block (one cache line), and sets one bit in each of its eight
+ * words, so a lookup costs a single cache miss. Blocks are selected by
+ * multiplying the top half of the hash by the number of blocks, rather than
+ * by masking, so the filter may have any size.
+ *
+ * \warning The hash function is not resistant to deliberate collisions, so
+ * it must not be relied on to distinguish untrusted data without comparing
+ * the data itself.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memcpy */
+
+#include <debctrl/hash.h>
+
+/** Multiplier used to mix words into the hash state (2^64 / phi) */
+#define HASH_MULT   UINT64_C(0x9e3779b97f4a7c15)
+
+/** Initial size of a hash table, if no hint is given */
+#define TABLE_INIT_SIZE   64
+
+/**
+ * Load a little-endian 64-bit word (helper function)
+ *
+ * \param[in] p A pointer to eight bytes, which need not be aligned
+ *
+ * \return The word, in host byte order
+ */
+static uint64_t dc_hash_load(
+  const unsigned char *p
+) {
+  uint64_t w;
+
+  memcpy(&w, p, sizeof(w));
+#ifdef WORDS_BIGENDIAN
+  w = ((w & UINT64_C(0x00000000000000ff)) << 56) |
+      ((w & UINT64_C(0x000000000000ff00)) << 40) |
+      ((w & UINT64_C(0x0000000000ff0000)) << 24) |
+      ((w & UINT64_C(0x00000000ff000000)) <<  8) |
+      ((w & UINT64_C(0x000000ff00000000)) >>  8) |
+      ((w & UINT64_C(0x0000ff0000000000)) >> 24) |
+      ((w & UINT64_C(0x00ff000000000000)) >> 40) |
+      ((w & UINT64_C(0xff00000000000000)) >> 56);
+#endif /* WORDS_BIGENDIAN */
+  return w;
+}
+
+/**
+ * Mix a word into a hash state (helper function)
+ *
+ * \param[in] h The current hash state
+ * \param[in] w The word to mix in
+ *
+ * \return The new hash state
+ */
+static uint64_t dc_hash_mix(
+  uint64_t h,
+  uint64_t w
+) {
+  h = (h ^ w) * HASH_MULT;
+  return h ^ (h >> 29);
+}
+
+/**
+ * Fold ASCII capital letters in a word to lower case (helper function)
+ *
+ * Each byte of the word is tested at once: adding a bias to the low seven
+ * bits of a byte sets its top bit if it is at least \c 'A', and another bias
+ * sets it if it is beyond \c 'Z'. Bytes in between (which are not already
+ * above 0x7f) get the 0x20 bit set, which lower-cases them.
+ *
+ * \param[in] w A word of text
+ *
+ * \return The word with \c A to \c Z replaced by \c a to \c z
+ */
+static uint64_t dc_hash_fold(
+  uint64_t w
+) {
+  const uint64_t ones = UINT64_C(0x0101010101010101);
+  uint64_t low = w & (ones * 0x7f);
+  uint64_t upper;
+
+  upper = (low + ones * (0x80 - 'A')) & ~(low + ones * (0x80 - 'Z' - 1));
+  upper &= ~w & (ones * 0x80);
+
+  return w | (upper >> 2);
+}
+
+/**
+ * Compute the hash of a block of memory (helper function)
+ *
+ * \param[in] buf A pointer to the data to hash
+ * \param[in] len The length of the data, in bytes
+ * \param[in] fold Whether to fold ASCII letters to lower case
+ *
+ * \return A 64-bit hash value
+ */
+static uint64_t dc_hash_words(
+  const void *buf,
+  size_t len,
+  int fold
+) {
+  const unsigned char *p = buf;
+  uint64_t h = HASH_MULT ^ ((uint64_t) len * UINT64_C(0xff51afd7ed558ccd));
+  uint64_t w;
+  size_t i;
+
+  assert(buf != NULL || len == 0);
+
+  while (len >= 8)
+  {
+    w = dc_hash_load(p);
+    h = dc_hash_mix(h, fold ? dc_hash_fold(w) : w);
+    p += 8;
+    len -= 8;
+  }
+
+  if (len > 0)
+  {
+    w = 0;
+    for (i = 0; i < len; i++)
+      w |= (uint64_t) p[i] << (8 * i);
+    h = dc_hash_mix(h, fold ? dc_hash_fold(w) : w);
+  }
+
+  /* final avalanche, from MurmurHash3 */
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+
+  return h;
+}
+
+/**
+ * Compute the hash of a block of memory
+ *
+ * \param[in] buf A pointer to the data to hash
+ * \param[in] len The length of the data, in bytes
+ *
+ * \return A 64-bit hash value, which is the same on all platforms
+ */
+uint64_t dc_hash(
+  const void *buf,
+  size_t len
+) {
+  return dc_hash_words(buf, len, 0);
+}
+
+/**
+ * Compute the hash of a block of memory, ignoring ASCII case
+ *
+ * This is used for field names, which are not case sensitive (Debian Policy
+ * 5.1): \c Package and \c package have the same hash.
+ *
+ * \param[in] buf A pointer to the data to hash
+ * \param[in] len The length of the data, in bytes
+ *
+ * \return A 64-bit hash value, which is the same on all platforms
+ */
+uint64_t dc_hash_case(
+  const void *buf,
+  size_t len
+) {
+  return dc_hash_words(buf, len, 1);
+}
+
+/**
+ * Combine a value into a running hash
+ *
+ * This allows a hash to be built up incrementally from the hashes of several
+ * parts (e.g. the chunks of a field, as they are parsed). The result depends
+ * on the order in which values are combined.
+ *
+ * \param[in] h The running hash
+ * \param[in] value The value to combine into it
+ *
+ * \return The new running hash
+ */
+uint64_t dc_hash_combine(
+  uint64_t h,
+  uint64_t value
+) {
+  h = dc_hash_mix(h, value);
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  return h ^ (h >> 32);
+}
+
+/**
+ * Construct a Hash Table
+ *
+ * For details on the structure and its fields, see \ref dcHashTable
+ *
+ * \param[in] hint The number of values expected to be stored, or \c 0 to use
+ * a default. The table grows as needed in any case.
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcHashTable object
+ */
+dcHashTable * dc_hash_table_new(
+  size_t hint
+) {
+  dcHashTable *table = NEW(dcHashTable);
+  size_t size = TABLE_INIT_SIZE;
+
+  if (table == NULL)
+    return NULL;
+
+  /* keep the table at most half full */
+  while (size < hint * 2)
+    size *= 2;
+
+  table->slots = calloc(size, sizeof(dcHashSlot));
+  if (table->slots == NULL)
+  {
+    free(table);
+    return NULL;
+  }
+  table->size = size;
+  table->count = 0;
+
+  return table;
+}
+
+/**
+ * Double the size of a Hash Table (helper function)
+ *
+ * \param[in,out] table A pointer to a Hash Table
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_hash_table_grow(
+  dcHashTable *table
+) {
+  dcHashSlot *slots;
+  size_t mask = table->size * 2 - 1;
+  size_t i;
+  size_t j;
+
+  slots = calloc(table->size * 2, sizeof(dcHashSlot));
+  if (slots == NULL)
+    return dcMemFullErr;
+
+  for (i = 0; i < table->size; i++)
+  {
+    if (table->slots[i].value == NULL)
+      continue;
+
+    j = (size_t) table->slots[i].key & mask;
+    while (slots[j].value != NULL)
+      j = (j + 1) & mask;
+    slots[j] = table->slots[i];
+  }
+
+  free(table->slots);
+  table->slots = slots;
+  table->size *= 2;
+
+  return dcNoErr;
+}
+
+/**
+ * Add a value to a Hash Table
+ *
+ * \param[in,out] table A pointer to a Hash Table
+ * \param[in] key The hash key
+ * \param[in] value The value to store, which must not be \c NULL
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ *
+ * \note Values already stored under the same key are kept.
+ */
+dcStatus dc_hash_table_insert(
+  dcHashTable *table,
+  uint64_t key,
+  void *value
+) {
+  size_t mask;
+  size_t i;
+
+  assert(table != NULL);
+  assert(value != NULL);
+
+  if (table == NULL || value == NULL)
+    return dcParameterErr;
+
+  if ((table->count + 1) * 2 > table->size &&
+    dc_hash_table_grow(table) != dcNoErr)
+    return dcMemFullErr;
+
+  mask = table->size - 1;
+  i = (size_t) key & mask;
+  while (table->slots[i].value != NULL)
+    i = (i + 1) & mask;
+
+  table->slots[i].key = key;
+  table->slots[i].value = value;
+  table->count++;
+
+  return dcNoErr;
+}
+
+/**
+ * Find values in a Hash Table
+ *
+ * This returns the values stored under a given key, one at a time. Example:
+ * \code
+ * size_t iter = 0;
+ * while ((entry = dc_hash_table_find(table, key, &iter)) != NULL)
+ * {
+ *   if (strcmp(entry->name, name) == 0)
+ *     break;
+ * }
+ * \endcode
+ *
+ * \param[in] table A pointer to a Hash Table
+ * \param[in] key The hash key
+ * \param[in,out] iter Iteration state, which must be set to \c 0 before the
+ * first call
+ *
+ * \retval NULL if there are no (more) values with the given key
+ * \return The next value with the given key
+ *
+ * \note The table must not be modified between calls for the same key.
+ */
+void * dc_hash_table_find(
+  const dcHashTable *table,
+  uint64_t key,
+  size_t *iter
+) {
+  size_t mask;
+  size_t i;
+
+  assert(table != NULL);
+  assert(iter != NULL);
+
+  mask = table->size - 1;
+  i = ((size_t) key + *iter) & mask;
+  while (table->slots[i].value != NULL)
+  {
+    (*iter)++;
+    if (table->slots[i].key == key)
+      return table->slots[i].value;
+    i = (i + 1) & mask;
+  }
+
+  return NULL;
+}
+
+/**
+ * Remove a value from a Hash Table
+ *
+ * \param[in,out] table A pointer to a Hash Table
+ * \param[in] key The hash key
+ * \param[in] value The value to remove
+ *
+ * \return Nonzero if the value was found and removed
+ */
+int dc_hash_table_remove(
+  dcHashTable *table,
+  uint64_t key,
+  const void *value
+) {
+  size_t mask;
+  size_t home;
+  size_t i;
+  size_t j;
+
+  assert(table != NULL);
+
+  mask = table->size - 1;
+  i = (size_t) key & mask;
+  while (table->slots[i].value != value || table->slots[i].key != key)
+  {
+    if (table->slots[i].value == NULL)
+      return 0;
+    i = (i + 1) & mask;
+  }
+
+  /* shift later members of the cluster back, if it shortens their probe */
+  j = i;
+  for (;;)
+  {
+    j = (j + 1) & mask;
+    if (table->slots[j].value == NULL)
+      break;
+
+    home = (size_t) table->slots[j].key & mask;
+    if (((j - home) & mask) >= ((j - i) & mask))
+    {
+      table->slots[i] = table->slots[j];
+      i = j;
+    }
+  }
+
+  table->slots[i].value = NULL;
+  table->count--;
+
+  return 1;
+}
+
+/**
+ * Destroy a Hash Table
+ *
+ * Given a Hash Table that was allocated by \ref dc_hash_table_new, this
+ * will free the table. The values stored in it are not freed.
+ *
+ * \param[in,out] ptr The address of a pointer to a Hash Table
+ *
+ * \note The pointer will be set to \c NULL after memory is freed.
+ */
+void dc_hash_table_free(
+  dcHashTable **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  free((*ptr)->slots);
+
+  free(*ptr);
+  *ptr = NULL;
+}
+
+/**
+ * Construct a Bloom filter
+ *
+ * For details on the structure and its fields, see \ref dcBloom
+ *
+ * \param[in] capacity The number of keys to size the filter for; with
+ * \ref BLOOM_BITS bits per key, about 0.1% of lookups of absent keys are
+ * false positives while no more keys than this have been added
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated, empty dcBloom object
+ */
+dcBloom * dc_bloom_new(
+  size_t capacity
+) {
+  dcBloom *bloom = NEW(dcBloom);
+
+  if (bloom == NULL)
+    return NULL;
+
+  bloom->nblocks = (capacity * BLOOM_BITS + 64 * BLOOM_BLOCK - 1) /
+    (64 * BLOOM_BLOCK);
+  if (bloom->nblocks == 0)
+    bloom->nblocks = 1;
+
+  bloom->words = calloc(bloom->nblocks * BLOOM_BLOCK, sizeof(uint64_t));
+  if (bloom->words == NULL)
+  {
+    free(bloom);
+    return NULL;
+  }
+
+  bloom->count = 0;
+  bloom->capacity = capacity;
+
+  return bloom;
+}
+
+/**
+ * Find the block of a Bloom filter for a key (helper function)
+ *
+ * \param[in] words The words of the filter
+ * \param[in] nblocks The number of blocks
+ * \param[in] key The hash key
+ *
+ * \return A pointer to the first word of the block
+ */
+static const uint64_t * dc_bloom_block(
+  const uint64_t *words,
+  size_t nblocks,
+  uint64_t key
+) {
+  return words + (size_t) (((key >> 32) * (uint64_t) nblocks) >> 32) *
+    BLOOM_BLOCK;
+}
+
+/**
+ * Find the bits of a Bloom filter block for a key (helper function)
+ *
+ * \param[in] key The hash key
+ *
+ * \return A word whose bytes each hold the bit number (0 to 63) to test in
+ * the corresponding word of the block
+ */
+static uint64_t dc_bloom_bits(
+  uint64_t key
+) {
+  /* spread the low half of the key over a full word, then take six bits of
+   * each byte */
+  return (key * HASH_MULT) & UINT64_C(0x3f3f3f3f3f3f3f3f);
+}
+
+/**
+ * Add a key to a Bloom filter
+ *
+ * \param[in,out] bloom A pointer to a Bloom filter
+ * \param[in] key The hash key (see \ref dc_hash)
+ */
+void dc_bloom_add(
+  dcBloom *bloom,
+  uint64_t key
+) {
+  uint64_t *block;
+  uint64_t bits;
+  size_t i;
+
+  assert(bloom != NULL);
+
+  block = (uint64_t *) dc_bloom_block(bloom->words, bloom->nblocks, key);
+  bits = dc_bloom_bits(key);
+  for (i = 0; i < BLOOM_BLOCK; i++)
+    block[i] |= UINT64_C(1) << ((bits >> (8 * i)) & 63);
+
+  bloom->count++;
+}
+
+/**
+ * Check whether a Bloom filter may contain a key
+ *
+ * \param[in] words The words of the filter (see \ref dcBloom)
+ * \param[in] nblocks The number of blocks
+ * \param[in] key The hash key
+ *
+ * \retval 0 if the key was certainly never added
+ * \retval 1 if the key may have been added
+ *
+ * \note This takes the filter's words rather than a \ref dcBloom, so that
+ * filters stored in files (see \ref frozen.c) can be checked in place; use
+ * \ref dc_bloom_check otherwise.
+ */
+int dc_bloom_check_words(
+  const uint64_t *words,
+  size_t nblocks,
+  uint64_t key
+) {
+  const uint64_t *block;
+  uint64_t bits;
+  uint64_t miss = 0;
+  size_t i;
+
+  assert(words != NULL);
+  assert(nblocks > 0);
+
+  block = dc_bloom_block(words, nblocks, key);
+  bits = dc_bloom_bits(key);
+  for (i = 0; i < BLOOM_BLOCK; i++)
+    miss |= ~block[i] & (UINT64_C(1) << ((bits >> (8 * i)) & 63));
+
+  return miss == 0;
+}
+
+/**
+ * Check whether a Bloom filter may contain a key
+ *
+ * \param[in] bloom A pointer to a Bloom filter
+ * \param[in] key The hash key (see \ref dc_hash)
+ *
+ * \retval 0 if the key was certainly never added
+ * \retval 1 if the key may have been added
+ */
+int dc_bloom_check(
+  const dcBloom *bloom,
+  uint64_t key
+) {
+  assert(bloom != NULL);
+
+  return dc_bloom_check_words(bloom->words, bloom->nblocks, key);
+}
+
+/**
+ * Destroy a Bloom filter
+ *
+ * \param[in,out] ptr The address of a pointer to a Bloom filter
+ *
+ * \note The pointer will be set to \c NULL after memory is freed.
+ */
+void dc_bloom_free(
+  dcBloom **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  free((*ptr)->words);
+
+  free(*ptr);
+  *ptr = NULL;
+}
@@ -0,0 +1,818 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Package indexes
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * A \ref dcIndex gathers the paragraphs of one or more package indexes
+ * (\c Packages or \c Sources files) and answers the lookups most tools need
+ * without scanning every paragraph:
+ * - paragraphs for a given package name (\ref dc_index_find)
+ * - paragraphs whose \c Depends or \c Pre-Depends name a given package
+ *   (\ref dc_index_rdepends)
+ * - paragraphs with a given field value (\ref dc_index_filter), which is a
+ *   linear scan
+ *
+ * Name lookups use a \ref dcHashTable keyed by the hash of the name; each
+ * candidate is checked against the name itself, so hash collisions are
+ * harmless. For reverse dependencies, the table holds a list of paragraphs
+ * for each distinct name, since popular libraries are depended on by tens
+ * of thousands of paragraphs.
+ *
+ * \par Summaries
+ * Resolvers look packages up in many indexes (suites, components and
+ * overlays), and most of those lookups miss. So that a miss costs less
+ * than probing the hash table, each index keeps a Bloom filter (see
+ * \ref dcBloom) of the package names and (name, version) pairs it
+ * contains. \ref dc_index_find consults it before the table, and
+ * \ref dc_index_may_contain exposes it directly. The filter is rebuilt at
+ * twice the size whenever it fills up, so building it costs amortized
+ * constant time per paragraph, and it is written out with frozen images
+ * (see \ref frozen.c).
+ *
+ * \par Lifetime
+ * Adding a parser to an index takes a copy-on-write clone of it (see
+ * \ref dc_parser_clone), so the paragraphs stay valid for as long as the
+ * index does, even if the parser is modified or freed.
+ *
+ * \par Relationships
+ * Relationship fields are split into atoms with \ref dc_relation_parse,
+ * and the package name of each atom (without any architecture qualifier) is
+ * indexed. One \ref dcRelation is used for every paragraph added at once,
+ * so this does not allocate per paragraph.
+ *
+ * \par Replicas
+ * On machines with several NUMA nodes, an index shared by worker threads on
+ * every node is remote to most of them, and its hash tables are probed at
+ * random. \ref dc_index_replicate builds a copy of the index on each node
+ * (see \ref dc_parallel_each_node), and \ref dc_index_local returns the
+ * copy for the caller's node. The copies share the paragraphs themselves,
+ * which are only read once a lookup has found them. Adding a parser to an
+ * index discards its replicas, since they no longer match it.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: strlen, strcmp, memcmp */
+
+#include <debctrl/index.h>
+#include <debctrl/column.h>
+#include <debctrl/hash.h>
+#include <debctrl/relation.h>
+#include <debctrl/thread.h>
+
+/** Expected number of paragraphs in an index (see \ref dc_index_tune) */
+static size_t dc_index_hint = 0;
+
+/** Relationship fields indexed for reverse dependency lookups */
+static const char *dc_index_relations[] = {
+  "Pre-Depends",
+  "Depends"
+};
+
+/**
+ * Find the postings for a dependency name (helper function)
+ *
+ * \param[in] table The reverse dependency table
+ * \param[in] name The name
+ * \param[in] len The length of the name
+ * \param[in] key The hash of the name
+ *
+ * \retval NULL if no paragraph depends on the name
+ * \return The postings for the name
+ */
+static dcIndexPostings * dc_index_postings(
+  const dcHashTable *table,
+  const char *name,
+  size_t len,
+  uint64_t key
+) {
+  dcIndexPostings *postings;
+  size_t iter = 0;
+
+  while ((postings = dc_hash_table_find(table, key, &iter)) != NULL)
+  {
+    if (postings->len == len && memcmp(postings->name, name, len) == 0)
+      return postings;
+  }
+
+  return NULL;
+}
+
+/**
+ * Record that a paragraph depends on a name (helper function)
+ *
+ * \param[in,out] table The reverse dependency table
+ * \param[in] name The name
+ * \param[in] len The length of the name
+ * \param[in] section The number of the paragraph
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_index_post(
+  dcHashTable *table,
+  const char *name,
+  size_t len,
+  size_t section
+) {
+  dcIndexPostings *postings;
+  size_t *sections;
+  size_t size;
+  uint64_t key;
+
+  key = dc_hash(name, len);
+  postings = dc_index_postings(table, name, len, key);
+  if (postings == NULL)
+  {
+    postings = NEW(dcIndexPostings);
+    if (postings == NULL)
+      return dcMemFullErr;
+
+    postings->name = name;
+    postings->len = len;
+    postings->sections = NULL;
+    postings->count = 0;
+    postings->size = 0;
+
+    if (dc_hash_table_insert(table, key, postings) != dcNoErr)
+    {
+      free(postings);
+      return dcMemFullErr;
+    }
+  }
+
+  /* paragraphs are added in order, so repeats are always the last one */
+  if (postings->count > 0 && postings->sections[postings->count-1] == section)
+    return dcNoErr;
+
+  if (postings->count == postings->size)
+  {
+    size = (postings->size == 0) ? 4 : postings->size * 2;
+    sections = realloc(postings->sections, size * sizeof(size_t));
+    if (sections == NULL)
+      return dcMemFullErr;
+
+    postings->sections = sections;
+    postings->size = size;
+  }
+
+  postings->sections[postings->count++] = section;
+  return dcNoErr;
+}
+
+/**
+ * Construct an Index
+ *
+ * For details on the structure and its fields, see \ref dcIndex
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated, empty dcIndex object
+ */
+dcIndex * dc_index_new(
+  void
+) {
+  dcIndex *index = NEW(dcIndex);
+  size_t hint;
+
+  if (index == NULL)
+    return NULL;
+
+  index->parsers = NULL;
+  index->nparsers = 0;
+  index->sections = NULL;
+  index->names = NULL;
+  index->count = 0;
+  index->size = 0;
+
+  index->summary = NULL;
+  index->columns = NULL;
+  index->ncolumns = 0;
+  index->replicas = NULL;
+  index->nreplicas = 0;
+  /* the hint may be changed by another thread; any recent value will do */
+#ifdef __ATOMIC_RELAXED
+  hint = __atomic_load_n(&dc_index_hint, __ATOMIC_RELAXED);
+#else
+  hint = dc_index_hint;
+#endif
+  index->packages = dc_hash_table_new(hint);
+  index->rdepends = dc_hash_table_new(hint);
+  if (index->packages == NULL || index->rdepends == NULL)
+  {
+    dc_index_free(&index);
+    return NULL;
+  }
+
+  return index;
+}
+
+/**
+ * Change the expected size of new Indexes
+ *
+ * The hash tables of indexes created from now on start large enough for
+ * this many paragraphs, usually measured from the input (see
+ * \ref dc_parser_stats_apply). They grow as needed in any case.
+ *
+ * \param[in] paragraphs The expected number of paragraphs, or \c 0 for the
+ * default
+ *
+ * \note The size is shared by the whole process. Indexes being created by
+ * other threads at the same time get either the old or the new size.
+ */
+void dc_index_tune(
+  size_t paragraphs
+) {
+#ifdef __ATOMIC_RELAXED
+  __atomic_store_n(&dc_index_hint, paragraphs, __ATOMIC_RELAXED);
+#else
+  dc_index_hint = paragraphs;
+#endif
+}
+
+/**
+ * Discard the replicas of an Index (helper function)
+ *
+ * \param[in,out] index A pointer to an Index
+ */
+static void dc_index_unreplicate(
+  dcIndex *index
+) {
+  unsigned int i;
+
+  for (i = 0; i < index->nreplicas; i++)
+  {
+    if (index->replicas[i] != NULL)
+      dc_index_free(&index->replicas[i]);
+  }
+  free(index->replicas);
+
+  index->replicas = NULL;
+  index->nreplicas = 0;
+}
+
+/**
+ * Add a paragraph to an Index (helper function)
+ *
+ * \param[in,out] index A pointer to an Index
+ * \param[in] section The paragraph
+ * \param[in,out] relation A relationship field parser to use
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_index_add_section(
+  dcIndex *index,
+  dcParserSection *section,
+  dcRelation *relation
+) {
+  dcParserSection **sections;
+  const char **names;
+  dcParserBlock *block;
+  const dcRelationAtom *atom;
+  const char *package;
+  size_t size;
+  size_t i;
+  size_t j;
+
+  if (index->count == index->size)
+  {
+    size = (index->size == 0) ? 1024 : index->size * 2;
+    sections = realloc(index->sections, size * sizeof(dcParserSection *));
+    if (sections == NULL)
+      return dcMemFullErr;
+    index->sections = sections;
+
+    names = realloc(index->names, size * sizeof(const char *));
+    if (names == NULL)
+      return dcMemFullErr;
+    index->names = names;
+
+    index->size = size;
+  }
+
+  package = NULL;
+  block = dc_parser_section_find(section, "Package");
+  if (block != NULL && block->head != NULL)
+    package = block->head->text;
+
+  if (package != NULL && dc_hash_table_insert(index->packages,
+    dc_hash(package, strlen(package)),
+    (void *) (uintptr_t) (index->count + 1)) != dcNoErr)
+    return dcMemFullErr;
+
+  /* index each name the paragraph depends on, once */
+  for (i = 0; i < sizeof(dc_index_relations) / sizeof(char *); i++)
+  {
+    block = dc_parser_section_find(section, dc_index_relations[i]);
+    if (block == NULL)
+      continue;
+
+    /* for a malformed field, the names before the error are still indexed */
+    if (dc_relation_parse(relation, block) == dcMemFullErr)
+      return dcMemFullErr;
+
+    for (j = 0; j < relation->count; j++)
+    {
+      atom = &relation->atoms[j];
+      if (dc_index_post(index->rdepends, atom->name, atom->namelen,
+        index->count) != dcNoErr)
+        return dcMemFullErr;
+    }
+  }
+
+  index->sections[index->count] = section;
+  index->names[index->count] = package;
+  index->count++;
+
+  return dcNoErr;
+}
+
+/**
+ * Add the keys of paragraphs to the summary of an Index (helper function)
+ *
+ * The summary is replaced with a larger one first if it would otherwise
+ * hold more keys than it was sized for.
+ *
+ * \param[in,out] index A pointer to an Index
+ * \param[in] first The number of the first paragraph to add; the rest of
+ * the paragraphs follow
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory (the index
+ * is then left without a summary)
+ */
+static dcStatus dc_index_summarize(
+  dcIndex *index,
+  size_t first
+) {
+  dcParserBlock *block;
+  const char *version;
+  size_t i;
+
+  /* two keys per paragraph: the name, and the name and version */
+  if (index->summary == NULL || index->summary->count +
+    2 * (index->count - first) > index->summary->capacity)
+  {
+    if (index->summary != NULL)
+      dc_bloom_free(&index->summary);
+
+    index->summary = dc_bloom_new(4 * index->count);
+    if (index->summary == NULL)
+      return dcMemFullErr;
+    first = 0;
+  }
+
+  for (i = first; i < index->count; i++)
+  {
+    if (index->names[i] == NULL)
+      continue;
+
+    version = NULL;
+    block = dc_parser_section_find(index->sections[i], "Version");
+    if (block != NULL && block->head != NULL)
+      version = block->head->text;
+
+    dc_bloom_add(index->summary, dc_index_key(index->names[i], NULL));
+    if (version != NULL)
+      dc_bloom_add(index->summary, dc_index_key(index->names[i], version));
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Add the paragraphs of a Parser to an Index
+ *
+ * Every non-empty paragraph of the parser is added to the index. The index
+ * keeps a clone of the parser, so the parser may be freed afterwards.
+ *
+ * \param[in,out] index A pointer to an Index
+ * \param[in] parser A pointer to a Parser
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory (some of
+ * the paragraphs may have been added)
+ */
+dcStatus dc_index_add(
+  dcIndex *index,
+  dcParser *parser
+) {
+  dcParserSection *section;
+  dcRelation *relation;
+  dcParser **parsers;
+  dcParser *clone;
+  size_t first;
+  dcStatus rc = dcNoErr;
+
+  assert(index != NULL);
+  assert(parser != NULL);
+
+  if (index == NULL || parser == NULL)
+    return dcParameterErr;
+
+  dc_index_unreplicate(index);
+
+  parsers = realloc(index->parsers,
+    (index->nparsers + 1) * sizeof(dcParser *));
+  if (parsers == NULL)
+    return dcMemFullErr;
+  index->parsers = parsers;
+
+  clone = dc_parser_clone(parser);
+  if (clone == NULL)
+    return dcMemFullErr;
+  index->parsers[index->nparsers++] = clone;
+
+  relation = dc_relation_new();
+  if (relation == NULL)
+    return dcMemFullErr;
+
+  first = index->count;
+  for (section = clone->head; section != NULL; section = section->next)
+  {
+    if (section->head == NULL)
+      continue;
+
+    rc = dc_index_add_section(index, section, relation);
+    if (rc != dcNoErr)
+      break;
+  }
+
+  dc_relation_free(&relation);
+
+  /* the summary must cover every paragraph added, even after a failure */
+  if (dc_index_summarize(index, first) != dcNoErr)
+    return dcMemFullErr;
+
+  return rc;
+}
+
+/**
+ * Compute the summary key of a package
+ *
+ * This is the key under which a package name, or a (name, version) pair, is
+ * recorded in the summary of an \ref dcIndex and of a frozen image.
+ *
+ * \param[in] package The package name
+ * \param[in] version The version, or \c NULL for the name alone
+ *
+ * \return The key
+ */
+uint64_t dc_index_key(
+  const char *package,
+  const char *version
+) {
+  uint64_t key;
+
+  assert(package != NULL);
+
+  key = dc_hash(package, strlen(package));
+  if (version != NULL)
+    key = dc_hash_combine(key, dc_hash(version, strlen(version)));
+
+  return key;
+}
+
+/**
+ * Check whether an Index may contain a package
+ *
+ * This consults the index's summary only, so it is cheaper than a lookup,
+ * but may give false positives (about 0.1% of absent packages).
+ *
+ * \param[in] index A pointer to an Index
+ * \param[in] package The package name
+ * \param[in] version The exact version, or \c NULL to accept any version
+ *
+ * \retval 0 if the index certainly has no paragraph for the package (with
+ * the given version)
+ * \retval 1 if it may have one
+ */
+int dc_index_may_contain(
+  const dcIndex *index,
+  const char *package,
+  const char *version
+) {
+  assert(index != NULL);
+  assert(package != NULL);
+
+  if (index->summary == NULL)
+    return 1;
+
+  return dc_bloom_check(index->summary, dc_index_key(package, version));
+}
+
+/**
+ * Find the paragraphs for a package
+ *
+ * This returns each paragraph whose \c Package field is the given name in
+ * turn. Set \c *iter to \c 0 before the first call.
+ *
+ * Example:
+ * \code
+ * size_t iter = 0;
+ * while ((section = dc_index_find(index, "dpkg", &iter)) != NULL)
+ *   ...
+ * \endcode
+ *
+ * \param[in] index A pointer to an Index
+ * \param[in] package The package name
+ * \param[in,out] iter Iteration state
+ *
+ * \retval NULL if there are no more matching paragraphs
+ * \return The next matching paragraph
+ */
+dcParserSection * dc_index_find(
+  const dcIndex *index,
+  const char *package,
+  size_t *iter
+) {
+  uint64_t key;
+  void *value;
+  size_t i;
+
+  assert(index != NULL);
+  assert(package != NULL);
+  assert(iter != NULL);
+
+  key = dc_hash(package, strlen(package));
+
+  /* most lookups of absent packages end here */
+  if (*iter == 0 && index->summary != NULL &&
+    !dc_bloom_check(index->summary, key))
+    return NULL;
+
+  while ((value = dc_hash_table_find(index->packages, key, iter)) != NULL)
+  {
+    i = (size_t) ((uintptr_t) value - 1);
+    if (strcmp(index->names[i], package) == 0)
+      return index->sections[i];
+  }
+
+  return NULL;
+}
+
+/**
+ * Find the paragraphs depending on a package
+ *
+ * This returns each paragraph whose \c Depends or \c Pre-Depends field
+ * names the given package in turn (in any alternative, with any version
+ * constraint). Set \c *iter to \c 0 before the first call.
+ *
+ * \param[in] index A pointer to an Index
+ * \param[in] package The package name
+ * \param[in,out] iter Iteration state
+ *
+ * \retval NULL if there are no more matching paragraphs
+ * \return The next matching paragraph
+ *
+ * \note Virtual packages are not resolved; a paragraph depending on a
+ * virtual package is only found by looking up the virtual package's name.
+ */
+dcParserSection * dc_index_rdepends(
+  const dcIndex *index,
+  const char *package,
+  size_t *iter
+) {
+  dcIndexPostings *postings;
+  size_t len;
+
+  assert(index != NULL);
+  assert(package != NULL);
+  assert(iter != NULL);
+
+  len = strlen(package);
+  postings = dc_index_postings(index->rdepends, package, len,
+    dc_hash(package, len));
+  if (postings == NULL || *iter >= postings->count)
+    return NULL;
+
+  return index->sections[postings->sections[(*iter)++]];
+}
+
+/**
+ * Find the paragraphs with a given field value
+ *
+ * This returns each paragraph in which the first line of the given field
+ * is exactly the given value in turn. Set \c *iter to \c 0 before the first
+ * call. Field names are matched case-insensitively, but values are not.
+ *
+ * \param[in] index A pointer to an Index
+ * \param[in] field The field name
+ * \param[in] value The value
+ * \param[in,out] iter Iteration state
+ *
+ * \retval NULL if there are no more matching paragraphs
+ * \return The next matching paragraph
+ *
+ * \note This examines every paragraph of the index.
+ */
+dcParserSection * dc_index_filter(
+  const dcIndex *index,
+  const char *field,
+  const char *value,
+  size_t *iter
+) {
+  dcParserBlock *block;
+
+  assert(index != NULL);
+  assert(field != NULL);
+  assert(value != NULL);
+  assert(iter != NULL);
+
+  while (*iter < index->count)
+  {
+    block = dc_parser_section_find(index->sections[(*iter)++], field);
+    if (block != NULL && block->head != NULL && block->head->text != NULL &&
+      strcmp(block->head->text, value) == 0)
+      return index->sections[*iter - 1];
+  }
+
+  return NULL;
+}
+
+/**
+ * State of a replication (internal)
+ */
+typedef struct
+{
+  dcIndex *index; /**< The index being replicated */
+  dcIndex **replicas; /**< Replica for each node */
+  dcStatus rc; /**< First failing status */
+} dcIndexReplication;
+
+/**
+ * Build the replica of an Index for one node (work function)
+ *
+ * \param[in] node The node
+ * \param[in,out] arg The \c dcIndexReplication
+ */
+static void dc_index_replicate_node(
+  size_t node,
+  void *arg
+) {
+  dcIndexReplication *replication = arg;
+  dcIndex *replica;
+  size_t i;
+
+  if (replication->rc != dcNoErr)
+    return;
+
+  replica = dc_index_new();
+  if (replica == NULL)
+  {
+    replication->rc = dcMemFullErr;
+    return;
+  }
+  replication->replicas[node] = replica;
+
+  for (i = 0; i < replication->index->nparsers; i++)
+  {
+    replication->rc = dc_index_add(replica, replication->index->parsers[i]);
+    if (replication->rc != dcNoErr)
+      return;
+  }
+}
+
+/**
+ * Replicate an Index on each NUMA node
+ *
+ * This builds a copy of the index's tables on each node of the machine,
+ * for lookups with \ref dc_index_local. Any previous replicas are replaced.
+ * On a machine with a single node, no replicas are built.
+ *
+ * \param[in,out] index A pointer to an Index
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ *
+ * \note Cached columns (see \ref dc_index_column) are not copied. A replica
+ * caches its own columns when asked, so threads sharing one must not call
+ * \ref dc_index_column on it concurrently.
+ */
+dcStatus dc_index_replicate(
+  dcIndex *index
+) {
+  dcIndexReplication replication;
+  unsigned int nodes;
+  unsigned int i;
+
+  assert(index != NULL);
+
+  if (index == NULL)
+    return dcParameterErr;
+
+  dc_index_unreplicate(index);
+
+  nodes = dc_parallel_nodes();
+  if (nodes < 2)
+    return dcNoErr;
+
+  replication.index = index;
+  replication.replicas = calloc(nodes, sizeof(dcIndex *));
+  replication.rc = dcNoErr;
+  if (replication.replicas == NULL)
+    return dcMemFullErr;
+
+  dc_parallel_each_node(&dc_index_replicate_node, &replication);
+
+  if (replication.rc != dcNoErr)
+  {
+    for (i = 0; i < nodes; i++)
+    {
+      if (replication.replicas[i] != NULL)
+        dc_index_free(&replication.replicas[i]);
+    }
+    free(replication.replicas);
+    return replication.rc;
+  }
+
+  index->replicas = replication.replicas;
+  index->nreplicas = nodes;
+  return dcNoErr;
+}
+
+/**
+ * Find the copy of an Index local to the caller
+ *
+ * \param[in] index A pointer to an Index
+ *
+ * \return The replica for the calling thread's NUMA node (see
+ * \ref dc_parallel_node), or \c index itself if it has not been replicated
+ */
+const dcIndex * dc_index_local(
+  const dcIndex *index
+) {
+  unsigned int node;
+
+  assert(index != NULL);
+
+  if (index->nreplicas == 0)
+    return index;
+
+  node = dc_parallel_node();
+  if (node >= index->nreplicas)
+    return index;
+
+  return index->replicas[node];
+}
+
+/**
+ * Destroy an Index
+ *
+ * This releases the index's clones of its parsers, and frees any memory
+ * allocated for the index.
+ *
+ * \param[in,out] ptr The address of a pointer to an Index
+ *
+ * \note The pointer will be set to \c NULL.
+ */
+void dc_index_free(
+  dcIndex **ptr
+) {
+  dcIndexPostings *postings;
+  dcIndex *index;
+  size_t i;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  index = *ptr;
+
+  dc_index_unreplicate(index);
+  for (i = 0; i < index->nparsers; i++)
+    dc_parser_free(&index->parsers[i]);
+  free(index->parsers);
+  free(index->sections);
+  free(index->names);
+
+  if (index->summary != NULL)
+    dc_bloom_free(&index->summary);
+  for (i = 0; i < index->ncolumns; i++)
+    dc_column_free(&index->columns[i]);
+  free(index->columns);
+  if (index->packages != NULL)
+    dc_hash_table_free(&index->packages);
+  if (index->rdepends != NULL)
+  {
+    for (i = 0; i < index->rdepends->size; i++)
+    {
+      postings = index->rdepends->slots[i].value;
+      if (postings != NULL)
+      {
+        free(postings->sections);
+        free(postings);
+      }
+    }
+    dc_hash_table_free(&index->rdepends);
+  }
+
+  free(index);
+  *ptr = NULL;
+}
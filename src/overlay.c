@@ -0,0 +1,617 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Layered index overlays
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Systems usually install packages from several archives at once, e.g. a
+ * stable release, its security updates, backports and a local repository.
+ * A \ref dcOverlay combines the \ref dcIndex of each of these as a layer,
+ * referring to the indexes rather than copying them, and decides which
+ * version of each package is the candidate for installation.
+ *
+ * \par Priorities
+ * Priorities follow the conventions of APT's preferences (see
+ * \c apt_preferences(5)). Every layer has a default priority, which is
+ * usually 500 (or 100 for archives such as backports, whose packages should
+ * only be installed on request); pins override it for the versions they
+ * match, and the first matching pin of a layer applies. The candidate of a
+ * package is the version with the highest priority, or the newest of those
+ * with the highest priority; versions with a negative priority are never
+ * candidates.
+ * \par
+ * Unlike APT, the installed version is not considered, so versions are
+ * never held back to avoid a downgrade; see \ref dc_upgrade_compute.
+ *
+ * \par Candidate Table
+ * The candidate of every package is kept in a hash table, so looking one up
+ * costs the same as a lookup in a single index. When a layer is added or
+ * replaced, or a pin is added, only the packages it could affect are
+ * evaluated again: those named in the old or new index of the layer (or
+ * matching the pin). Each evaluation looks the package up in every layer,
+ * which is cheap for the layers without it thanks to their summaries (see
+ * \ref dc_index_may_contain).
+ *
+ * \note Packages are identified by name alone, so an overlay should combine
+ * indexes for a single architecture, as \c Packages files are.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: strcmp, strdup, strlen, memcpy, memset */
+#include <fnmatch.h>  /* for: fnmatch */
+
+#include <debctrl/overlay.h>
+#include <debctrl/version.h>
+
+/**
+ * Construct an Overlay
+ *
+ * For details on the structure and its fields, see \ref dcOverlay
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcOverlay object, with no layers
+ */
+dcOverlay * dc_overlay_new(
+  void
+) {
+  dcOverlay *overlay = NEW(dcOverlay);
+
+  if (overlay == NULL)
+    return NULL;
+
+  overlay->layers = NULL;
+  overlay->count = 0;
+
+  overlay->candidates = dc_hash_table_new(0);
+  if (overlay->candidates == NULL)
+  {
+    free(overlay);
+    return NULL;
+  }
+
+  return overlay;
+}
+
+/**
+ * Look up the value of a single-line field (helper function)
+ *
+ * \param[in] section A pointer to a Parser Section
+ * \param[in] field The name of the field
+ *
+ * \retval NULL if the field is missing or empty
+ * \return The field's value
+ */
+static const char * dc_overlay_field(
+  dcParserSection *section,
+  const char *field
+) {
+  dcParserBlock *block;
+
+  block = dc_parser_section_find(section, field);
+  if (block == NULL || block->head == NULL)
+    return NULL;
+
+  return block->head->text;
+}
+
+/**
+ * Compute the comparison key of a version (helper function)
+ *
+ * \param[in] version The version
+ * \param[in] buf A buffer of \c VERSION_KEY_SIZE bytes, used if the key fits
+ * \param[out] len Set to the length of the key
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return The key, which is either \c buf or must be released using \c free
+ */
+static unsigned char * dc_overlay_key(
+  const char *version,
+  unsigned char *buf,
+  size_t *len
+) {
+  unsigned char *key;
+
+  *len = dc_version_key(version, buf, VERSION_KEY_SIZE);
+  if (*len <= VERSION_KEY_SIZE)
+    return buf;
+
+  key = malloc(*len);
+  if (key != NULL)
+    dc_version_key(version, key, *len);
+
+  return key;
+}
+
+/**
+ * Find the candidate entry for a package (helper function)
+ *
+ * \param[in] overlay A pointer to an Overlay
+ * \param[in] package The package name
+ * \param[in] hash The hash of the package name
+ *
+ * \retval NULL if the package has no candidate
+ * \return The candidate
+ */
+static dcOverlayCandidate * dc_overlay_lookup(
+  const dcOverlay *overlay,
+  const char *package,
+  uint64_t hash
+) {
+  dcOverlayCandidate *candidate;
+  size_t iter = 0;
+
+  while ((candidate = dc_hash_table_find(overlay->candidates, hash, &iter))
+    != NULL)
+  {
+    if (strcmp(candidate->package, package) == 0)
+      return candidate;
+  }
+
+  return NULL;
+}
+
+/**
+ * Evaluate the candidate of a package again (helper function)
+ *
+ * \param[in,out] overlay A pointer to an Overlay
+ * \param[in] package The package name
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_overlay_resolve(
+  dcOverlay *overlay,
+  const char *package
+) {
+  unsigned char bestbuf[VERSION_KEY_SIZE];
+  unsigned char buf[VERSION_KEY_SIZE];
+  unsigned char *best = NULL;
+  unsigned char *key;
+  dcOverlayCandidate found;
+  dcOverlayCandidate *candidate;
+  dcParserSection *section;
+  const char *version;
+  uint64_t hash;
+  size_t blen = 0;
+  size_t len;
+  size_t iter;
+  size_t i;
+  int priority;
+  dcStatus rc = dcNoErr;
+
+  memset(&found, 0, sizeof(found));
+  for (i = 0; i < overlay->count; i++)
+  {
+    iter = 0;
+    while ((section = dc_index_find(overlay->layers[i].index, package, &iter))
+      != NULL)
+    {
+      version = dc_overlay_field(section, "Version");
+      if (version == NULL)
+        continue;
+
+      priority = dc_overlay_priority(overlay, i, package, version);
+      if (priority < 0 || (best != NULL && priority < found.priority))
+        continue;
+
+      key = dc_overlay_key(version, buf, &len);
+      if (key == NULL)
+      {
+        rc = dcMemFullErr;
+        goto done;
+      }
+
+      /* higher priority wins; among equals, the newer version */
+      if (best == NULL || priority > found.priority ||
+        dc_version_key_compare(key, len, best, blen) > 0)
+      {
+        if (best != NULL && best != bestbuf)
+          free(best);
+
+        if (key == buf)
+        {
+          memcpy(bestbuf, buf, len);
+          best = bestbuf;
+        }
+        else
+          best = key;
+        blen = len;
+
+        found.package = dc_overlay_field(section, "Package");
+        found.version = version;
+        found.section = section;
+        found.layer = i;
+        found.priority = priority;
+      }
+      else if (key != buf)
+        free(key);
+    }
+  }
+
+  hash = dc_hash(package, strlen(package));
+  candidate = dc_overlay_lookup(overlay, package, hash);
+
+  if (best == NULL)
+  {
+    if (candidate != NULL)
+    {
+      dc_hash_table_remove(overlay->candidates, hash, candidate);
+      free(candidate);
+    }
+    goto done;
+  }
+
+  if (candidate == NULL)
+  {
+    candidate = NEW(dcOverlayCandidate);
+    if (candidate == NULL)
+    {
+      rc = dcMemFullErr;
+      goto done;
+    }
+
+    if (dc_hash_table_insert(overlay->candidates, hash, candidate) != dcNoErr)
+    {
+      free(candidate);
+      rc = dcMemFullErr;
+      goto done;
+    }
+  }
+
+  *candidate = found;
+
+done:
+  if (best != NULL && best != bestbuf)
+    free(best);
+
+  return rc;
+}
+
+/**
+ * Evaluate the candidates of the packages in an index again (helper)
+ *
+ * Each package is evaluated once, however many paragraphs it has.
+ *
+ * \param[in,out] overlay A pointer to an Overlay
+ * \param[in] index The index whose packages may have changed
+ * \param[in] pattern Only evaluate packages whose names match this pattern,
+ * or \c NULL for every package
+ * \param[in,out] seen Names of the packages evaluated so far
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_overlay_refresh(
+  dcOverlay *overlay,
+  const dcIndex *index,
+  const char *pattern,
+  dcHashTable *seen
+) {
+  const char *name;
+  const char *other;
+  uint64_t hash;
+  size_t iter;
+  size_t i;
+  dcStatus rc;
+
+  for (i = 0; i < index->count; i++)
+  {
+    name = index->names[i];
+    if (name == NULL || (pattern != NULL && fnmatch(pattern, name, 0) != 0))
+      continue;
+
+    hash = dc_hash(name, strlen(name));
+    iter = 0;
+    while ((other = dc_hash_table_find(seen, hash, &iter)) != NULL)
+    {
+      if (strcmp(other, name) == 0)
+        break;
+    }
+    if (other != NULL)
+      continue;
+
+    if (dc_hash_table_insert(seen, hash, (void *) name) != dcNoErr)
+      return dcMemFullErr;
+
+    rc = dc_overlay_resolve(overlay, name);
+    if (rc != dcNoErr)
+      return rc;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Add a layer to an Overlay
+ *
+ * The index is referenced rather than copied, so it must remain valid (and
+ * unmodified) for as long as the overlay uses it. The candidates of the
+ * packages it contains are evaluated again.
+ *
+ * Example:
+ * \code
+ * dc_overlay_add(overlay, "bookworm", stable, 500);
+ * dc_overlay_add(overlay, "bookworm-backports", backports, 100);
+ * \endcode
+ *
+ * \param[in,out] overlay A pointer to an Overlay
+ * \param[in] name The name of the layer, which is copied
+ * \param[in] index The index holding the layer's paragraphs
+ * \param[in] priority The priority of the layer's versions, unless pinned
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ *
+ * \note Layers are numbered from \c 0, in the order they were added.
+ */
+dcStatus dc_overlay_add(
+  dcOverlay *overlay,
+  const char *name,
+  const dcIndex *index,
+  int priority
+) {
+  dcOverlayLayer *layers;
+  dcOverlayLayer *layer;
+  dcHashTable *seen;
+  dcStatus rc;
+
+  assert(overlay != NULL);
+  assert(name != NULL);
+  assert(index != NULL);
+
+  if (overlay == NULL || name == NULL || index == NULL)
+    return dcParameterErr;
+
+  layers = realloc(overlay->layers, (overlay->count + 1) *
+    sizeof(dcOverlayLayer));
+  if (layers == NULL)
+    return dcMemFullErr;
+  overlay->layers = layers;
+
+  layer = &overlay->layers[overlay->count];
+  layer->name = strdup(name);
+  if (layer->name == NULL)
+    return dcMemFullErr;
+  layer->index = index;
+  layer->priority = priority;
+  layer->pins = NULL;
+  layer->npins = 0;
+  overlay->count++;
+
+  seen = dc_hash_table_new(index->count);
+  if (seen == NULL)
+    return dcMemFullErr;
+
+  rc = dc_overlay_refresh(overlay, index, NULL, seen);
+  dc_hash_table_free(&seen);
+
+  return rc;
+}
+
+/**
+ * Pin versions of a layer of an Overlay
+ *
+ * This gives the versions of packages in a layer matching the patterns the
+ * given priority, unless an earlier pin of the layer already matches them.
+ * The candidates of the matching packages are evaluated again.
+ *
+ * Example:
+ * \code
+ * dc_overlay_pin(overlay, backports, "linux-image-*", NULL, 500);
+ * dc_overlay_pin(overlay, local, "dpkg", "1.21.*", 1001);
+ * \endcode
+ *
+ * \param[in,out] overlay A pointer to an Overlay
+ * \param[in] layer The number of the layer
+ * \param[in] package The package name pattern
+ * \param[in] version The version pattern, or \c NULL to match any version
+ * \param[in] priority The priority of matching versions
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_overlay_pin(
+  dcOverlay *overlay,
+  size_t layer,
+  const char *package,
+  const char *version,
+  int priority
+) {
+  dcOverlayLayer *target;
+  dcOverlayPin *pins;
+  dcOverlayPin *pin;
+  dcHashTable *seen;
+  dcStatus rc;
+
+  assert(overlay != NULL);
+  assert(package != NULL);
+
+  if (overlay == NULL || package == NULL || layer >= overlay->count)
+    return dcParameterErr;
+
+  target = &overlay->layers[layer];
+  pins = realloc(target->pins, (target->npins + 1) * sizeof(dcOverlayPin));
+  if (pins == NULL)
+    return dcMemFullErr;
+  target->pins = pins;
+
+  pin = &target->pins[target->npins];
+  pin->package = strdup(package);
+  pin->version = (version == NULL) ? NULL : strdup(version);
+  pin->priority = priority;
+  if (pin->package == NULL || (version != NULL && pin->version == NULL))
+  {
+    free(pin->package);
+    free(pin->version);
+    return dcMemFullErr;
+  }
+  target->npins++;
+
+  seen = dc_hash_table_new(0);
+  if (seen == NULL)
+    return dcMemFullErr;
+
+  rc = dc_overlay_refresh(overlay, target->index, package, seen);
+  dc_hash_table_free(&seen);
+
+  return rc;
+}
+
+/**
+ * Replace the index of a layer of an Overlay
+ *
+ * This is used when a layer changes (e.g. after downloading a new
+ * \c Packages file for a suite). Only the candidates of packages named in
+ * the old or the new index are evaluated again; see \ref overlay.c.
+ *
+ * \param[in,out] overlay A pointer to an Overlay
+ * \param[in] layer The number of the layer
+ * \param[in] index The new index, which must remain valid for as long as the
+ * overlay uses it
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ *
+ * \note The old index may be freed once this returns.
+ */
+dcStatus dc_overlay_replace(
+  dcOverlay *overlay,
+  size_t layer,
+  const dcIndex *index
+) {
+  const dcIndex *old;
+  dcHashTable *seen;
+  dcStatus rc;
+
+  assert(overlay != NULL);
+  assert(index != NULL);
+
+  if (overlay == NULL || index == NULL || layer >= overlay->count)
+    return dcParameterErr;
+
+  old = overlay->layers[layer].index;
+  overlay->layers[layer].index = index;
+
+  seen = dc_hash_table_new(old->count + index->count);
+  if (seen == NULL)
+    return dcMemFullErr;
+
+  rc = dc_overlay_refresh(overlay, old, NULL, seen);
+  if (rc == dcNoErr)
+    rc = dc_overlay_refresh(overlay, index, NULL, seen);
+  dc_hash_table_free(&seen);
+
+  return rc;
+}
+
+/**
+ * Find the priority of a version in a layer of an Overlay
+ *
+ * This is the priority given by the first pin of the layer matching the
+ * package and version, or the layer's default priority.
+ *
+ * \param[in] overlay A pointer to an Overlay
+ * \param[in] layer The number of the layer
+ * \param[in] package The package name
+ * \param[in] version The version
+ *
+ * \return The priority
+ */
+int dc_overlay_priority(
+  const dcOverlay *overlay,
+  size_t layer,
+  const char *package,
+  const char *version
+) {
+  const dcOverlayLayer *target;
+  const dcOverlayPin *pin;
+  size_t i;
+
+  assert(overlay != NULL);
+  assert(layer < overlay->count);
+  assert(package != NULL);
+  assert(version != NULL);
+
+  target = &overlay->layers[layer];
+  for (i = 0; i < target->npins; i++)
+  {
+    pin = &target->pins[i];
+    if (fnmatch(pin->package, package, 0) == 0 &&
+      (pin->version == NULL || fnmatch(pin->version, version, 0) == 0))
+      return pin->priority;
+  }
+
+  return target->priority;
+}
+
+/**
+ * Find the candidate version of a package
+ *
+ * \param[in] overlay A pointer to an Overlay
+ * \param[in] package The package name
+ *
+ * \retval NULL if no layer has a version of the package with a
+ * non-negative priority
+ * \return The candidate, which remains valid until the overlay is next
+ * changed
+ */
+const dcOverlayCandidate * dc_overlay_candidate(
+  const dcOverlay *overlay,
+  const char *package
+) {
+  assert(overlay != NULL);
+  assert(package != NULL);
+
+  return dc_overlay_lookup(overlay, package, dc_hash(package,
+    strlen(package)));
+}
+
+/**
+ * Destroy an Overlay
+ *
+ * This frees the layers, pins and candidate table of the overlay; the
+ * indexes of its layers are left alone.
+ *
+ * \param[in,out] ptr The address of a pointer to an Overlay
+ *
+ * \note The pointer will be set to \c NULL.
+ */
+void dc_overlay_free(
+  dcOverlay **ptr
+) {
+  dcOverlay *overlay;
+  size_t i;
+  size_t j;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  overlay = *ptr;
+
+  for (i = 0; i < overlay->count; i++)
+  {
+    for (j = 0; j < overlay->layers[i].npins; j++)
+    {
+      free(overlay->layers[i].pins[j].package);
+      free(overlay->layers[i].pins[j].version);
+    }
+    free(overlay->layers[i].pins);
+    free(overlay->layers[i].name);
+  }
+  free(overlay->layers);
+
+  for (i = 0; i < overlay->candidates->size; i++)
+    free(overlay->candidates->slots[i].value);
+  dc_hash_table_free(&overlay->candidates);
+
+  free(overlay);
+  *ptr = NULL;
+}
@@ -52,6 +52,72 @@
  * and any other files as indicated in the Debian Policy Manual, because this
  * library does not emit warnings about them.
  *
+ * \par Resource Limits
+ * When parsing untrusted input, a \ref dcParserLimits structure bounds the
+ * length of lines, the total size of the input and the number of paragraphs,
+ * fields and continuation lines. Each limit is checked in constant time as
+ * lines arrive, before any memory is allocated for them, so parse time and
+ * memory use are linear in the size of the input and capped by the limits.
+ *
+ * \par Copy-on-write Clones
+ * A parser can be cloned cheaply with \ref dc_parser_clone, for deriving
+ * variants of a file (e.g. per-architecture) without parsing it again. The
+ * clone initially shares all of its sections, blocks and chunks with the
+ * original, and parts are only copied when they are about to be modified:
+ * - The section list is shared as a persistent list; each section counts
+ *   the references to it (from parsers and from the preceding section).
+ *   \ref dc_parser_section_writable copies the sections from the head of
+ *   the list up to the one being modified, and shares the rest.
+ * - The block list of a section is shared between copies; the \c refs
+ *   count of the first block says how many owners the list has. The chunk
+ *   list of a block is shared in the same way, but its count is kept by
+ *   the blocks (in \c shares), so that chunks stay small.
+ *   \ref dc_parser_section_writable copies the block list of the section
+ *   being modified (but not their chunks), and
+ *   \ref dc_parser_block_writable copies a single block's chunks.
+ * \par
+ * So creating a variant costs time and memory proportional to what it
+ * changes, rather than to the size of the file. Any code that modifies a
+ * section or block of a clone (or of a parser that has been cloned) must
+ * first make it writable using these routines.
+ *
+ * \par Stopping Early
+ * A caller which only needs the start of a file, or which must answer
+ * within a time limit, can set conditions in \ref dcParserStop: a number of
+ * paragraphs or bytes, a cancellation flag (which another thread may set)
+ * or a deadline. They are checked after each line, and reading stops with
+ * \c dcStoppedErr, keeping what has been read.
+ *
+ * \par Trusted Input
+ * Files generated by trusted tools (such as a \c Packages file written by
+ * this library) are known to be well-formed, so checking them again is
+ * wasted work. Setting the \c trusted flag of a \ref dcParser skips:
+ * - the check that field names are ASCII
+ * - the backward scan for trailing whitespace, since only the newline is
+ *   removed
+ * - the search for a duplicate of each field in its paragraph
+ * \par
+ * The field name is also split from its value in place, rather than in a
+ * copy of the line. Resource limits and stopping conditions still apply.
+ * Trusted input that is not well-formed is parsed into something
+ * unspecified (but memory-safe): trailing whitespace is kept in values,
+ * and duplicate fields are not merged. In builds configured with
+ * \c --enable-debug, trusted input is checked against these rules anyway,
+ * and any line on which the two paths would differ is reported as a
+ * syntax error.
+ *
+ * \par Content Hashes
+ * As each line is read, the parser keeps a 64-bit hash of every field and
+ * paragraph up to date, so that changed or duplicate paragraphs can be found
+ * without serializing them again. The hash of a field covers its name
+ * (folded to lower case, since field names are not case sensitive) and the
+ * type and text of each chunk in order. The hash of a paragraph is the sum
+ * of the hashes of its fields, so it does not depend on the order of the
+ * fields, and can be updated in constant time when a field grows. Hashes
+ * are the same on every platform (see \ref hash.c); they are shared along
+ * with the data by clones, and must be recomputed with
+ * \ref dc_parser_section_hash after modifying a section.
+ *
  * \bug All error messages are in English and are not internationalized
  *
  * \see "Control files and their fields", from the Debian Policy Manual:
@@ -59,14 +125,19 @@
  * \see RFC-822: Format of ARPA Messages http://www.faqs.org/rfcs/rfc822.html
  */
 
-#include <string.h>   /* for: strdup */
+#include <string.h>   /* for: strdup, memchr */
+#include <limits.h>   /* for: INT_MAX */
 #include <strings.h>  /* for: strcasecmp */
 #include <stdio.h>    /* for: fopen, etc. */
 #include <errno.h>    /* for: errno */
 #include <ctype.h>    /* for: isascii */
+#include <time.h>     /* for: clock_gettime */
 
 #include <debctrl/parser.h>
 #include <debctrl/error.h>
+#include <debctrl/hash.h>
+#include <debctrl/position.h>
+#include <debctrl/stats.h>
 
 /**
  * Construct a Parser Chunk
@@ -107,6 +178,10 @@ dcParserChunk * dc_parser_chunk_new(
     chunk->type = CHUNK_MERGE;
   }
 
+  chunk->pooled = 0;
+  chunk->pos.file = 0;
+  chunk->pos.offset = 0;
+
   chunk->next = NULL;
   chunk->prev = NULL;
 
@@ -130,7 +205,9 @@ void dc_parser_chunk_free(
   assert(ptr != NULL);
   assert(*ptr != NULL);
 
-  free((*ptr)->text);
+  /* pooled text is freed along with the arena of its block */
+  if (!(*ptr)->pooled)
+    free((*ptr)->text);
 
   free(*ptr);
   *ptr = NULL;
@@ -157,8 +234,12 @@ dcParserBlock * dc_parser_block_new(
 
   block->head = NULL;
   block->tail = NULL;
+  block->shares = NULL;
+  block->arena = NULL;
+  block->refs = 1;
 
   block->next = NULL;
+  block->prev = NULL;
 
   if (name != NULL)
   {
@@ -168,9 +249,13 @@ dcParserBlock * dc_parser_block_new(
       free(block);
       return NULL;
     }
+    block->hash = dc_hash_case(name, strlen(name));
   }
   else
+  {
     block->name = NULL;
+    block->hash = 0;
+  }
 
   return block;
 }
@@ -275,6 +360,64 @@ void dc_parser_block_delete(
   dc_parser_chunk_free(chunk);
 }
 
+/**
+ * Write a Parser Block to a dcString
+ *
+ * This routine serializes a given \ref dcParserBlock object, appending the
+ * field name and each of its chunks to a \ref dcString in control file
+ * syntax, so that parsing the output again yields an identical block.
+ *
+ * \param[in] block A pointer to a Parser Block
+ * \param[in,out] buf A dcString to append the serialized block to
+ *
+ * \retval 0 if there is a failure to allocate memory (the block may have
+ * been partly written)
+ * \retval 1 if the block was written
+ *
+ * \note If the first chunk of the block is empty, the field name is written
+ * on a line by itself (e.g. for the \c Files field of a \c *.dsc file).
+ */
+int dc_parser_block_write(
+  dcParserBlock *block,
+  dcString *buf
+) {
+  dcParserChunk *chunk;
+  int ok;
+
+  assert(block != NULL);
+  assert(block->head != NULL);
+  assert(buf != NULL);
+
+  chunk = block->head;
+
+  /* The head chunk is next to the field name */
+  ok = dc_string_append_n(buf, block->name, strlen(block->name)) &&
+    dc_string_append_n(buf, ":", 1);
+  if (ok && chunk->type != CHUNK_EMPTY)
+  {
+    ok = dc_string_append_n(buf, " ", 1) &&
+      dc_string_append_n(buf, chunk->text, strlen(chunk->text));
+  }
+  ok = ok && dc_string_append_n(buf, "\n", 1);
+
+  while (ok && (chunk = chunk->next) != NULL)
+  {
+    if (chunk->type == CHUNK_EMPTY)
+    {
+      ok = dc_string_append_n(buf, " .\n", 3);
+    }
+    else
+    {
+      ok = dc_string_append_n(buf, " ", 1) &&
+        (chunk->type != CHUNK_FIXED || dc_string_append_n(buf, " ", 1)) &&
+        dc_string_append_n(buf, chunk->text, strlen(chunk->text)) &&
+        dc_string_append_n(buf, "\n", 1);
+    }
+  }
+
+  return ok;
+}
+
 /**
  * Return contents of a Parser Block as a dcString
  *
@@ -287,13 +430,12 @@ void dc_parser_block_delete(
  * \note This routine uses dcString to ensure the buffer is automatically
  * resized (expanded) as necessary.
  *
- * \deprecated This routine is deprecated and will be replaced in a subsequent
- * release.
+ * \deprecated This routine is deprecated; use \ref dc_parser_block_write to
+ * serialize blocks into a shared buffer instead.
  */
 dcString * dc_parser_block_string(
   dcParserBlock *block
 ) {
-  dcParserChunk *chunk;
   dcString *buf;
 
   assert(block != NULL);
@@ -303,38 +445,132 @@ dcString * dc_parser_block_string(
   if (buf == NULL)
     return NULL;
 
-  chunk = block->head;
+  dc_parser_block_write(block, buf);
 
-  /* The head chunk is next to the field name */
-  dc_string_append(buf, block->name);
-  dc_string_append_c(buf, ':');
-  dc_string_append_c(buf, ' ');
-  dc_string_append(buf, chunk->text);
-  dc_string_append_c(buf, '\n');
+  /* trim down and return string */
+  dc_string_resize(buf, 0);
+  return buf;
+}
+
+/**
+ * Combine a Parser Chunk into the hash of a block (helper function)
+ *
+ * \param[in] h The hash of the block so far
+ * \param[in] chunk A pointer to the Parser Chunk to add
+ *
+ * \return The hash of the block with the chunk appended
+ */
+static uint64_t dc_parser_chunk_hash(
+  uint64_t h,
+  const dcParserChunk *chunk
+) {
+  h = dc_hash_combine(h, (uint64_t) chunk->type);
+  if (chunk->text != NULL)
+    h = dc_hash_combine(h, dc_hash(chunk->text, strlen(chunk->text)));
+  return h;
+}
+
+/**
+ * Compute the hash of a Parser Block
+ *
+ * This recomputes the \c hash of a \ref dcParserBlock from its name and
+ * chunks, which is necessary after it has been modified other than by the
+ * parser. See \ref parser.c for details.
+ *
+ * \param[in,out] block A pointer to a Parser Block
+ *
+ * \return The new hash of the block, which is also stored in it
+ */
+uint64_t dc_parser_block_hash(
+  dcParserBlock *block
+) {
+  dcParserChunk *chunk;
+  uint64_t h = 0;
+
+  assert(block != NULL);
+
+  if (block->name != NULL)
+    h = dc_hash_case(block->name, strlen(block->name));
 
-  while ((chunk = chunk->next) != NULL)
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+    h = dc_parser_chunk_hash(h, chunk);
+
+  block->hash = h;
+  return h;
+}
+
+/**
+ * Make the chunks of a Parser Block writable
+ *
+ * If the block's chunk list is shared with another block (see
+ * \ref dc_parser_clone), this gives the block its own copy of the chunks
+ * (and their text), so that they may be modified. Otherwise, it does
+ * nothing.
+ *
+ * \param[in,out] block A pointer to a Parser Block, which must belong to a
+ * writable section (see \ref dc_parser_section_writable)
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_parser_block_writable(
+  dcParserBlock *block
+) {
+  dcParserChunk *chunk;
+  dcParserChunk *copy;
+  dcParserChunk *head = NULL;
+  dcParserChunk *tail = NULL;
+
+  assert(block != NULL);
+
+  if (block == NULL)
+    return dcParameterErr;
+
+  /* the other owners of the chunks may have gone already */
+  if (block->shares != NULL && *block->shares == 1)
   {
-    if (chunk->type == CHUNK_EMPTY)
-    {
-      dc_string_append_c(buf, ' ');
-      dc_string_append_c(buf, '.');
-      dc_string_append_c(buf, '\n');
-    }
-    else
+    free(block->shares);
+    block->shares = NULL;
+  }
+
+  if (block->head == NULL || block->shares == NULL)
+    return dcNoErr;
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    copy = dc_parser_chunk_new(chunk->text);
+    if (copy == NULL)
     {
-      dc_string_append_c(buf, ' ');
-      if (chunk->type == CHUNK_FIXED)
+      while (head != NULL)
       {
-        dc_string_append_c(buf, ' ');
+        copy = head->next;
+        dc_parser_chunk_free(&head);
+        head = copy;
       }
-      dc_string_append(buf, chunk->text);
-      dc_string_append_c(buf, '\n');
+      return dcMemFullErr;
     }
+    copy->type = chunk->type;
+    copy->pos = chunk->pos;
+
+    copy->prev = tail;
+    if (tail == NULL)
+      head = copy;
+    else
+      tail->next = copy;
+    tail = copy;
   }
 
-  /* trim down and return string */
-  dc_string_resize(buf, 0);
-  return buf;
+  (*block->shares)--;
+  block->shares = NULL;
+  block->head = head;
+  block->tail = tail;
+
+  /* the copies hold their own text */
+  if (block->arena != NULL)
+    dc_arena_free(&block->arena);
+
+  return dcNoErr;
 }
 
 /**
@@ -349,7 +585,8 @@ dcString * dc_parser_block_string(
  * \note The pointer will be set to \c NULL after memory is freed.
  *
  * \note Using this will also destroy internally-stored chunks; if you wish
- * to preserve these, set the \c head and \c tail to \c NULL first.
+ * to preserve these, set the \c head and \c tail to \c NULL first. Chunks
+ * shared with another block are left alone.
  */
 void dc_parser_block_free(
   dcParserBlock **ptr
@@ -359,11 +596,18 @@ void dc_parser_block_free(
 
   free((*ptr)->name);
 
-  if ((*ptr)->head != NULL)
+  /* only drop our share of a shared chunk list */
+  if ((*ptr)->shares != NULL && *(*ptr)->shares > 1)
+  {
+    (*(*ptr)->shares)--;
+  }
+  else
   {
     dcParserChunk *chunk;
     dcParserChunk *next;
 
+    free((*ptr)->shares);
+
     chunk = (*ptr)->head;
     while (chunk != NULL)
     {
@@ -377,6 +621,9 @@ void dc_parser_block_free(
     (*ptr)->tail = NULL;
   }
 
+  if ((*ptr)->arena != NULL)
+    dc_arena_free(&(*ptr)->arena);
+
   free(*ptr);
   *ptr = NULL;
 }
@@ -401,6 +648,8 @@ dcParserSection * dc_parser_section_new(
   section->head = NULL;
   section->tail = NULL;
   section->next = NULL;
+  section->refs = 1;
+  section->hash = 0;
 
   return section;
 }
@@ -469,6 +718,71 @@ dcParserBlock * dc_parser_section_find(
   return NULL;
 }
 
+/**
+ * Write a Parser Section to a dcString
+ *
+ * This routine serializes each \ref dcParserBlock of a given
+ * \ref dcParserSection in order (see \ref dc_parser_block_write).
+ *
+ * \param[in] section A pointer to a Parser Section
+ * \param[in,out] buf A dcString to append the serialized section to
+ *
+ * \retval 0 if there is a failure to allocate memory (the section may have
+ * been partly written)
+ * \retval 1 if the section was written
+ *
+ * \note No blank line is written after the section; see
+ * \ref dc_parser_write for writing complete files.
+ */
+int dc_parser_section_write(
+  dcParserSection *section,
+  dcString *buf
+) {
+  dcParserBlock *block;
+
+  assert(section != NULL);
+  assert(buf != NULL);
+
+  block = section->head;
+  while (block != NULL)
+  {
+    if (!dc_parser_block_write(block, buf))
+      return 0;
+    block = block->next;
+  }
+
+  return 1;
+}
+
+/**
+ * Compute the hash of a Parser Section
+ *
+ * This recomputes the \c hash of a \ref dcParserSection and each of its
+ * blocks (see \ref dc_parser_block_hash), which is necessary after it has
+ * been modified other than by the parser.
+ *
+ * \param[in,out] section A pointer to a Parser Section
+ *
+ * \return The new hash of the section, which is also stored in it
+ *
+ * \note The blocks of a section shared with a clone are updated in place,
+ * which is harmless since the clone shares their contents as well.
+ */
+uint64_t dc_parser_section_hash(
+  dcParserSection *section
+) {
+  dcParserBlock *block;
+  uint64_t h = 0;
+
+  assert(section != NULL);
+
+  for (block = section->head; block != NULL; block = block->next)
+    h += dc_parser_block_hash(block);
+
+  section->hash = h;
+  return h;
+}
+
 /**
  * Destroy a Parser Section
  *
@@ -481,7 +795,12 @@ dcParserBlock * dc_parser_section_find(
  * \note The pointer will be set to \c NULL after memory is freed.
  *
  * \note Using this will also destroy internally-stored blocks; if you wish
- * to preserve these, set the \c head and \c tail to \c NULL first.
+ * to preserve these, set the \c head and \c tail to \c NULL first. Blocks
+ * shared with another section are left alone.
+ *
+ * \note This releases one reference to a section shared by clones (see
+ * \ref dc_parser_clone); it is only destroyed when the last one is released.
+ * The following section is not released.
  */
 void dc_parser_section_free(
   dcParserSection **ptr
@@ -489,7 +808,19 @@ void dc_parser_section_free(
   assert(ptr != NULL);
   assert(*ptr != NULL);
 
-  if ((*ptr)->head != NULL)
+  if ((*ptr)->refs > 1)
+  {
+    (*ptr)->refs--;
+    *ptr = NULL;
+    return;
+  }
+
+  /* only drop our reference to a shared block list */
+  if ((*ptr)->head != NULL && (*ptr)->head->refs > 1)
+  {
+    (*ptr)->head->refs--;
+  }
+  else if ((*ptr)->head != NULL)
   {
     dcParserBlock *block;
     dcParserBlock *next;
@@ -528,15 +859,250 @@ dcParser * dc_parser_new(
     return NULL;
 
   parser->head = NULL;
+  parser->tail = NULL;
   parser->ctx.line = 0;
   parser->ctx.path = NULL;
 
+  parser->file = NULL;
+  parser->offset = 0;
+  parser->pos.file = 0;
+  parser->pos.offset = 0;
+
+  /* no limits or stopping conditions by default */
+  memset(&parser->limits, 0, sizeof(parser->limits));
+  memset(&parser->stop, 0, sizeof(parser->stop));
+  parser->trusted = 0;
+  parser->stats = NULL;
+  parser->sections = 0;
+  parser->fields = 0;
+  parser->chunks = 0;
+
   /* set up default error handler */
   dc_error_handler_init(&parser->handler);
 
   return parser;
 }
 
+/**
+ * Clone a Parser instance
+ *
+ * This creates a new parser sharing all of the data held by the original,
+ * in constant time. Either parser may then be modified independently,
+ * provided that sections and blocks are first made writable using
+ * \ref dc_parser_section_writable and \ref dc_parser_block_writable. See
+ * \ref parser.c for details.
+ *
+ * \param[in] parser A pointer to a Parser instance
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcParser object
+ *
+ * \note The clone should not be used to read more input.
+ */
+dcParser * dc_parser_clone(
+  dcParser *parser
+) {
+  dcParser *clone;
+
+  assert(parser != NULL);
+
+  if (parser == NULL)
+    return NULL;
+
+  clone = NEW(dcParser);
+  if (clone == NULL)
+    return NULL;
+
+  *clone = *parser;
+
+  if (clone->file != NULL)
+    dc_parser_file_retain(clone->file);
+
+  if (clone->head != NULL)
+    clone->head->refs++;
+
+  return clone;
+}
+
+/**
+ * Copy a section, sharing its blocks and the following sections (helper)
+ *
+ * \param[in] section A pointer to the Parser Section to copy
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcParserSection object
+ */
+static dcParserSection * dc_parser_section_copy(
+  dcParserSection *section
+) {
+  dcParserSection *copy = dc_parser_section_new();
+
+  if (copy == NULL)
+    return NULL;
+
+  copy->head = section->head;
+  copy->tail = section->tail;
+  copy->hash = section->hash;
+  if (copy->head != NULL)
+    copy->head->refs++;
+
+  copy->next = section->next;
+  if (copy->next != NULL)
+    copy->next->refs++;
+
+  return copy;
+}
+
+/**
+ * Make a Parser Section writable
+ *
+ * This ensures that a section, and its list of blocks, belong only to the
+ * given parser, so that blocks may be added, removed or reordered. Shared
+ * sections from the head of the list up to the given one are replaced with
+ * copies; the sections following it remain shared. The chunks of each
+ * block remain shared until \ref dc_parser_block_writable is used.
+ *
+ * Example:
+ * \code
+ * section = dc_parser_section_writable(variant, section);
+ * block = dc_parser_section_find(section, "Architecture");
+ * dc_parser_block_writable(block);
+ * \endcode
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in] section A pointer to a Parser Section in the parser's list
+ *
+ * \retval NULL if there is a failure to allocate memory, or the section does
+ * not belong to the parser
+ * \return the writable section, which replaces \c section in the list
+ *
+ * \note Pointers to sections and blocks previously obtained from the parser
+ * may refer to the shared originals; look them up again afterwards.
+ */
+dcParserSection * dc_parser_section_writable(
+  dcParser *parser,
+  dcParserSection *section
+) {
+  dcParserSection **link;
+  dcParserSection *node;
+  dcParserSection *copy;
+  dcParserBlock *block;
+  int found;
+  dcParserBlock *head = NULL;
+  dcParserBlock *tail = NULL;
+
+  assert(parser != NULL);
+  assert(section != NULL);
+
+  if (parser == NULL || section == NULL)
+    return NULL;
+
+  /* copy every shared section on the path to the target */
+  link = &parser->head;
+  node = parser->head;
+  while (node != NULL)
+  {
+    found = (node == section);
+
+    if (node->refs > 1)
+    {
+      copy = dc_parser_section_copy(node);
+      if (copy == NULL)
+        return NULL;
+
+      node->refs--;
+      *link = copy;
+      if (parser->tail == node)
+        parser->tail = copy;
+      node = copy;
+    }
+
+    if (found)
+      break;
+
+    link = &node->next;
+    node = node->next;
+  }
+
+  if (node == NULL)
+    return NULL;
+
+  /* give the section its own list of blocks */
+  if (node->head != NULL && node->head->refs > 1)
+  {
+    for (block = node->head; block != NULL; block = block->next)
+    {
+      dcParserBlock *dup = dc_parser_block_new(block->name);
+
+      /* the chunks are about to gain a second owner */
+      if (dup != NULL && block->head != NULL && block->shares == NULL)
+      {
+        block->shares = NEW(unsigned int);
+        if (block->shares == NULL)
+          dc_parser_block_free(&dup);
+        else
+          *block->shares = 1;
+      }
+
+      if (dup == NULL)
+      {
+        while (head != NULL)
+        {
+          dup = head->next;
+          dc_parser_block_free(&head);
+          head = dup;
+        }
+        return NULL;
+      }
+
+      dup->head = block->head;
+      dup->tail = block->tail;
+      dup->hash = block->hash;
+      if (dup->head != NULL)
+      {
+        dup->shares = block->shares;
+        (*dup->shares)++;
+        if (block->arena != NULL)
+          dup->arena = dc_arena_ref(block->arena);
+      }
+
+      dup->prev = tail;
+      if (tail == NULL)
+        head = dup;
+      else
+        tail->next = dup;
+      tail = dup;
+    }
+
+    node->head->refs--;
+    node->head = head;
+    node->tail = tail;
+  }
+
+  return node;
+}
+
+/**
+ * Update content hashes for a newly parsed chunk (helper function)
+ *
+ * Combines the chunk into the hash of its block, and replaces the block's
+ * old hash in the sum kept by the current section.
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in,out] block The Parser Block the chunk was appended to
+ * \param[in] chunk The Parser Chunk that was appended
+ */
+static void dc_parse_hash(
+  dcParser *parser,
+  dcParserBlock *block,
+  const dcParserChunk *chunk
+) {
+  uint64_t old = block->hash;
+
+  block->hash = dc_parser_chunk_hash(old, chunk);
+  parser->tail->hash += block->hash - old;
+}
+
 /**
  * Process a textual "chunk" of data
  *
@@ -580,6 +1146,14 @@ static dcStatus dc_parse_chunk(
     return dcSyntaxErr;
   }
 
+  if (parser->limits.chunks != 0 && parser->chunks >= parser->limits.chunks)
+  {
+    dc_crit(&parser->handler, &parser->ctx, _("Field has more than %lu "
+      "continuation lines"), (unsigned long) parser->limits.chunks);
+    return dcLimitErr;
+  }
+  parser->chunks++;
+
   /* this probably doesn't matter...
 
   if (line[0] == '\t' || line[1] == '\t')
@@ -617,18 +1191,63 @@ static dcStatus dc_parse_chunk(
   if (chunk == NULL)
     return dcMemFullErr;
 
-  /* shallow copy of the current parsing context */
-  chunk->ctx = parser->ctx;
+  /* position of the line currently being parsed */
+  chunk->pos = parser->pos;
 
   dc_parser_block_append(parser->tail->tail, chunk);
+  dc_parse_hash(parser, parser->tail->tail, chunk);
 
   return dcNoErr;
 }
 
 /**
- * Process a textual "block" of data
+ * Add the value on a field's first line (helper function)
  *
- * Lines beginning a new field are internally identified as a "block" of data,
+ * The text following the ":" is treated as a fixed-width
+ * \ref dcParserChunk, or an empty one if the field is on a line by itself.
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in,out] block The Parser Block of the field
+ * \param[in] text The text after the ":", without leading whitespace
+ *
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcNoErr if the operation completed successfully
+ */
+static dcStatus dc_parse_value(
+  dcParser *parser,
+  dcParserBlock *block,
+  const char *text
+) {
+  dcParserChunk *chunk;
+
+  if (*text == '\0')
+  {
+    chunk = dc_parser_chunk_new(NULL);
+    if (chunk == NULL)
+      return dcMemFullErr;
+    chunk->type = CHUNK_EMPTY;
+  }
+  else
+  {
+    chunk = dc_parser_chunk_new(text);
+    if (chunk == NULL)
+      return dcMemFullErr;
+    chunk->type = CHUNK_FIXED;
+  }
+
+  /* position of the line currently being parsed */
+  chunk->pos = parser->pos;
+
+  dc_parser_block_append(block, chunk);
+  dc_parse_hash(parser, block, chunk);
+
+  return dcNoErr;
+}
+
+/**
+ * Process a textual "block" of data
+ *
+ * Lines beginning a new field are internally identified as a "block" of data,
  * which may optionally have some data (the "chunks"). The text between the
  * ":" and end-of-line is treated as a fixed-width \ref dcParserChunk (but it
  * may also be empty, in case a field is on a line by itself).
@@ -651,7 +1270,7 @@ static dcStatus dc_parse_block(
   char *field;
   char *text;
   dcParserBlock *block = NULL;
-  dcParserChunk *chunk = NULL;
+  dcStatus rc;
 
   assert(parser != NULL);
   assert(line != NULL);
@@ -659,6 +1278,15 @@ static dcStatus dc_parse_block(
   if (parser == NULL || line == NULL)
     return dcParameterErr;
 
+  if (parser->limits.fields != 0 && parser->fields >= parser->limits.fields)
+  {
+    dc_crit(&parser->handler, &parser->ctx, _("Paragraph has more than %lu "
+      "fields"), (unsigned long) parser->limits.fields);
+    return dcLimitErr;
+  }
+  parser->fields++;
+  parser->chunks = 0;
+
   /* ensure the field name contains only ASCII characters */
   text = (char *) line; /* use text temporarily */
   while (*text != '\0')
@@ -725,33 +1353,292 @@ static dcStatus dc_parse_block(
     assert(parser->tail != NULL);
 
     dc_parser_section_append(parser->tail, block);
+    parser->tail->hash += block->hash;
   }
 
-  if (*text == '\0')
+  rc = dc_parse_value(parser, block, text);
+  free(field);
+
+  return rc;
+}
+
+#ifdef DEBUG
+/**
+ * Check that a trusted line is well-formed (helper function)
+ *
+ * This applies the checks which \ref dc_parse_block_trusted skips, so
+ * that debug builds catch trusted input which the strict path would have
+ * parsed differently.
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in] line The field name, already split from its value
+ *
+ * \retval dcSyntaxErr if the strict path would differ
+ * \retval dcNoErr if the line is well-formed
+ */
+static dcStatus dc_parse_trusted_check(
+  dcParser *parser,
+  const char *line
+) {
+  const char *text;
+
+  for (text = line; *text != '\0'; text++)
   {
-    chunk = dc_parser_chunk_new(NULL);
-    if (chunk == NULL)
-      return dcMemFullErr;
-    chunk->type = CHUNK_EMPTY;
+    if (!isascii(*text))
+    {
+      dc_crit(&parser->handler, &parser->ctx, _("Trusted input has a field "
+        "name which is not ASCII"));
+      return dcSyntaxErr;
+    }
   }
-  else
+
+  if (dc_parser_section_find(parser->tail, line) != NULL)
   {
-    chunk = dc_parser_chunk_new(text);
-    if (chunk == NULL)
-      return dcMemFullErr;
-    chunk->type = CHUNK_FIXED;
+    dc_crit(&parser->handler, &parser->ctx, _("Trusted input has a "
+      "duplicate field"));
+    return dcSyntaxErr;
   }
 
-  /* shallow copy of the current parsing context */
-  chunk->ctx = parser->ctx;
+  return dcNoErr;
+}
+#endif /* DEBUG */
 
-  dc_parser_block_append(block, chunk);
+/**
+ * Process a textual "block" of data from trusted input
+ *
+ * This is the equivalent of \ref dc_parse_block for parsers with the
+ * \c trusted flag set. It splits the field name from its value in place,
+ * and neither checks the field name nor looks for a duplicate.
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in,out] line A line of textual data (a block), which is modified
+ *
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcSyntaxErr if the line has no ":"
+ * \retval dcLimitErr if the paragraph exceeds a limit in
+ * \ref dcParserLimits
+ * \retval dcNoErr if the operation completed successfully
+ */
+static dcStatus dc_parse_block_trusted(
+  dcParser *parser,
+  char *line
+) {
+  dcParserBlock *block;
+  char *text;
 
-  free(field);
+  if (parser->limits.fields != 0 && parser->fields >= parser->limits.fields)
+  {
+    dc_crit(&parser->handler, &parser->ctx, _("Paragraph has more than %lu "
+      "fields"), (unsigned long) parser->limits.fields);
+    return dcLimitErr;
+  }
+  parser->fields++;
+  parser->chunks = 0;
+
+  text = strchr(line, ':');
+  if (text == NULL)
+  {
+    dc_crit(&parser->handler, &parser->ctx, _("Expected pseudoheader/data "
+      "pair (Sec. 5.1); if continuing a previous line, add a space"));
+    return dcSyntaxErr;
+  }
+  *text++ = '\0';
+
+#ifdef DEBUG
+  if (dc_parse_trusted_check(parser, line) != dcNoErr)
+    return dcSyntaxErr;
+#endif /* DEBUG */
+
+  block = dc_parser_block_new(line);
+  if (block == NULL)
+    return dcMemFullErr;
+
+  dc_parser_section_append(parser->tail, block);
+  parser->tail->hash += block->hash;
+
+  return dc_parse_value(parser, block, dc_strchug(text));
+}
+
+/**
+ * Install the recommended resource limits for untrusted input
+ *
+ * This fills in a \ref dcParserLimits structure using the \c LIMIT_*
+ * values from \ref defaults.h. Example:
+ * \code
+ * dc_parser_limits_init(&parser->limits);
+ * rc = dc_parser_read_file(parser, path);
+ * \endcode
+ *
+ * \param[out] limits A pointer to the limits to initialize
+ */
+void dc_parser_limits_init(
+  dcParserLimits *limits
+) {
+  assert(limits != NULL);
+
+  limits->line = LIMIT_LINE_LENGTH;
+  limits->bytes = LIMIT_BYTES;
+  limits->sections = LIMIT_SECTIONS;
+  limits->fields = LIMIT_FIELDS;
+  limits->chunks = LIMIT_CHUNKS;
+}
+
+/**
+ * Set a deadline for parsing
+ *
+ * This sets the \c deadline of a \ref dcParserStop to the given time from
+ * now. Example:
+ * \code
+ * dc_parser_stop_timeout(&parser->stop, 50);
+ * rc = dc_parser_read_file(parser, path);
+ * \endcode
+ *
+ * \param[in,out] stop A pointer to the stopping conditions
+ * \param[in] msec The time allowed, in milliseconds
+ */
+void dc_parser_stop_timeout(
+  dcParserStop *stop,
+  unsigned long msec
+) {
+  assert(stop != NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &stop->deadline);
+  stop->deadline.tv_sec += msec / 1000;
+  stop->deadline.tv_nsec += (long) (msec % 1000) * 1000000;
+  if (stop->deadline.tv_nsec >= 1000000000)
+  {
+    stop->deadline.tv_sec++;
+    stop->deadline.tv_nsec -= 1000000000;
+  }
+}
+
+/**
+ * Determine whether a Parser should stop reading (helper function)
+ *
+ * This is called after each line, so the common case (no conditions set)
+ * costs a few comparisons.
+ *
+ * \param[in] parser A pointer to a Parser instance
+ *
+ * \return Nonzero if a condition in \ref dcParserStop has been met
+ */
+static int dc_parser_stopped(
+  const dcParser *parser
+) {
+  const dcParserStop *stop = &parser->stop;
+  struct timespec now;
+
+  if (stop->sections != 0 && parser->sections > stop->sections)
+    return 1;
+  if (stop->bytes != 0 && parser->offset >= stop->bytes)
+    return 1;
+#ifdef __ATOMIC_ACQUIRE
+  /* pairs with a release store by the cancelling thread */
+  if (stop->cancel != NULL && __atomic_load_n(stop->cancel, __ATOMIC_ACQUIRE))
+    return 1;
+#else
+  if (stop->cancel != NULL && *stop->cancel)
+    return 1;
+#endif
+
+  if ((stop->deadline.tv_sec != 0 || stop->deadline.tv_nsec != 0) &&
+    parser->ctx.line % STOP_POLL_LINES == 0)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > stop->deadline.tv_sec ||
+      (now.tv_sec == stop->deadline.tv_sec &&
+      now.tv_nsec >= stop->deadline.tv_nsec))
+      return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Prepare a Parser to read new input (helper function)
+ *
+ * This registers the input's \ref dcParserFile (if it has a name) and opens
+ * the first section.
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in] name The name of the input, or \c NULL if unknown
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_parser_begin(
+  dcParser *parser,
+  const char *name
+) {
+  dcParserSection *section;
+
+  if (name != NULL)
+  {
+    parser->file = dc_parser_file_new(name);
+    if (parser->file == NULL)
+      return dcMemFullErr;
+    parser->ctx.path = parser->file->path;
+    parser->pos.file = parser->file->id;
+  }
+
+  section = dc_parser_section_new();
+  if (section == NULL)
+    return dcMemFullErr;
+  dc_parser_append(parser, section);
+  parser->sections = 1;
+
+  if (parser->stats != NULL)
+    dc_parser_stats_begin(parser->stats);
 
   return dcNoErr;
 }
 
+/**
+ * Read a line from a file, observing the line length limit (helper function)
+ *
+ * Without a line length limit, this behaves like \c getline. Otherwise, at
+ * most one byte more than the limit is read, so that overlong lines can be
+ * detected by \ref dc_parser_read_line without ever being held in memory.
+ *
+ * \param[in] parser A pointer to a Parser instance
+ * \param[in,out] line The address of the line buffer
+ * \param[in,out] size The address of the allocated size of \c line
+ * \param[in] fp The file to read from
+ *
+ * \retval -1 at end of file, or on failure
+ * \return The number of bytes read, including any line terminator
+ *
+ * \note With a limit in place, lines are read with \c fgets, so lines
+ * containing NUL bytes are split at them.
+ */
+static ssize_t dc_parser_getline(
+  dcParser *parser,
+  char **line,
+  size_t *size,
+  FILE *fp
+) {
+  char *tmp;
+  size_t max = parser->limits.line;
+
+  if (max == 0 || max > INT_MAX - 2)
+    return getline(line, size, fp);
+
+  /* room for the limit, a newline and a NUL byte */
+  if (*line == NULL || *size < max + 2)
+  {
+    tmp = realloc(*line, max + 2);
+    if (tmp == NULL)
+      return -1;
+    *line = tmp;
+    *size = max + 2;
+  }
+
+  if (fgets(*line, (int) (max + 2), fp) == NULL)
+    return -1;
+
+  return (ssize_t) strlen(*line);
+}
+
 /**
  * Process a file into Parser data structures
  *
@@ -763,7 +1650,10 @@ static dcStatus dc_parse_block(
  * \param[in,out] parser A pointer to a Parser instance
  * \param[in] path The path to the file to open
  *
- * \returns The status indication returned from \ref dc_parser_read_line
+ * \retval dcStoppedErr if a condition in \ref dcParserStop was met before
+ * the end of the file
+ * \returns Otherwise, the status indication returned from
+ * \ref dc_parser_read_line
  *
  * \note Any problems manipulating the file will be reported via the dcParser
  * \link error.c error handler interface \endlink, and the status indication
@@ -775,10 +1665,9 @@ dcStatus dc_parser_read_file(
 ) {
   FILE *fp;
   char *line = NULL;
-  size_t size;
+  size_t size = 0;
   ssize_t len;
-  dcStatus rc; /* return status of chunk/block parser */
-  dcParserSection *section;
+  dcStatus rc = dcNoErr; /* return status of chunk/block parser */
 
   assert(parser != NULL);
   assert(parser->head == NULL);
@@ -787,10 +1676,6 @@ dcStatus dc_parser_read_file(
   if (parser == NULL || parser->head != NULL || path == NULL)
     return dcParameterErr;
 
-  parser->ctx.path = strdup(path);
-  if (parser->ctx.path == NULL)
-    return dcMemFullErr;
-
   fp = fopen(path, "r");
   if (fp == NULL)
   {
@@ -799,25 +1684,135 @@ dcStatus dc_parser_read_file(
     return dcFileErr;
   }
 
-  section = dc_parser_section_new();
-  if (section == NULL)
-    return dcMemFullErr;
-  dc_parser_append(parser, section);
-
-  while ((len = getline(&line, &size, fp)) != -1)
+  rc = dc_parser_begin(parser, path);
+  if (rc != dcNoErr)
   {
-    parser->ctx.line++;
+    fclose(fp);
+    return rc;
+  }
 
+  while ((len = dc_parser_getline(parser, &line, &size, fp)) != -1)
+  {
     rc = dc_parser_read_line(parser, line, len);
 
     /* if there were parsing errors, abort */
     if (rc != dcNoErr)
       break;
+
+    if (dc_parser_stopped(parser))
+    {
+      rc = dcStoppedErr;
+      break;
+    }
   }
 
   free(line);
   fclose(fp);
 
+  /* counts from an input which failed part way are never added */
+  if (parser->stats != NULL && (rc == dcNoErr || rc == dcStoppedErr))
+    dc_parser_stats_end(parser->stats);
+
+  return rc;
+}
+
+/**
+ * Process a memory buffer into Parser data structures
+ *
+ * This method behaves like \ref dc_parser_read_file, but processes data
+ * already held in memory. The buffer is split into lines in place; each line
+ * is copied into a single reusable line buffer before being parsed, so the
+ * buffer itself is not modified.
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in] buf The data to parse (need not be NUL-terminated)
+ * \param[in] len The length of the data, in bytes
+ * \param[in] name The name of the input (e.g. a path) for use in diagnostics,
+ * or \c NULL if unknown
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcLimitErr if the input exceeds a limit in \ref dcParserLimits
+ * \retval dcStoppedErr if a condition in \ref dcParserStop was met before
+ * the end of the buffer
+ * \returns Otherwise, the status returned by \ref dc_parser_read_line
+ */
+dcStatus dc_parser_read_buffer(
+  dcParser *parser,
+  const char *buf,
+  size_t len,
+  const char *name
+) {
+  const char *end;
+  const char *eol;
+  char *line = NULL;
+  char *tmp;
+  size_t size = 0;
+  size_t n;
+  dcStatus rc;
+
+  assert(parser != NULL);
+  assert(parser->head == NULL);
+  assert(buf != NULL || len == 0);
+
+  if (parser == NULL || parser->head != NULL || (buf == NULL && len != 0))
+    return dcParameterErr;
+
+  rc = dc_parser_begin(parser, name);
+  if (rc != dcNoErr)
+    return rc;
+
+  /* refuse oversized input before doing any work on it */
+  if (parser->limits.bytes != 0 && len > parser->limits.bytes)
+  {
+    dc_crit(&parser->handler, &parser->ctx, _("Input is larger than the "
+      "limit of %lu bytes"), (unsigned long) parser->limits.bytes);
+    return dcLimitErr;
+  }
+
+  end = buf + len;
+  while (buf < end)
+  {
+    eol = memchr(buf, '\n', end - buf);
+    n = (eol == NULL) ? (size_t) (end - buf) : (size_t) (eol - buf) + 1;
+
+    /* copy at most one byte beyond the limit; read_line rejects the rest */
+    if (parser->limits.line != 0 && n > parser->limits.line + 1)
+      n = parser->limits.line + 1;
+
+    if (n + 1 > size)
+    {
+      tmp = realloc(line, n + 1);
+      if (tmp == NULL)
+      {
+        rc = dcMemFullErr;
+        break;
+      }
+      line = tmp;
+      size = n + 1;
+    }
+    memcpy(line, buf, n);
+    line[n] = '\0';
+    buf += n;
+
+    rc = dc_parser_read_line(parser, line, n);
+    if (rc != dcNoErr)
+      break;
+
+    if (dc_parser_stopped(parser))
+    {
+      rc = dcStoppedErr;
+      break;
+    }
+  }
+
+  free(line);
+
+  /* counts from an input which failed part way are never added */
+  if (parser->stats != NULL && (rc == dcNoErr || rc == dcStoppedErr))
+    dc_parser_stats_end(parser->stats);
+
   return rc;
 }
 
@@ -831,10 +1826,15 @@ dcStatus dc_parser_read_file(
  *
  * \param[in,out] parser A pointer to a Parser instance
  * \param[in,out] line A pointer to the text to be parsed
- * \param[in] len The length of the string
+ * \param[in] len The length of the string, including any line terminator
  *
- * \returns The status indication returned from either \c dc_parse_block or
- * \c dc_parse_chunk
+ * \retval dcLimitErr if the line exceeds a limit in \ref dcParserLimits
+ * \returns Otherwise, the status indication returned from either
+ * \c dc_parse_block or \c dc_parse_chunk
+ *
+ * \note Lines are numbered and their byte offsets tracked (for
+ * \ref dcParserPosition) as they are given to this routine, so every line of
+ * the input must be passed in order, including comments and blank lines.
  *
  * \note Any problems manipulating the file will be reported via the dcParser
  * \link error.c error handler interface \endlink, and the status indication
@@ -855,13 +1855,56 @@ dcStatus dc_parser_read_line(
     return dcParameterErr;
 
   section = parser->tail;
+  parser->ctx.line++;
+
+  /* check the size limits before taking on any more of the input */
+  if (parser->limits.bytes != 0 && len > parser->limits.bytes - parser->offset)
+  {
+    dc_crit(&parser->handler, &parser->ctx, _("Input is larger than the "
+      "limit of %lu bytes"), (unsigned long) parser->limits.bytes);
+    return dcLimitErr;
+  }
+  if (parser->limits.line != 0 && len > parser->limits.line &&
+    (len - 1 > parser->limits.line || line[len-1] != '\n'))
+  {
+    dc_crit(&parser->handler, &parser->ctx, _("Line is longer than the "
+      "limit of %lu bytes"), (unsigned long) parser->limits.line);
+    return dcLimitErr;
+  }
+
+  /* track the position of this line; offsets saturate at 4 GiB */
+  parser->pos.offset = (parser->offset > UINT32_MAX) ?
+    UINT32_MAX : (uint32_t) parser->offset;
+  parser->offset += len;
+
+  if (parser->file != NULL &&
+    dc_parser_file_line(parser->file, parser->pos.offset) != dcNoErr)
+    return dcMemFullErr;
+
+  if (parser->stats != NULL)
+    dc_parser_stats_line(parser->stats, line, len);
 
   /* XXX: Ignore comments completely */
   if (line[0] == '#')
     return dcNoErr;
 
-  /* remove trailing whitespace */
-  dc_strchomp(line, len);
+  /* remove trailing whitespace; trusted input has none but the newline */
+  if (!parser->trusted)
+    dc_strchomp(line, len);
+  else
+  {
+    if (len > 0 && line[len-1] == '\n')
+      line[--len] = '\0';
+#ifdef DEBUG
+    if (len > 0 && (line[len-1] == ' ' || line[len-1] == '\t' ||
+      line[len-1] == '\r' || line[len-1] == '\n'))
+    {
+      dc_crit(&parser->handler, &parser->ctx, _("Trusted input has trailing "
+        "whitespace"));
+      return dcSyntaxErr;
+    }
+#endif /* DEBUG */
+  }
 
   /* If there is a byte of whitespace, the line can be fixed, mergeable or
    * empty. Otherwise, it is a new block (or some garbage in the file).
@@ -878,16 +1921,28 @@ dcStatus dc_parser_read_line(
     }
     else
     {
+      if (parser->limits.sections != 0 &&
+        parser->sections >= parser->limits.sections)
+      {
+        dc_crit(&parser->handler, &parser->ctx, _("Input has more than %lu "
+          "paragraphs"), (unsigned long) parser->limits.sections);
+        return dcLimitErr;
+      }
+
       section = dc_parser_section_new();
       if (section == NULL)
         return dcMemFullErr;
       dc_parser_append(parser, section);
+      parser->sections++;
+      parser->fields = 0;
     }
     return dcNoErr;
   }
 
   if (line[0] == ' ' || line[0] == '\t')
     rc = dc_parse_chunk(parser, line);
+  else if (parser->trusted)
+    rc = dc_parse_block_trusted(parser, line);
   else
     rc = dc_parse_block(parser, line);
 
@@ -895,37 +1950,67 @@ dcStatus dc_parser_read_line(
 }
 
 /**
- * Append a Parser Block to a Parser instance
+ * Append a Parser Section to a Parser instance
  *
  * This routine will append a given \ref dcParserSection object to the end of
- * the \ref dcParser's internal list.
+ * the \ref dcParser's internal list, in constant time.
  *
  * \param[in,out] parser A pointer to a Parser instance
  * \param[in] section A pointer to a Parser Section
+ *
+ * \note If the parser has been cloned, its last section must first be made
+ * writable (see \ref dc_parser_section_writable).
  */
 void dc_parser_append(
   dcParser *parser,
   dcParserSection *section
 ) {
-  dcParserSection *node;
-
   assert(parser != NULL);
   assert(section != NULL);
 
-  node = parser->head;
-  if (node == NULL)
-  {
+  if (parser->head == NULL)
     parser->head = section;
-  }
   else
+    parser->tail->next = section;
+
+  parser->tail = section;
+}
+
+/**
+ * Write the contents of a Parser instance to a dcString
+ *
+ * This routine serializes every non-empty \ref dcParserSection held by the
+ * parser, in order, separating them with blank lines. It makes a single
+ * linear pass over the data structures, appending to one buffer.
+ *
+ * \param[in] parser A pointer to a Parser instance
+ * \param[in,out] buf A dcString to append the serialized data to
+ *
+ * \note Comments are discarded by the parser, so they are not reproduced.
+ */
+void dc_parser_write(
+  dcParser *parser,
+  dcString *buf
+) {
+  dcParserSection *section;
+  int first = 1;
+
+  assert(parser != NULL);
+  assert(buf != NULL);
+
+  section = parser->head;
+  while (section != NULL)
   {
-    while (node->next != NULL)
+    if (section->head != NULL)
     {
-      node = node->next;
+      if (!first)
+        dc_string_append_c(buf, '\n');
+
+      dc_parser_section_write(section, buf);
+      first = 0;
     }
-    node->next = section;
+    section = section->next;
   }
-  parser->tail = section;
 }
 
 /**
@@ -948,8 +2033,8 @@ void dc_parser_free(
   assert(ptr != NULL);
   assert(*ptr != NULL);
 
-  if ((*ptr)->ctx.path != NULL)
-    free((*ptr)->ctx.path);
+  if ((*ptr)->file != NULL)
+    dc_parser_file_release(&(*ptr)->file);
 
   if ((*ptr)->head != NULL)
   {
@@ -961,6 +2046,13 @@ void dc_parser_free(
     {
       next = section->next;
 
+      /* the rest of the list is still referenced by a clone */
+      if (section->refs > 1)
+      {
+        dc_parser_section_free(&section);
+        break;
+      }
+
       dc_parser_section_free(&section);
 
       section = next;
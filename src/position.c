@@ -0,0 +1,301 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Compact source positions
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Each \ref dcParserChunk remembers where it came from, so that diagnostics
+ * about it can name the file and line (e.g. "unknown field at
+ * debian/control line 30"). Rather than storing a full \ref dcParserContext
+ * (a path pointer and a line number) in every chunk, chunks store a compact
+ * \ref dcParserPosition: a 32-bit file id and the byte offset at which the
+ * chunk's line begins.
+ *
+ * \par File registry
+ * File ids refer to \ref dcParserFile objects held in a process-wide table.
+ * As a parser reads each line, it records the line's starting offset in the
+ * file's newline index. Positions are then resolved into a path and line
+ * number on demand, using a binary search of this index, by
+ * \ref dc_parser_position_context.
+ *
+ * \par Thread safety
+ * The registry itself is protected by a lock, so files may be registered,
+ * released and resolved from multiple threads. The newline index of a file
+ * is only updated by the parser reading it, and must not be used to resolve
+ * positions from other threads until that parser has finished reading.
+ *
+ * \note Offsets are 32 bits wide; positions in files larger than 4 GiB
+ * saturate at the largest representable offset, so line numbers beyond that
+ * point are not reported accurately.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: strdup */
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>  /* for: pthread_mutex_lock, etc. */
+#endif /* HAVE_PTHREAD_H */
+
+#include <debctrl/position.h>
+#include <debctrl/parser.h> /* for: dcParserContext */
+
+/** Initial number of slots in the line index of a file */
+#define LINES_INIT_SIZE   64
+
+/** Table of registered files, indexed by file id (id 0 is never used) */
+static dcParserFile **dc_file_table = NULL;
+/** Number of slots in \c dc_file_table */
+static size_t dc_file_size = 0;
+/** Lowest file id which may be free */
+static size_t dc_file_hint = 1;
+
+#ifdef HAVE_PTHREAD_H
+/** Protects \c dc_file_table and the reference counts of files */
+static pthread_mutex_t dc_file_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK()    pthread_mutex_lock(&dc_file_lock)
+#define UNLOCK()  pthread_mutex_unlock(&dc_file_lock)
+#else /* !HAVE_PTHREAD_H */
+#define LOCK()
+#define UNLOCK()
+#endif /* HAVE_PTHREAD_H */
+
+/**
+ * Construct and register a Parser File
+ *
+ * For details on the structure and its fields, see \ref dcParserFile
+ *
+ * \param[in] path The path to the file. The text is internally copied, so
+ * the source string may be freed.
+ *
+ * \retval NULL if there is a failure to allocate memory, or all file ids
+ * are in use
+ * \return a dynamically allocated dcParserFile object, with a reference
+ * count of one
+ */
+dcParserFile * dc_parser_file_new(
+  const char *path
+) {
+  dcParserFile *file;
+  dcParserFile **tmp;
+  size_t size;
+  size_t id;
+
+  assert(path != NULL);
+
+  file = NEW(dcParserFile);
+  if (file == NULL)
+    return NULL;
+
+  file->path = strdup(path);
+  if (file->path == NULL)
+  {
+    free(file);
+    return NULL;
+  }
+
+  file->refs = 1;
+  file->lines = NULL;
+  file->count = 0;
+  file->size = 0;
+
+  LOCK();
+
+  /* find a free slot, growing the table if there are none */
+  for (id = dc_file_hint; id < dc_file_size; id++)
+  {
+    if (dc_file_table[id] == NULL)
+      break;
+  }
+
+  if (id >= dc_file_size)
+  {
+    size = (dc_file_size == 0) ? 16 : dc_file_size * 2;
+    tmp = NULL;
+    if (size - 1 <= (uint32_t) -1)
+      tmp = realloc(dc_file_table, size * sizeof(dcParserFile *));
+
+    if (tmp == NULL)
+    {
+      UNLOCK();
+      free(file->path);
+      free(file);
+      return NULL;
+    }
+
+    dc_file_table = tmp;
+    while (dc_file_size < size)
+      dc_file_table[dc_file_size++] = NULL;
+  }
+
+  file->id = (uint32_t) id;
+  dc_file_table[id] = file;
+  dc_file_hint = id + 1;
+
+  UNLOCK();
+
+  return file;
+}
+
+/**
+ * Record the start of a line in a Parser File
+ *
+ * Lines must be recorded in order of increasing offset, starting with the
+ * first line (at offset \c 0).
+ *
+ * \param[in,out] file A pointer to a Parser File
+ * \param[in] offset The byte offset at which the line begins
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_parser_file_line(
+  dcParserFile *file,
+  uint32_t offset
+) {
+  uint32_t *tmp;
+  size_t size;
+
+  assert(file != NULL);
+  assert(file->count == 0 || file->lines[file->count-1] <= offset);
+
+  if (file->count == file->size)
+  {
+    size = (file->size == 0) ? LINES_INIT_SIZE : file->size * 2;
+    tmp = realloc(file->lines, size * sizeof(uint32_t));
+    if (tmp == NULL)
+      return dcMemFullErr;
+
+    file->lines = tmp;
+    file->size = size;
+  }
+
+  file->lines[file->count++] = offset;
+  return dcNoErr;
+}
+
+/**
+ * Acquire a reference to a Parser File
+ *
+ * \param[in,out] file A pointer to a Parser File
+ *
+ * \return The same pointer, for convenience
+ */
+dcParserFile * dc_parser_file_retain(
+  dcParserFile *file
+) {
+  assert(file != NULL);
+
+  LOCK();
+  file->refs++;
+  UNLOCK();
+
+  return file;
+}
+
+/**
+ * Release a reference to a Parser File
+ *
+ * When the last reference is released, the file is removed from the
+ * registry and its memory is freed.
+ *
+ * \param[in,out] ptr The address of a pointer to a Parser File
+ *
+ * \note The pointer will be set to \c NULL.
+ */
+void dc_parser_file_release(
+  dcParserFile **ptr
+) {
+  dcParserFile *file;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  file = *ptr;
+  *ptr = NULL;
+
+  LOCK();
+  if (--file->refs > 0)
+  {
+    UNLOCK();
+    return;
+  }
+
+  dc_file_table[file->id] = NULL;
+  if (file->id < dc_file_hint)
+    dc_file_hint = file->id;
+  UNLOCK();
+
+  free(file->lines);
+  free(file->path);
+  free(file);
+}
+
+/**
+ * Resolve a Parser Position into a Parser Context
+ *
+ * This looks up the path of the originating file of a position, and finds
+ * its line number using the file's newline index.
+ *
+ * Example:
+ * \code
+ * dcParserContext ctx;
+ * dc_warn(handler, dc_parser_position_context(&chunk->pos, &ctx), "...");
+ * \endcode
+ *
+ * \param[in] pos A pointer to a Parser Position
+ * \param[out] ctx A pointer to a Parser Context to fill in
+ *
+ * \retval NULL if the originating file is unknown
+ * \return The pointer \c ctx, for convenience
+ *
+ * \note The path in the resulting context belongs to the file, and remains
+ * valid for as long as the file is registered.
+ */
+dcParserContext * dc_parser_position_context(
+  const dcParserPosition *pos,
+  dcParserContext *ctx
+) {
+  dcParserFile *file;
+  size_t lo;
+  size_t hi;
+  size_t mid;
+
+  assert(pos != NULL);
+  assert(ctx != NULL);
+
+  if (pos->file == 0)
+    return NULL;
+
+  LOCK();
+
+  if (pos->file >= dc_file_size || dc_file_table[pos->file] == NULL)
+  {
+    UNLOCK();
+    return NULL;
+  }
+  file = dc_file_table[pos->file];
+
+  /* find the last line beginning at or before the offset */
+  lo = 0;
+  hi = file->count;
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if (file->lines[mid] <= pos->offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  ctx->path = file->path;
+  ctx->line = (unsigned int) lo;
+
+  UNLOCK();
+
+  return ctx;
+}
@@ -0,0 +1,947 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Query daemon protocol
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Tools which only need to look up a few packages spend most of their time
+ * parsing the whole archive on startup. Instead, a long-running daemon can
+ * load a \ref dcIndex once and answer lookups over a Unix domain socket,
+ * using \ref dc_query_serve; tools then connect with \ref dc_query_connect
+ * and issue queries, receiving the matching paragraphs as a \ref dcParser.
+ * \par
+ * The daemon may instead serve a frozen image (see \ref frozen.c) with
+ * \ref dc_query_serve_frozen. The image is mapped rather than loaded, so
+ * any number of daemons (and other processes) share a single copy of the
+ * index, and a daemon starts serving as soon as the image is opened.
+ *
+ * \par Protocol
+ * A client may send any number of requests on a connection, waiting for the
+ * response to each before sending the next. All integers are unsigned and
+ * in network (big-endian) byte order.
+ * \par
+ * A request consists of a one-byte operation code, followed by two
+ * arguments, each a 16-bit length followed by that many bytes:
+ * - \c QUERY_PACKAGE (1): paragraphs for a package (name, unused)
+ * - \c QUERY_RDEPENDS (2): paragraphs depending on a package (name, unused)
+ * - \c QUERY_FILTER (3): paragraphs with a field value (field, value)
+ * \par
+ * A response consists of a 32-bit \ref dcStatus and a 32-bit length,
+ * followed by that many bytes holding the matching paragraphs in control
+ * file format.
+ *
+ * \par Concurrency
+ * The daemon waits on all of its connections at once (with \c poll), and
+ * buffers each client's requests until they are complete, so a slow client
+ * does not hold up the others. Up to \c QUERY_CLIENTS clients may be
+ * connected at a time; further connections wait to be accepted. Responses
+ * are sent in full before the next request is read, which takes little
+ * time unless a client stops reading.
+ *
+ * \note Connections idle for longer than \c QUERY_TIMEOUT seconds, and
+ * clients which stop reading their responses for as long, are dropped.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memcpy, memmove, memset, strcpy, strlen */
+#include <errno.h>    /* for: errno */
+#include <time.h>     /* for: time */
+#include <unistd.h>   /* for: read, close, unlink */
+#include <poll.h>     /* for: poll */
+#include <sys/socket.h> /* for: socket, bind, etc. */
+#include <sys/stat.h> /* for: lstat, S_ISSOCK */
+#include <sys/time.h> /* for: struct timeval */
+#include <sys/un.h>   /* for: struct sockaddr_un */
+
+#include <debctrl/query.h>
+#include <debctrl/defaults.h>
+
+/** Operation codes */
+#define QUERY_PACKAGE   1
+#define QUERY_RDEPENDS  2
+#define QUERY_FILTER    3
+
+/** Seconds to wait for a request before dropping a connection */
+#define QUERY_TIMEOUT   5
+
+/** Maximum number of pending connections */
+#define QUERY_BACKLOG   64
+
+/** Maximum number of connections served at a time */
+#define QUERY_CLIENTS   64
+
+/** Milliseconds between checks for idle connections and stop requests */
+#define QUERY_POLL      1000
+
+/** Size of the largest request: an operation code and two arguments */
+#define QUERY_REQUEST   (1 + 2 * (2 + 0xffff))
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL    0
+#endif
+
+/**
+ * Fill in the address of a socket (helper function)
+ *
+ * \param[out] addr The address
+ * \param[in] path The path of the socket
+ *
+ * \return Nonzero if the path fits in the address
+ */
+static int dc_query_address(
+  struct sockaddr_un *addr,
+  const char *path
+) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(addr->sun_path))
+    return 0;
+
+  strcpy(addr->sun_path, path);
+  return 1;
+}
+
+/**
+ * Send a buffer on a socket (helper function)
+ *
+ * \param[in] fd The socket
+ * \param[in] buf The data
+ * \param[in] len The length of the data
+ *
+ * \return Nonzero if all of the data was sent
+ */
+static int dc_query_send(
+  int fd,
+  const void *buf,
+  size_t len
+) {
+  const char *p = buf;
+  ssize_t n;
+
+  while (len > 0)
+  {
+    n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+
+    p += n;
+    len -= n;
+  }
+
+  return 1;
+}
+
+/**
+ * Receive a buffer from a socket (helper function)
+ *
+ * \param[in] fd The socket
+ * \param[out] buf The buffer
+ * \param[in] len The length of data to receive
+ *
+ * \return Nonzero if all of the data was received
+ */
+static int dc_query_recv(
+  int fd,
+  void *buf,
+  size_t len
+) {
+  char *p = buf;
+  ssize_t n;
+
+  while (len > 0)
+  {
+    n = read(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+
+    p += n;
+    len -= n;
+  }
+
+  return 1;
+}
+
+/**
+ * The index a daemon serves (internal)
+ *
+ * Exactly one of the members is set.
+ */
+typedef struct
+{
+  const dcIndex *index; /**< An index in memory */
+  const dcFrozenIndex *frozen; /**< A mapped frozen image */
+} dcQuerySource;
+
+/**
+ * A connection to a daemon (internal)
+ */
+typedef struct
+{
+  int fd; /**< Connected socket */
+  dcString *in; /**< Received bytes not yet answered */
+  time_t active; /**< When the connection was last used */
+} dcQueryConnection;
+
+/**
+ * Split a complete request from received bytes (helper function)
+ *
+ * \param[in] buf The received bytes
+ * \param[in] len The number of received bytes
+ * \param[out] op The operation code
+ * \param[out] args Buffers of at least 65536 bytes for the two arguments
+ *
+ * \retval 0 if the bytes do not yet hold a complete request
+ * \return The length of the request
+ */
+static size_t dc_query_split(
+  const unsigned char *buf,
+  size_t len,
+  unsigned char *op,
+  char **args
+) {
+  size_t start[2];
+  size_t n[2];
+  size_t pos = 1;
+  int i;
+
+  for (i = 0; i < 2; i++)
+  {
+    if (len < pos + 2)
+      return 0;
+    n[i] = ((size_t) buf[pos] << 8) | buf[pos + 1];
+    start[i] = pos + 2;
+    pos = start[i] + n[i];
+  }
+  if (len < pos)
+    return 0;
+
+  *op = buf[0];
+  for (i = 0; i < 2; i++)
+  {
+    memcpy(args[i], buf + start[i], n[i]);
+    args[i][n[i]] = '\0';
+  }
+
+  return pos;
+}
+
+/**
+ * Find the next paragraph matching a request (helper function)
+ *
+ * \param[in] source The index to query
+ * \param[in] op The operation code
+ * \param[in] args The two arguments
+ * \param[in,out] iter Iterator for the lookup, initially \c 0
+ * \param[out] section Set to the paragraph, for indexes in memory
+ * \param[out] text Set to the text of the paragraph, for frozen images
+ * \param[out] len Set to the length of \c text
+ * \param[out] rc Set to \c dcProtocolErr if the operation is unknown
+ *
+ * \return Nonzero if another paragraph was found
+ */
+static int dc_query_next(
+  const dcQuerySource *source,
+  unsigned char op,
+  char **args,
+  size_t *iter,
+  dcParserSection **section,
+  const char **text,
+  size_t *len,
+  dcStatus *rc
+) {
+  size_t paragraph = FROZEN_NONE;
+
+  *section = NULL;
+  *text = NULL;
+
+  if (source->index != NULL)
+  {
+    switch (op)
+    {
+      case QUERY_PACKAGE:
+        *section = dc_index_find(source->index, args[0], iter);
+        break;
+      case QUERY_RDEPENDS:
+        *section = dc_index_rdepends(source->index, args[0], iter);
+        break;
+      case QUERY_FILTER:
+        *section = dc_index_filter(source->index, args[0], args[1], iter);
+        break;
+      default:
+        *rc = dcProtocolErr;
+        break;
+    }
+    return (*section != NULL);
+  }
+
+  switch (op)
+  {
+    case QUERY_PACKAGE:
+      paragraph = dc_frozen_find(source->frozen, args[0], iter);
+      break;
+    case QUERY_RDEPENDS:
+      paragraph = dc_frozen_rdepends(source->frozen, args[0], iter);
+      break;
+    case QUERY_FILTER:
+      paragraph = dc_frozen_filter(source->frozen, args[0], args[1], iter);
+      break;
+    default:
+      *rc = dcProtocolErr;
+      break;
+  }
+  if (paragraph == FROZEN_NONE)
+    return 0;
+
+  *text = dc_frozen_text(source->frozen, paragraph, len);
+  return (*text != NULL);
+}
+
+/**
+ * Answer a single request (helper function)
+ *
+ * \param[in] source The index to query
+ * \param[in] fd The socket
+ * \param[in,out] buf Buffer for the response
+ * \param[in] op The operation code
+ * \param[in] args The two arguments
+ *
+ * \return Nonzero if the request was answered
+ */
+static int dc_query_answer(
+  const dcQuerySource *source,
+  int fd,
+  dcString *buf,
+  unsigned char op,
+  char **args
+) {
+  dcParserSection *section;
+  const char *text;
+  dcStatus rc = dcNoErr;
+  size_t iter = 0;
+  size_t len = 0;
+  unsigned char head[8];
+
+  buf->len = 0;
+  buf->text[0] = '\0';
+  memset(head, 0, sizeof(head));
+
+  /* leave room for the response header, which is filled in last */
+  if (!dc_string_append_n(buf, (const char *) head, sizeof(head)))
+    return 0;
+
+  while (dc_query_next(source, op, args, &iter, &section, &text, &len, &rc))
+  {
+    if (buf->len > sizeof(head))
+      dc_string_append_c(buf, '\n');
+    if (section != NULL)
+      dc_parser_section_write(section, buf);
+    else
+      dc_string_append_n(buf, text, len);
+  }
+
+  len = buf->len - sizeof(head);
+  if (len > 0xffffffff)
+  {
+    rc = dcLimitErr;
+    len = 0;
+    buf->len = sizeof(head);
+  }
+
+  head[0] = head[1] = head[2] = 0;
+  head[3] = (unsigned char) rc;
+  head[4] = (unsigned char) ((len >> 24) & 0xff);
+  head[5] = (unsigned char) ((len >> 16) & 0xff);
+  head[6] = (unsigned char) ((len >> 8) & 0xff);
+  head[7] = (unsigned char) (len & 0xff);
+  memcpy(buf->text, head, sizeof(head));
+
+  return dc_query_send(fd, buf->text, buf->len);
+}
+
+/**
+ * Read from a connection and answer its complete requests (helper function)
+ *
+ * \param[in] source The index to query
+ * \param[in,out] conn The connection
+ * \param[in,out] buf Buffer for responses
+ * \param[in,out] args Buffers for the two arguments of a request
+ *
+ * \return Nonzero if the connection should be kept open
+ */
+static int dc_query_receive(
+  const dcQuerySource *source,
+  dcQueryConnection *conn,
+  dcString *buf,
+  char **args
+) {
+  dcString *in = conn->in;
+  unsigned char op;
+  size_t used;
+  ssize_t n;
+
+  /* a full buffer holds a complete request, so there is always room */
+  n = recv(conn->fd, in->text + in->len, in->size - in->len - 1,
+    MSG_DONTWAIT);
+  if (n < 0)
+    return (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK);
+  if (n == 0)
+    return 0;
+
+  in->len += n;
+  conn->active = time(NULL);
+
+  while ((used = dc_query_split((const unsigned char *) in->text, in->len,
+    &op, args)) > 0)
+  {
+    if (!dc_query_answer(source, conn->fd, buf, op, args))
+      return 0;
+
+    memmove(in->text, in->text + used, in->len - used);
+    in->len -= used;
+  }
+
+  return 1;
+}
+
+/**
+ * Accept a new connection (helper function)
+ *
+ * \param[in] listener The listening socket
+ * \param[out] conn The connection
+ *
+ * \retval dcNoErr if a connection was accepted, or there was none waiting
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the listening socket failed
+ */
+static dcStatus dc_query_accept(
+  int listener,
+  dcQueryConnection *conn
+) {
+  struct timeval timeout;
+
+  conn->fd = accept(listener, NULL, NULL);
+  if (conn->fd < 0)
+  {
+    if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN ||
+      errno == EWOULDBLOCK)
+      return dcNoErr;
+    return dcFileErr;
+  }
+
+  conn->in = dc_string_new(QUERY_REQUEST + 1);
+  if (conn->in == NULL)
+  {
+    close(conn->fd);
+    conn->fd = -1;
+    return dcMemFullErr;
+  }
+  conn->active = time(NULL);
+
+  /* bounds the time spent sending to a client which stops reading */
+  timeout.tv_sec = QUERY_TIMEOUT;
+  timeout.tv_usec = 0;
+  setsockopt(conn->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  return dcNoErr;
+}
+
+/**
+ * Close a connection (helper function)
+ *
+ * \param[in,out] conn The connection
+ */
+static void dc_query_hangup(
+  dcQueryConnection *conn
+) {
+  close(conn->fd);
+  conn->fd = -1;
+  dc_string_free(&conn->in);
+}
+
+/**
+ * Remove a stale socket (helper function)
+ *
+ * Only a socket is removed, so that a mistyped path cannot delete some
+ * other file.
+ *
+ * \param[in] path The path of the socket
+ *
+ * \retval 0 if something other than a socket is at the path
+ * \retval 1 if the path is now free
+ */
+static int dc_query_unlink(
+  const char *path
+) {
+  struct stat st;
+
+  if (lstat(path, &st) != 0)
+    return 1;
+  if (!S_ISSOCK(st.st_mode))
+    return 0;
+
+  unlink(path);
+  return 1;
+}
+
+/**
+ * Serve queries from an index or frozen image (helper function)
+ *
+ * \param[in] source The index to query
+ * \param[in] path The path of the socket
+ * \param[in] stop A flag requesting the server stop, or \c NULL
+ *
+ * \return As for \ref dc_query_serve
+ */
+static dcStatus dc_query_run(
+  const dcQuerySource *source,
+  const char *path,
+  volatile int *stop
+) {
+  struct sockaddr_un addr;
+  struct pollfd fds[QUERY_CLIENTS + 1];
+  dcQueryConnection conns[QUERY_CLIENTS];
+  dcString *buf;
+  char *args[2];
+  dcStatus rc = dcNoErr;
+  size_t nconns = 0;
+  size_t i;
+  time_t now;
+  int listener;
+  int n;
+
+  if (!dc_query_address(&addr, path))
+    return dcParameterErr;
+
+  buf = dc_string_new(0);
+  args[0] = malloc(65536);
+  args[1] = malloc(65536);
+  if (buf == NULL || args[0] == NULL || args[1] == NULL)
+  {
+    rc = dcMemFullErr;
+    goto done;
+  }
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0)
+  {
+    rc = dcFileErr;
+    goto done;
+  }
+
+  if (!dc_query_unlink(path) ||
+    bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+    listen(listener, QUERY_BACKLOG) != 0)
+  {
+    close(listener);
+    rc = dcFileErr;
+    goto done;
+  }
+
+  while (stop == NULL || !*stop)
+  {
+    /* stop listening while every slot is taken */
+    fds[0].fd = (nconns < QUERY_CLIENTS) ? listener : -1;
+    fds[0].events = POLLIN;
+    for (i = 0; i < nconns; i++)
+    {
+      fds[i + 1].fd = conns[i].fd;
+      fds[i + 1].events = POLLIN;
+    }
+
+    n = poll(fds, nconns + 1, QUERY_POLL);
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      rc = dcFileErr;
+      break;
+    }
+
+    now = time(NULL);
+    for (i = 0; i < nconns; i++)
+    {
+      if (fds[i + 1].revents != 0)
+      {
+        if (dc_query_receive(source, &conns[i], buf, args))
+          continue;
+      }
+      else if (now - conns[i].active <= QUERY_TIMEOUT)
+        continue;
+
+      /* fill the slot with the last connection, keeping fds in step */
+      dc_query_hangup(&conns[i]);
+      nconns--;
+      conns[i] = conns[nconns];
+      fds[i + 1] = fds[nconns + 1];
+      i--;
+    }
+
+    if (fds[0].fd >= 0 && (fds[0].revents & POLLIN))
+    {
+      rc = dc_query_accept(listener, &conns[nconns]);
+      if (rc != dcNoErr)
+        break;
+      if (conns[nconns].fd >= 0)
+        nconns++;
+    }
+  }
+
+  for (i = 0; i < nconns; i++)
+    dc_query_hangup(&conns[i]);
+
+  close(listener);
+  dc_query_unlink(path);
+
+done:
+  if (buf != NULL)
+    dc_string_free(&buf);
+  free(args[0]);
+  free(args[1]);
+
+  return rc;
+}
+
+/**
+ * Serve queries from an Index
+ *
+ * This listens on a Unix domain socket at the given path (replacing any
+ * existing socket there, but no other kind of file), answering requests
+ * from any number of clients as described in \ref query.c. It returns once
+ * \c *stop becomes nonzero (which is checked at least every \c QUERY_POLL
+ * milliseconds, and whenever a call is interrupted by a signal, so it may
+ * be set by a signal handler), or when an error occurs.
+ *
+ * \param[in] index The index to query
+ * \param[in] path The path of the socket
+ * \param[in] stop A flag requesting the server stop, or \c NULL to serve
+ * until an error occurs
+ *
+ * \retval dcNoErr if the server was stopped
+ * \retval dcParameterErr if the parameters are invalid, or the path is too
+ * long
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the socket could not be created or used, or a file
+ * which is not a socket is in the way
+ *
+ * \note The socket is removed when the server stops.
+ */
+dcStatus dc_query_serve(
+  const dcIndex *index,
+  const char *path,
+  volatile int *stop
+) {
+  dcQuerySource source;
+
+  assert(index != NULL);
+  assert(path != NULL);
+
+  if (index == NULL || path == NULL)
+    return dcParameterErr;
+
+  source.index = index;
+  source.frozen = NULL;
+
+  return dc_query_run(&source, path, stop);
+}
+
+/**
+ * Serve queries from a frozen image
+ *
+ * This works like \ref dc_query_serve, but answers from an image mapped
+ * with \ref dc_frozen_open, which is shared with any other processes
+ * mapping the same image. Example:
+ * \code
+ * dcFrozenIndex *frozen = dc_frozen_open("/dev/shm/debctrl.idx");
+ * if (frozen != NULL)
+ *   rc = dc_query_serve_frozen(frozen, QUERY_SOCKET, &stop);
+ * \endcode
+ *
+ * \param[in] frozen The frozen image to query
+ * \param[in] path The path of the socket
+ * \param[in] stop A flag requesting the server stop, or \c NULL to serve
+ * until an error occurs
+ *
+ * \retval dcNoErr if the server was stopped
+ * \retval dcParameterErr if the parameters are invalid, or the path is too
+ * long
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the socket could not be created or used, or a file
+ * which is not a socket is in the way
+ *
+ * \note The socket is removed when the server stops.
+ */
+dcStatus dc_query_serve_frozen(
+  const dcFrozenIndex *frozen,
+  const char *path,
+  volatile int *stop
+) {
+  dcQuerySource source;
+
+  assert(frozen != NULL);
+  assert(path != NULL);
+
+  if (frozen == NULL || path == NULL)
+    return dcParameterErr;
+
+  source.index = NULL;
+  source.frozen = frozen;
+
+  return dc_query_run(&source, path, stop);
+}
+
+/**
+ * Connect to a query daemon
+ *
+ * For details on the structure and its fields, see \ref dcQueryClient
+ *
+ * \param[in] path The path of the daemon's socket, or \c NULL to use the
+ * default (\c QUERY_SOCKET)
+ *
+ * \retval NULL if the daemon could not be reached, or there is a failure to
+ * allocate memory
+ * \return a dynamically allocated dcQueryClient object
+ */
+dcQueryClient * dc_query_connect(
+  const char *path
+) {
+  struct sockaddr_un addr;
+  dcQueryClient *client;
+
+  if (path == NULL)
+    path = QUERY_SOCKET;
+
+  if (!dc_query_address(&addr, path))
+    return NULL;
+
+  client = NEW(dcQueryClient);
+  if (client == NULL)
+    return NULL;
+
+  client->buf = dc_string_new(0);
+  client->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (client->buf == NULL || client->fd < 0 ||
+    connect(client->fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+  {
+    dc_query_close(&client);
+    return NULL;
+  }
+
+  return client;
+}
+
+/**
+ * Issue a request to a query daemon (helper function)
+ *
+ * \param[in,out] client A pointer to a Query Client
+ * \param[in] op The operation code
+ * \param[in] arg1 The first argument
+ * \param[in] arg2 The second argument
+ * \param[out] result Set to a new Parser holding the matching paragraphs
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the daemon could not be reached
+ * \retval dcProtocolErr if the daemon sent a malformed response
+ */
+static dcStatus dc_query_request(
+  dcQueryClient *client,
+  int op,
+  const char *arg1,
+  const char *arg2,
+  dcParser **result
+) {
+  const char *args[2];
+  unsigned char head[8];
+  size_t len;
+  size_t i;
+  dcStatus rc;
+
+  assert(client != NULL);
+  assert(arg1 != NULL);
+  assert(result != NULL);
+
+  if (client == NULL || arg1 == NULL || result == NULL)
+    return dcParameterErr;
+
+  *result = NULL;
+
+  args[0] = arg1;
+  args[1] = (arg2 == NULL) ? "" : arg2;
+
+  client->buf->len = 0;
+  dc_string_append_c(client->buf, (char) op);
+  for (i = 0; i < 2; i++)
+  {
+    len = strlen(args[i]);
+    if (len > 0xffff)
+      return dcParameterErr;
+
+    dc_string_append_c(client->buf, (char) (len >> 8));
+    dc_string_append_c(client->buf, (char) (len & 0xff));
+    if (!dc_string_append_n(client->buf, args[i], len))
+      return dcMemFullErr;
+  }
+
+  if (!dc_query_send(client->fd, client->buf->text, client->buf->len) ||
+    !dc_query_recv(client->fd, head, sizeof(head)))
+    return dcFileErr;
+
+  rc = (dcStatus) (((uint32_t) head[0] << 24) | ((uint32_t) head[1] << 16) |
+    ((uint32_t) head[2] << 8) | head[3]);
+  len = ((size_t) head[4] << 24) | ((size_t) head[5] << 16) |
+    ((size_t) head[6] << 8) | head[7];
+
+  client->buf->len = 0;
+  if (len >= client->buf->size && !dc_string_resize(client->buf, len + 1))
+    return dcMemFullErr;
+  if (!dc_query_recv(client->fd, client->buf->text, len))
+    return dcFileErr;
+  client->buf->len = len;
+  client->buf->text[len] = '\0';
+
+  if (rc != dcNoErr)
+    return rc;
+
+  *result = dc_parser_new();
+  if (*result == NULL)
+    return dcMemFullErr;
+
+  rc = dc_parser_read_buffer(*result, client->buf->text, len, NULL);
+  if (rc != dcNoErr)
+  {
+    dc_parser_free(result);
+    return (rc == dcMemFullErr) ? rc : dcProtocolErr;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Look up the paragraphs for a package
+ *
+ * This asks the daemon for the paragraphs its index returns from
+ * \ref dc_index_find.
+ *
+ * Example:
+ * \code
+ * dcQueryClient *client = dc_query_connect(NULL);
+ * dcParser *result;
+ * if (client != NULL && dc_query_package(client, "dpkg", &result) == dcNoErr)
+ * {
+ *   ...
+ *   dc_parser_free(&result);
+ * }
+ * \endcode
+ *
+ * \param[in,out] client A pointer to a Query Client
+ * \param[in] package The package name
+ * \param[out] result Set to a new Parser holding the matching paragraphs,
+ * which the caller must free with \ref dc_parser_free
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the daemon could not be reached
+ * \retval dcProtocolErr if the daemon sent a malformed response
+ */
+dcStatus dc_query_package(
+  dcQueryClient *client,
+  const char *package,
+  dcParser **result
+) {
+  return dc_query_request(client, QUERY_PACKAGE, package, NULL, result);
+}
+
+/**
+ * Look up the paragraphs depending on a package
+ *
+ * This asks the daemon for the paragraphs its index returns from
+ * \ref dc_index_rdepends.
+ *
+ * \param[in,out] client A pointer to a Query Client
+ * \param[in] package The package name
+ * \param[out] result Set to a new Parser holding the matching paragraphs,
+ * which the caller must free with \ref dc_parser_free
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the daemon could not be reached
+ * \retval dcProtocolErr if the daemon sent a malformed response
+ */
+dcStatus dc_query_rdepends(
+  dcQueryClient *client,
+  const char *package,
+  dcParser **result
+) {
+  return dc_query_request(client, QUERY_RDEPENDS, package, NULL, result);
+}
+
+/**
+ * Look up the paragraphs with a given field value
+ *
+ * This asks the daemon for the paragraphs its index returns from
+ * \ref dc_index_filter.
+ *
+ * \param[in,out] client A pointer to a Query Client
+ * \param[in] field The field name
+ * \param[in] value The value
+ * \param[out] result Set to a new Parser holding the matching paragraphs,
+ * which the caller must free with \ref dc_parser_free
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the daemon could not be reached
+ * \retval dcProtocolErr if the daemon sent a malformed response
+ */
+dcStatus dc_query_filter(
+  dcQueryClient *client,
+  const char *field,
+  const char *value,
+  dcParser **result
+) {
+  assert(value != NULL);
+
+  if (value == NULL)
+    return dcParameterErr;
+
+  return dc_query_request(client, QUERY_FILTER, field, value, result);
+}
+
+/**
+ * Disconnect from a query daemon
+ *
+ * \param[in,out] ptr The address of a pointer to a Query Client
+ *
+ * \note The pointer will be set to \c NULL.
+ */
+void dc_query_close(
+  dcQueryClient **ptr
+) {
+  dcQueryClient *client;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  client = *ptr;
+
+  if (client->fd >= 0)
+    close(client->fd);
+  if (client->buf != NULL)
+    dc_string_free(&client->buf);
+
+  free(client);
+  *ptr = NULL;
+}
@@ -0,0 +1,1007 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Relationship field tokenizer and parser
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Relationship fields (\c Depends, \c Build-Depends and so on) are the
+ * largest fields most tools actually interpret. Their syntax is small:
+ * \code
+ *   name[:arch] [(op version)] [[arch ...]] [<profile ...> ...]
+ * \endcode
+ * with alternatives separated by \c | and groups of alternatives separated
+ * by \c , and any amount of whitespace (including tabs, and line breaks
+ * between chunks) between tokens.
+ *
+ * \par Tokenizer
+ * A \ref dcRelationScanner walks the chunks of a field in turn, so a field
+ * is tokenized in a single pass no matter how it is folded. Punctuation is
+ * classified a byte at a time, but words (which make up most of the text)
+ * are scanned eight bytes at a time for whitespace and delimiters, using
+ * the same word-wide bit tricks as \ref serialize.c; only the word holding
+ * the end of the token is examined byte by byte.
+ *
+ * Inside a version constraint, runs of \c <, \c > and \c = form an
+ * operator; elsewhere, \c < and \c > delimit build profile restrictions.
+ *
+ * \par Parser
+ * \ref dc_relation_parse turns the tokens of a field into a list of
+ * \ref dcRelationAtom structures, which point into the chunks of the field
+ * rather than holding copies. A \ref dcRelation keeps its arrays between
+ * calls, so parsing many fields in turn does not allocate once the arrays
+ * are large enough.
+ *
+ * \par Restrictions
+ * Build tools filter the \c Build-Depends of every source for one build
+ * configuration (a host architecture and a set of active build profiles).
+ * Rather than comparing strings for every atom, restrictions are compiled
+ * while parsing into masks over the names in a \ref dcRestrictions:
+ * - an architecture list becomes a pair of masks, of the names it lists
+ *   and of those it lists negated (as in \c [!i386])
+ * - each build profile list becomes a pair of masks, of the profiles it
+ *   requires and of those it excludes (as in \c <!nocheck>)
+ *
+ * A configuration is compiled the same way once (see
+ * \ref dc_restrictions_arch_mask), with the bits of every wildcard matching
+ * the architecture set, so \ref dc_relation_enabled is a few AND
+ * operations per atom.
+ *
+ * \note Atoms point into the chunks of the field, so they are only valid
+ * for as long as the block is not modified or freed.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memcpy, memchr, memset, strcmp, strlen */
+
+#include <debctrl/relation.h>
+
+#include "word.h"
+
+/**
+ * Determine whether a byte ends a word (helper function)
+ *
+ * \param[in] c The byte
+ * \param[in] paren Nonzero within a version constraint
+ *
+ * \return Nonzero if the byte is whitespace or a delimiter
+ */
+static int dc_relation_delimiter(
+  unsigned char c,
+  int paren
+) {
+  if (c <= ' ')
+    return 1;
+
+  switch (c)
+  {
+    case ',': case '|':
+    case '(': case ')':
+    case '[': case ']':
+    case '<': case '>':
+      return 1;
+    case '=':
+      return paren;
+  }
+
+  return 0;
+}
+
+/**
+ * Determine whether a word may contain the end of a token (helper function)
+ *
+ * This may report false positives, but never false negatives.
+ *
+ * \param[in] p A pointer to eight bytes, which need not be aligned
+ * \param[in] paren Nonzero within a version constraint
+ *
+ * \return Nonzero if some byte may be whitespace or a delimiter
+ */
+static int dc_relation_special(
+  const char *p,
+  int paren
+) {
+  uint64_t w;
+  uint64_t found;
+
+  memcpy(&w, p, sizeof(w));
+  found = HASLESS(w, 0x21) | HASBYTE(w, ',') | HASBYTE(w, '|') |
+    HASBYTE(w, '(') | HASBYTE(w, ')') | HASBYTE(w, '[') |
+    HASBYTE(w, ']') | HASBYTE(w, '<') | HASBYTE(w, '>');
+  if (paren)
+    found |= HASBYTE(w, '=');
+
+  return found != 0;
+}
+
+/**
+ * Find the end of a word (helper function)
+ *
+ * \param[in] p The start of the word
+ * \param[in] end The end of the chunk text
+ * \param[in] paren Nonzero within a version constraint
+ *
+ * \return A pointer to the first byte after the word
+ */
+static const char * dc_relation_word_end(
+  const char *p,
+  const char *end,
+  int paren
+) {
+  /* skip over words which hold no delimiters */
+  while (end - p >= 8 && !dc_relation_special(p, paren))
+    p += 8;
+
+  while (p < end && !dc_relation_delimiter((unsigned char) *p, paren))
+    p++;
+
+  return p;
+}
+
+/**
+ * Move a scanner to the start of a chunk (helper function)
+ *
+ * \param[in,out] scanner A pointer to the scanner
+ * \param[in] chunk The chunk, or \c NULL at the end of the field
+ */
+static void dc_relation_scan_chunk(
+  dcRelationScanner *scanner,
+  const dcParserChunk *chunk
+) {
+  scanner->chunk = chunk;
+  if (chunk == NULL || chunk->text == NULL)
+    scanner->p = scanner->end = "";
+  else
+  {
+    scanner->p = chunk->text;
+    scanner->end = chunk->text + strlen(chunk->text);
+  }
+}
+
+/**
+ * Prepare to tokenize a relationship field
+ *
+ * \param[out] scanner A pointer to the scanner to initialize
+ * \param[in] block The block holding the field
+ */
+void dc_relation_scan_init(
+  dcRelationScanner *scanner,
+  const dcParserBlock *block
+) {
+  assert(scanner != NULL);
+  assert(block != NULL);
+
+  dc_relation_scan_chunk(scanner, block->head);
+  scanner->paren = 0;
+}
+
+/**
+ * Find the next token of a relationship field
+ *
+ * \param[in,out] scanner A pointer to the scanner
+ * \param[out] token Set to the token
+ *
+ * \retval 0 if there are no more tokens
+ * \retval 1 if a token was found
+ */
+int dc_relation_scan(
+  dcRelationScanner *scanner,
+  dcRelationToken *token
+) {
+  const char *p;
+
+  assert(scanner != NULL);
+  assert(token != NULL);
+
+  /* skip whitespace, moving on to the next chunk as needed */
+  for (;;)
+  {
+    while (scanner->p < scanner->end && (unsigned char) *scanner->p <= ' ')
+      scanner->p++;
+
+    if (scanner->p < scanner->end)
+      break;
+
+    if (scanner->chunk == NULL)
+      return 0;
+    dc_relation_scan_chunk(scanner, scanner->chunk->next);
+  }
+
+  p = scanner->p;
+  token->text = p;
+  token->len = 1;
+
+  switch (*p)
+  {
+    case ',':
+      token->type = TOKEN_COMMA;
+      break;
+    case '|':
+      token->type = TOKEN_PIPE;
+      break;
+    case '(':
+      token->type = TOKEN_OPEN;
+      scanner->paren = 1;
+      break;
+    case ')':
+      token->type = TOKEN_CLOSE;
+      scanner->paren = 0;
+      break;
+    case '[':
+      token->type = TOKEN_ARCH_OPEN;
+      break;
+    case ']':
+      token->type = TOKEN_ARCH_CLOSE;
+      break;
+    case '<':
+    case '>':
+    case '=':
+      if (scanner->paren)
+      {
+        token->type = TOKEN_OPERATOR;
+        while (p + token->len < scanner->end && (p[token->len] == '<' ||
+          p[token->len] == '>' || p[token->len] == '='))
+          token->len++;
+        break;
+      }
+      if (*p != '=')
+      {
+        token->type = (*p == '<') ? TOKEN_PROFILE_OPEN : TOKEN_PROFILE_CLOSE;
+        break;
+      }
+      /* '=' outside a version constraint is part of a word */
+      token->type = TOKEN_WORD;
+      token->len = dc_relation_word_end(p + 1, scanner->end, 0) - p;
+      break;
+    default:
+      token->type = TOKEN_WORD;
+      token->len = dc_relation_word_end(p + 1, scanner->end,
+        scanner->paren) - p;
+      break;
+  }
+
+  scanner->p = p + token->len;
+  return 1;
+}
+
+/**
+ * Create a new relationship field parser
+ *
+ * \return A pointer to the new parser, or \c NULL if there was a failure to
+ * allocate memory
+ */
+dcRelation * dc_relation_new(
+  void
+) {
+  dcRelation *relation = NEW(dcRelation);
+
+  if (relation == NULL)
+    return NULL;
+
+  relation->atoms = NULL;
+  relation->count = 0;
+  relation->size = 0;
+  relation->groups = 0;
+
+  relation->terms = NULL;
+  relation->nterms = 0;
+  relation->tsize = 0;
+
+  relation->restrictions = NULL;
+  relation->masks = NULL;
+  relation->nmasks = 0;
+  relation->msize = 0;
+
+  return relation;
+}
+
+/**
+ * Append a new atom to a relationship field (helper function)
+ *
+ * \param[in,out] relation A pointer to the parser
+ * \param[in] name The name token of the atom
+ *
+ * \retval NULL if there was a failure to allocate memory
+ * \return A pointer to the new atom
+ */
+static dcRelationAtom * dc_relation_atom(
+  dcRelation *relation,
+  const dcRelationToken *name
+) {
+  dcRelationAtom *atom;
+  const char *colon;
+  size_t size;
+
+  if (relation->count == relation->size)
+  {
+    size = (relation->size == 0) ? 16 : relation->size * 2;
+    atom = realloc(relation->atoms, size * sizeof(dcRelationAtom));
+    if (atom == NULL)
+      return NULL;
+    relation->atoms = atom;
+    relation->size = size;
+  }
+
+  atom = &relation->atoms[relation->count++];
+  memset(atom, 0, sizeof(dcRelationAtom));
+  atom->name = name->text;
+  atom->namelen = name->len;
+  atom->group = relation->groups;
+
+  /* split off an architecture qualifier, but not within a substvar */
+  if (name->len < 2 || name->text[0] != '$' || name->text[1] != '{')
+  {
+    colon = memchr(name->text, ':', name->len);
+    if (colon != NULL)
+    {
+      atom->namelen = colon - name->text;
+      atom->arch = colon + 1;
+      atom->archlen = name->len - atom->namelen - 1;
+    }
+  }
+
+  return atom;
+}
+
+/**
+ * Append a restriction term to a relationship field (helper function)
+ *
+ * \param[in,out] relation A pointer to the parser
+ * \param[in] token The token
+ *
+ * \return Nonzero if successful
+ */
+static int dc_relation_term(
+  dcRelation *relation,
+  const dcRelationToken *token
+) {
+  dcRelationToken *terms;
+  size_t size;
+
+  if (relation->nterms == relation->tsize)
+  {
+    size = (relation->tsize == 0) ? 16 : relation->tsize * 2;
+    terms = realloc(relation->terms, size * sizeof(dcRelationToken));
+    if (terms == NULL)
+      return 0;
+    relation->terms = terms;
+    relation->tsize = size;
+  }
+
+  relation->terms[relation->nterms++] = *token;
+  return 1;
+}
+
+/**
+ * Compile an architecture restriction term into an atom (helper function)
+ *
+ * \param[in,out] relation A pointer to the parser
+ * \param[in,out] atom The atom
+ * \param[in] token The term
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcLimitErr if there are too many architecture names
+ */
+static dcStatus dc_relation_arch_term(
+  dcRelation *relation,
+  dcRelationAtom *atom,
+  const dcRelationToken *token
+) {
+  int neg = (token->text[0] == '!');
+  int id;
+
+  id = dc_restrictions_arch(relation->restrictions, token->text + neg,
+    token->len - neg);
+  if (id < 0)
+    return (id == -1) ? dcMemFullErr : dcLimitErr;
+
+  if (neg)
+    atom->archexclude |= UINT64_C(1) << id;
+  else
+    atom->archmask |= UINT64_C(1) << id;
+  return dcNoErr;
+}
+
+/**
+ * Start a new build profile list for an atom (helper function)
+ *
+ * \param[in,out] relation A pointer to the parser
+ * \param[in,out] atom The atom
+ *
+ * \return Nonzero if successful
+ */
+static int dc_relation_mask(
+  dcRelation *relation,
+  dcRelationAtom *atom
+) {
+  uint64_t *masks;
+  size_t size;
+
+  if (relation->nmasks == relation->msize)
+  {
+    size = (relation->msize == 0) ? 16 : relation->msize * 2;
+    masks = realloc(relation->masks, 2 * size * sizeof(uint64_t));
+    if (masks == NULL)
+      return 0;
+    relation->masks = masks;
+    relation->msize = size;
+  }
+
+  if (atom->nmasks == 0)
+    atom->masks = relation->nmasks;
+  atom->nmasks++;
+
+  relation->masks[2 * relation->nmasks] = 0;
+  relation->masks[2 * relation->nmasks + 1] = 0;
+  relation->nmasks++;
+  return 1;
+}
+
+/**
+ * Compile a build profile term into the last list (helper function)
+ *
+ * \param[in,out] relation A pointer to the parser
+ * \param[in] token The term
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcLimitErr if there are too many build profile names
+ */
+static dcStatus dc_relation_profile_term(
+  dcRelation *relation,
+  const dcRelationToken *token
+) {
+  int neg = (token->text[0] == '!');
+  int id;
+
+  id = dc_restrictions_profile(relation->restrictions, token->text + neg,
+    token->len - neg);
+  if (id < 0)
+    return (id == -1) ? dcMemFullErr : dcLimitErr;
+
+  relation->masks[2 * (relation->nmasks - 1) + neg] |= UINT64_C(1) << id;
+  return dcNoErr;
+}
+
+/**
+ * Parse a relationship field
+ *
+ * Empty groups (as left by a trailing comma) are ignored. If the parser has
+ * \c restrictions, architecture and build profile restrictions are also
+ * compiled into masks, for \ref dc_relation_enabled.
+ *
+ * \param[in,out] relation A pointer to the parser
+ * \param[in] block The block holding the field
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcSyntaxErr if the field is malformed; the atoms before the error
+ * are kept
+ * \retval dcLimitErr if the restrictions use more than \c RESTRICTION_IDS
+ * architecture or build profile names
+ */
+dcStatus dc_relation_parse(
+  dcRelation *relation,
+  const dcParserBlock *block
+) {
+  dcRelationScanner scanner;
+  dcRelationToken token;
+  dcRelationAtom *atom = NULL;
+  dcStatus rc;
+  int pipe = 0;
+
+  assert(relation != NULL);
+  assert(block != NULL);
+  if (relation == NULL || block == NULL)
+    return dcParameterErr;
+
+  relation->count = 0;
+  relation->groups = 0;
+  relation->nterms = 0;
+  relation->nmasks = 0;
+
+  dc_relation_scan_init(&scanner, block);
+  while (dc_relation_scan(&scanner, &token))
+  {
+    switch (token.type)
+    {
+      case TOKEN_WORD:
+        if (atom != NULL)
+          return dcSyntaxErr;
+        atom = dc_relation_atom(relation, &token);
+        if (atom == NULL)
+          return dcMemFullErr;
+        pipe = 0;
+        break;
+
+      case TOKEN_COMMA:
+        if (pipe)
+          return dcSyntaxErr;
+        if (atom != NULL)
+          relation->groups++;
+        atom = NULL;
+        break;
+
+      case TOKEN_PIPE:
+        if (atom == NULL)
+          return dcSyntaxErr;
+        atom = NULL;
+        pipe = 1;
+        break;
+
+      case TOKEN_OPEN:
+        if (atom == NULL || atom->version != NULL)
+          return dcSyntaxErr;
+
+        if (!dc_relation_scan(&scanner, &token))
+          return dcSyntaxErr;
+        if (token.type == TOKEN_OPERATOR)
+        {
+          atom->op = token.text;
+          atom->oplen = token.len;
+          if (!dc_relation_scan(&scanner, &token))
+            return dcSyntaxErr;
+        }
+        if (token.type != TOKEN_WORD)
+          return dcSyntaxErr;
+        atom->version = token.text;
+        atom->versionlen = token.len;
+
+        if (!dc_relation_scan(&scanner, &token) || token.type != TOKEN_CLOSE)
+          return dcSyntaxErr;
+        break;
+
+      case TOKEN_ARCH_OPEN:
+        if (atom == NULL || atom->narchs != 0)
+          return dcSyntaxErr;
+
+        atom->archs = relation->nterms;
+        for (;;)
+        {
+          if (!dc_relation_scan(&scanner, &token))
+            return dcSyntaxErr;
+          if (token.type == TOKEN_ARCH_CLOSE)
+            break;
+          if (token.type != TOKEN_WORD)
+            return dcSyntaxErr;
+          if (!dc_relation_term(relation, &token))
+            return dcMemFullErr;
+          atom->narchs++;
+
+          if (relation->restrictions != NULL)
+          {
+            rc = dc_relation_arch_term(relation, atom, &token);
+            if (rc != dcNoErr)
+              return rc;
+          }
+        }
+        break;
+
+      case TOKEN_PROFILE_OPEN:
+        if (atom == NULL)
+          return dcSyntaxErr;
+
+        /* keep the brackets, since an atom may have several lists */
+        if (atom->nprofiles == 0)
+          atom->profiles = relation->nterms;
+        else if (atom->profiles + atom->nprofiles != relation->nterms)
+          return dcSyntaxErr;
+
+        if (relation->restrictions != NULL &&
+          !dc_relation_mask(relation, atom))
+          return dcMemFullErr;
+
+        do
+        {
+          if (!dc_relation_term(relation, &token))
+            return dcMemFullErr;
+          atom->nprofiles++;
+
+          if (!dc_relation_scan(&scanner, &token))
+            return dcSyntaxErr;
+          if (token.type != TOKEN_WORD && token.type != TOKEN_PROFILE_CLOSE)
+            return dcSyntaxErr;
+
+          if (token.type == TOKEN_WORD && relation->restrictions != NULL)
+          {
+            rc = dc_relation_profile_term(relation, &token);
+            if (rc != dcNoErr)
+              return rc;
+          }
+        } while (token.type != TOKEN_PROFILE_CLOSE);
+
+        if (!dc_relation_term(relation, &token))
+          return dcMemFullErr;
+        atom->nprofiles++;
+        break;
+
+      default:
+        return dcSyntaxErr;
+    }
+  }
+
+  if (pipe)
+    return dcSyntaxErr;
+  if (atom != NULL)
+    relation->groups++;
+
+  return dcNoErr;
+}
+
+/**
+ * Determine whether an atom applies to a build configuration
+ *
+ * An atom applies if its architecture list (if any) names the
+ * architecture, or only names other architectures negated, and any one of
+ * its build profile lists (if any) is satisfied by the active profiles.
+ * This only tests bits, so it is cheap enough to call for every atom of
+ * every source.
+ *
+ * \param[in] relation A pointer to the parser, which must have compiled
+ * the atom's restrictions
+ * \param[in] atom The atom
+ * \param[in] arch The mask of the host architecture, from
+ * \ref dc_restrictions_arch_mask
+ * \param[in] profiles The mask of active build profiles, from
+ * \ref dc_restrictions_profile_mask
+ *
+ * \retval 0 if the atom does not apply
+ * \retval 1 if the atom applies
+ */
+int dc_relation_enabled(
+  const dcRelation *relation,
+  const dcRelationAtom *atom,
+  uint64_t arch,
+  uint64_t profiles
+) {
+  const uint64_t *mask;
+  size_t i;
+
+  assert(relation != NULL);
+  assert(atom != NULL);
+
+  if (atom->archmask != 0 && (atom->archmask & arch) == 0)
+    return 0;
+  if ((atom->archexclude & arch) != 0)
+    return 0;
+
+  if (atom->nmasks == 0)
+    return 1;
+
+  for (i = 0; i < atom->nmasks; i++)
+  {
+    mask = &relation->masks[2 * (atom->masks + i)];
+    if ((mask[0] & profiles) == mask[0] && (mask[1] & profiles) == 0)
+      return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Free a relationship field parser
+ *
+ * \param[in,out] ptr A pointer to the parser to free
+ */
+void dc_relation_free(
+  dcRelation **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  free((*ptr)->atoms);
+  free((*ptr)->terms);
+  free((*ptr)->masks);
+
+  free(*ptr);
+  *ptr = NULL;
+}
+
+/**
+ * Create a new set of restriction names
+ *
+ * \return A pointer to the new set, or \c NULL if there was a failure to
+ * allocate memory
+ */
+dcRestrictions * dc_restrictions_new(
+  void
+) {
+  dcRestrictions *restrictions = NEW(dcRestrictions);
+
+  if (restrictions == NULL)
+    return NULL;
+
+  restrictions->narchs = 0;
+  restrictions->nprofiles = 0;
+
+  return restrictions;
+}
+
+/**
+ * Find or add a name in a list of names (helper function)
+ *
+ * \param[in,out] names The names
+ * \param[in,out] count The number of names
+ * \param[in] name The name (need not be \c NUL terminated)
+ * \param[in] len The length of the name
+ *
+ * \retval -1 if there was a failure to allocate memory
+ * \retval -2 if \c RESTRICTION_IDS names are already known
+ * \return The bit number of the name
+ */
+static int dc_restrictions_id(
+  char **names,
+  size_t *count,
+  const char *name,
+  size_t len
+) {
+  size_t i;
+
+  for (i = 0; i < *count; i++)
+  {
+    if (strncmp(names[i], name, len) == 0 && names[i][len] == '\0')
+      return (int) i;
+  }
+
+  if (*count == RESTRICTION_IDS)
+    return -2;
+
+  names[*count] = malloc(len + 1);
+  if (names[*count] == NULL)
+    return -1;
+  memcpy(names[*count], name, len);
+  names[*count][len] = '\0';
+
+  return (int) (*count)++;
+}
+
+/**
+ * Find the bit of an architecture name or wildcard, adding it if needed
+ *
+ * \param[in,out] restrictions A pointer to the set of names
+ * \param[in] name The name (need not be \c NUL terminated)
+ * \param[in] len The length of the name
+ *
+ * \retval -1 if there was a failure to allocate memory
+ * \retval -2 if \c RESTRICTION_IDS names of the kind are already known
+ * \return The bit number of the name
+ */
+int dc_restrictions_arch(
+  dcRestrictions *restrictions,
+  const char *name,
+  size_t len
+) {
+  assert(restrictions != NULL);
+  assert(name != NULL);
+
+  return dc_restrictions_id(restrictions->archs, &restrictions->narchs,
+    name, len);
+}
+
+/**
+ * Find the bit of a build profile name, adding it if needed
+ *
+ * \param[in,out] restrictions A pointer to the set of names
+ * \param[in] name The name (need not be \c NUL terminated)
+ * \param[in] len The length of the name
+ *
+ * \retval -1 if there was a failure to allocate memory
+ * \retval -2 if \c RESTRICTION_IDS names of the kind are already known
+ * \return The bit number of the name
+ */
+int dc_restrictions_profile(
+  dcRestrictions *restrictions,
+  const char *name,
+  size_t len
+) {
+  assert(restrictions != NULL);
+  assert(name != NULL);
+
+  return dc_restrictions_id(restrictions->profiles, &restrictions->nprofiles,
+    name, len);
+}
+
+/**
+ * CPUs of architecture names which differ from the name, after dpkg's
+ * \c cputable and \c triplettable
+ */
+static const struct
+{
+  const char *name; /**< Architecture name, without any operating system */
+  const char *cpu; /**< CPU, as used in \c any-cpu wildcards */
+} dc_restrictions_cpus[] = {
+  { "armel", "arm" },
+  { "armhf", "arm" },
+  { "arm64ilp32", "arm64" },
+  { "lpia", "i386" },
+  { "mipsn32", "mips64" },
+  { "mipsn32el", "mips64el" },
+  { "mipsn32r6", "mips64r6" },
+  { "mipsn32r6el", "mips64r6el" },
+  { "powerpcspe", "powerpc" },
+  { "x32", "amd64" },
+  { NULL, NULL }
+};
+
+/**
+ * Determine whether an architecture matches a name or wildcard (helper)
+ *
+ * Wildcards are \c any, \c os-any and \c any-cpu. The architecture is
+ * split into its operating system (e.g. \c kfreebsd or \c musl-linux,
+ * or \c linux if there is none, as for \c amd64) and its CPU, which
+ * differs from the name for ABI variants (e.g. \c armhf runs on an \c arm
+ * CPU, so it matches \c any-arm). An \c os-any wildcard naming only the
+ * kernel (e.g. \c linux-any) also matches other C libraries on it (e.g.
+ * \c musl-linux-amd64).
+ *
+ * \param[in] pattern The name or wildcard
+ * \param[in] arch The architecture
+ *
+ * \return Nonzero if the architecture matches
+ */
+static int dc_restrictions_match(
+  const char *pattern,
+  const char *arch
+) {
+  const char *dash;
+  const char *os;
+  const char *cpu;
+  size_t oslen;
+  size_t len;
+  size_t i;
+
+  if (strcmp(pattern, arch) == 0 || strcmp(pattern, "any") == 0)
+    return 1;
+
+  dash = strrchr(pattern, '-');
+  if (dash == NULL)
+    return 0;
+
+  cpu = strrchr(arch, '-');
+  if (cpu == NULL)
+  {
+    os = "linux";
+    oslen = 5;
+    cpu = arch;
+  }
+  else
+  {
+    os = arch;
+    oslen = cpu - arch;
+    cpu++;
+  }
+
+  for (i = 0; dc_restrictions_cpus[i].name != NULL; i++)
+  {
+    if (strcmp(cpu, dc_restrictions_cpus[i].name) == 0)
+    {
+      cpu = dc_restrictions_cpus[i].cpu;
+      break;
+    }
+  }
+
+  if (strcmp(dash + 1, "any") == 0)
+  {
+    len = dash - pattern;
+    if (len == 3 && strncmp(pattern, "any", 3) == 0)
+      return 1;
+    if (len == oslen)
+      return strncmp(pattern, os, oslen) == 0;
+
+    /* a kernel alone matches whatever C library precedes it */
+    return len < oslen && memchr(pattern, '-', len) == NULL &&
+      os[oslen - len - 1] == '-' &&
+      strncmp(pattern, os + oslen - len, len) == 0;
+  }
+
+  if (strncmp(pattern, "any-", 4) == 0 && dash == pattern + 3)
+    return strcmp(dash + 1, cpu) == 0;
+
+  return 0;
+}
+
+/**
+ * Compute the mask of a host architecture
+ *
+ * The mask has the bit of every known name or wildcard which matches the
+ * architecture, so it should be computed after the fields to be evaluated
+ * have been parsed.
+ *
+ * \param[in] restrictions A pointer to the set of names
+ * \param[in] arch The architecture (e.g. "amd64")
+ *
+ * \return The mask
+ */
+uint64_t dc_restrictions_arch_mask(
+  const dcRestrictions *restrictions,
+  const char *arch
+) {
+  uint64_t mask = 0;
+  size_t i;
+
+  assert(restrictions != NULL);
+  assert(arch != NULL);
+
+  for (i = 0; i < restrictions->narchs; i++)
+  {
+    if (dc_restrictions_match(restrictions->archs[i], arch))
+      mask |= UINT64_C(1) << i;
+  }
+
+  return mask;
+}
+
+/**
+ * Compute the mask of a set of active build profiles
+ *
+ * Profiles not seen yet are added, so this may be called before or after
+ * parsing the fields to be evaluated.
+ *
+ * \param[in,out] restrictions A pointer to the set of names
+ * \param[in] profiles The names of the active profiles
+ * \param[in] count The number of profiles
+ * \param[out] mask Set to the mask
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcLimitErr if there would be more than \c RESTRICTION_IDS build
+ * profile names
+ */
+dcStatus dc_restrictions_profile_mask(
+  dcRestrictions *restrictions,
+  const char * const *profiles,
+  size_t count,
+  uint64_t *mask
+) {
+  size_t i;
+  int id;
+
+  assert(restrictions != NULL);
+  assert(profiles != NULL || count == 0);
+  assert(mask != NULL);
+  if (restrictions == NULL || (profiles == NULL && count != 0) ||
+    mask == NULL)
+    return dcParameterErr;
+
+  *mask = 0;
+  for (i = 0; i < count; i++)
+  {
+    id = dc_restrictions_profile(restrictions, profiles[i],
+      strlen(profiles[i]));
+    if (id < 0)
+      return (id == -1) ? dcMemFullErr : dcLimitErr;
+
+    *mask |= UINT64_C(1) << id;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Free a set of restriction names
+ *
+ * \param[in,out] ptr A pointer to the set to free
+ */
+void dc_restrictions_free(
+  dcRestrictions **ptr
+) {
+  size_t i;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  for (i = 0; i < (*ptr)->narchs; i++)
+    free((*ptr)->archs[i]);
+  for (i = 0; i < (*ptr)->nprofiles; i++)
+    free((*ptr)->profiles[i]);
+
+  free(*ptr);
+  *ptr = NULL;
+}
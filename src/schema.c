@@ -0,0 +1,787 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Declarative control file schemas
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * The routines in this file validate the structure of parsed control data
+ * against a declarative description (a "schema") of the type of file being
+ * processed. Like \ref control.c, this operates on the data structures
+ * produced by \ref parser.c, but it is concerned only with which fields are
+ * present and whether their values are well-formed, not with their meaning.
+ *
+ * \par Schemas
+ * A schema lists the kinds of paragraph that make up a file, in order, along
+ * with how many times each may occur. Each kind of paragraph in turn lists
+ * the fields it permits, whether they are required, whether they may span
+ * multiple lines, and an optional routine used to validate the value.
+ *
+ * \par Dispatch tables
+ * When a schema is constructed with \ref dc_schema_new, the field table of
+ * each kind of paragraph is compiled into an open-addressed hash table keyed
+ * on the (case-insensitive) field name. Validation then visits each field of
+ * a paragraph exactly once, with a single table probe per field, and checks
+ * for missing required fields using the flags gathered along the way.
+ *
+ * \par User-defined fields
+ * Fields beginning with \c X, followed by any of the letters \c B, \c C and
+ * \c S and then a hyphen, are user-defined fields (Sec. 5.7). They are
+ * always accepted. Other unknown fields result in a warning, but do not cause
+ * validation to fail.
+ *
+ * \bug All error messages are in English and are not internationalized
+ *
+ * \see "Control files and their fields", from the Debian Policy Manual:
+ * http://www.debian.org/doc/debian-policy/ch-controlfields.html
+ */
+
+#include <string.h>   /* for: memcpy */
+#include <strings.h>  /* for: strcasecmp */
+#include <ctype.h>    /* for: tolower */
+
+#include <debctrl/schema.h>
+#include <debctrl/parser.h>
+#include <debctrl/error.h>
+#include <debctrl/position.h>
+#include <debctrl/thread.h>
+#include <debctrl/validate.h>
+#include <debctrl/version.h>
+
+/**
+ * Maximum number of fields permitted by one kind of paragraph
+ *
+ * This bounds the size of the scratch table used to record which fields have
+ * been seen while validating a paragraph.
+ */
+#define SCHEMA_MAX_FIELDS   64
+
+static dcStatus dc_schema_valid_package(
+  const char *text
+);
+static dcStatus dc_schema_valid_source(
+  const char *text
+);
+static dcStatus dc_schema_valid_version(
+  const char *text
+);
+
+/**
+ * Fields permitted in the source paragraph of a \c debian/control file
+ *
+ * \see "5.2 Source package control files -- debian/control"
+ */
+static const dcSchemaField dc_control_source_fields[] = {
+  { "Source",                 FIELD_REQUIRED,  &dc_schema_valid_package },
+  { "Maintainer",             FIELD_REQUIRED,  NULL },
+  { "Uploaders",              FIELD_MULTILINE, NULL },
+  { "Section",                0,               NULL },
+  { "Priority",               0,               NULL },
+  { "Build-Depends",          FIELD_MULTILINE, NULL },
+  { "Build-Depends-Indep",    FIELD_MULTILINE, NULL },
+  { "Build-Depends-Arch",     FIELD_MULTILINE, NULL },
+  { "Build-Conflicts",        FIELD_MULTILINE, NULL },
+  { "Build-Conflicts-Indep",  FIELD_MULTILINE, NULL },
+  { "Build-Conflicts-Arch",   FIELD_MULTILINE, NULL },
+  { "Standards-Version",      FIELD_REQUIRED,  NULL },
+  { "Homepage",               0,               NULL },
+  { "Rules-Requires-Root",    0,               NULL },
+  { "Testsuite",              FIELD_MULTILINE, NULL },
+  { "Vcs-Arch",               0,               NULL },
+  { "Vcs-Browser",            0,               NULL },
+  { "Vcs-Bzr",                0,               NULL },
+  { "Vcs-Cvs",                0,               NULL },
+  { "Vcs-Darcs",              0,               NULL },
+  { "Vcs-Git",                0,               NULL },
+  { "Vcs-Hg",                 0,               NULL },
+  { "Vcs-Mtn",                0,               NULL },
+  { "Vcs-Svn",                0,               NULL },
+  { "Dm-Upload-Allowed",      0,               NULL }
+};
+
+/**
+ * Fields permitted in binary package paragraphs of a \c debian/control file
+ *
+ * \see "5.2 Source package control files -- debian/control"
+ */
+static const dcSchemaField dc_control_binary_fields[] = {
+  { "Package",                FIELD_REQUIRED,  &dc_schema_valid_package },
+  { "Architecture",           FIELD_REQUIRED,  NULL },
+  { "Section",                0,               NULL },
+  { "Priority",               0,               NULL },
+  { "Essential",              0,               NULL },
+  { "Protected",              0,               NULL },
+  { "Multi-Arch",             0,               NULL },
+  { "Package-Type",           0,               NULL },
+  { "Build-Profiles",         0,               NULL },
+  { "Pre-Depends",            FIELD_MULTILINE, NULL },
+  { "Depends",                FIELD_MULTILINE, NULL },
+  { "Recommends",             FIELD_MULTILINE, NULL },
+  { "Suggests",               FIELD_MULTILINE, NULL },
+  { "Enhances",               FIELD_MULTILINE, NULL },
+  { "Breaks",                 FIELD_MULTILINE, NULL },
+  { "Conflicts",              FIELD_MULTILINE, NULL },
+  { "Replaces",               FIELD_MULTILINE, NULL },
+  { "Provides",               FIELD_MULTILINE, NULL },
+  { "Built-Using",            FIELD_MULTILINE, NULL },
+  { "Homepage",               0,               NULL },
+  { "Description",            FIELD_REQUIRED | FIELD_MULTILINE, NULL }
+};
+
+/**
+ * Fields permitted in a Debian source control (\c *.dsc) file
+ *
+ * \see "5.4 Debian source control files -- .dsc"
+ */
+static const dcSchemaField dc_dsc_fields[] = {
+  { "Format",                 FIELD_REQUIRED,  NULL },
+  { "Source",                 FIELD_REQUIRED,  &dc_schema_valid_source },
+  { "Binary",                 FIELD_MULTILINE, NULL },
+  { "Architecture",           0,               NULL },
+  { "Version",                FIELD_REQUIRED,  &dc_schema_valid_version },
+  { "Maintainer",             FIELD_REQUIRED,  NULL },
+  { "Uploaders",              FIELD_MULTILINE, NULL },
+  { "Homepage",               0,               NULL },
+  { "Standards-Version",      0,               NULL },
+  { "Testsuite",              FIELD_MULTILINE, NULL },
+  { "Testsuite-Triggers",     FIELD_MULTILINE, NULL },
+  { "Dgit",                   FIELD_MULTILINE, NULL },
+  { "Build-Depends",          FIELD_MULTILINE, NULL },
+  { "Build-Depends-Indep",    FIELD_MULTILINE, NULL },
+  { "Build-Depends-Arch",     FIELD_MULTILINE, NULL },
+  { "Build-Conflicts",        FIELD_MULTILINE, NULL },
+  { "Build-Conflicts-Indep",  FIELD_MULTILINE, NULL },
+  { "Build-Conflicts-Arch",   FIELD_MULTILINE, NULL },
+  { "Package-List",           FIELD_MULTILINE, NULL },
+  { "Vcs-Arch",               0,               NULL },
+  { "Vcs-Browser",            0,               NULL },
+  { "Vcs-Bzr",                0,               NULL },
+  { "Vcs-Cvs",                0,               NULL },
+  { "Vcs-Darcs",              0,               NULL },
+  { "Vcs-Git",                0,               NULL },
+  { "Vcs-Hg",                 0,               NULL },
+  { "Vcs-Mtn",                0,               NULL },
+  { "Vcs-Svn",                0,               NULL },
+  { "Checksums-Sha1",         FIELD_REQUIRED | FIELD_MULTILINE, NULL },
+  { "Checksums-Sha256",       FIELD_REQUIRED | FIELD_MULTILINE, NULL },
+  { "Files",                  FIELD_REQUIRED | FIELD_MULTILINE, NULL }
+};
+
+/**
+ * Fields permitted in a Debian changes (\c *.changes) file
+ *
+ * \see "5.5 Debian changes files -- .changes"
+ */
+static const dcSchemaField dc_changes_fields[] = {
+  { "Format",                 FIELD_REQUIRED,  NULL },
+  { "Date",                   FIELD_REQUIRED,  NULL },
+  { "Source",                 FIELD_REQUIRED,  &dc_schema_valid_source },
+  { "Binary",                 FIELD_MULTILINE, NULL },
+  { "Architecture",           FIELD_REQUIRED,  NULL },
+  { "Version",                FIELD_REQUIRED,  &dc_schema_valid_version },
+  { "Distribution",           FIELD_REQUIRED,  NULL },
+  { "Urgency",                0,               NULL },
+  { "Maintainer",             FIELD_REQUIRED,  NULL },
+  { "Changed-By",             0,               NULL },
+  { "Description",            FIELD_MULTILINE, NULL },
+  { "Closes",                 0,               NULL },
+  { "Launchpad-Bugs-Fixed",   0,               NULL },
+  { "Binary-Only",            0,               NULL },
+  { "Built-For-Profiles",     0,               NULL },
+  { "Changes",                FIELD_REQUIRED | FIELD_MULTILINE, NULL },
+  { "Checksums-Sha1",         FIELD_REQUIRED | FIELD_MULTILINE, NULL },
+  { "Checksums-Sha256",       FIELD_REQUIRED | FIELD_MULTILINE, NULL },
+  { "Files",                  FIELD_REQUIRED | FIELD_MULTILINE, NULL }
+};
+
+/** Number of elements in a static table */
+#define TABLE_SIZE(t)   (sizeof (t) / sizeof ((t)[0]))
+
+/**
+ * Paragraphs of a \c debian/control file: one source paragraph, followed by
+ * at least one binary package paragraph
+ */
+static const dcSchemaParagraph dc_control_paragraphs[] = {
+  { "source package", dc_control_source_fields,
+    TABLE_SIZE(dc_control_source_fields), 1, 1, NULL, 0 },
+  { "binary package", dc_control_binary_fields,
+    TABLE_SIZE(dc_control_binary_fields), 1, 0, NULL, 0 }
+};
+
+/** Paragraphs of a \c *.dsc file: exactly one paragraph */
+static const dcSchemaParagraph dc_dsc_paragraphs[] = {
+  { "source control", dc_dsc_fields,
+    TABLE_SIZE(dc_dsc_fields), 1, 1, NULL, 0 }
+};
+
+/** Paragraphs of a \c *.changes file: exactly one paragraph */
+static const dcSchemaParagraph dc_changes_paragraphs[] = {
+  { "changes", dc_changes_fields,
+    TABLE_SIZE(dc_changes_fields), 1, 1, NULL, 0 }
+};
+
+/**
+ * Validate a package name (schema validator)
+ *
+ * \param[in] text The value of the field, or \c NULL if it is empty
+ *
+ * \returns The status indication returned from \ref dc_valid_package
+ */
+static dcStatus dc_schema_valid_package(
+  const char *text
+) {
+  if (text == NULL)
+    return dcPackageLengthErr;
+
+  return dc_valid_package(text);
+}
+
+/**
+ * Validate a source package name (schema validator)
+ *
+ * In \c *.changes files, the \c Source field may be followed by a version in
+ * parentheses, when it differs from the binary package version. Only the
+ * source package name, up to the first whitespace character, is validated.
+ *
+ * \param[in] text The value of the field, or \c NULL if it is empty
+ *
+ * \returns The status indication returned from \ref dc_valid_package
+ */
+static dcStatus dc_schema_valid_source(
+  const char *text
+) {
+  char name[256];
+  size_t len;
+
+  if (text == NULL)
+    return dcPackageLengthErr;
+
+  len = strcspn(text, " \t");
+  if (text[len] == '\0')
+    return dc_valid_package(text);
+
+  if (len >= sizeof(name))
+    return dcPackageInvalidErr;
+
+  memcpy(name, text, len);
+  name[len] = '\0';
+
+  return dc_valid_package(name);
+}
+
+/**
+ * Validate a package version (schema validator)
+ *
+ * \param[in] text The value of the field, or \c NULL if it is empty
+ *
+ * \returns The status indication returned from \ref dc_version_set or
+ * \ref dc_valid_version
+ */
+static dcStatus dc_schema_valid_version(
+  const char *text
+) {
+  dcVersion version;
+  dcStatus rc;
+
+  if (text == NULL)
+    return dcVersionUpstreamErr;
+
+  version.epoch = 0;
+  version.hasepoch = 0;
+  version.version = NULL;
+  version.revision = NULL;
+
+  rc = dc_version_set(&version, text);
+  if (rc == dcNoErr)
+    rc = dc_valid_version(&version);
+
+  dc_version_clear(&version);
+
+  return rc;
+}
+
+/**
+ * Hash a field name, ignoring case
+ *
+ * This is the FNV-1a hash of the field name, with ASCII letters folded to
+ * lower case (field names are not case sensitive, see Sec. 5.1).
+ */
+static size_t dc_schema_hash(
+  const char *name
+) {
+  unsigned long hash = 2166136261UL;
+
+  while (*name != '\0')
+  {
+    hash ^= (unsigned char) tolower(*name);
+    hash *= 16777619UL;
+    name++;
+  }
+
+  return (size_t) hash;
+}
+
+/**
+ * Compile the dispatch table of a kind of paragraph
+ *
+ * \param[in,out] para A pointer to a Schema Paragraph
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_schema_compile(
+  dcSchemaParagraph *para
+) {
+  size_t size;
+  size_t slot;
+  size_t i;
+
+  assert(para->count <= SCHEMA_MAX_FIELDS);
+
+  /* keep the table at most half full, so probe sequences stay short */
+  size = 1;
+  while (size < para->count * 2)
+    size <<= 1;
+
+  para->slots = malloc(size * sizeof(short));
+  if (para->slots == NULL)
+    return dcMemFullErr;
+  para->mask = size - 1;
+
+  for (i = 0; i < size; i++)
+    para->slots[i] = -1;
+
+  for (i = 0; i < para->count; i++)
+  {
+    slot = dc_schema_hash(para->fields[i].name) & para->mask;
+    while (para->slots[slot] != -1)
+      slot = (slot + 1) & para->mask;
+
+    para->slots[slot] = (short) i;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Look up a field in the dispatch table of a kind of paragraph
+ *
+ * \param[in] para A pointer to a compiled Schema Paragraph
+ * \param[in] name The field name to look for
+ *
+ * \retval -1 if the field is not permitted by this kind of paragraph
+ * \return The index of the field in dcSchemaParagraph::fields
+ */
+static int dc_schema_lookup(
+  const dcSchemaParagraph *para,
+  const char *name
+) {
+  size_t slot;
+  int index;
+
+  slot = dc_schema_hash(name) & para->mask;
+  while ((index = para->slots[slot]) != -1)
+  {
+    if (strcasecmp(para->fields[index].name, name) == 0)
+      return index;
+
+    slot = (slot + 1) & para->mask;
+  }
+
+  return -1;
+}
+
+/**
+ * Determine whether a field is user-defined
+ *
+ * User-defined fields begin with \c X, followed by zero or more of the
+ * letters \c B, \c C and \c S, and then a hyphen (Sec. 5.7).
+ */
+static int dc_schema_user_field(
+  const char *name
+) {
+  if (*name != 'X' && *name != 'x')
+    return 0;
+
+  name++;
+  while (*name != '\0' && strchr("BCSbcs", *name) != NULL)
+    name++;
+
+  return (*name == '-');
+}
+
+/**
+ * Construct a Schema
+ *
+ * This creates one of the built-in schemas, compiling the field tables of
+ * each kind of paragraph into dispatch tables.
+ *
+ * For details on the structure and its fields, see \ref dcSchema
+ *
+ * \param[in] type The type of file described by the schema
+ *
+ * \retval NULL if there is a failure to allocate memory, or the type is
+ * unknown
+ * \return a dynamically allocated dcSchema object
+ */
+dcSchema * dc_schema_new(
+  enum dcSchemaType type
+) {
+  const dcSchemaParagraph *template;
+  dcSchema *schema;
+  size_t i;
+
+  schema = NEW(dcSchema);
+  if (schema == NULL)
+    return NULL;
+
+  switch (type)
+  {
+    case SCHEMA_CONTROL:
+      schema->name = "debian/control";
+      template = dc_control_paragraphs;
+      schema->count = TABLE_SIZE(dc_control_paragraphs);
+      break;
+    case SCHEMA_DSC:
+      schema->name = "source control (.dsc)";
+      template = dc_dsc_paragraphs;
+      schema->count = TABLE_SIZE(dc_dsc_paragraphs);
+      break;
+    case SCHEMA_CHANGES:
+      schema->name = "changes (.changes)";
+      template = dc_changes_paragraphs;
+      schema->count = TABLE_SIZE(dc_changes_paragraphs);
+      break;
+    default:
+      free(schema);
+      return NULL;
+  }
+
+  schema->paragraphs = malloc(schema->count * sizeof(dcSchemaParagraph));
+  if (schema->paragraphs == NULL)
+  {
+    free(schema);
+    return NULL;
+  }
+
+  memcpy(schema->paragraphs, template,
+    schema->count * sizeof(dcSchemaParagraph));
+
+  for (i = 0; i < schema->count; i++)
+  {
+    if (dc_schema_compile(&schema->paragraphs[i]) != dcNoErr)
+    {
+      schema->count = i;
+      dc_schema_free(&schema);
+      return NULL;
+    }
+  }
+
+  return schema;
+}
+
+/**
+ * Validate a paragraph against a kind of paragraph (helper function)
+ *
+ * This is an internal helper function which checks every field of a section
+ * in a single pass, then checks for required fields that were not seen.
+ *
+ * \param[in] para A pointer to a compiled Schema Paragraph
+ * \param[in] handler The error handler used to report problems
+ * \param[in] section A pointer to the Parser Section to validate
+ *
+ * \return The number of problems found
+ */
+static unsigned int dc_schema_check(
+  const dcSchemaParagraph *para,
+  dcErrorHandler *handler,
+  dcParserSection *section
+) {
+  unsigned char seen[SCHEMA_MAX_FIELDS];
+  const dcSchemaField *field;
+  dcParserBlock *block;
+  dcParserContext ctx;
+  dcStatus rc;
+  unsigned int errors = 0;
+  int index;
+  size_t i;
+
+  memset(seen, 0, para->count);
+
+  block = section->head;
+  while (block != NULL)
+  {
+    index = dc_schema_lookup(para, block->name);
+    if (index == -1)
+    {
+      if (!dc_schema_user_field(block->name))
+        dc_warn(handler, dc_parser_position_context(&block->head->pos,
+          &ctx), _("Ignoring unknown %s field '%s'"), para->name,
+          block->name);
+
+      block = block->next;
+      continue;
+    }
+
+    field = &para->fields[index];
+    seen[index] = 1;
+
+    if (!(field->flags & FIELD_MULTILINE) && block->head->next != NULL)
+    {
+      dc_warn(handler, dc_parser_position_context(&block->head->next->pos,
+        &ctx), _("Field '%s' must not contain continuation lines"),
+        field->name);
+      errors++;
+    }
+
+    if (field->valid != NULL)
+    {
+      rc = (*field->valid)(block->head->text);
+      if (rc != dcNoErr)
+      {
+        dc_warn(handler, dc_parser_position_context(&block->head->pos,
+          &ctx), _("Field '%s' has an invalid value '%s'"), field->name,
+          block->head->text == NULL ? "" : block->head->text);
+        errors++;
+      }
+    }
+
+    block = block->next;
+  }
+
+  for (i = 0; i < para->count; i++)
+  {
+    if ((para->fields[i].flags & FIELD_REQUIRED) && !seen[i])
+    {
+      dc_warn(handler, dc_parser_position_context(&section->head->head->pos,
+        &ctx), _("Missing required field '%s' in %s paragraph"),
+        para->fields[i].name, para->name);
+      errors++;
+    }
+  }
+
+  return errors;
+}
+
+/**
+ * Validate parsed control data against a Schema
+ *
+ * This routine checks each paragraph held by a \ref dcParser against the
+ * kinds of paragraph described by the schema, in order. Problems are
+ * reported using the parser's \link error.c error handler interface
+ * \endlink.
+ *
+ * \param[in] schema A pointer to a Schema
+ * \param[in] parser A pointer to a Parser instance holding parsed data
+ *
+ * \retval dcNoErr if the data conforms to the schema
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcSchemaErr if the data does not conform to the schema
+ */
+dcStatus dc_schema_validate(
+  const dcSchema *schema,
+  dcParser *parser
+) {
+  const dcSchemaParagraph *para;
+  dcParserSection *section;
+  dcParserContext ctx;
+  unsigned int errors = 0;
+  unsigned int seen = 0; /* occurrences of the current kind of paragraph */
+  size_t kind = 0;
+
+  assert(schema != NULL);
+  assert(parser != NULL);
+
+  if (schema == NULL || parser == NULL)
+    return dcParameterErr;
+
+  section = parser->head;
+  while (section != NULL)
+  {
+    /* skip empty sections (e.g. following a trailing blank line) */
+    if (section->head == NULL)
+    {
+      section = section->next;
+      continue;
+    }
+
+    /* move on to the next kind of paragraph once this one is full */
+    if (kind < schema->count && schema->paragraphs[kind].max != 0 &&
+      seen >= schema->paragraphs[kind].max)
+    {
+      kind++;
+      seen = 0;
+    }
+
+    if (kind >= schema->count)
+    {
+      dc_warn(&parser->handler,
+        dc_parser_position_context(&section->head->head->pos, &ctx),
+        _("Unexpected paragraph in %s file"), schema->name);
+      errors++;
+      break;
+    }
+
+    para = &schema->paragraphs[kind];
+    errors += dc_schema_check(para, &parser->handler, section);
+    seen++;
+
+    section = section->next;
+  }
+
+  /* all remaining kinds of paragraph must have occurred often enough */
+  for (; kind < schema->count; kind++)
+  {
+    para = &schema->paragraphs[kind];
+    if (seen < para->min)
+    {
+      dc_warn(&parser->handler, NULL, _("Expected at least %u %s "
+        "paragraph(s) in %s file, found %u"), para->min, para->name,
+        schema->name, seen);
+      errors++;
+    }
+    seen = 0;
+  }
+
+  return (errors == 0) ? dcNoErr : dcSchemaErr;
+}
+
+/**
+ * Arguments shared by the workers of \ref dc_schema_validate_files
+ */
+struct _dcSchemaBatch
+{
+  const dcSchema *schema; /**< Schema to validate against */
+  const char * const *paths; /**< Paths of files to validate */
+  dcStatus *results; /**< Status of each file */
+};
+typedef struct _dcSchemaBatch dcSchemaBatch;
+
+/**
+ * Parse and validate a single file (batch worker)
+ *
+ * \param[in] index The index of the file to validate
+ * \param[in,out] arg A pointer to the shared \c dcSchemaBatch
+ */
+static void dc_schema_validate_one(
+  size_t index,
+  void *arg
+) {
+  dcSchemaBatch *batch = arg;
+  dcParser *parser;
+  dcStatus rc;
+
+  parser = dc_parser_new();
+  if (parser == NULL)
+  {
+    batch->results[index] = dcMemFullErr;
+    return;
+  }
+
+  rc = dc_parser_read_file(parser, batch->paths[index]);
+  if (rc == dcNoErr)
+    rc = dc_schema_validate(batch->schema, parser);
+
+  dc_parser_free(&parser);
+
+  batch->results[index] = rc;
+}
+
+/**
+ * Validate a batch of files against a Schema
+ *
+ * This routine parses and validates each of the given files, spreading the
+ * work over several threads (see \ref dc_parallel_run). It is intended for
+ * validating all of the files of a given type in an archive at once.
+ *
+ * Problems are reported using the default \link error.c error handler
+ * interface \endlink of each file's parser.
+ *
+ * \param[in] schema A pointer to a Schema
+ * \param[in] paths An array of paths of files to validate
+ * \param[in] count The number of elements in \c paths
+ * \param[in] threads The maximum number of threads to use (\c 0 for one per
+ * online processor)
+ * \param[out] results An array of \c count elements which receives the
+ * status of each file, or \c NULL if the individual results are not needed
+ *
+ * \retval dcNoErr if all of the files conform to the schema
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \return Otherwise, the first failing status, in order of \c paths
+ */
+dcStatus dc_schema_validate_files(
+  const dcSchema *schema,
+  const char * const *paths,
+  size_t count,
+  unsigned int threads,
+  dcStatus *results
+) {
+  dcSchemaBatch batch;
+  dcStatus rc = dcNoErr;
+  size_t i;
+
+  assert(schema != NULL);
+  assert(paths != NULL || count == 0);
+
+  if (schema == NULL || (paths == NULL && count > 0))
+    return dcParameterErr;
+
+  batch.schema = schema;
+  batch.paths = paths;
+  batch.results = results;
+
+  if (results == NULL && count > 0)
+  {
+    batch.results = malloc(count * sizeof(dcStatus));
+    if (batch.results == NULL)
+      return dcMemFullErr;
+  }
+
+  dc_parallel_run(count, threads, &dc_schema_validate_one, &batch);
+
+  for (i = 0; i < count; i++)
+  {
+    if (batch.results[i] != dcNoErr)
+    {
+      rc = batch.results[i];
+      break;
+    }
+  }
+
+  if (results == NULL)
+    free(batch.results);
+
+  return rc;
+}
+
+/**
+ * Destroy a Schema
+ *
+ * Given a \ref dcSchema that was allocated by \ref dc_schema_new, this will
+ * automatically free internally-allocated memory before destroying the
+ * schema itself.
+ *
+ * \param[in,out] ptr The address of a pointer to a Schema
+ *
+ * \note The pointer will be set to \c NULL after memory is freed.
+ */
+void dc_schema_free(
+  dcSchema **ptr
+) {
+  size_t i;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  for (i = 0; i < (*ptr)->count; i++)
+    free((*ptr)->paragraphs[i].slots);
+
+  free((*ptr)->paragraphs);
+
+  free(*ptr);
+  *ptr = NULL;
+}
@@ -0,0 +1,561 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * JSON and CBOR serialization
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * These routines walk the sections, blocks and chunks of a parse tree and
+ * append a JSON (RFC 8259) or CBOR (RFC 8949) rendering of it to a
+ * \ref dcString, without building any intermediate representation.
+ *
+ * \par Structure
+ * A parser is written as an array with one element per (non-empty)
+ * paragraph. Each paragraph is an object (a map, in CBOR) from field names
+ * to values, in the order they appear. Sections may also be written one at
+ * a time, so that output can be streamed (e.g. flushing the buffer to a
+ * socket after each paragraph).
+ * \par
+ * By default, values spanning several lines are flattened into a single
+ * string, with lines joined by newlines. With \c SERIALIZE_CHUNKS, each value
+ * is instead an array holding one string per chunk, so that the original
+ * formatting can be reconstructed:
+ * - an empty chunk (a "." line) is written as an empty string
+ * - a fixed-format continuation line is written with a leading space
+ * - a mergeable chunk is written as-is
+ *
+ * \par Escaping
+ * Most of the text in control files needs no escaping in JSON, so text is
+ * scanned eight bytes at a time for the characters that do (quotes,
+ * backslashes and control characters), using word-wide bit tricks; runs of
+ * plain text are then copied into the buffer in one go.
+ *
+ * \note Text is written as-is, without checking that it is valid UTF-8.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memcpy, strlen */
+
+#include <debctrl/serialize.h>
+
+#include "word.h"
+
+/** CBOR major types */
+#define CBOR_TEXT   3
+#define CBOR_ARRAY  4
+#define CBOR_MAP    5
+
+/**
+ * Find the prefix of a chunk in \c SERIALIZE_CHUNKS mode (helper function)
+ *
+ * \param[in] block The field
+ * \param[in] chunk A chunk of the field
+ *
+ * \return A single space for fixed-format continuation lines, else \c NULL
+ */
+static const char * dc_serialize_prefix(
+  const dcParserBlock *block,
+  const dcParserChunk *chunk
+) {
+  /* the first line of a field is never a continuation line */
+  if (chunk != block->head && chunk->type == CHUNK_FIXED)
+    return " ";
+
+  return NULL;
+}
+
+/**
+ * Determine whether a word contains a byte needing escaping in JSON (helper)
+ *
+ * This may report false positives (after a byte which really needs
+ * escaping), but never false negatives.
+ *
+ * \param[in] p A pointer to eight bytes, which need not be aligned
+ *
+ * \return Nonzero if some byte may need escaping
+ */
+static int dc_json_special(
+  const char *p
+) {
+  uint64_t w;
+
+  memcpy(&w, p, sizeof(w));
+  return (HASLESS(w, 0x20) | HASZERO(w ^ REPEAT('"')) |
+    HASZERO(w ^ REPEAT('\\'))) != 0;
+}
+
+/**
+ * Append escaped text to a JSON string (helper function)
+ *
+ * \param[in,out] buf The output buffer
+ * \param[in] text The text to escape
+ * \param[in] len The length of the text
+ *
+ * \return Nonzero if successful
+ */
+static int dc_json_escape(
+  dcString *buf,
+  const char *text,
+  size_t len
+) {
+  static const char hex[] = "0123456789abcdef";
+  char esc[6];
+  size_t start = 0;
+  size_t i = 0;
+  size_t end;
+  unsigned char c;
+
+  while (i < len)
+  {
+    /* skip over words which need no escaping */
+    while (i + 8 <= len && !dc_json_special(text + i))
+      i += 8;
+
+    /* then examine bytes individually, up to the end of the word */
+    end = (i + 8 < len) ? i + 8 : len;
+    for (; i < end; i++)
+    {
+      c = (unsigned char) text[i];
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+
+      if (!dc_string_append_n(buf, text + start, i - start))
+        return 0;
+      start = i + 1;
+
+      esc[0] = '\\';
+      switch (c)
+      {
+        case '"':  esc[1] = '"';  break;
+        case '\\': esc[1] = '\\'; break;
+        case '\n': esc[1] = 'n';  break;
+        case '\t': esc[1] = 't';  break;
+        case '\r': esc[1] = 'r';  break;
+        case '\b': esc[1] = 'b';  break;
+        case '\f': esc[1] = 'f';  break;
+        default:
+          esc[1] = 'u';
+          esc[2] = '0';
+          esc[3] = '0';
+          esc[4] = hex[c >> 4];
+          esc[5] = hex[c & 0x0f];
+          if (!dc_string_append_n(buf, esc, 6))
+            return 0;
+          continue;
+      }
+      if (!dc_string_append_n(buf, esc, 2))
+        return 0;
+    }
+  }
+
+  return dc_string_append_n(buf, text + start, len - start);
+}
+
+/**
+ * Append a JSON string (helper function)
+ *
+ * \param[in,out] buf The output buffer
+ * \param[in] prefix Text to write before \c text, or \c NULL
+ * \param[in] text The text, or \c NULL for an empty string
+ *
+ * \return Nonzero if successful
+ */
+static int dc_json_string(
+  dcString *buf,
+  const char *prefix,
+  const char *text
+) {
+  if (!dc_string_append_n(buf, "\"", 1))
+    return 0;
+  if (prefix != NULL && !dc_json_escape(buf, prefix, strlen(prefix)))
+    return 0;
+  if (text != NULL && !dc_json_escape(buf, text, strlen(text)))
+    return 0;
+  return dc_string_append_n(buf, "\"", 1);
+}
+
+/**
+ * Append the value of a field as JSON (helper function)
+ *
+ * \param[in,out] buf The output buffer
+ * \param[in] block The field
+ * \param[in] flags A combination of \ref dcSerializeFlags values
+ *
+ * \return Nonzero if successful
+ */
+static int dc_json_value(
+  dcString *buf,
+  const dcParserBlock *block,
+  int flags
+) {
+  const dcParserChunk *chunk;
+
+  if (flags & SERIALIZE_CHUNKS)
+  {
+    if (!dc_string_append_n(buf, "[", 1))
+      return 0;
+
+    for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+    {
+      if (chunk != block->head && !dc_string_append_n(buf, ",", 1))
+        return 0;
+      if (!dc_json_string(buf, dc_serialize_prefix(block, chunk),
+        chunk->text))
+        return 0;
+    }
+
+    return dc_string_append_n(buf, "]", 1);
+  }
+
+  if (!dc_string_append_n(buf, "\"", 1))
+    return 0;
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    if (chunk != block->head && !dc_string_append_n(buf, "\\n", 2))
+      return 0;
+    if (chunk->text != NULL &&
+      !dc_json_escape(buf, chunk->text, strlen(chunk->text)))
+      return 0;
+  }
+
+  return dc_string_append_n(buf, "\"", 1);
+}
+
+/**
+ * Serialize a Parser Section as JSON
+ *
+ * This appends a JSON object mapping each field name of the section to its
+ * value, as described in \ref serialize.c.
+ *
+ * \param[in] section A pointer to a Parser Section
+ * \param[in,out] buf The buffer to which output is appended
+ * \param[in] flags A combination of \ref dcSerializeFlags values
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory (the
+ * buffer then holds partial output)
+ */
+dcStatus dc_json_write_section(
+  const dcParserSection *section,
+  dcString *buf,
+  int flags
+) {
+  const dcParserBlock *block;
+
+  assert(section != NULL);
+  assert(buf != NULL);
+
+  if (section == NULL || buf == NULL)
+    return dcParameterErr;
+
+  if (!dc_string_append_n(buf, "{", 1))
+    return dcMemFullErr;
+
+  for (block = section->head; block != NULL; block = block->next)
+  {
+    if (block != section->head && !dc_string_append_n(buf, ",", 1))
+      return dcMemFullErr;
+    if (!dc_json_string(buf, NULL, block->name) ||
+      !dc_string_append_n(buf, ":", 1) ||
+      !dc_json_value(buf, block, flags))
+      return dcMemFullErr;
+  }
+
+  if (!dc_string_append_n(buf, "}", 1))
+    return dcMemFullErr;
+
+  return dcNoErr;
+}
+
+/**
+ * Serialize a Parser as JSON
+ *
+ * This appends a JSON array holding an object for each non-empty paragraph
+ * of the parser, as written by \ref dc_json_write_section.
+ *
+ * Example:
+ * \code
+ * dcString *buf = dc_string_new(0);
+ * if (dc_json_write(parser, buf, 0) == dcNoErr)
+ *   fwrite(buf->text, 1, buf->len, stdout);
+ * \endcode
+ *
+ * \param[in] parser A pointer to a Parser
+ * \param[in,out] buf The buffer to which output is appended
+ * \param[in] flags A combination of \ref dcSerializeFlags values
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory (the
+ * buffer then holds partial output)
+ */
+dcStatus dc_json_write(
+  const dcParser *parser,
+  dcString *buf,
+  int flags
+) {
+  const dcParserSection *section;
+  dcStatus rc;
+  int first = 1;
+
+  assert(parser != NULL);
+  assert(buf != NULL);
+
+  if (parser == NULL || buf == NULL)
+    return dcParameterErr;
+
+  if (!dc_string_append_n(buf, "[", 1))
+    return dcMemFullErr;
+
+  for (section = parser->head; section != NULL; section = section->next)
+  {
+    if (section->head == NULL)
+      continue;
+
+    if (!first && !dc_string_append_n(buf, ",", 1))
+      return dcMemFullErr;
+    first = 0;
+
+    rc = dc_json_write_section(section, buf, flags);
+    if (rc != dcNoErr)
+      return rc;
+  }
+
+  if (!dc_string_append_n(buf, "]", 1))
+    return dcMemFullErr;
+
+  return dcNoErr;
+}
+
+/**
+ * Append the head of a CBOR data item (helper function)
+ *
+ * \param[in,out] buf The output buffer
+ * \param[in] major The major type
+ * \param[in] value The argument (a length or count)
+ *
+ * \return Nonzero if successful
+ */
+static int dc_cbor_head(
+  dcString *buf,
+  int major,
+  uint64_t value
+) {
+  char head[9];
+  size_t size;
+  size_t i;
+
+  if (value < 24)
+  {
+    head[0] = (char) ((major << 5) | (int) value);
+    return dc_string_append_n(buf, head, 1);
+  }
+
+  if (value <= 0xff)
+  {
+    head[0] = (char) ((major << 5) | 24);
+    size = 1;
+  }
+  else if (value <= 0xffff)
+  {
+    head[0] = (char) ((major << 5) | 25);
+    size = 2;
+  }
+  else if (value <= 0xffffffff)
+  {
+    head[0] = (char) ((major << 5) | 26);
+    size = 4;
+  }
+  else
+  {
+    head[0] = (char) ((major << 5) | 27);
+    size = 8;
+  }
+
+  /* the argument follows in network (big-endian) byte order */
+  for (i = 0; i < size; i++)
+    head[1 + i] = (char) ((value >> (8 * (size - 1 - i))) & 0xff);
+
+  return dc_string_append_n(buf, head, 1 + size);
+}
+
+/**
+ * Append a CBOR text string (helper function)
+ *
+ * \param[in,out] buf The output buffer
+ * \param[in] prefix Text to write before \c text, or \c NULL
+ * \param[in] text The text, or \c NULL for an empty string
+ *
+ * \return Nonzero if successful
+ */
+static int dc_cbor_string(
+  dcString *buf,
+  const char *prefix,
+  const char *text
+) {
+  size_t plen = (prefix == NULL) ? 0 : strlen(prefix);
+  size_t len = (text == NULL) ? 0 : strlen(text);
+
+  return dc_cbor_head(buf, CBOR_TEXT, plen + len) &&
+    dc_string_append_n(buf, prefix, plen) &&
+    dc_string_append_n(buf, text, len);
+}
+
+/**
+ * Append the value of a field as CBOR (helper function)
+ *
+ * \param[in,out] buf The output buffer
+ * \param[in] block The field
+ * \param[in] flags A combination of \ref dcSerializeFlags values
+ *
+ * \return Nonzero if successful
+ */
+static int dc_cbor_value(
+  dcString *buf,
+  const dcParserBlock *block,
+  int flags
+) {
+  const dcParserChunk *chunk;
+  size_t count = 0;
+  size_t len = 0;
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    count++;
+    if (chunk->text != NULL)
+      len += strlen(chunk->text);
+  }
+
+  if (flags & SERIALIZE_CHUNKS)
+  {
+    if (!dc_cbor_head(buf, CBOR_ARRAY, count))
+      return 0;
+
+    for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+    {
+      if (!dc_cbor_string(buf, dc_serialize_prefix(block, chunk),
+        chunk->text))
+        return 0;
+    }
+
+    return 1;
+  }
+
+  /* lines are joined by newlines */
+  if (!dc_cbor_head(buf, CBOR_TEXT, len + count - 1))
+    return 0;
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    if (chunk != block->head && !dc_string_append_n(buf, "\n", 1))
+      return 0;
+    if (chunk->text != NULL &&
+      !dc_string_append_n(buf, chunk->text, strlen(chunk->text)))
+      return 0;
+  }
+
+  return 1;
+}
+
+/**
+ * Serialize a Parser Section as CBOR
+ *
+ * This appends a CBOR map from each field name of the section to its value,
+ * as described in \ref serialize.c.
+ *
+ * \param[in] section A pointer to a Parser Section
+ * \param[in,out] buf The buffer to which output is appended
+ * \param[in] flags A combination of \ref dcSerializeFlags values
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory (the
+ * buffer then holds partial output)
+ */
+dcStatus dc_cbor_write_section(
+  const dcParserSection *section,
+  dcString *buf,
+  int flags
+) {
+  const dcParserBlock *block;
+  size_t count = 0;
+
+  assert(section != NULL);
+  assert(buf != NULL);
+
+  if (section == NULL || buf == NULL)
+    return dcParameterErr;
+
+  for (block = section->head; block != NULL; block = block->next)
+    count++;
+
+  if (!dc_cbor_head(buf, CBOR_MAP, count))
+    return dcMemFullErr;
+
+  for (block = section->head; block != NULL; block = block->next)
+  {
+    if (!dc_cbor_string(buf, NULL, block->name) ||
+      !dc_cbor_value(buf, block, flags))
+      return dcMemFullErr;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Serialize a Parser as CBOR
+ *
+ * This appends a CBOR array holding a map for each non-empty paragraph of
+ * the parser, as written by \ref dc_cbor_write_section.
+ *
+ * \param[in] parser A pointer to a Parser
+ * \param[in,out] buf The buffer to which output is appended
+ * \param[in] flags A combination of \ref dcSerializeFlags values
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory (the
+ * buffer then holds partial output)
+ */
+dcStatus dc_cbor_write(
+  const dcParser *parser,
+  dcString *buf,
+  int flags
+) {
+  const dcParserSection *section;
+  size_t count = 0;
+  dcStatus rc;
+
+  assert(parser != NULL);
+  assert(buf != NULL);
+
+  if (parser == NULL || buf == NULL)
+    return dcParameterErr;
+
+  for (section = parser->head; section != NULL; section = section->next)
+  {
+    if (section->head != NULL)
+      count++;
+  }
+
+  if (!dc_cbor_head(buf, CBOR_ARRAY, count))
+    return dcMemFullErr;
+
+  for (section = parser->head; section != NULL; section = section->next)
+  {
+    if (section->head == NULL)
+      continue;
+
+    rc = dc_cbor_write_section(section, buf, flags);
+    if (rc != dcNoErr)
+      return rc;
+  }
+
+  return dcNoErr;
+}
@@ -0,0 +1,570 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Archive snapshot history
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Archives are often kept as a series of snapshots (e.g. the \c Packages
+ * file of a suite, taken daily), which differ in only a small fraction of
+ * their paragraphs. A \ref dcSnapshotStore holds many such snapshots while
+ * storing each distinct paragraph only once.
+ *
+ * \par Structural Sharing
+ * As each snapshot is added, its paragraphs are hashed (see \ref dc_hash).
+ * A paragraph whose hash matches one already in the store is compared with
+ * it byte for byte, and if identical, is neither parsed nor stored again;
+ * otherwise (including when distinct paragraphs merely share a hash), it is
+ * parsed and given the next paragraph id. A snapshot is then just a sorted
+ * array of paragraph ids, so each additional snapshot costs one word per
+ * paragraph, plus the paragraphs that changed.
+ *
+ * \par Differences
+ * Since the ids of each snapshot are sorted, the paragraphs added and
+ * removed between two snapshots are found by merging their arrays, in time
+ * linear in their sizes and without looking at the paragraphs themselves
+ * (see \ref dc_snapshot_diff). A changed paragraph appears as the removal of
+ * its old version and the addition of its new one.
+ *
+ * \note The store keeps the bytes of each distinct paragraph, to confirm
+ * matches by hash, as well as its parsed form.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memchr, memcmp, strdup, strcmp, etc. */
+#include <errno.h>    /* for: errno */
+
+#include <debctrl/snapshot.h>
+
+/**
+ * Compare paragraph ids (helper function for qsort)
+ *
+ * \param[in] a A pointer to the first id
+ * \param[in] b A pointer to the second id
+ *
+ * \return An integer less than, equal to or greater than zero, if \c a is
+ * found to be less than, equal to or greater than \c b, respectively
+ */
+static int dc_snapshot_id_cmp(
+  const void *a,
+  const void *b
+) {
+  size_t x = *(const size_t *) a;
+  size_t y = *(const size_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * Destroy a Snapshot (helper function)
+ *
+ * \param[in,out] ptr The address of a pointer to a Snapshot
+ */
+static void dc_snapshot_free(
+  dcSnapshot **ptr
+) {
+  free((*ptr)->name);
+  free((*ptr)->ids);
+  free(*ptr);
+  *ptr = NULL;
+}
+
+/**
+ * Construct a Snapshot Store
+ *
+ * For details on the structure and its fields, see \ref dcSnapshotStore
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated, empty dcSnapshotStore object
+ */
+dcSnapshotStore * dc_snapshot_store_new(
+  void
+) {
+  dcSnapshotStore *store = NEW(dcSnapshotStore);
+
+  if (store == NULL)
+    return NULL;
+
+  dc_error_handler_init(&store->handler);
+
+  store->sections = NULL;
+  store->hashes = NULL;
+  store->lengths = NULL;
+  store->texts = NULL;
+  store->count = 0;
+  store->size = 0;
+
+  store->snapshots = NULL;
+  store->nsnapshots = 0;
+
+  store->ids = dc_hash_table_new(0);
+  if (store->ids == NULL)
+  {
+    free(store);
+    return NULL;
+  }
+
+  return store;
+}
+
+/**
+ * Find or add a paragraph in a Snapshot Store (helper function)
+ *
+ * \param[in,out] store A pointer to a Snapshot Store
+ * \param[in] name The name of the snapshot, for diagnostics
+ * \param[in] line The line number at which the paragraph begins
+ * \param[in] buf The paragraph's bytes
+ * \param[in] len The length of the paragraph
+ * \param[out] id Set to the paragraph's id
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \returns Otherwise, the status returned by \ref dc_parser_read_buffer
+ */
+static dcStatus dc_snapshot_paragraph(
+  dcSnapshotStore *store,
+  const char *name,
+  unsigned int line,
+  const char *buf,
+  size_t len,
+  size_t *id
+) {
+  dcParserSection **sections;
+  uint64_t *hashes;
+  size_t *lengths;
+  char **texts;
+  char *text;
+  dcParser *parser;
+  uint64_t hash;
+  void *value;
+  size_t iter = 0;
+  size_t size;
+  dcStatus rc;
+
+  hash = dc_hash(buf, len);
+  while ((value = dc_hash_table_find(store->ids, hash, &iter)) != NULL)
+  {
+    *id = (size_t) ((uintptr_t) value - 1);
+    if (store->lengths[*id] == len &&
+      memcmp(store->texts[*id], buf, len) == 0)
+      return dcNoErr;
+  }
+
+  if (store->count == store->size)
+  {
+    size = (store->size == 0) ? 1024 : store->size * 2;
+
+    sections = realloc(store->sections, size * sizeof(dcParserSection *));
+    if (sections == NULL)
+      return dcMemFullErr;
+    store->sections = sections;
+
+    hashes = realloc(store->hashes, size * sizeof(uint64_t));
+    if (hashes == NULL)
+      return dcMemFullErr;
+    store->hashes = hashes;
+
+    lengths = realloc(store->lengths, size * sizeof(size_t));
+    if (lengths == NULL)
+      return dcMemFullErr;
+    store->lengths = lengths;
+
+    texts = realloc(store->texts, size * sizeof(char *));
+    if (texts == NULL)
+      return dcMemFullErr;
+    store->texts = texts;
+
+    store->size = size;
+  }
+
+  parser = dc_parser_new();
+  if (parser == NULL)
+    return dcMemFullErr;
+
+  /* report problems relative to the whole snapshot */
+  parser->handler = store->handler;
+  parser->ctx.path = (char *) name;
+  parser->ctx.line = line - 1;
+
+  rc = dc_parser_read_buffer(parser, buf, len, NULL);
+  if (rc != dcNoErr)
+  {
+    dc_parser_free(&parser);
+    return rc;
+  }
+
+  text = malloc(len);
+  if (text == NULL)
+  {
+    dc_parser_free(&parser);
+    return dcMemFullErr;
+  }
+  memcpy(text, buf, len);
+
+  *id = store->count;
+  if (dc_hash_table_insert(store->ids, hash,
+    (void *) (uintptr_t) (*id + 1)) != dcNoErr)
+  {
+    free(text);
+    dc_parser_free(&parser);
+    return dcMemFullErr;
+  }
+
+  /* a paragraph has no blank lines, so it becomes a single section */
+  store->sections[*id] = parser->head;
+  store->hashes[*id] = hash;
+  store->lengths[*id] = len;
+  store->texts[*id] = text;
+  store->count++;
+
+  parser->head = NULL;
+  dc_parser_free(&parser);
+
+  return dcNoErr;
+}
+
+/**
+ * Add a snapshot to a Snapshot Store
+ *
+ * This splits the buffer (e.g. the contents of a \c Packages file) into
+ * paragraphs, adding those not already in the store, and records the
+ * snapshot as the set of its paragraphs' ids.
+ *
+ * \param[in,out] store A pointer to a Snapshot Store
+ * \param[in] name A name for the snapshot (e.g. its date), which is copied
+ * \param[in] buf The snapshot's contents
+ * \param[in] len The length of the contents
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \returns Otherwise, the status returned by \ref dc_parser_read_buffer
+ *
+ * \note On failure, no snapshot is added, although paragraphs read before
+ * the failure remain in the store.
+ */
+dcStatus dc_snapshot_store_add(
+  dcSnapshotStore *store,
+  const char *name,
+  const char *buf,
+  size_t len
+) {
+  dcSnapshot **snapshots;
+  dcSnapshot *snapshot;
+  const char *end = buf + len;
+  const char *p = buf;
+  const char *next;
+  const char *start = NULL;
+  const char *q;
+  unsigned int line = 1;
+  unsigned int first = 0;
+  size_t size = 0;
+  size_t *ids;
+  size_t i;
+  size_t n;
+  int blank;
+  dcStatus rc = dcNoErr;
+
+  assert(store != NULL);
+  assert(name != NULL);
+  assert(buf != NULL || len == 0);
+
+  if (store == NULL || name == NULL || (buf == NULL && len > 0))
+    return dcParameterErr;
+
+  snapshot = NEW(dcSnapshot);
+  if (snapshot == NULL)
+    return dcMemFullErr;
+
+  snapshot->name = strdup(name);
+  snapshot->ids = NULL;
+  snapshot->count = 0;
+  if (snapshot->name == NULL)
+  {
+    dc_snapshot_free(&snapshot);
+    return dcMemFullErr;
+  }
+
+  while (rc == dcNoErr)
+  {
+    next = end;
+    blank = 1;
+    if (p < end)
+    {
+      next = memchr(p, '\n', end - p);
+      next = (next == NULL) ? end : next + 1;
+
+      for (q = p; q < next && blank; q++)
+        blank = (*q == ' ' || *q == '\t' || *q == '\r' || *q == '\n');
+
+      if (!blank)
+      {
+        if (start == NULL)
+        {
+          start = p;
+          first = line;
+        }
+        p = next;
+        line++;
+        continue;
+      }
+    }
+
+    /* paragraphs end at a blank line, or the end of the buffer */
+    if (start != NULL)
+    {
+      if (snapshot->count == size)
+      {
+        size = (size == 0) ? 1024 : size * 2;
+        ids = realloc(snapshot->ids, size * sizeof(size_t));
+        if (ids == NULL)
+        {
+          rc = dcMemFullErr;
+          break;
+        }
+        snapshot->ids = ids;
+      }
+
+      rc = dc_snapshot_paragraph(store, name, first, start, p - start,
+        &snapshot->ids[snapshot->count]);
+      if (rc == dcNoErr)
+        snapshot->count++;
+      start = NULL;
+    }
+
+    if (p == end)
+      break;
+
+    p = next;
+    line++;
+  }
+
+  if (rc == dcNoErr)
+  {
+    snapshots = realloc(store->snapshots,
+      (store->nsnapshots + 1) * sizeof(dcSnapshot *));
+    if (snapshots == NULL)
+      rc = dcMemFullErr;
+    else
+      store->snapshots = snapshots;
+  }
+
+  if (rc != dcNoErr)
+  {
+    dc_snapshot_free(&snapshot);
+    return rc;
+  }
+
+  /* sort the ids, dropping repeated paragraphs */
+  if (snapshot->count > 0)
+  {
+    qsort(snapshot->ids, snapshot->count, sizeof(size_t),
+      &dc_snapshot_id_cmp);
+    for (i = 1, n = 1; i < snapshot->count; i++)
+    {
+      if (snapshot->ids[i] != snapshot->ids[n-1])
+        snapshot->ids[n++] = snapshot->ids[i];
+    }
+    snapshot->count = n;
+  }
+
+  store->snapshots[store->nsnapshots++] = snapshot;
+
+  return dcNoErr;
+}
+
+/**
+ * Add a snapshot file to a Snapshot Store
+ *
+ * This reads a file and adds its contents as a snapshot, using
+ * \ref dc_snapshot_store_add.
+ *
+ * \param[in,out] store A pointer to a Snapshot Store
+ * \param[in] name A name for the snapshot (e.g. its date), which is copied
+ * \param[in] path The path of the file
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcFileErr if the file could not be read
+ * \returns Otherwise, the status returned by \ref dc_parser_read_buffer
+ */
+dcStatus dc_snapshot_store_add_file(
+  dcSnapshotStore *store,
+  const char *name,
+  const char *path
+) {
+  dcStatus rc;
+  char *buf;
+  size_t len;
+
+  assert(store != NULL);
+  assert(path != NULL);
+
+  if (store == NULL || path == NULL)
+    return dcParameterErr;
+
+  buf = dc_file_read(path, &len);
+  if (buf == NULL)
+  {
+    dc_crit(&store->handler, NULL, _("Can't read file '%s': %s"),
+      path, strerror(errno));
+    return dcFileErr;
+  }
+
+  rc = dc_snapshot_store_add(store, name, buf, len);
+  free(buf);
+
+  return rc;
+}
+
+/**
+ * Find a snapshot by name
+ *
+ * \param[in] store A pointer to a Snapshot Store
+ * \param[in] name The name of the snapshot
+ *
+ * \retval NULL if there is no snapshot with that name
+ * \return The most recently added snapshot with that name
+ */
+dcSnapshot * dc_snapshot_store_find(
+  const dcSnapshotStore *store,
+  const char *name
+) {
+  size_t i;
+
+  assert(store != NULL);
+  assert(name != NULL);
+
+  for (i = store->nsnapshots; i > 0; i--)
+  {
+    if (strcmp(store->snapshots[i-1]->name, name) == 0)
+      return store->snapshots[i-1];
+  }
+
+  return NULL;
+}
+
+/**
+ * Find the differences between two snapshots
+ *
+ * This finds the ids of the paragraphs in snapshot \c b but not in \c a
+ * (added), and in \c a but not in \c b (removed), each in increasing order.
+ * The paragraphs themselves are available from \ref dcSnapshotStore::sections.
+ *
+ * Example:
+ * \code
+ * dc_snapshot_diff(monday, tuesday, &added, &nadded, &removed, &nremoved);
+ * for (i = 0; i < nadded; i++)
+ *   dc_parser_section_write(store->sections[added[i]], buf);
+ * free(added);
+ * free(removed);
+ * \endcode
+ *
+ * \param[in] a A pointer to the earlier Snapshot
+ * \param[in] b A pointer to the later Snapshot
+ * \param[out] added Set to a dynamically allocated array of ids, which the
+ * caller must free with \c free
+ * \param[out] nadded Set to the number of ids in \c added
+ * \param[out] removed Set to a dynamically allocated array of ids, which the
+ * caller must free with \c free
+ * \param[out] nremoved Set to the number of ids in \c removed
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_snapshot_diff(
+  const dcSnapshot *a,
+  const dcSnapshot *b,
+  size_t **added,
+  size_t *nadded,
+  size_t **removed,
+  size_t *nremoved
+) {
+  size_t i = 0;
+  size_t j = 0;
+
+  assert(a != NULL);
+  assert(b != NULL);
+  assert(added != NULL && nadded != NULL);
+  assert(removed != NULL && nremoved != NULL);
+
+  if (a == NULL || b == NULL || added == NULL || nadded == NULL ||
+    removed == NULL || nremoved == NULL)
+    return dcParameterErr;
+
+  /* allocate at least one element, so NULL always means failure */
+  *added = malloc((b->count + 1) * sizeof(size_t));
+  *removed = malloc((a->count + 1) * sizeof(size_t));
+  if (*added == NULL || *removed == NULL)
+  {
+    free(*added);
+    free(*removed);
+    *added = *removed = NULL;
+    return dcMemFullErr;
+  }
+
+  *nadded = 0;
+  *nremoved = 0;
+
+  while (i < a->count || j < b->count)
+  {
+    if (j == b->count || (i < a->count && a->ids[i] < b->ids[j]))
+      (*removed)[(*nremoved)++] = a->ids[i++];
+    else if (i == a->count || b->ids[j] < a->ids[i])
+      (*added)[(*nadded)++] = b->ids[j++];
+    else
+    {
+      i++;
+      j++;
+    }
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Destroy a Snapshot Store
+ *
+ * This frees the store's snapshots and paragraphs, and any memory allocated
+ * for the store itself.
+ *
+ * \param[in,out] ptr The address of a pointer to a Snapshot Store
+ *
+ * \note The pointer will be set to \c NULL.
+ */
+void dc_snapshot_store_free(
+  dcSnapshotStore **ptr
+) {
+  dcSnapshotStore *store;
+  size_t i;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  store = *ptr;
+
+  for (i = 0; i < store->nsnapshots; i++)
+    dc_snapshot_free(&store->snapshots[i]);
+  free(store->snapshots);
+
+  for (i = 0; i < store->count; i++)
+  {
+    dc_parser_section_free(&store->sections[i]);
+    free(store->texts[i]);
+  }
+  free(store->sections);
+  free(store->hashes);
+  free(store->lengths);
+  free(store->texts);
+
+  dc_hash_table_free(&store->ids);
+
+  free(store);
+  *ptr = NULL;
+}
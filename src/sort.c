@@ -0,0 +1,495 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Sorting of package indexes
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Archive tools publish \c Packages and \c Sources files with their
+ * paragraphs sorted by package name, then by version. \ref dc_parser_sort
+ * puts the paragraphs of a parser in that order by relinking its list of
+ * sections, so no paragraph is copied.
+ *
+ * \par Algorithm
+ * The sort keys are extracted once, before sorting, rather than in every
+ * comparison:
+ * - Package names are interned, and the distinct names sorted, so each
+ *   paragraph's name is replaced by the rank of its name. Indexes have far
+ *   fewer distinct names than paragraphs, so this is cheap, and most
+ *   comparisons are then decided by comparing two integers.
+ * - Versions are replaced by their keys (see \ref dc_version_key), which
+ *   are compared with \c memcmp.
+ * \par
+ * Key extraction is spread over several threads (see \ref dc_parallel_run).
+ * The records are then sorted as a merge sort: the array is split into one
+ * run per thread, the runs are sorted in parallel, and then merged in pairs,
+ * with the merges of each pass also done in parallel. Paragraphs with equal
+ * keys keep their original order.
+ * \par
+ * Paragraphs without a \c Package field (including empty ones) are moved to
+ * the end, in their original order.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: strcmp, strlen, memcpy */
+
+#include <debctrl/sort.h>
+#include <debctrl/hash.h>
+#include <debctrl/thread.h>
+#include <debctrl/version.h>
+
+/** Number of paragraphs in each key extraction work item */
+#define SORT_BATCH      1024
+
+/** Minimum number of paragraphs per run worth sorting in parallel */
+#define SORT_MIN_RUN    4096
+
+/** Rank given to paragraphs without a package name */
+#define SORT_NO_NAME    UINT32_MAX
+
+/**
+ * Sort record for a paragraph (internal)
+ */
+typedef struct
+{
+  uint32_t rank; /**< Rank of the package name */
+  size_t order; /**< Original position of the paragraph */
+  const unsigned char *key; /**< Version key */
+  size_t len; /**< Length of \c key */
+  dcParserSection *section; /**< The paragraph */
+} dcSortRecord;
+
+/**
+ * Shared state of a sort (internal)
+ */
+typedef struct
+{
+  dcSortRecord *records; /**< Records, in list order until sorted */
+  dcSortRecord *scratch; /**< Space for merging into */
+  size_t count; /**< Number of records */
+
+  const char **names; /**< Package name of each record, or \c NULL */
+  const char **versions; /**< Version of each record, or \c NULL */
+
+  dcHashTable *interned; /**< Name number + 1, by package name */
+  const char **distinct; /**< Each distinct name, by name number */
+  uint32_t *ranks; /**< Rank of each name, by name number */
+
+  unsigned char *keys; /**< Storage for all of the version keys */
+
+  size_t runs; /**< Number of runs sorted in parallel */
+  size_t width; /**< Number of runs already merged, in the current pass */
+} dcSortState;
+
+/**
+ * Look up the value of a single-line field (helper function)
+ *
+ * \param[in] section A pointer to a Parser Section
+ * \param[in] field The name of the field
+ *
+ * \retval NULL if the field is missing or empty
+ * \return The field's value
+ */
+static const char * dc_sort_field(
+  dcParserSection *section,
+  const char *field
+) {
+  dcParserBlock *block;
+
+  block = dc_parser_section_find(section, field);
+  if (block == NULL || block->head == NULL)
+    return NULL;
+
+  return block->head->text;
+}
+
+/**
+ * Find the name and version of a batch of paragraphs (work function)
+ *
+ * This also stores the length of each version key in the record's \c len.
+ *
+ * \param[in] batch The number of the batch
+ * \param[in,out] arg The \c dcSortState
+ */
+static void dc_sort_extract(
+  size_t batch,
+  void *arg
+) {
+  dcSortState *state = arg;
+  dcSortRecord *record;
+  size_t end = (batch + 1) * SORT_BATCH;
+  size_t i;
+
+  if (end > state->count)
+    end = state->count;
+
+  for (i = batch * SORT_BATCH; i < end; i++)
+  {
+    record = &state->records[i];
+    state->names[i] = dc_sort_field(record->section, "Package");
+    state->versions[i] = dc_sort_field(record->section, "Version");
+    record->len = (state->versions[i] == NULL) ? 0 :
+      dc_version_key(state->versions[i], NULL, 0);
+  }
+}
+
+/**
+ * Find the number of an interned name (helper function)
+ *
+ * \param[in] state The \c dcSortState
+ * \param[in] name The name
+ * \param[in] hash The hash of the name
+ *
+ * \retval 0 if the name has not been interned
+ * \return The name number + 1
+ */
+static size_t dc_sort_intern_find(
+  const dcSortState *state,
+  const char *name,
+  uint64_t hash
+) {
+  void *value;
+  size_t iter = 0;
+
+  while ((value = dc_hash_table_find(state->interned, hash, &iter)) != NULL)
+  {
+    if (strcmp(state->distinct[(uintptr_t) value - 1], name) == 0)
+      return (size_t) (uintptr_t) value;
+  }
+
+  return 0;
+}
+
+/**
+ * Fill in the rank and version key of a batch of paragraphs (work function)
+ *
+ * \param[in] batch The number of the batch
+ * \param[in,out] arg The \c dcSortState
+ */
+static void dc_sort_keys(
+  size_t batch,
+  void *arg
+) {
+  dcSortState *state = arg;
+  dcSortRecord *record;
+  const char *name;
+  size_t end = (batch + 1) * SORT_BATCH;
+  size_t i;
+
+  if (end > state->count)
+    end = state->count;
+
+  for (i = batch * SORT_BATCH; i < end; i++)
+  {
+    record = &state->records[i];
+
+    name = state->names[i];
+    if (name == NULL)
+      record->rank = SORT_NO_NAME;
+    else
+      record->rank = state->ranks[dc_sort_intern_find(state, name,
+        dc_hash(name, strlen(name))) - 1];
+
+    if (record->len > 0)
+      dc_version_key(state->versions[i], (unsigned char *) record->key,
+        record->len);
+  }
+}
+
+/**
+ * Compare two sort records (helper function)
+ *
+ * \param[in] a A pointer to a \c dcSortRecord
+ * \param[in] b A pointer to a \c dcSortRecord
+ *
+ * \return A value less than, equal to or greater than zero, if \c a sorts
+ * before, with or after \c b respectively
+ */
+static int dc_sort_compare(
+  const void *a,
+  const void *b
+) {
+  const dcSortRecord *x = a;
+  const dcSortRecord *y = b;
+  int rc;
+
+  if (x->rank != y->rank)
+    return (x->rank < y->rank) ? -1 : 1;
+
+  rc = dc_version_key_compare(x->key, x->len, y->key, y->len);
+  if (rc != 0)
+    return rc;
+
+  return (x->order < y->order) ? -1 : (x->order > y->order);
+}
+
+/**
+ * Compare two distinct names (helper function for qsort)
+ *
+ * \param[in] a A pointer to a name
+ * \param[in] b A pointer to a name
+ *
+ * \return The result of \c strcmp
+ */
+static int dc_sort_compare_names(
+  const void *a,
+  const void *b
+) {
+  return strcmp(*(const char * const *) a, *(const char * const *) b);
+}
+
+/**
+ * Find the start of a run (helper function)
+ *
+ * \param[in] state The \c dcSortState
+ * \param[in] run The number of the run, up to and including \c state->runs
+ *
+ * \return The number of the first record in the run
+ */
+static size_t dc_sort_run_start(
+  const dcSortState *state,
+  size_t run
+) {
+  if (run >= state->runs)
+    return state->count;
+
+  return (size_t) ((uint64_t) state->count * run / state->runs);
+}
+
+/**
+ * Sort a single run (work function)
+ *
+ * \param[in] run The number of the run
+ * \param[in,out] arg The \c dcSortState
+ */
+static void dc_sort_run(
+  size_t run,
+  void *arg
+) {
+  dcSortState *state = arg;
+  size_t start = dc_sort_run_start(state, run);
+
+  qsort(state->records + start, dc_sort_run_start(state, run + 1) - start,
+    sizeof(dcSortRecord), &dc_sort_compare);
+}
+
+/**
+ * Merge a pair of adjacent sorted ranges into the scratch space (work
+ * function)
+ *
+ * Merge \c i combines the \c state->width runs starting at run
+ * <tt>2 * i * width</tt> with the (up to) \c width runs after them.
+ *
+ * \param[in] merge The number of the merge
+ * \param[in,out] arg The \c dcSortState
+ */
+static void dc_sort_merge(
+  size_t merge,
+  void *arg
+) {
+  dcSortState *state = arg;
+  size_t first = 2 * merge * state->width;
+  size_t i = dc_sort_run_start(state, first);
+  size_t mid = dc_sort_run_start(state, first + state->width);
+  size_t end = dc_sort_run_start(state, first + 2 * state->width);
+  size_t j = mid;
+  size_t k = i;
+
+  while (i < mid && j < end)
+  {
+    if (dc_sort_compare(&state->records[j], &state->records[i]) < 0)
+      state->scratch[k++] = state->records[j++];
+    else
+      state->scratch[k++] = state->records[i++];
+  }
+
+  memcpy(state->scratch + k, state->records + i,
+    (mid - i) * sizeof(dcSortRecord));
+  k += mid - i;
+  memcpy(state->scratch + k, state->records + j,
+    (end - j) * sizeof(dcSortRecord));
+}
+
+/**
+ * Sort the paragraphs of a Parser by package name and version
+ *
+ * This reorders the sections of the parser by package name (in byte order,
+ * as \c strcmp) and then by version (as dpkg compares them), without
+ * copying them. See \ref sort.c for details.
+ *
+ * \param[in,out] parser A pointer to a Parser instance
+ * \param[in] threads The maximum number of threads to use, or \c 0 for one
+ * per online processor (see \ref dc_parallel_run)
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory (the
+ * parser is then unchanged)
+ *
+ * \note If the sections of the parser are shared with a clone, they are
+ * made writable first (see \ref dc_parser_section_writable); the clone
+ * keeps its original order.
+ */
+dcStatus dc_parser_sort(
+  dcParser *parser,
+  unsigned int threads
+) {
+  dcSortState state;
+  dcSortRecord *swap;
+  dcParserSection *section;
+  const char *name;
+  uint64_t hash;
+  size_t batches;
+  size_t total;
+  size_t ndistinct = 0;
+  size_t i;
+  int shared = 0;
+  dcStatus rc = dcMemFullErr;
+
+  assert(parser != NULL);
+
+  if (parser == NULL)
+    return dcParameterErr;
+
+  memset(&state, 0, sizeof(state));
+  for (section = parser->head; section != NULL; section = section->next)
+  {
+    state.count++;
+    if (section->refs > 1)
+      shared = 1;
+  }
+
+  if (state.count < 2)
+    return dcNoErr;
+
+  /* relinking must not disturb clones sharing the list */
+  if (shared && dc_parser_section_writable(parser, parser->tail) == NULL)
+    return dcMemFullErr;
+
+  if (threads == 0)
+    threads = dc_parallel_threads();
+
+  state.records = malloc(state.count * sizeof(dcSortRecord));
+  state.scratch = malloc(state.count * sizeof(dcSortRecord));
+  state.names = malloc(state.count * sizeof(const char *));
+  state.versions = malloc(state.count * sizeof(const char *));
+  state.interned = dc_hash_table_new(0);
+  if (state.records == NULL || state.scratch == NULL || state.names == NULL ||
+    state.versions == NULL || state.interned == NULL)
+    goto done;
+
+  i = 0;
+  for (section = parser->head; section != NULL; section = section->next)
+  {
+    state.records[i].section = section;
+    state.records[i].order = i;
+    i++;
+  }
+
+  batches = (state.count + SORT_BATCH - 1) / SORT_BATCH;
+  dc_parallel_run(batches, threads, &dc_sort_extract, &state);
+
+  /* intern the names, and lay out storage for the version keys */
+  total = 0;
+  for (i = 0; i < state.count; i++)
+  {
+    total += state.records[i].len;
+
+    name = state.names[i];
+    if (name == NULL)
+      continue;
+
+    hash = dc_hash(name, strlen(name));
+    if (dc_sort_intern_find(&state, name, hash) != 0)
+      continue;
+
+    if ((ndistinct & (ndistinct - 1)) == 0)
+    {
+      const char **distinct = realloc(state.distinct,
+        (ndistinct == 0 ? 1 : 2 * ndistinct) * sizeof(const char *));
+      if (distinct == NULL)
+        goto done;
+      state.distinct = distinct;
+    }
+
+    state.distinct[ndistinct++] = name;
+    if (dc_hash_table_insert(state.interned, hash,
+      (void *) (uintptr_t) ndistinct) != dcNoErr)
+      goto done;
+  }
+
+  state.keys = malloc(total + 1);
+  state.ranks = malloc((ndistinct + 1) * sizeof(uint32_t));
+  if (state.keys == NULL || state.ranks == NULL)
+    goto done;
+
+  total = 0;
+  for (i = 0; i < state.count; i++)
+  {
+    state.records[i].key = state.keys + total;
+    total += state.records[i].len;
+  }
+
+  /* rank the distinct names, keeping their numbers in the table */
+  {
+    const char **sorted = malloc((ndistinct + 1) * sizeof(const char *));
+    if (sorted == NULL)
+      goto done;
+
+    memcpy(sorted, state.distinct, ndistinct * sizeof(const char *));
+    qsort(sorted, ndistinct, sizeof(const char *), &dc_sort_compare_names);
+    for (i = 0; i < ndistinct; i++)
+    {
+      name = sorted[i];
+      state.ranks[dc_sort_intern_find(&state, name,
+        dc_hash(name, strlen(name))) - 1] = (uint32_t) i;
+    }
+    free(sorted);
+  }
+
+  dc_parallel_run(batches, threads, &dc_sort_keys, &state);
+
+  /* sort a run per thread, then merge them in pairs */
+  state.runs = state.count / SORT_MIN_RUN;
+  if (state.runs > threads)
+    state.runs = threads;
+  if (state.runs == 0)
+    state.runs = 1;
+
+  dc_parallel_run(state.runs, threads, &dc_sort_run, &state);
+  for (state.width = 1; state.width < state.runs; state.width *= 2)
+  {
+    dc_parallel_run((state.runs + 2 * state.width - 1) / (2 * state.width),
+      threads, &dc_sort_merge, &state);
+
+    swap = state.records;
+    state.records = state.scratch;
+    state.scratch = swap;
+  }
+
+  /* relink the sections in their new order */
+  parser->head = state.records[0].section;
+  for (i = 0; i + 1 < state.count; i++)
+    state.records[i].section->next = state.records[i + 1].section;
+  parser->tail = state.records[state.count - 1].section;
+  parser->tail->next = NULL;
+
+  rc = dcNoErr;
+
+done:
+  free(state.records);
+  free(state.scratch);
+  free(state.names);
+  free(state.versions);
+  free(state.distinct);
+  free(state.ranks);
+  free(state.keys);
+  if (state.interned != NULL)
+    dc_hash_table_free(&state.interned);
+
+  return rc;
+}
@@ -0,0 +1,357 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Parse statistics
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * The sizes of buffers used throughout the library (such as
+ * \ref STRING_INIT_SIZE) are guesses at the size of typical input. A
+ * \ref dcParserStats collects the distributions of line, field and
+ * paragraph sizes, and of the number of paragraphs per input, from the
+ * input actually parsed, so that these sizes can be chosen from
+ * measurements instead.
+ *
+ * \par Collecting
+ * Statistics are collected by any \ref dcParser whose \c stats member
+ * points to a dcParserStats, for each file or buffer it reads. One
+ * dcParserStats may be shared by any number of parsers, one at a time,
+ * to gather statistics for a whole corpus. Example:
+ * \code
+ * stats = dc_parser_stats_new();
+ * parser->stats = stats;
+ * rc = dc_parser_read_file(parser, path);
+ * \endcode
+ * \par
+ * Each histogram has one bucket per power of two, so recording a size
+ * costs a few instructions and the histograms have a fixed size, however
+ * much input is seen.
+ *
+ * \par Tuning
+ * \ref dc_parser_stats_apply sizes later allocations in the same process
+ * from the statistics collected so far:
+ * - new strings (see \ref dc_string_new) start large enough for nine in
+ *   ten paragraphs, and grow by at least the size of a typical paragraph
+ * - arena blocks (see \ref dc_arena_alloc) hold \ref STATS_ARENA_PARAGRAPHS
+ *   large paragraphs
+ * - the hash tables of new indexes (see \ref dc_index_new) start large
+ *   enough for the paragraphs of a typical input
+ * \par
+ * Tuned sizes are kept between \ref STATS_SIZE_MIN and
+ * \ref STATS_SIZE_MAX, and index sizes between \ref STATS_INDEX_MIN and
+ * \ref STATS_INDEX_MAX paragraphs. The \c dcstats example program prints the
+ * distributions for a set of files, to help choose the built-in defaults.
+ */
+
+#include <config.h>
+
+#include <limits.h>   /* for: CHAR_BIT */
+#include <string.h>   /* for: memset */
+
+#include <debctrl/stats.h>
+#include <debctrl/defaults.h>
+#include <debctrl/index.h>
+#include <debctrl/util.h>
+
+/**
+ * Construct a Parse Statistics object
+ *
+ * For details on the structure and its fields, see \ref dcParserStats
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcParserStats object, with every count
+ * set to \c 0
+ */
+dcParserStats * dc_parser_stats_new(
+  void
+) {
+  dcParserStats *stats = NEW(dcParserStats);
+
+  if (stats == NULL)
+    return NULL;
+
+  memset(stats, 0, sizeof(dcParserStats));
+
+  return stats;
+}
+
+/**
+ * Count a size in a histogram (helper function)
+ *
+ * \param[in,out] histogram The histogram, of \ref STATS_BUCKETS buckets
+ * \param[in] size The size
+ */
+static void dc_parser_stats_count(
+  size_t *histogram,
+  size_t size
+) {
+  unsigned int bucket = 0;
+
+  while (size > 1 && bucket < STATS_BUCKETS - 1)
+  {
+    size >>= 1;
+    bucket++;
+  }
+
+  histogram[bucket]++;
+}
+
+/**
+ * Finish the current field (helper function)
+ *
+ * \param[in,out] stats A pointer to a Parse Statistics object
+ */
+static void dc_parser_stats_field(
+  dcParserStats *stats
+) {
+  if (stats->field == 0)
+    return;
+
+  dc_parser_stats_count(stats->input_fields, stats->field);
+  stats->input_nfields++;
+  stats->field = 0;
+}
+
+/**
+ * Finish the current paragraph (helper function)
+ *
+ * \param[in,out] stats A pointer to a Parse Statistics object
+ */
+static void dc_parser_stats_paragraph(
+  dcParserStats *stats
+) {
+  dc_parser_stats_field(stats);
+
+  if (stats->paragraph == 0)
+    return;
+
+  dc_parser_stats_count(stats->input_paragraphs, stats->paragraph);
+  stats->paragraph = 0;
+  stats->count++;
+}
+
+/**
+ * Begin collecting statistics for an input
+ *
+ * This is called by the parser when it begins reading a file or buffer.
+ * Any counts left over from an input which was not finished are
+ * discarded.
+ *
+ * \param[in,out] stats A pointer to a Parse Statistics object
+ */
+void dc_parser_stats_begin(
+  dcParserStats *stats
+) {
+  assert(stats != NULL);
+
+  stats->field = 0;
+  stats->paragraph = 0;
+  stats->count = 0;
+  memset(stats->input_lines, 0, sizeof(stats->input_lines));
+  memset(stats->input_fields, 0, sizeof(stats->input_fields));
+  memset(stats->input_paragraphs, 0, sizeof(stats->input_paragraphs));
+  stats->input_nlines = 0;
+  stats->input_nfields = 0;
+  stats->input_bytes = 0;
+}
+
+/**
+ * Collect statistics for a line of input
+ *
+ * This is called by the parser for each line it reads, before the line is
+ * modified. Comments are counted as lines, but not as part of any field or
+ * paragraph.
+ *
+ * \param[in,out] stats A pointer to a Parse Statistics object
+ * \param[in] line The line
+ * \param[in] len The length of the line, including any line terminator
+ */
+void dc_parser_stats_line(
+  dcParserStats *stats,
+  const char *line,
+  size_t len
+) {
+  const char *p;
+
+  assert(stats != NULL);
+  assert(line != NULL);
+
+  dc_parser_stats_count(stats->input_lines, len);
+  stats->input_nlines++;
+  stats->input_bytes += len;
+
+  if (len == 0 || line[0] == '#')
+    return;
+
+  /* a line of only whitespace ends the paragraph */
+  for (p = line; p < line + len; p++)
+  {
+    if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+      break;
+  }
+  if (p == line + len)
+  {
+    dc_parser_stats_paragraph(stats);
+    return;
+  }
+
+  /* any other line not beginning with whitespace starts a new field */
+  if (line[0] != ' ' && line[0] != '\t')
+    dc_parser_stats_field(stats);
+
+  stats->field += len;
+  stats->paragraph += len;
+}
+
+/**
+ * Finish collecting statistics for an input
+ *
+ * This adds the counts for the input to the totals. It is called by the
+ * parser when it has finished reading a file or buffer, including when it
+ * stops early (see \ref dcParserStop). It is not called when reading
+ * fails, so nothing from a partly read input is counted.
+ *
+ * \param[in,out] stats A pointer to a Parse Statistics object
+ */
+void dc_parser_stats_end(
+  dcParserStats *stats
+) {
+  unsigned int i;
+
+  assert(stats != NULL);
+
+  dc_parser_stats_paragraph(stats);
+
+  for (i = 0; i < STATS_BUCKETS; i++)
+  {
+    stats->lines[i] += stats->input_lines[i];
+    stats->fields[i] += stats->input_fields[i];
+    stats->paragraphs[i] += stats->input_paragraphs[i];
+  }
+  stats->nlines += stats->input_nlines;
+  stats->nfields += stats->input_nfields;
+  stats->nparagraphs += stats->count;
+  stats->bytes += stats->input_bytes;
+
+  dc_parser_stats_count(stats->inputs, stats->count);
+  stats->ninputs++;
+
+  dc_parser_stats_begin(stats);
+}
+
+/**
+ * Estimate a percentile of a histogram
+ *
+ * \param[in] histogram A histogram of a \ref dcParserStats
+ * \param[in] percent The percentile, from \c 0 to \c 100
+ *
+ * \retval 0 if the histogram is empty
+ * \return The upper bound of the bucket holding the percentile, which is
+ * at least the percentile itself and less than twice it
+ */
+size_t dc_parser_stats_quantile(
+  const size_t *histogram,
+  unsigned int percent
+) {
+  size_t total = 0;
+  size_t seen = 0;
+  unsigned int i;
+
+  assert(histogram != NULL);
+  assert(percent <= 100);
+
+  for (i = 0; i < STATS_BUCKETS; i++)
+    total += histogram[i];
+  if (total == 0)
+    return 0;
+
+  for (i = 0; i < STATS_BUCKETS - 1; i++)
+  {
+    seen += histogram[i];
+    if (seen * 100 >= total * percent)
+      break;
+  }
+
+  if (i + 1 >= sizeof(size_t) * CHAR_BIT)
+    return SIZE_MAX;
+  return (size_t) 1 << (i + 1);
+}
+
+/**
+ * Keep a tuned size within bounds (helper function)
+ *
+ * \param[in] size The size
+ * \param[in] min The smallest size allowed
+ * \param[in] max The largest size allowed
+ *
+ * \return The size, raised to \c min or lowered to \c max
+ */
+static size_t dc_parser_stats_clamp(
+  size_t size,
+  size_t min,
+  size_t max
+) {
+  if (size < min)
+    return min;
+  if (size > max)
+    return max;
+  return size;
+}
+
+/**
+ * Size later allocations from collected statistics
+ *
+ * This sets the default sizes of strings, arena blocks and the hash tables
+ * of indexes created from now on (see \ref stats.c for the details). It
+ * has no effect if no paragraphs have been seen.
+ *
+ * \param[in] stats A pointer to a Parse Statistics object
+ *
+ * \note The defaults are shared by the whole process. Allocations made by
+ * other threads at the same time get either the old or the new sizes.
+ */
+void dc_parser_stats_apply(
+  const dcParserStats *stats
+) {
+  size_t typical;
+  size_t large;
+
+  assert(stats != NULL);
+
+  if (stats->nparagraphs == 0)
+    return;
+
+  typical = dc_parser_stats_quantile(stats->paragraphs, 50);
+  large = dc_parser_stats_quantile(stats->paragraphs, 90);
+
+  dc_string_tune(
+    dc_parser_stats_clamp(large, STATS_SIZE_MIN, STATS_SIZE_MAX),
+    dc_parser_stats_clamp(typical, STATS_SIZE_MIN, STATS_SIZE_MAX));
+  dc_arena_tune(dc_parser_stats_clamp(large * STATS_ARENA_PARAGRAPHS,
+    STATS_SIZE_MIN, STATS_SIZE_MAX));
+
+  if (stats->ninputs > 0)
+    dc_index_tune(dc_parser_stats_clamp(
+      dc_parser_stats_quantile(stats->inputs, 50),
+      STATS_INDEX_MIN, STATS_INDEX_MAX));
+}
+
+/**
+ * Destroy a Parse Statistics object
+ *
+ * \param[in,out] ptr A pointer to a dcParserStats pointer
+ *
+ * \note The pointer will be set to \c NULL.
+ */
+void dc_parser_stats_free(
+  dcParserStats **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  free(*ptr);
+  *ptr = NULL;
+}
@@ -0,0 +1,561 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Substitution variables
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Generated control files refer to substitution variables such as
+ * \c ${shlibs:Depends} and \c ${misc:Depends}, whose values are collected in
+ * \c debian/package.substvars files while packages are built. A
+ * \ref dcSubstvars table holds these variables, and
+ * \ref dc_substvars_expand replaces every reference to them in an already
+ * parsed file, so a file with many binary packages is parsed once and
+ * expanded in a single pass.
+ *
+ * \par Substvars Files
+ * Each line of a substvars file has the form \c name=value (or
+ * \c name?=value, for a variable which need not be used). Names start with
+ * a letter, digit or underscore, followed by letters, digits, \c - and
+ * \c :. Trailing whitespace is removed from each line, and blank lines and
+ * lines whose first non-blank character is \c # are ignored, as in
+ * \c dpkg. Variables set later replace those set earlier. The variables
+ * \c Space and \c Tab are predefined.
+ *
+ * \par Expansion
+ * References are written \c ${name}. References to unknown variables expand
+ * to nothing, as in \c dpkg-gencontrol. Values may refer to other
+ * variables, up to \ref SUBSTVARS_DEPTH levels deep.
+ *
+ * \par Storage
+ * Lookups hash the name (see \ref dc_hash) and use a \ref dcHashTable.
+ * Names, values and expanded text are all allocated from a single
+ * \ref dcArena, rather than with one allocation each. Blocks with expanded
+ * chunks take a reference to the arena, so their text stays valid after the
+ * table is freed, until the last such block is freed. Only the chunks
+ * which contain references are replaced, and sections shared with a clone
+ * of the parser (see \ref dc_parser_clone) are copied first, so the clone
+ * is left unchanged.
+ */
+
+#include <config.h>
+
+#include <string.h>   /* for: memchr, strchr, strdup, strlen, strncmp, etc. */
+#include <ctype.h>    /* for: isalnum */
+
+#include <debctrl/substvars.h>
+
+/**
+ * Construct a substitution variable table
+ *
+ * The table initially holds the predefined variables.
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcSubstvars object
+ */
+dcSubstvars * dc_substvars_new(
+  void
+) {
+  dcSubstvars *substvars = NEW(dcSubstvars);
+
+  if (substvars == NULL)
+    return NULL;
+
+  substvars->count = 0;
+  substvars->table = dc_hash_table_new(0);
+  substvars->arena = dc_arena_new();
+  substvars->buf = dc_string_new(0);
+
+  if (substvars->table == NULL || substvars->arena == NULL ||
+    substvars->buf == NULL ||
+    dc_substvars_set(substvars, "Space", " ") != dcNoErr ||
+    dc_substvars_set(substvars, "Tab", "\t") != dcNoErr)
+  {
+    dc_substvars_free(&substvars);
+    return NULL;
+  }
+
+  return substvars;
+}
+
+/**
+ * Find a substitution variable (helper function)
+ *
+ * \param[in] substvars A pointer to the table
+ * \param[in] name The name (need not be \c NUL terminated)
+ * \param[in] len The length of the name
+ *
+ * \retval NULL if there is no such variable
+ * \return A pointer to the variable
+ */
+static dcSubstvar * dc_substvars_find(
+  const dcSubstvars *substvars,
+  const char *name,
+  size_t len
+) {
+  dcSubstvar *var;
+  size_t iter = 0;
+  uint64_t key = dc_hash(name, len);
+
+  while ((var = dc_hash_table_find(substvars->table, key, &iter)) != NULL)
+  {
+    if (strncmp(var->name, name, len) == 0 && var->name[len] == '\0')
+      return var;
+  }
+
+  return NULL;
+}
+
+/**
+ * Set a substitution variable from counted strings (helper function)
+ *
+ * \param[in,out] substvars A pointer to the table
+ * \param[in] name The name
+ * \param[in] namelen The length of the name
+ * \param[in] value The value
+ * \param[in] valuelen The length of the value
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_substvars_set_n(
+  dcSubstvars *substvars,
+  const char *name,
+  size_t namelen,
+  const char *value,
+  size_t valuelen
+) {
+  dcSubstvar *var;
+  char *copy;
+
+  copy = dc_arena_strndup(substvars->arena, value, valuelen);
+  if (copy == NULL)
+    return dcMemFullErr;
+
+  /* the old value stays in the arena until it is freed */
+  var = dc_substvars_find(substvars, name, namelen);
+  if (var != NULL)
+  {
+    var->value = copy;
+    return dcNoErr;
+  }
+
+  var = dc_arena_alloc(substvars->arena, sizeof(dcSubstvar));
+  if (var == NULL)
+    return dcMemFullErr;
+
+  var->value = copy;
+  var->name = dc_arena_strndup(substvars->arena, name, namelen);
+  if (var->name == NULL)
+    return dcMemFullErr;
+
+  if (dc_hash_table_insert(substvars->table, dc_hash(name, namelen), var) !=
+    dcNoErr)
+    return dcMemFullErr;
+
+  substvars->count++;
+  return dcNoErr;
+}
+
+/**
+ * Set a substitution variable
+ *
+ * \param[in,out] substvars A pointer to the table
+ * \param[in] name The name of the variable
+ * \param[in] value The value, which replaces any previous value
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+dcStatus dc_substvars_set(
+  dcSubstvars *substvars,
+  const char *name,
+  const char *value
+) {
+  assert(substvars != NULL);
+  assert(name != NULL);
+  assert(value != NULL);
+  if (substvars == NULL || name == NULL || value == NULL)
+    return dcParameterErr;
+
+  return dc_substvars_set_n(substvars, name, strlen(name), value,
+    strlen(value));
+}
+
+/**
+ * Look up the value of a substitution variable
+ *
+ * \param[in] substvars A pointer to the table
+ * \param[in] name The name (need not be \c NUL terminated)
+ * \param[in] len The length of the name
+ *
+ * \retval NULL if there is no such variable
+ * \return The value of the variable
+ */
+const char * dc_substvars_get(
+  const dcSubstvars *substvars,
+  const char *name,
+  size_t len
+) {
+  dcSubstvar *var;
+
+  assert(substvars != NULL);
+  assert(name != NULL);
+
+  var = dc_substvars_find(substvars, name, len);
+  return (var == NULL) ? NULL : var->value;
+}
+
+/**
+ * Determine whether a character is whitespace (helper function)
+ *
+ * \param[in] c The character
+ *
+ * \return Nonzero if \c c is one of the characters Perl's \c \\s matches
+ */
+static int dc_substvars_space(
+  char c
+) {
+  return (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+    c == '\v');
+}
+
+/**
+ * Read substitution variables from a buffer
+ *
+ * \param[in,out] substvars A pointer to the table
+ * \param[in] buf The contents of a substvars file
+ * \param[in] len The length of the contents
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcSyntaxErr if a line is malformed; the variables before it are
+ * kept
+ */
+dcStatus dc_substvars_read_buffer(
+  dcSubstvars *substvars,
+  const char *buf,
+  size_t len
+) {
+  const char *end = buf + len;
+  const char *line;
+  const char *eol;
+  const char *eq;
+  const char *value;
+  const char *p;
+  size_t namelen;
+
+  assert(substvars != NULL);
+  assert(buf != NULL || len == 0);
+  if (substvars == NULL || (buf == NULL && len != 0))
+    return dcParameterErr;
+
+  for (line = buf; line < end; line = eol + 1)
+  {
+    eol = memchr(line, '\n', end - line);
+    if (eol == NULL)
+      eol = end;
+
+    /* skip blank lines and comments, which may be indented */
+    for (p = line; p < eol && dc_substvars_space(*p); p++)
+      ;
+    if (p == eol || *p == '#')
+      continue;
+
+    /* like dpkg, only strip whitespace before a newline */
+    value = eol;
+    if (eol < end)
+    {
+      while (value > line && dc_substvars_space(value[-1]))
+        value--;
+    }
+
+    /* a name is letters, digits, '-' and ':', starting with a word char */
+    if (!isalnum((unsigned char) *line) && *line != '_')
+      return dcSyntaxErr;
+    for (p = line + 1; p < value && (isalnum((unsigned char) *p) ||
+      *p == '-' || *p == ':'); p++)
+      ;
+
+    namelen = p - line;
+    if (p < value && *p == '?')
+      p++;
+    if (p == value || *p != '=')
+      return dcSyntaxErr;
+    eq = p;
+
+    if (dc_substvars_set_n(substvars, line, namelen, eq + 1,
+      value - eq - 1) != dcNoErr)
+      return dcMemFullErr;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Read substitution variables from a file
+ *
+ * \param[in,out] substvars A pointer to the table
+ * \param[in] path The path to a substvars file
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcFileErr if the file cannot be read
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcSyntaxErr if a line is malformed; the variables before it are
+ * kept
+ */
+dcStatus dc_substvars_read_file(
+  dcSubstvars *substvars,
+  const char *path
+) {
+  dcStatus rc;
+  char *buf;
+  size_t len;
+
+  assert(substvars != NULL);
+  assert(path != NULL);
+  if (substvars == NULL || path == NULL)
+    return dcParameterErr;
+
+  buf = dc_file_read(path, &len);
+  if (buf == NULL)
+    return dcFileErr;
+
+  rc = dc_substvars_read_buffer(substvars, buf, len);
+  free(buf);
+  return rc;
+}
+
+/**
+ * Append text to the scratch buffer, expanding references (helper function)
+ *
+ * \param[in,out] substvars A pointer to the table
+ * \param[in] text The text to expand
+ * \param[in] depth The number of variables being expanded around this text
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcSyntaxErr if variables are nested too deeply
+ */
+static dcStatus dc_substvars_append(
+  dcSubstvars *substvars,
+  const char *text,
+  unsigned int depth
+) {
+  const char *ref;
+  const char *close;
+  const char *value;
+  dcStatus rc;
+
+  while ((ref = strstr(text, "${")) != NULL)
+  {
+    close = strchr(ref + 2, '}');
+    if (close == NULL)
+      break;
+
+    if (!dc_string_append_n(substvars->buf, text, ref - text))
+      return dcMemFullErr;
+
+    value = dc_substvars_get(substvars, ref + 2, close - ref - 2);
+    if (value != NULL)
+    {
+      if (depth == SUBSTVARS_DEPTH)
+        return dcSyntaxErr;
+
+      rc = dc_substvars_append(substvars, value, depth + 1);
+      if (rc != dcNoErr)
+        return rc;
+    }
+
+    text = close + 1;
+  }
+
+  if (!dc_string_append_n(substvars->buf, text, strlen(text)))
+    return dcMemFullErr;
+
+  return dcNoErr;
+}
+
+/**
+ * Determine whether a block refers to any variable (helper function)
+ *
+ * \param[in] block A pointer to a Parser Block
+ *
+ * \return Nonzero if some chunk of the block contains a reference
+ */
+static int dc_substvars_uses(
+  const dcParserBlock *block
+) {
+  const dcParserChunk *chunk;
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    if (chunk->text != NULL && strstr(chunk->text, "${") != NULL)
+      return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Expand the references in a block (helper function)
+ *
+ * \param[in,out] substvars A pointer to the table
+ * \param[in,out] block A pointer to a writable Parser Block
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcSyntaxErr if variables are nested too deeply
+ */
+static dcStatus dc_substvars_expand_block(
+  dcSubstvars *substvars,
+  dcParserBlock *block
+) {
+  dcParserChunk *chunk;
+  dcStatus rc;
+  char *text;
+
+  if (dc_parser_block_writable(block) != dcNoErr)
+    return dcMemFullErr;
+
+  /* a block keeps one arena alive, so give up text pooled in any other */
+  if (block->arena != NULL && block->arena != substvars->arena)
+  {
+    for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+    {
+      if (!chunk->pooled)
+        continue;
+
+      text = strdup(chunk->text);
+      if (text == NULL)
+        return dcMemFullErr;
+      chunk->text = text;
+      chunk->pooled = 0;
+    }
+    dc_arena_free(&block->arena);
+  }
+  if (block->arena == NULL)
+    block->arena = dc_arena_ref(substvars->arena);
+
+  for (chunk = block->head; chunk != NULL; chunk = chunk->next)
+  {
+    if (chunk->text == NULL || strstr(chunk->text, "${") == NULL)
+      continue;
+
+    substvars->buf->len = 0;
+    substvars->buf->text[0] = '\0';
+    rc = dc_substvars_append(substvars, chunk->text, 0);
+    if (rc != dcNoErr)
+      return rc;
+
+    text = dc_arena_strndup(substvars->arena, substvars->buf->text,
+      substvars->buf->len);
+    if (text == NULL)
+      return dcMemFullErr;
+
+    if (!chunk->pooled)
+      free(chunk->text);
+
+    chunk->text = text;
+    chunk->pooled = 1;
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Expand substitution variables throughout a parsed file
+ *
+ * Every reference in every field of every paragraph is replaced by the
+ * value of the variable it names. Paragraphs are made writable first (see
+ * \ref dc_parser_section_writable), and the hashes of changed paragraphs
+ * are recomputed.
+ *
+ * \param[in,out] substvars A pointer to the table
+ * \param[in,out] parser A pointer to a Parser
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if one of the parameters was invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ * \retval dcSyntaxErr if variables are nested too deeply
+ *
+ * \note After a failure, some of the references may have been expanded.
+ */
+dcStatus dc_substvars_expand(
+  dcSubstvars *substvars,
+  dcParser *parser
+) {
+  dcParserSection *section;
+  dcParserBlock *block;
+  dcStatus rc;
+
+  assert(substvars != NULL);
+  assert(parser != NULL);
+  if (substvars == NULL || parser == NULL)
+    return dcParameterErr;
+
+  for (section = parser->head; section != NULL; section = section->next)
+  {
+    for (block = section->head; block != NULL; block = block->next)
+    {
+      if (dc_substvars_uses(block))
+        break;
+    }
+    if (block == NULL)
+      continue;
+
+    section = dc_parser_section_writable(parser, section);
+    if (section == NULL)
+      return dcMemFullErr;
+
+    for (block = section->head; block != NULL; block = block->next)
+    {
+      if (!dc_substvars_uses(block))
+        continue;
+
+      rc = dc_substvars_expand_block(substvars, block);
+      if (rc != dcNoErr)
+      {
+        dc_parser_section_hash(section);
+        return rc;
+      }
+    }
+
+    dc_parser_section_hash(section);
+  }
+
+  return dcNoErr;
+}
+
+/**
+ * Destroy a substitution variable table
+ *
+ * Blocks with chunks expanded using the table keep its arena alive, so
+ * their text remains valid.
+ *
+ * \param[in,out] ptr The address of a pointer to a table
+ *
+ * \note The pointer will be set to \c NULL after memory is freed.
+ */
+void dc_substvars_free(
+  dcSubstvars **ptr
+) {
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  if ((*ptr)->table != NULL)
+    dc_hash_table_free(&(*ptr)->table);
+  if ((*ptr)->arena != NULL)
+    dc_arena_free(&(*ptr)->arena);
+  if ((*ptr)->buf != NULL)
+    dc_string_free(&(*ptr)->buf);
+
+  free(*ptr);
+  *ptr = NULL;
+}
@@ -0,0 +1,559 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Parallel processing facilities
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * Batch operations (such as validating every control file in an archive)
+ * consist of many independent work items. The routines in this file spread
+ * such work items over a number of worker threads, each of which repeatedly
+ * claims the next unprocessed item until none remain.
+ *
+ * \par Work functions
+ * Work functions must follow the prototype:
+ *
+ * \code
+ *  size_t index, void *arg
+ * \endcode
+ *
+ * - \c index, the number of the work item to process (from \c 0 up to, but
+ *   not including, the item count)
+ * - \c arg, the opaque argument given to \ref dc_parallel_run
+ *
+ * Work functions may be called concurrently from several threads, so they
+ * must not modify shared state without synchronization. Writing results into
+ * a per-item slot of an array is safe.
+ *
+ * \par NUMA
+ * On machines with several NUMA nodes (e.g. two-socket servers), memory is
+ * placed on the node of the processor that first writes to it, and reading
+ * memory on another node is slower and loads the links between sockets.
+ * So that each worker's data stays on one node, the threads started by
+ * \ref dc_parallel_run are spread round-robin over the nodes, starting from
+ * the calling thread's node, and each is bound to the processors of its
+ * node. Anything a worker allocates and fills in (such as a file it parses)
+ * is then local to that worker.
+ * Read-only data used by every worker can be replicated once per node with
+ * \ref dc_parallel_each_node (see \ref dc_index_replicate).
+ * \par
+ * The nodes and their processors are read from \c sysfs, limited to the
+ * processors this process may run on, and nodes without any are skipped.
+ * Nodes are numbered from \c 0 among the remaining ones, so these numbers
+ * may differ from the kernel's. On a machine with a single node (or where
+ * the topology is unknown), threads are not bound at all.
+ *
+ * \note If the library was built without POSIX threads support, all work is
+ * performed sequentially in the calling thread.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   /* for: cpu_set_t, pthread_setaffinity_np, etc. */
+#endif /* _GNU_SOURCE */
+
+#include <config.h>
+
+#include <stdio.h>    /* for: fopen, fgets, snprintf */
+#include <stdlib.h>   /* for: strtoul */
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>  /* for: pthread_create, pthread_mutex_lock, etc. */
+#endif /* HAVE_PTHREAD_H */
+#ifdef HAVE_SCHED_H
+#include <sched.h>    /* for: sched_getcpu, sched_getaffinity */
+#endif /* HAVE_SCHED_H */
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>   /* for: sysconf */
+#endif /* HAVE_UNISTD_H */
+
+#include <debctrl/thread.h>
+#include <debctrl/defaults.h>
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_SCHED_H) && \
+  defined(HAVE_PTHREAD_SETAFFINITY_NP) && defined(HAVE_SCHED_GETCPU) && \
+  defined(CPU_SETSIZE)
+/** Threads can be bound to the processors of a node */
+#define PARALLEL_NUMA
+#endif
+
+/**
+ * NUMA topology of the machine (internal)
+ */
+typedef struct
+{
+  unsigned int nodes; /**< Number of nodes, at least \c 1 */
+#ifdef PARALLEL_NUMA
+  cpu_set_t cpus[PARALLEL_NODES]; /**< Processors of each node */
+#endif /* PARALLEL_NUMA */
+} dcParallelTopology;
+
+/** The machine's topology, filled in by \ref dc_parallel_init */
+static dcParallelTopology dc_parallel_topology;
+
+/**
+ * Shared state of a parallel run
+ *
+ * Each worker thread holds a pointer to this structure, and claims work items
+ * by incrementing \c next while holding \c lock.
+ */
+struct _dcParallelRun
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock; /**< Protects \c next */
+#endif /* HAVE_PTHREAD_H */
+  size_t next;  /**< Next unclaimed work item */
+  size_t count; /**< Total number of work items */
+
+  void (*work)( /**< Work function */
+    size_t,
+    void *
+  );
+  void *arg;    /**< Opaque argument for the work function */
+};
+typedef struct _dcParallelRun dcParallelRun;
+
+/**
+ * State of a worker thread (internal)
+ */
+typedef struct
+{
+  dcParallelRun *run; /**< The run this worker belongs to */
+  unsigned int node; /**< Node to bind to */
+  int bind; /**< Whether to bind to \c node */
+} dcParallelWorker;
+
+#ifdef HAVE_PTHREAD_H
+/** Runs \ref dc_parallel_init once */
+static pthread_once_t dc_parallel_once = PTHREAD_ONCE_INIT;
+
+/** Key of the calling thread's \c dcParallelWorker */
+static pthread_key_t dc_parallel_key;
+#else /* !HAVE_PTHREAD_H */
+/** The \c dcParallelWorker of the running work function */
+static dcParallelWorker *dc_parallel_current;
+#endif /* HAVE_PTHREAD_H */
+
+#ifdef PARALLEL_NUMA
+/**
+ * Read a list of processors from sysfs (helper function)
+ *
+ * The list is in the kernel's format, such as \c "0-7,16-23".
+ *
+ * \param[in] path The path of the file
+ * \param[out] set The processors in the list
+ *
+ * \return Nonzero if the file was read
+ */
+static int dc_parallel_cpulist(
+  const char *path,
+  cpu_set_t *set
+) {
+  char buf[4096];
+  unsigned long first, last;
+  char *p, *end;
+  FILE *fp;
+
+  fp = fopen(path, "r");
+  if (fp == NULL)
+    return 0;
+  p = fgets(buf, sizeof(buf), fp);
+  fclose(fp);
+  if (p == NULL)
+    return 0;
+
+  CPU_ZERO(set);
+  while (*p >= '0' && *p <= '9')
+  {
+    first = last = strtoul(p, &end, 10);
+    if (*end == '-')
+      last = strtoul(end + 1, &end, 10);
+
+    for (; first <= last && first < CPU_SETSIZE; first++)
+      CPU_SET(first, set);
+
+    p = end;
+    if (*p == ',')
+      p++;
+  }
+
+  return 1;
+}
+#endif /* PARALLEL_NUMA */
+
+/**
+ * Discover the machine's topology (helper function)
+ *
+ * This is called once, before the topology is first used.
+ */
+static void dc_parallel_init(
+  void
+) {
+#ifdef PARALLEL_NUMA
+  cpu_set_t allowed;
+  cpu_set_t *cpus;
+  char path[64];
+  unsigned int nodes = 0;
+  unsigned int i;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+  {
+    for (i = 0; i < PARALLEL_NODES; i++)
+    {
+      cpus = &dc_parallel_topology.cpus[nodes];
+      snprintf(path, sizeof(path), "%s/node%u/cpulist", PARALLEL_NODE_DIR, i);
+      if (!dc_parallel_cpulist(path, cpus))
+        continue;
+
+      CPU_AND(cpus, cpus, &allowed);
+      if (CPU_COUNT(cpus) > 0)
+        nodes++;
+    }
+  }
+
+  if (nodes > 1)
+    dc_parallel_topology.nodes = nodes;
+#endif /* PARALLEL_NUMA */
+
+  if (dc_parallel_topology.nodes == 0)
+    dc_parallel_topology.nodes = 1;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_key_create(&dc_parallel_key, NULL);
+#endif /* HAVE_PTHREAD_H */
+}
+
+/**
+ * Get the calling thread's worker state (helper function)
+ *
+ * \retval NULL if the calling thread is not running a work function
+ * \return The worker state
+ */
+static dcParallelWorker * dc_parallel_self(
+  void
+) {
+#ifdef HAVE_PTHREAD_H
+  pthread_once(&dc_parallel_once, &dc_parallel_init);
+  return pthread_getspecific(dc_parallel_key);
+#else /* !HAVE_PTHREAD_H */
+  return dc_parallel_current;
+#endif /* HAVE_PTHREAD_H */
+}
+
+/**
+ * Set the calling thread's worker state (helper function)
+ *
+ * \param[in] worker The worker state, or \c NULL
+ */
+static void dc_parallel_set_self(
+  dcParallelWorker *worker
+) {
+#ifdef HAVE_PTHREAD_H
+  pthread_once(&dc_parallel_once, &dc_parallel_init);
+  pthread_setspecific(dc_parallel_key, worker);
+#else /* !HAVE_PTHREAD_H */
+  dc_parallel_current = worker;
+#endif /* HAVE_PTHREAD_H */
+}
+
+/**
+ * Bind the calling thread to the processors of a node (helper function)
+ *
+ * \param[in] node The node
+ */
+static void dc_parallel_bind(
+  unsigned int node
+) {
+#ifdef PARALLEL_NUMA
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+    &dc_parallel_topology.cpus[node]);
+#else /* !PARALLEL_NUMA */
+  (void) node;
+#endif /* PARALLEL_NUMA */
+}
+
+/**
+ * Worker thread main loop
+ *
+ * This internal routine claims and processes work items until none remain.
+ *
+ * \param[in,out] ptr A pointer to the worker's \c dcParallelWorker state
+ *
+ * \return Always \c NULL
+ */
+static void * dc_parallel_worker(
+  void *ptr
+) {
+  dcParallelWorker *worker = ptr;
+  dcParallelWorker *outer;
+  dcParallelRun *run = worker->run;
+  size_t index;
+
+  if (worker->bind)
+    dc_parallel_bind(worker->node);
+
+  /* the calling thread may itself be a worker of an enclosing run */
+  outer = dc_parallel_self();
+  dc_parallel_set_self(worker);
+
+  for (;;)
+  {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&run->lock);
+#endif /* HAVE_PTHREAD_H */
+    index = run->next;
+    if (index < run->count)
+      run->next++;
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&run->lock);
+#endif /* HAVE_PTHREAD_H */
+
+    if (index >= run->count)
+      break;
+
+    (*run->work)(index, run->arg);
+  }
+
+  dc_parallel_set_self(outer);
+
+  return NULL;
+}
+
+/**
+ * Determine the default number of worker threads
+ *
+ * This returns the number of processors currently online, which is the
+ * number of threads used by \ref dc_parallel_run unless otherwise specified.
+ *
+ * \return The number of online processors, or \c 1 if it cannot be
+ * determined
+ */
+unsigned int dc_parallel_threads(
+  void
+) {
+#if defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (n > 0)
+    return (unsigned int) n;
+#endif /* HAVE_SYSCONF */
+
+  return 1;
+}
+
+/**
+ * Determine the number of NUMA nodes
+ *
+ * \return The number of nodes whose processors this process may use, or
+ * \c 1 if the topology cannot be determined
+ */
+unsigned int dc_parallel_nodes(
+  void
+) {
+#ifdef HAVE_PTHREAD_H
+  pthread_once(&dc_parallel_once, &dc_parallel_init);
+#else /* !HAVE_PTHREAD_H */
+  if (dc_parallel_topology.nodes == 0)
+    dc_parallel_init();
+#endif /* HAVE_PTHREAD_H */
+
+  return dc_parallel_topology.nodes;
+}
+
+/**
+ * Determine the NUMA node of the calling thread
+ *
+ * This is the node of the processor the thread is currently running on.
+ * Unless the thread is bound to a node (as the threads started by
+ * \ref dc_parallel_run are), it may move to another node at any time, so
+ * the result is only a hint.
+ *
+ * \return The node, from \c 0 up to, but not including,
+ * \ref dc_parallel_nodes
+ */
+unsigned int dc_parallel_node(
+  void
+) {
+#ifdef PARALLEL_NUMA
+  unsigned int i;
+  int cpu;
+
+  if (dc_parallel_nodes() > 1)
+  {
+    cpu = sched_getcpu();
+    for (i = 0; cpu >= 0 && i < dc_parallel_topology.nodes; i++)
+    {
+      if (CPU_ISSET(cpu, &dc_parallel_topology.cpus[i]))
+        return i;
+    }
+  }
+#endif /* PARALLEL_NUMA */
+
+  return 0;
+}
+
+/**
+ * Call a function once on each NUMA node
+ *
+ * This calls \c work once for each node, with the number of the node as
+ * its index, from a thread bound to the processors of that node. Memory the
+ * work function allocates and fills in is therefore placed on that node,
+ * which makes this suitable for building per-node copies of read-only data.
+ *
+ * The nodes are visited one at a time, so the calls may share state without
+ * synchronization. On a machine with a single node, \c work is called once,
+ * from the calling thread.
+ *
+ * \param[in] work The work function to call for each node
+ * \param[in] arg An opaque argument passed to each call of \c work
+ */
+void dc_parallel_each_node(
+  void (*work)(
+    size_t,
+    void *
+  ),
+  void *arg
+) {
+  unsigned int nodes = dc_parallel_nodes();
+  dcParallelWorker worker;
+  dcParallelRun run;
+  unsigned int i;
+
+  assert(work != NULL);
+
+  run.work = work;
+  run.arg = arg;
+
+  worker.run = &run;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init(&run.lock, NULL);
+#endif /* HAVE_PTHREAD_H */
+
+  for (i = 0; i < nodes; i++)
+  {
+    /* the work function sees the node as the index of its only item */
+    run.next = i;
+    run.count = (size_t) i + 1;
+    worker.node = i;
+    worker.bind = (nodes > 1);
+
+#ifdef HAVE_PTHREAD_H
+    {
+      pthread_t tid;
+
+      if (worker.bind &&
+        pthread_create(&tid, NULL, &dc_parallel_worker, &worker) == 0)
+      {
+        pthread_join(tid, NULL);
+        continue;
+      }
+    }
+#endif /* HAVE_PTHREAD_H */
+
+    /* unbound, if a thread could not be started */
+    worker.bind = 0;
+    dc_parallel_worker(&worker);
+  }
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy(&run.lock);
+#endif /* HAVE_PTHREAD_H */
+}
+
+/**
+ * Process a number of independent work items in parallel
+ *
+ * This routine calls \c work once for each item from \c 0 to \c count-1,
+ * spreading the calls over up to \c threads threads (including the calling
+ * thread). It returns once all of the work items have been processed.
+ *
+ * \param[in] count The number of work items
+ * \param[in] threads The maximum number of threads to use. Using \c 0 will
+ * use one thread per online processor (see \ref dc_parallel_threads).
+ * \param[in] work The work function to call for each item
+ * \param[in] arg An opaque argument passed to each call of \c work
+ *
+ * \note If additional threads cannot be created, the remaining work is done
+ * by the threads that were started successfully, so all of the work items
+ * are still processed.
+ *
+ * \note On machines with several NUMA nodes, the threads started are each
+ * bound to a node (see \ref thread.c).
+ */
+void dc_parallel_run(
+  size_t count,
+  unsigned int threads,
+  void (*work)(
+    size_t,
+    void *
+  ),
+  void *arg
+) {
+  dcParallelWorker self;
+  dcParallelRun run;
+
+  assert(work != NULL);
+
+  if (count == 0)
+    return;
+
+  run.next = 0;
+  run.count = count;
+  run.work = work;
+  run.arg = arg;
+
+  if (threads == 0)
+    threads = dc_parallel_threads();
+  if (threads > count)
+    threads = (unsigned int) count;
+
+  /* the calling thread acts as one of the workers, and stays where it is */
+  self.run = &run;
+  self.node = dc_parallel_node();
+  self.bind = 0;
+
+#ifdef HAVE_PTHREAD_H
+  {
+    dcParallelWorker *workers = NULL;
+    unsigned int nodes = dc_parallel_nodes();
+    pthread_t *tids = NULL;
+    unsigned int started = 0;
+    unsigned int i;
+
+    pthread_mutex_init(&run.lock, NULL);
+
+    if (threads > 1)
+    {
+      tids = malloc((threads - 1) * sizeof(pthread_t));
+      workers = malloc((threads - 1) * sizeof(dcParallelWorker));
+    }
+
+    if (tids != NULL && workers != NULL)
+    {
+      for (started = 0; started < threads - 1; started++)
+      {
+        workers[started].run = &run;
+        workers[started].node = (self.node + started + 1) % nodes;
+        workers[started].bind = (nodes > 1);
+
+        if (pthread_create(&tids[started], NULL, &dc_parallel_worker,
+          &workers[started]) != 0)
+          break;
+      }
+    }
+
+    dc_parallel_worker(&self);
+
+    for (i = 0; i < started; i++)
+      pthread_join(tids[i], NULL);
+
+    free(tids);
+    free(workers);
+    pthread_mutex_destroy(&run.lock);
+  }
+#else /* !HAVE_PTHREAD_H */
+  dc_parallel_worker(&self);
+#endif /* HAVE_PTHREAD_H */
+}
@@ -0,0 +1,303 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Upgrade computation
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * This computes which installed packages have newer versions available in a
+ * set of package indexes (\c Packages files), by joining the records of a
+ * \ref dcDpkgStatus with the index paragraphs on (Package, Architecture).
+ *
+ * \par Algorithm
+ * The join is a hash join: the status database already indexes its records
+ * by package name, so each index paragraph is matched with a single hash
+ * lookup, and the whole computation takes time linear in the number of
+ * records and paragraphs.
+ * \par
+ * Versions are compared using keys from \ref dc_version_key, so each
+ * installed version is decoded once (when it is first matched) rather than
+ * once per comparison. Candidate versions are decoded into a buffer on the
+ * stack, and only copied when they are the newest seen so far. This keeps
+ * memory use small, which matters on low-powered machines.
+ */
+
+#include <string.h>   /* for: strcmp, strlen, memcpy */
+
+#include <debctrl/upgrade.h>
+#include <debctrl/hash.h>
+#include <debctrl/version.h>
+
+/**
+ * Join state for an installed package (internal)
+ */
+typedef struct
+{
+  unsigned char *key; /**< Key of the installed version, once computed */
+  size_t len; /**< Length of \c key */
+  unsigned char *best; /**< Key of the newest candidate so far, if any */
+  size_t blen; /**< Length of \c best */
+
+  dcParserSection *candidate; /**< Paragraph of the newest candidate */
+  const char *version; /**< Version of the newest candidate */
+} dcUpgradeState;
+
+/**
+ * Look up the value of a single-line field (helper function)
+ *
+ * \param[in] section A pointer to a Parser Section
+ * \param[in] field The name of the field
+ *
+ * \retval NULL if the field is missing or empty
+ * \return The field's value
+ */
+static const char * dc_upgrade_field(
+  dcParserSection *section,
+  const char *field
+) {
+  dcParserBlock *block = dc_parser_section_find(section, field);
+
+  if (block == NULL || block->head == NULL)
+    return NULL;
+
+  return block->head->text;
+}
+
+/**
+ * Compute a version key into a new buffer (helper function)
+ *
+ * \param[in] vstring A package version in string format
+ * \param[in] buf A buffer already holding the key (or \c NULL to compute it)
+ * \param[in,out] len The length of the key in \c buf; set to the length of
+ * the key
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return A dynamically allocated copy of the key
+ */
+static unsigned char * dc_upgrade_key(
+  const char *vstring,
+  const unsigned char *buf,
+  size_t *len
+) {
+  unsigned char *key;
+
+  if (buf == NULL)
+    *len = dc_version_key(vstring, NULL, 0);
+
+  key = malloc(*len);
+  if (key == NULL)
+    return NULL;
+
+  if (buf != NULL)
+    memcpy(key, buf, *len);
+  else
+    dc_version_key(vstring, key, *len);
+
+  return key;
+}
+
+/**
+ * Match an index paragraph against the installed packages (helper)
+ *
+ * \param[in] status A pointer to a dpkg status database
+ * \param[in,out] state Join state, indexed like \c status->entries
+ * \param[in] section The index paragraph
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ */
+static dcStatus dc_upgrade_match(
+  const dcDpkgStatus *status,
+  dcUpgradeState *state,
+  dcParserSection *section
+) {
+  unsigned char buf[VERSION_KEY_SIZE];
+  unsigned char *key = buf;
+  const char *package;
+  const char *arch;
+  const char *version;
+  dcDpkgEntry *entry;
+  dcUpgradeState *st;
+  size_t iter = 0;
+  size_t len;
+  dcStatus rc = dcNoErr;
+
+  package = dc_upgrade_field(section, "Package");
+  version = dc_upgrade_field(section, "Version");
+  if (package == NULL || version == NULL)
+    return dcNoErr;
+
+  arch = dc_upgrade_field(section, "Architecture");
+  if (arch == NULL)
+    arch = "";
+
+  while ((entry = dc_hash_table_find(status->packages,
+    dc_hash(package, strlen(package)), &iter)) != NULL)
+  {
+    if (strcmp(entry->package, package) == 0 &&
+      strcmp(entry->arch, arch) == 0)
+      break;
+  }
+  if (entry == NULL)
+    return dcNoErr;
+
+  st = &state[entry->index];
+  if (st->key == NULL)
+  {
+    const char *installed = dc_upgrade_field(entry->section, "Version");
+    const char *current = dc_upgrade_field(entry->section, "Status");
+
+    /* only consider packages which are actually installed */
+    if (installed == NULL || current == NULL ||
+      strlen(current) < 10 ||
+      strcmp(current + strlen(current) - 10, " installed") != 0)
+      return dcNoErr;
+
+    st->key = dc_upgrade_key(installed, NULL, &st->len);
+    if (st->key == NULL)
+      return dcMemFullErr;
+  }
+
+  len = dc_version_key(version, buf, sizeof(buf));
+  if (len > sizeof(buf))
+  {
+    key = malloc(len);
+    if (key == NULL)
+      return dcMemFullErr;
+    dc_version_key(version, key, len);
+  }
+
+  /* newer than what is installed, and than any other candidate? */
+  if (dc_version_key_compare(key, len, st->key, st->len) > 0 &&
+    (st->best == NULL ||
+    dc_version_key_compare(key, len, st->best, st->blen) > 0))
+  {
+    free(st->best);
+    st->best = dc_upgrade_key(version, key, &len);
+    st->blen = len;
+    st->candidate = section;
+    st->version = version;
+    if (st->best == NULL)
+    {
+      st->candidate = NULL;
+      rc = dcMemFullErr;
+    }
+  }
+
+  if (key != buf)
+    free(key);
+
+  return rc;
+}
+
+/**
+ * Compute the available upgrades for installed packages
+ *
+ * This finds, for each installed package in a dpkg status database, the
+ * newest version of the same package and architecture in a set of package
+ * indexes, if it is newer than the installed version. See \ref upgrade.c
+ * for details.
+ *
+ * Example:
+ * \code
+ * rc = dc_upgrade_compute(status, indexes, 2, &upgrades, &n);
+ * for (i = 0; i < n; i++)
+ *   printf("%s %s -> %s\n", upgrades[i].installed->package,
+ *     upgrades[i].installed_version, upgrades[i].version);
+ * free(upgrades);
+ * \endcode
+ *
+ * \param[in] status A pointer to a dpkg status database, which has been read
+ * using \ref dc_dpkg_status_read
+ * \param[in] indexes An array of Parser instances holding package indexes
+ * \param[in] count The number of elements in \c indexes
+ * \param[out] upgrades Set to a dynamically allocated array of upgrades, in
+ * the order of the status database, or \c NULL if there are none. It should
+ * be released using \c free.
+ * \param[out] n Set to the number of upgrades
+ *
+ * \retval dcNoErr if the operation completed successfully
+ * \retval dcParameterErr if the input parameters are invalid
+ * \retval dcMemFullErr if there was a failure to allocate memory
+ *
+ * \note The upgrades point into \c status and \c indexes, so they remain
+ * valid only while both do.
+ *
+ * \note Only packages whose \c Status is "installed" are considered.
+ */
+dcStatus dc_upgrade_compute(
+  const dcDpkgStatus *status,
+  dcParser * const *indexes,
+  size_t count,
+  dcUpgrade **upgrades,
+  size_t *n
+) {
+  dcUpgradeState *state;
+  dcParserSection *section;
+  size_t found = 0;
+  size_t i;
+  dcStatus rc = dcNoErr;
+
+  assert(status != NULL);
+  assert(indexes != NULL || count == 0);
+  assert(upgrades != NULL);
+  assert(n != NULL);
+
+  if (status == NULL || (indexes == NULL && count != 0) || upgrades == NULL ||
+    n == NULL)
+    return dcParameterErr;
+
+  *upgrades = NULL;
+  *n = 0;
+
+  if (status->count == 0 || status->packages == NULL)
+    return dcNoErr;
+
+  state = calloc(status->count, sizeof(dcUpgradeState));
+  if (state == NULL)
+    return dcMemFullErr;
+
+  for (i = 0; i < count && rc == dcNoErr; i++)
+  {
+    section = indexes[i]->head;
+    for (; section != NULL && rc == dcNoErr; section = section->next)
+      rc = dc_upgrade_match(status, state, section);
+  }
+
+  for (i = 0; i < status->count; i++)
+  {
+    if (state[i].candidate != NULL)
+      found++;
+  }
+
+  if (rc == dcNoErr && found > 0)
+  {
+    *upgrades = malloc(found * sizeof(dcUpgrade));
+    if (*upgrades == NULL)
+      rc = dcMemFullErr;
+  }
+
+  for (i = 0; i < status->count; i++)
+  {
+    if (rc == dcNoErr && state[i].candidate != NULL)
+    {
+      dcUpgrade *upgrade = &(*upgrades)[(*n)++];
+
+      upgrade->installed = status->entries[i];
+      upgrade->candidate = state[i].candidate;
+      upgrade->installed_version = dc_upgrade_field(
+        status->entries[i]->section, "Version");
+      upgrade->version = state[i].version;
+    }
+
+    free(state[i].key);
+    free(state[i].best);
+  }
+
+  free(state);
+
+  return rc;
+}
@@ -10,15 +10,70 @@
  *
  * This provides utilities for:
  * - string manipulation
+ * - reading whole files into memory
+ * - arena allocation
  *
  * These utilities are used internally by libdebctrl, and may also be useful
  * externally.
  */
 
-#include <string.h> /* for: strlen, strcat, etc. */
+#include <string.h> /* for: strlen, memcpy, etc. */
+#include <stdio.h>  /* for: fopen, fread, etc. */
+#include <sys/stat.h> /* for: fstat, fchmod */
+#include <errno.h>  /* for: errno */
+#include <stdlib.h> /* for: mkstemp */
+#include <unistd.h> /* for: close, unlink */
 
 #include <debctrl/util.h>
 
+/** Default initial size of a String (see \ref dc_string_tune) */
+static size_t dc_string_init_size = STRING_INIT_SIZE;
+
+/** Minimum growth of a String (see \ref dc_string_tune) */
+static size_t dc_string_step_size = STRING_STEP_SIZE;
+
+/** Minimum size of an arena block (see \ref dc_arena_tune) */
+static size_t dc_arena_block_size = ARENA_BLOCK_SIZE;
+
+/**
+ * Read a tuned size (helper function)
+ *
+ * Tuned sizes may be changed by one thread while others are allocating, so
+ * they are read atomically where the compiler supports it. Nothing else is
+ * ordered by them, so a relaxed load is enough.
+ *
+ * \param[in] size A pointer to the tuned size
+ *
+ * 
+eturn The current value of the size
+ */
+static size_t dc_tune_load(
+  const size_t *size
+) {
+#ifdef __ATOMIC_RELAXED
+  return __atomic_load_n(size, __ATOMIC_RELAXED);
+#else
+  return *size;
+#endif
+}
+
+/**
+ * Change a tuned size (helper function)
+ *
+ * \param[out] size A pointer to the tuned size
+ * \param[in] value The new value of the size
+ */
+static void dc_tune_store(
+  size_t *size,
+  size_t value
+) {
+#ifdef __ATOMIC_RELAXED
+  __atomic_store_n(size, value, __ATOMIC_RELAXED);
+#else
+  *size = value;
+#endif
+}
+
 /**
  * Strip trailing whitespace characters
  *
@@ -134,7 +189,8 @@ char * dc_strndup(
  * \ref dc_string_append, the string will be automatically expanded as needed.
  *
  * \param[in] size The size (in bytes) of the buffer to allocate initially.
- * Using \c 0 will use a default size (\c STRING_INIT_SIZE bytes).
+ * Using \c 0 will use a default size (\c STRING_INIT_SIZE bytes, unless
+ * changed with \ref dc_string_tune).
  *
  * \retval NULL if there is a failure to allocate memory (either for dcString
  * or its internal buffer space, dcString::text)
@@ -149,7 +205,7 @@ dcString * dc_string_new(
     return NULL;
 
   if (size == 0)
-    size = STRING_INIT_SIZE;
+    size = dc_tune_load(&dc_string_init_size);
 
   string->text = malloc(size);
   if (string->text == NULL)
@@ -172,7 +228,10 @@ dcString * dc_string_new(
  *
  * This function resizes the internal buffer (dcString::text) of a dcString,
  * so that it is at least \c size bytes large. If additional space is needed,
- * it will be allocated in chunks \c INIT_STEP_SIZE large.
+ * the buffer grows by at least half of its size (and at least
+ * \c STRING_STEP_SIZE bytes, unless changed with \ref dc_string_tune), so
+ * that building a large string by repeated appends takes amortized linear
+ * time.
  *
  * If \c size is \c 0, the string buffer will be trimmed down to the amount
  * needed for the string, and excess memory will be freed.
@@ -191,6 +250,7 @@ int dc_string_resize(
 ) {
   char *tmp;
   size_t bufsize;
+  size_t step;
 
   assert(string != NULL);
   assert(string->text != NULL);
@@ -203,9 +263,12 @@ int dc_string_resize(
   {
     bufsize = string->size;
 
-    while (bufsize < size)
+    if (bufsize < size)
     {
-      bufsize += STRING_STEP_SIZE;
+      step = dc_tune_load(&dc_string_step_size);
+      bufsize += (bufsize / 2 > step) ? bufsize / 2 : step;
+      if (bufsize < size)
+        bufsize = size;
     }
   }
 
@@ -264,10 +327,51 @@ void dc_string_append(
   }
 
   /* we are guaranteed to have sufficient space */
-  strcat(string->text, text);
+  memcpy(string->text + string->len, text, len + 1);
   string->len += len;
 }
 
+/**
+ * Append a block of bytes to a dcString
+ *
+ * This method appends \c len bytes to the end of a dcString, expanding the
+ * internal buffer if necessary (using \ref dc_string_resize). Unlike
+ * \ref dc_string_append, the data may contain \c NUL bytes, so it may be
+ * used to build binary data.
+ *
+ * \param[in] string A dcString for which data will be appended
+ * \param[in] text The data to append
+ * \param[in] len The number of bytes to append
+ *
+ * \retval 0 if there is a failure to allocate memory (the string is left
+ * unchanged)
+ * \retval 1 if the data was appended
+ */
+int dc_string_append_n(
+  dcString *string,
+  const char *text,
+  size_t len
+) {
+  assert(string != NULL);
+  assert(string->text != NULL);
+  assert(text != NULL || len == 0);
+
+  /* ensure we have enough space in our buffer, expand if needed */
+  if ((string->len + len) >= string->size)
+  {
+    if (dc_string_resize(string, string->len + len + 1) == 0)
+      return 0;
+  }
+
+  /* text may be NULL when len is 0, which memcpy does not allow */
+  if (len > 0)
+    memcpy(string->text + string->len, text, len);
+  string->len += len;
+  string->text[string->len] = '\0';
+
+  return 1;
+}
+
 /**
  * Append a character to a dcString
  *
@@ -303,6 +407,30 @@ void dc_string_append_c(
   string->text[string->len]   = '\0';
 }
 
+/**
+ * Change the default sizes of Strings
+ *
+ * This replaces \c STRING_INIT_SIZE and \c STRING_STEP_SIZE for strings
+ * created or grown from now on, usually with sizes measured from the
+ * input (see \ref dc_parser_stats_apply).
+ *
+ * \param[in] init The initial size of new strings, or \c 0 to restore
+ * \c STRING_INIT_SIZE
+ * \param[in] step The minimum growth of strings, or \c 0 to restore
+ * \c STRING_STEP_SIZE
+ *
+ * \note The sizes are shared by the whole process. Strings being created
+ * or grown by other threads at the same time get either the old or the new
+ * sizes.
+ */
+void dc_string_tune(
+  size_t init,
+  size_t step
+) {
+  dc_tune_store(&dc_string_init_size, (init == 0) ? STRING_INIT_SIZE : init);
+  dc_tune_store(&dc_string_step_size, (step == 0) ? STRING_STEP_SIZE : step);
+}
+
 /**
  * Destroy a dcString
  *
@@ -324,3 +452,312 @@ void dc_string_free(
   free(*ptr);
   *ptr = NULL;
 }
+
+/**
+ * Read the entire contents of a file into memory
+ *
+ * The file's size is used to allocate the buffer up front, so it is usually
+ * read with a single allocation; if the file grows while being read (or its
+ * size is unknown, e.g. for a pipe), the buffer is grown geometrically.
+ *
+ * \param[in] path The path to the file to read
+ * \param[out] len The length of the contents, in bytes
+ *
+ * \retval NULL if the file cannot be read, or there is a failure to allocate
+ * memory; \c errno indicates the reason
+ * \return A dynamically allocated buffer holding the contents, followed by a
+ * \c NUL byte (which is not included in \c len)
+ */
+char * dc_file_read(
+  const char *path,
+  size_t *len
+) {
+  FILE *fp;
+  struct stat st;
+  char *buf;
+  char *tmp;
+  size_t size = dc_tune_load(&dc_string_init_size);
+  size_t n;
+
+  assert(path != NULL);
+  assert(len != NULL);
+
+  fp = fopen(path, "rb");
+  if (fp == NULL)
+    return NULL;
+
+  /* leave room to detect growth, and for the NUL byte */
+  if (fstat(fileno(fp), &st) == 0 && st.st_size > 0)
+    size = (size_t) st.st_size + 2;
+
+  buf = malloc(size);
+  if (buf == NULL)
+  {
+    fclose(fp);
+    return NULL;
+  }
+
+  *len = 0;
+  while ((n = fread(buf + *len, 1, size - *len - 1, fp)) > 0)
+  {
+    *len += n;
+    if (*len + 1 < size)
+      continue;
+
+    tmp = realloc(buf, size * 2);
+    if (tmp == NULL)
+    {
+      free(buf);
+      fclose(fp);
+      return NULL;
+    }
+    buf = tmp;
+    size *= 2;
+  }
+
+  if (ferror(fp))
+  {
+    free(buf);
+    fclose(fp);
+    return NULL;
+  }
+
+  fclose(fp);
+  buf[*len] = '\0';
+  return buf;
+}
+
+/**
+ * Create a temporary file to replace another
+ *
+ * The file is created with a unique name in the same directory as \c path,
+ * so that it can later be renamed over it. It is given the permissions of
+ * \c path, or \c 0644 if \c path does not exist yet.
+ *
+ * \param[in] path The path to the file that will be replaced
+ * \param[out] tmp The path to the temporary file, which must be freed by the
+ * caller (and removed, unless it is renamed); set to \c NULL on failure
+ *
+ * \retval NULL if the file cannot be created, or there is a failure to
+ * allocate memory; \c errno indicates the reason
+ * \return The temporary file, open for writing
+ */
+FILE * dc_file_temp(
+  const char *path,
+  char **tmp
+) {
+  FILE *fp;
+  struct stat st;
+  mode_t mode = 0644;
+  int fd;
+  int err;
+
+  assert(path != NULL);
+  assert(tmp != NULL);
+
+  *tmp = malloc(strlen(path) + sizeof(".XXXXXX"));
+  if (*tmp == NULL)
+    return NULL;
+  strcpy(*tmp, path);
+  strcat(*tmp, ".XXXXXX");
+
+  if (stat(path, &st) == 0)
+    mode = st.st_mode & 07777;
+
+  fd = mkstemp(*tmp);
+  if (fd < 0)
+    goto err;
+
+  if (fchmod(fd, mode) != 0)
+  {
+    err = errno;
+    close(fd);
+    unlink(*tmp);
+    errno = err;
+    goto err;
+  }
+
+  fp = fdopen(fd, "wb");
+  if (fp == NULL)
+  {
+    err = errno;
+    close(fd);
+    unlink(*tmp);
+    errno = err;
+    goto err;
+  }
+
+  return fp;
+
+err:
+  err = errno;
+  free(*tmp);
+  *tmp = NULL;
+  errno = err;
+  return NULL;
+}
+
+/**
+ * Construct an arena
+ *
+ * The arena starts with a single reference, held by the caller.
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return a dynamically allocated dcArena object
+ */
+dcArena * dc_arena_new(
+  void
+) {
+  dcArena *arena = NEW(dcArena);
+
+  if (arena == NULL)
+    return NULL;
+
+  arena->blocks = NULL;
+  arena->next = NULL;
+  arena->avail = 0;
+  arena->refs = 1;
+
+  return arena;
+}
+
+/**
+ * Allocate memory from an arena
+ *
+ * The memory is suitably aligned for any type, and remains valid until the
+ * last reference to the arena is dropped.
+ *
+ * \param[in,out] arena A pointer to an arena
+ * \param[in] size The number of bytes to allocate
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return A pointer to the memory
+ */
+void * dc_arena_alloc(
+  dcArena *arena,
+  size_t size
+) {
+  const size_t header = sizeof(uint64_t);
+  size_t block;
+  char *mem;
+
+  assert(arena != NULL);
+
+  /* keep every allocation aligned to eight bytes */
+  size = (size + 7) & ~(size_t) 7;
+
+  if (size > arena->avail)
+  {
+    block = dc_tune_load(&dc_arena_block_size);
+    block = header + ((size > block) ? size : block);
+    mem = malloc(block);
+    if (mem == NULL)
+      return NULL;
+
+    *(void **) mem = arena->blocks;
+    arena->blocks = mem;
+    arena->next = mem + header;
+    arena->avail = block - header;
+  }
+
+  mem = arena->next;
+  arena->next += size;
+  arena->avail -= size;
+  return mem;
+}
+
+/**
+ * Copy text into an arena
+ *
+ * \param[in,out] arena A pointer to an arena
+ * \param[in] text The text to copy (need not be \c NUL terminated)
+ * \param[in] len The number of bytes to copy
+ *
+ * \retval NULL if there is a failure to allocate memory
+ * \return A \c NUL terminated copy of the text
+ */
+char * dc_arena_strndup(
+  dcArena *arena,
+  const char *text,
+  size_t len
+) {
+  char *copy;
+
+  assert(arena != NULL);
+  assert(text != NULL || len == 0);
+
+  copy = dc_arena_alloc(arena, len + 1);
+  if (copy == NULL)
+    return NULL;
+
+  memcpy(copy, text, len);
+  copy[len] = '\0';
+  return copy;
+}
+
+/**
+ * Take a reference to an arena
+ *
+ * \param[in,out] arena A pointer to an arena
+ *
+ * \return The arena (same as \c arena)
+ */
+dcArena * dc_arena_ref(
+  dcArena *arena
+) {
+  assert(arena != NULL);
+
+  arena->refs++;
+  return arena;
+}
+
+/**
+ * Change the size of arena blocks
+ *
+ * This replaces \c ARENA_BLOCK_SIZE for blocks allocated from now on,
+ * usually with a size measured from the input (see
+ * \ref dc_parser_stats_apply).
+ *
+ * \param[in] size The minimum size of a block, or \c 0 to restore
+ * \c ARENA_BLOCK_SIZE
+ *
+ * \note The size is shared by the whole process. Arenas allocating blocks
+ * in other threads at the same time get either the old or the new size.
+ */
+void dc_arena_tune(
+  size_t size
+) {
+  dc_tune_store(&dc_arena_block_size, (size == 0) ? ARENA_BLOCK_SIZE : size);
+}
+
+/**
+ * Drop a reference to an arena
+ *
+ * When the last reference is dropped, the arena and all memory allocated
+ * from it are freed.
+ *
+ * \param[in,out] ptr The address of a pointer to an arena
+ *
+ * \note The pointer will be set to \c NULL, whether or not memory is freed.
+ */
+void dc_arena_free(
+  dcArena **ptr
+) {
+  void *block;
+
+  assert(ptr != NULL);
+  assert(*ptr != NULL);
+
+  if (--(*ptr)->refs == 0)
+  {
+    while ((*ptr)->blocks != NULL)
+    {
+      block = (*ptr)->blocks;
+      (*ptr)->blocks = *(void **) block;
+      free(block);
+    }
+    free(*ptr);
+  }
+
+  *ptr = NULL;
+}
@@ -21,6 +21,7 @@
 #include <ctype.h>    /* for: various isalpha/etc functions */
 
 #include <debctrl/validate.h>
+#include <debctrl/version.h> /* for: dcVersion */
 
 /**
  * Validate a package name
@@ -65,8 +66,8 @@ dcStatus dc_valid_package(
    * character.
    */
   if (!(
-    islower(*name) ||
-    isdigit(*name)
+    islower((unsigned char) *name) ||
+    isdigit((unsigned char) *name)
   )) {
     return dcPackagePrefixErr;
   }
@@ -78,8 +79,8 @@ dcStatus dc_valid_package(
   while (*name != '\0')
   {
     if (!(
-      islower(*name) ||
-      isdigit(*name) ||
+      islower((unsigned char) *name) ||
+      isdigit((unsigned char) *name) ||
       *name == '+' ||
       *name == '-' ||
       *name == '.'
@@ -109,10 +110,19 @@ dcStatus dc_valid_package(
  *   '+', '.' and '~'. If it is omitted (e.g. for Debian native packages),
  *   then the upstream version may not contain any '-' characters.
  *
- * \param[in,out] version A version object to validate
+ * \param[in] version A version object to validate
  *
  * \retval dcNoErr if the version appears valid
  * \retval dcParameterErr if the \c version is \c NULL
+ * \retval dcVersionPrefixErr if the upstream version does not begin with a
+ * digit
+ * \retval dcVersionUpstreamErr if the upstream version is empty or contains
+ * invalid characters
+ * \retval dcVersionRevisionErr if the Debian revision is empty or contains
+ * invalid characters
+ *
+ * \note The epoch is checked by \ref dc_version_set when the version string
+ * is split into its components, so it is not checked again here.
  *
  * \see "5.6.12 Version", from the Debian Policy Manual:
  * http://www.debian.org/doc/debian-policy/ch-controlfields.html#s-f-Version
@@ -120,27 +130,60 @@ dcStatus dc_valid_package(
 dcStatus dc_valid_version(
   const dcVersion *version
 ) {
+  const char *ptr;
+
   assert(version != NULL);
 
   if (version == NULL)
     return dcParameterErr;
 
-/*
-  if (version->valid)
-    return dcNoErr;
+  ptr = version->version;
+  if (ptr == NULL || *ptr == '\0')
+    return dcVersionUpstreamErr;
 
+  /* The upstream version should start with a digit */
+  if (!isdigit((unsigned char) *ptr))
+    return dcVersionPrefixErr;
 
- * - The epoch is a (generally small) unsigned integer. If it is omitted,
- *   an epoch of zero is assumed and the upstream version may not contain
- *   any ':' characters.
- * - The upstream version may contain alphabetic, numeric and the '.', '+',
- *   '-', ':' and '~' characters.
- * - The Debian revision may contain alphabetic, numeric and the characters
- *   '+', '.' and '~'. If it is omitted (e.g. for Debian native packages),
- *   then the upstream version may not contain any '-' characters.
- *
+  /* The upstream version may contain alphanumerics and '.', '+', '~', plus
+   * ':' (only if an epoch was given, since it has already been removed) and
+   * '-' (the revision has already been removed at the last hyphen).
+   */
+  while (*ptr != '\0')
+  {
+    if (!(
+      isalnum((unsigned char) *ptr) ||
+      *ptr == '.' ||
+      *ptr == '+' ||
+      *ptr == '~' ||
+      (*ptr == ':' && version->hasepoch) ||
+      *ptr == '-'
+    )) {
+      return dcVersionUpstreamErr;
+    }
+    ptr++;
+  }
+
+  /* Debian native packages have no revision */
+  ptr = version->revision;
+  if (ptr == NULL)
+    return dcNoErr;
 
-*/
+  if (*ptr == '\0')
+    return dcVersionRevisionErr;
+
+  while (*ptr != '\0')
+  {
+    if (!(
+      isalnum((unsigned char) *ptr) ||
+      *ptr == '.' ||
+      *ptr == '+' ||
+      *ptr == '~'
+    )) {
+      return dcVersionRevisionErr;
+    }
+    ptr++;
+  }
 
   return dcNoErr;
 }
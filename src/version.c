@@ -11,6 +11,25 @@
  * This package provides a representation of a package version, as well as
  * some utilities to manipulate and compare them.
  *
+ * \par Version Comparison
+ * Versions are ordered as dpkg orders them: by epoch, then upstream version,
+ * then Debian revision. The latter two are compared by alternately comparing
+ * runs of non-digits (character by character, where \c ~ sorts before
+ * everything, even the end of the string, and letters sort before other
+ * characters) and runs of digits (numerically).
+ *
+ * \par Version Keys
+ * When one version is compared with many others (e.g. when searching package
+ * indexes for upgrades), \ref dc_version_key can precompute a byte string
+ * for each version, such that comparing two keys with \c memcmp gives the
+ * same result as \ref dc_version_compare. Each run of non-digits becomes one
+ * weight byte per character followed by a terminator (which sorts after
+ * \c ~, but before any other character), and each run of digits becomes its
+ * number of significant digits (in one byte, or nine for runs of 255 digits
+ * or more) followed by the digits themselves.
+ *
+ * \see dpkg's lib/dpkg/version.c, which defines the comparison algorithm
+ *
  * \see "5.6.12 Version", from the Debian Policy Manual:
  * http://www.debian.org/doc/debian-policy/ch-controlfields.html#s-f-Version
  */
@@ -42,6 +61,7 @@ dcVersion * dc_version_new(
     return NULL;
 
   version->epoch = 0;
+  version->hasepoch = 0;
   version->version = NULL;
   version->revision = NULL;
 
@@ -87,6 +107,8 @@ dcStatus dc_version_set(
 
   if (*ptr == ':')
   {
+    version->hasepoch = 1;
+
     /* ensure epoch contains only numeric characters */
     ptr = vstring;
     while (*ptr != ':')
@@ -150,6 +172,7 @@ void dc_version_clear(
   assert(version != NULL);
 
   version->epoch = 0;
+  version->hasepoch = 0;
 
   free(version->version);
   version->version = NULL;
@@ -179,3 +202,308 @@ void dc_version_free(
   free(*ptr);
   *ptr = NULL;
 }
+
+/**
+ * Determine whether a character is a digit (helper function)
+ *
+ * Like dpkg, this only considers ASCII, whatever the locale.
+ *
+ * \param[in] c A character
+ *
+ * \return Nonzero if \c c is an ASCII digit
+ */
+static int dc_version_isdigit(
+  unsigned char c
+) {
+  return (c >= '0' && c <= '9');
+}
+
+/**
+ * Determine whether a character is a letter (helper function)
+ *
+ * \param[in] c A character
+ *
+ * \return Nonzero if \c c is an ASCII letter
+ */
+static int dc_version_isalpha(
+  unsigned char c
+) {
+  return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'));
+}
+
+/**
+ * Determine the sort weight of a character in a version (helper function)
+ *
+ * \param[in] c A character, or \c NUL for the end of a run of non-digits
+ *
+ * \return The weight of the character, following dpkg
+ */
+static int dc_version_order(
+  unsigned char c
+) {
+  if (dc_version_isdigit(c))
+    return 0;
+  else if (dc_version_isalpha(c))
+    return c;
+  else if (c == '~')
+    return -1;
+  else if (c)
+    return c + 256;
+  else
+    return 0;
+}
+
+/**
+ * Compare upstream versions or revisions (helper function)
+ *
+ * \param[in] a The first string, or \c NULL (equivalent to an empty string)
+ * \param[in] b The second string, or \c NULL
+ *
+ * \return An integer less than, equal to or greater than zero, if \c a is
+ * found to be less than, equal to or greater than \c b, respectively
+ */
+static int dc_version_strcmp(
+  const char *a,
+  const char *b
+) {
+  int diff;
+
+  if (a == NULL)
+    a = "";
+  if (b == NULL)
+    b = "";
+
+  while (*a != '\0' || *b != '\0')
+  {
+    diff = 0;
+
+    while ((*a != '\0' && !dc_version_isdigit(*a)) ||
+      (*b != '\0' && !dc_version_isdigit(*b)))
+    {
+      int ac = dc_version_order(*a);
+      int bc = dc_version_order(*b);
+
+      if (ac != bc)
+        return ac - bc;
+
+      a++;
+      b++;
+    }
+
+    while (*a == '0')
+      a++;
+    while (*b == '0')
+      b++;
+
+    while (dc_version_isdigit(*a) && dc_version_isdigit(*b))
+    {
+      if (diff == 0)
+        diff = *a - *b;
+      a++;
+      b++;
+    }
+
+    if (dc_version_isdigit(*a))
+      return 1;
+    if (dc_version_isdigit(*b))
+      return -1;
+    if (diff != 0)
+      return diff;
+  }
+
+  return 0;
+}
+
+/**
+ * Compare two package versions
+ *
+ * \param[in] a A pointer to the first dcVersion
+ * \param[in] b A pointer to the second dcVersion
+ *
+ * \return An integer less than, equal to or greater than zero, if \c a is
+ * found to be older than, equal to or newer than \c b, respectively
+ */
+int dc_version_compare(
+  const dcVersion *a,
+  const dcVersion *b
+) {
+  int rc;
+
+  assert(a != NULL);
+  assert(b != NULL);
+
+  if (a->epoch != b->epoch)
+    return (a->epoch > b->epoch) ? 1 : -1;
+
+  rc = dc_version_strcmp(a->version, b->version);
+  if (rc != 0)
+    return rc;
+
+  return dc_version_strcmp(a->revision, b->revision);
+}
+
+/** Key byte ending a run of non-digits, which sorts just after \c ~ */
+#define KEY_END   0x02
+
+/**
+ * Append the key of an upstream version or revision (helper function)
+ *
+ * \param[in] p The start of the string
+ * \param[in] end The end of the string
+ * \param[out] buf The key buffer
+ * \param[in] size The size of the key buffer
+ * \param[in] n The number of bytes of key already produced
+ *
+ * \return The number of bytes of key produced, including \c n
+ */
+static size_t dc_version_key_part(
+  const char *p,
+  const char *end,
+  unsigned char *buf,
+  size_t size,
+  size_t n
+) {
+  const char *run;
+  size_t len;
+  unsigned char c;
+  int i;
+
+#define PUT(x) do { if (n < size) buf[n] = (x); n++; } while (0)
+
+  /* the first pair of runs is always present, even if both are empty */
+  do
+  {
+    /* run of non-digits (only the first may be empty) */
+    for (; p < end && !dc_version_isdigit(*p); p++)
+    {
+      c = (unsigned char) *p;
+      if (c == '~')
+        PUT(0x01);
+      else if (dc_version_isalpha(c))
+        PUT(c);
+      else if (c < 0x7f)
+        PUT(0x80 + c);
+      else
+      {
+        /* DEL and non-ASCII bytes sort last, so take a second byte */
+        PUT(0xff);
+        PUT(c - 0x7f);
+      }
+    }
+    PUT(KEY_END);
+
+    /* run of digits, without leading zeros */
+    while (p < end && *p == '0')
+      p++;
+    for (run = p; p < end && dc_version_isdigit(*p); p++)
+      ;
+    len = p - run;
+    if (len < 0xff)
+      PUT((unsigned char) len);
+    else
+    {
+      /* longer runs have a fixed-width big-endian length */
+      PUT(0xff);
+      for (i = 0; i < 8; i++)
+        PUT((unsigned char) ((uint64_t) len >> (56 - 8 * i)));
+    }
+    for (; run < p; run++)
+      PUT(*run);
+  } while (p < end);
+
+  /* the end sorts like an empty run of non-digits */
+  PUT(KEY_END);
+
+#undef PUT
+
+  return n;
+}
+
+/**
+ * Compute the sort key of a version string
+ *
+ * This produces a byte string which sorts (using \c memcmp, with a shorter
+ * key sorting first when one is a prefix of the other) in the same order
+ * as the versions would be sorted by \ref dc_version_compare. See
+ * \ref version.c for details. Example:
+ * \code
+ * unsigned char key[VERSION_KEY_SIZE];
+ * len = dc_version_key("1:2.30-1", key, sizeof(key));
+ * if (len > sizeof(key))
+ *   ... use a larger buffer ...
+ * \endcode
+ *
+ * \param[in] vstring A package version in string format
+ * \param[out] buf The buffer to store the key in (may be \c NULL if \c size
+ * is \c 0)
+ * \param[in] size The size of the buffer
+ *
+ * \return The length of the key. If this is larger than \c size, the key was
+ * truncated and a larger buffer is needed.
+ */
+size_t dc_version_key(
+  const char *vstring,
+  unsigned char *buf,
+  size_t size
+) {
+  const char *colon;
+  const char *hyphen;
+  const char *end;
+  unsigned long epoch = 0;
+  size_t n;
+  int i;
+
+  assert(vstring != NULL);
+  assert(buf != NULL || size == 0);
+
+  end = vstring + strlen(vstring);
+
+  colon = strchr(vstring, ':');
+  if (colon != NULL)
+  {
+    epoch = strtoul(vstring, NULL, 10);
+    vstring = colon + 1;
+  }
+
+  hyphen = strrchr(vstring, '-');
+  if (hyphen == NULL)
+    hyphen = end;
+
+  /* the epoch, as a fixed-width big-endian number */
+  for (i = 0; i < 8; i++)
+  {
+    if ((size_t) i < size)
+      buf[i] = (unsigned char) ((uint64_t) epoch >> (56 - 8 * i));
+  }
+
+  n = dc_version_key_part(vstring, hyphen, buf, size, 8);
+  if (hyphen < end)
+    hyphen++;
+  return dc_version_key_part(hyphen, end, buf, size, n);
+}
+
+/**
+ * Compare two version keys
+ *
+ * \param[in] a The first key, from \ref dc_version_key
+ * \param[in] alen The length of the first key
+ * \param[in] b The second key
+ * \param[in] blen The length of the second key
+ *
+ * \return An integer less than, equal to or greater than zero, if \c a is
+ * found to be older than, equal to or newer than \c b, respectively
+ */
+int dc_version_key_compare(
+  const unsigned char *a,
+  size_t alen,
+  const unsigned char *b,
+  size_t blen
+) {
+  int rc;
+
+  rc = memcmp(a, b, (alen < blen) ? alen : blen);
+  if (rc != 0)
+    return rc;
+
+  return (alen > blen) - (alen < blen);
+}
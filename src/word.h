@@ -0,0 +1,33 @@
+/***************************************************************************
+** The libdebctrl library, this package and its contents (unless explicitly
+** noted otherwise) are licensed under the MIT/X11 License (see the included
+** LICENSE file for copyright information, full terms and conditions).
+****************************************************************************/
+
+/** \file
+ * Word-at-a-time byte tests (internal)
+ * \author Jonathan Yu <jawnsy@cpan.org>
+ *
+ * These test all eight bytes of a 64-bit word at once, for scanning text a
+ * word at a time. They are used by \ref relation.c and \ref serialize.c,
+ * and are not installed.
+ */
+
+#ifndef DEBCTRL_WORD_H
+#define DEBCTRL_WORD_H
+
+#include <debctrl/common.h>
+
+/** Repeat a byte in each byte of a 64-bit word */
+#define REPEAT(c)   (UINT64_C(0x0101010101010101) * (c))
+
+/** Nonzero if any byte of \c x is zero */
+#define HASZERO(x)  (((x) - REPEAT(0x01)) & ~(x) & REPEAT(0x80))
+
+/** Nonzero if any byte of \c x is less than \c n (where n <= 128) */
+#define HASLESS(x, n) (((x) - REPEAT(n)) & ~(x) & REPEAT(0x80))
+
+/** Nonzero if any byte of \c x is equal to \c c */
+#define HASBYTE(x, c) HASZERO((x) ^ REPEAT(c))
+
+#endif /* DEBCTRL_WORD_H */